@@ -0,0 +1,329 @@
+/**
+ * @file base64-test.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Compares each Base64 compaction variant of base64.c supported by the CPU with the scalar
+ * reference. The input is generated from random mixes of alphabet, padding, separator and invalid
+ * characters with every length up to several vector widths and misaligned start addresses, as well
+ * as from encoded data formatted as G-Code thumbnail comment lines with correct and broken padding.
+ * The compacted output, its length and the validity need to match. The output is checked for
+ * writes beyond the input length and compacting in place needs to give the same result.
+ *
+ * Usage: base64-test [-n iterations] [-s seed]
+ *
+ * -n  number of random test cases per variant (defaults to 20000)
+ * -s  seed of the pseudo-random number generator (defaults to 1)
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* the variants are static */
+#include "../src/base64.c"
+
+
+/** Maximum input length in bytes. */
+#define MAX_LENGTH 4096
+
+/** Maximum misalignment of the input start in bytes. */
+#define MAX_OFFSET 64
+
+/** Number of guard bytes after the input length checked for unexpected writes. */
+#define GUARD_SIZE 64
+
+/** Value of the guard bytes. */
+#define GUARD_BYTE 0x5A
+
+
+/** Vectorized compaction function (see b64_compactSse2()). */
+typedef size_t (* tCompactFn)(char *, const char *, const size_t, int *);
+
+
+/** Tested variant. */
+typedef struct {
+	const char * name;         /**< variant name */
+	tCompactFn fn;             /**< compaction function or NULL for b64_compact() */
+	int supported;             /**< 1 if supported by the CPU, else 0 */
+} tVariant;
+
+
+/** Test buffers. */
+typedef struct {
+	char * src;                /**< input */
+	char * ref;                /**< output of the scalar reference */
+	char * dst;                /**< output of the tested variant */
+	char * tmp;                /**< input copy for compacting in place */
+	unsigned char * raw;       /**< data to encode */
+} tBuffers;
+
+
+/** Pseudo-random number generator state (xorshift64). */
+static uint64_t t_rnd = 1;
+
+
+/**
+ * Returns the next pseudo-random number.
+ *
+ * @return pseudo-random number
+ */
+static uint64_t t_next(void) {
+	t_rnd ^= t_rnd << 13;
+	t_rnd ^= t_rnd >> 7;
+	t_rnd ^= t_rnd << 17;
+	return t_rnd;
+}
+
+
+/**
+ * Fills the given buffer with random characters. Each byte is taken from the Base64 alphabet,
+ * the padding, the separators or any other byte value with the given weights.
+ *
+ * @param[out] buf - buffer to fill
+ * @param[in] len - buffer length in bytes
+ * @param[in] weight - weights of alphabet, padding, separator and invalid characters
+ */
+static void t_fill(char * buf, const size_t len, const unsigned weight[4]) {
+	static const char sep[] = "; \t\r\n";
+	const unsigned total = weight[0] + weight[1] + weight[2] + weight[3];
+	for (size_t i = 0; i < len; i++) {
+		const uint64_t r = t_next();
+		unsigned w = (unsigned)(r % total);
+		if (w < weight[0]) {
+			buf[i] = b64_alphabet[(r >> 32) % 64];
+		} else if ((w -= weight[0]) < weight[1]) {
+			buf[i] = '=';
+		} else if ((w -= weight[1]) < weight[2]) {
+			buf[i] = sep[(r >> 32) % (sizeof(sep) - 1)];
+		} else {
+			/* any byte, mostly outside of the alphabet */
+			buf[i] = (char)(r >> 32);
+		}
+	}
+}
+
+
+/**
+ * Formats the encoding of random data as G-Code thumbnail comment lines.
+ *
+ * @param[out] buf - output buffer (at least MAX_LENGTH bytes)
+ * @param[out] raw - encoded random data (at least MAX_LENGTH bytes)
+ * @param[out] rawLen - number of encoded random bytes
+ * @return number of bytes written to the output buffer
+ */
+static size_t t_format(char * buf, unsigned char * raw, size_t * rawLen) {
+	static const char * const eol[] = {"\n", "\r\n"};
+	static const char * const prefix[] = {"; ", ";", ";\t", " ; "};
+	char enc[MAX_LENGTH];
+	const size_t width = 1 + (size_t)(t_next() % 100);
+	const char * lineEnd = eol[t_next() % 2];
+	const char * linePrefix = prefix[t_next() % 4];
+	/* at most 5 bytes of prefix and line end per line */
+	const size_t maxEnc = (MAX_LENGTH - 8) * width / (width + 5);
+	*rawLen = (size_t)(t_next() % (maxEnc / 4 * 3 + 1));
+	for (size_t i = 0; i < *rawLen; i++) raw[i] = (unsigned char)t_next();
+	const size_t encLen = b64_encode(enc, raw, *rawLen);
+	size_t n = 0;
+	for (size_t i = 0; i < encLen; i += width) {
+		const size_t len = PCF_MIN(width, encLen - i);
+		n += (size_t)sprintf(buf + n, "%s", linePrefix);
+		memcpy(buf + n, enc + i, len);
+		n += len;
+		n += (size_t)sprintf(buf + n, "%s", lineEnd);
+	}
+	return n;
+}
+
+
+/**
+ * Compacts the given input with the given variant.
+ *
+ * @param[in] var - variant to use
+ * @param[out] dst - output buffer
+ * @param[in] src - input data
+ * @param[in] len - input length in bytes
+ * @param[out] valid - set to 1 if valid, else 0
+ * @return number of bytes written to the output buffer
+ */
+static size_t t_compact(const tVariant * var, char * dst, const char * src, const size_t len, int * valid) {
+	if (var->fn == NULL) return b64_compact(dst, src, len, valid);
+	int bad = 0;
+	const size_t res = var->fn(dst, src, len, &bad);
+	*valid = (bad == 0 && b64_checkPadding(dst, res) != 0) ? 1 : 0;
+	return res;
+}
+
+
+/**
+ * Checks the given variant against the scalar reference for the given input.
+ *
+ * @param[in] var - variant to check
+ * @param[in,out] b - test buffers with the input at `b->src + offset`
+ * @param[in] offset - misalignment of the input
+ * @param[in] len - input length in bytes
+ * @param[in] expectValid - expected validity or -1 to only compare with the reference
+ * @return 1 on success, else 0
+ */
+static int t_compare(const tVariant * var, tBuffers * b, const size_t offset, const size_t len, const int expectValid) {
+	const char * src = b->src + offset;
+	int refValid, valid;
+	const size_t refLen = b64_compactScalar(b->ref, src, len, &refValid);
+	if (expectValid >= 0 && refValid != expectValid) {
+		fprintf(stderr, "reference: validity %i instead of %i for %zu bytes\n", refValid, expectValid, len);
+		return 0;
+	}
+	/* out of place with guard bytes after the input length */
+	memset(b->dst + offset, GUARD_BYTE, len + GUARD_SIZE);
+	const size_t dstLen = t_compact(var, b->dst + offset, src, len, &valid);
+	if (dstLen != refLen || valid != refValid || memcmp(b->dst + offset, b->ref, refLen) != 0) {
+		fprintf(stderr, "%s: got %zu bytes (valid %i) instead of %zu bytes (valid %i) for %zu bytes at offset %zu\n", var->name, dstLen, valid, refLen, refValid, len, offset);
+		return 0;
+	}
+	for (size_t i = 0; i < GUARD_SIZE; i++) {
+		if ((unsigned char)b->dst[offset + len + i] != GUARD_BYTE) {
+			fprintf(stderr, "%s: wrote beyond the input length for %zu bytes at offset %zu\n", var->name, len, offset);
+			return 0;
+		}
+	}
+	/* in place */
+	memcpy(b->tmp + offset, src, len);
+	const size_t tmpLen = t_compact(var, b->tmp + offset, b->tmp + offset, len, &valid);
+	if (tmpLen != refLen || valid != refValid || memcmp(b->tmp + offset, b->ref, refLen) != 0) {
+		fprintf(stderr, "%s: in place got %zu bytes (valid %i) instead of %zu bytes (valid %i) for %zu bytes at offset %zu\n", var->name, tmpLen, valid, refLen, refValid, len, offset);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Checks the given variant against the scalar reference.
+ *
+ * @param[in] var - variant to check
+ * @param[in,out] b - test buffers
+ * @param[in] iterations - number of random test cases
+ * @return 1 on success, else 0
+ */
+static int t_check(const tVariant * var, tBuffers * b, const unsigned long iterations) {
+	static const unsigned weight[][4] = {
+		{1, 0, 0, 0}, /* alphabet only */
+		{60, 0, 1, 0}, /* few separators */
+		{60, 1, 3, 0}, /* misplaced padding */
+		{60, 0, 3, 1}, /* few invalid characters */
+		{1, 1, 1, 1}, /* anything */
+		{0, 0, 1, 0}, /* separators only */
+		{0, 0, 0, 1} /* invalid only */
+	};
+	/* every length up to several vector widths */
+	for (size_t w = 0; w < (sizeof(weight) / sizeof(*weight)); w++) {
+		for (size_t len = 0; len <= 160; len++) {
+			for (size_t offset = 0; offset < MAX_OFFSET; offset += 5) {
+				t_fill(b->src + offset, len, weight[w]);
+				if (t_compare(var, b, offset, len, -1) == 0) return 0;
+			}
+		}
+	}
+	/* random mixes and lengths */
+	for (unsigned long it = 0; it < iterations; it++) {
+		const size_t offset = (size_t)(t_next() % MAX_OFFSET);
+		const size_t len = (size_t)(t_next() % (MAX_LENGTH + 1));
+		t_fill(b->src + offset, len, weight[t_next() % (sizeof(weight) / sizeof(*weight))]);
+		if (t_compare(var, b, offset, len, -1) == 0) return 0;
+	}
+	/* encoded data with correct and broken padding */
+	for (unsigned long it = 0; it < (iterations / 4); it++) {
+		const size_t offset = (size_t)(t_next() % MAX_OFFSET);
+		size_t rawLen;
+		char * src = b->src + offset;
+		size_t len = t_format(src, b->raw, &rawLen);
+		if (t_compare(var, b, offset, len, 1) == 0) return 0;
+		int valid;
+		const size_t n = t_compact(var, b->dst, src, len, &valid);
+		unsigned char dec[MAX_LENGTH];
+		if (b64_decode(dec, b->dst, n) != rawLen || memcmp(dec, b->raw, rawLen) != 0) {
+			fprintf(stderr, "%s: decoded data differs for %zu bytes at offset %zu\n", var->name, len, offset);
+			return 0;
+		}
+		if (len < 1) continue;
+		/* break a random byte */
+		const size_t pos = (size_t)(t_next() % len);
+		switch (t_next() % 3) {
+		case 0: src[pos] = '='; break;
+		case 1: src[pos] = (char)('~' + (t_next() % 100)); break; /* outside of the alphabet */
+		default: len = pos; break; /* truncate */
+		}
+		if (t_compare(var, b, offset, len, -1) == 0) return 0;
+	}
+	return 1;
+}
+
+
+int main(int argc, char ** argv) {
+	unsigned long iterations = 20000;
+	int res = EXIT_SUCCESS;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+			iterations = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc) {
+			t_rnd = (uint64_t)strtoull(argv[++i], NULL, 10);
+			if (t_rnd == 0) t_rnd = 1;
+		} else {
+			fprintf(stderr, "Usage: %s [-n iterations] [-s seed]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	const tVariant variant[] = {
+#ifdef B64_HAS_SSE2
+		{"SSE2", b64_compactSse2, 1},
+#endif /* B64_HAS_SSE2 */
+#ifdef B64_HAS_X86_DISPATCH
+		{"AVX2", b64_compactAvx2, __builtin_cpu_supports("avx2") ? 1 : 0},
+#endif /* B64_HAS_X86_DISPATCH */
+#ifdef B64_HAS_NEON
+		{"NEON", b64_compactNeon, 1},
+#endif /* B64_HAS_NEON */
+		{"dispatch", NULL, 1}
+	};
+	const size_t size = MAX_OFFSET + MAX_LENGTH + GUARD_SIZE;
+	tBuffers b;
+	b.src = (char *)malloc(size);
+	b.ref = (char *)malloc(size);
+	b.dst = (char *)malloc(size);
+	b.tmp = (char *)malloc(size);
+	b.raw = (unsigned char *)malloc(MAX_LENGTH);
+	if (b.src == NULL || b.ref == NULL || b.dst == NULL || b.tmp == NULL || b.raw == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory.\n");
+		res = EXIT_FAILURE;
+		goto onError;
+	}
+	for (size_t i = 0; i < (sizeof(variant) / sizeof(*variant)); i++) {
+		if (variant[i].supported == 0) {
+			printf("SKIPPED b64_compact %s (not supported by the CPU)\n", variant[i].name);
+		} else if (t_check(variant + i, &b, iterations) != 0) {
+			printf("OK      b64_compact %s\n", variant[i].name);
+		} else {
+			printf("FAILED  b64_compact %s\n", variant[i].name);
+			res = EXIT_FAILURE;
+		}
+	}
+onError:
+	free(b.src);
+	free(b.ref);
+	free(b.dst);
+	free(b.tmp);
+	free(b.raw);
+	return res;
+}
@@ -0,0 +1,464 @@
+/**
+ * @file bench.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Benchmark driver for sm2pspp. Each run processes a fresh copy of the given input file with
+ * warm or cold page cache and reports wall time, CPU time, throughput and peak resident set size
+ * as one JSON object per line on standard output. The wall and CPU time per processing phase
+ * (read, scan, header and body) is taken from the statistics of sm2pspp, which is run with
+ * `--stats-json` for this. A summary line with the median values follows each series of runs.
+ *
+ * Usage: bench [-r runs] [-c warm|cold|both] [-a argument]... <sm2pspp> <file>...
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+
+/** Copy buffer size in bytes. */
+#define COPY_BUFFER_SIZE 0x100000
+
+/** Maximum number of runs per series. */
+#define MAX_RUNS 100
+
+/** Maximum number of arguments passed to sm2pspp. */
+#define MAX_ARGS 32
+
+/** Maximum length of a statistics line of sm2pspp in bytes. */
+#define MAX_STATS_LINE 4096
+
+/** Number of processing phases reported by sm2pspp. */
+#define PHASE_COUNT 4
+
+
+/** Page cache state before each run. */
+typedef enum {
+	CACHE_WARM = 1,
+	CACHE_COLD = 2,
+	CACHE_BOTH = 3
+} tCache;
+
+
+/** Result of a single run. */
+typedef struct {
+	int status;                /**< exit code of sm2pspp or -1 */
+	double wall;               /**< wall time in seconds */
+	double user;               /**< user CPU time in seconds */
+	double sys;                /**< system CPU time in seconds */
+	long maxRss;               /**< peak resident set size in KiB */
+	double phaseWall[PHASE_COUNT]; /**< wall time per processing phase in seconds */
+	double phaseCpu[PHASE_COUNT];  /**< CPU time per processing phase in seconds */
+} tRun;
+
+
+/** Processing phase names as output by sm2pspp `--stats-json`. */
+static const char * b_phaseName[PHASE_COUNT] = {"read", "scan", "header", "body"};
+
+/** Copy buffer shared by all runs. */
+static char * b_buffer = NULL;
+
+
+/**
+ * Writes the given string as JSON string literal to standard output.
+ *
+ * @param[in] str - string to write
+ */
+static void b_jsonString(const char * str) {
+	putchar('"');
+	for (; *str != 0; str++) {
+		const unsigned char c = (unsigned char)(*str);
+		if (c == '"' || c == '\\') {
+			putchar('\\');
+			putchar(c);
+		} else if (c < 0x20) {
+			printf("\\u%04x", (unsigned)c);
+		} else {
+			putchar(c);
+		}
+	}
+	putchar('"');
+}
+
+
+/**
+ * Returns the given time value in seconds.
+ *
+ * @param[in] tv - time value
+ * @return seconds
+ */
+static double b_seconds(const struct timeval * tv) {
+	return (double)tv->tv_sec + ((double)tv->tv_usec / 1000000.0);
+}
+
+
+/**
+ * Creates the work copy of the given input file and prepares the page cache state.
+ *
+ * @param[in] src - input file
+ * @param[in] dst - work copy
+ * @param[in] cache - requested page cache state (CACHE_WARM or CACHE_COLD)
+ * @return 1 on success, 0 on error
+ */
+static int b_prepare(const char * src, const char * dst, const tCache cache) {
+	int res = 0;
+	ssize_t n;
+	const int in = open(src, O_RDONLY);
+	if (in < 0) return 0;
+	const int out = open(dst, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (out < 0) {
+		close(in);
+		return 0;
+	}
+	while ((n = read(in, b_buffer, COPY_BUFFER_SIZE)) > 0) {
+		for (ssize_t i = 0; i < n; ) {
+			const ssize_t w = write(out, b_buffer + i, (size_t)(n - i));
+			if (w < 0) {
+				if (errno == EINTR) continue;
+				goto onError;
+			}
+			i += w;
+		}
+	}
+	if (n < 0 || fsync(out) != 0) goto onError;
+	if (cache == CACHE_COLD) {
+		/* dirty pages are not dropped, hence the fsync() above */
+		if (posix_fadvise(out, 0, 0, POSIX_FADV_DONTNEED) != 0) goto onError;
+	} else {
+		if (lseek(out, 0, SEEK_SET) != 0) goto onError;
+		while ((n = read(out, b_buffer, COPY_BUFFER_SIZE)) > 0);
+		if (n < 0) goto onError;
+	}
+	res = 1;
+onError:
+	close(out);
+	close(in);
+	return res;
+}
+
+
+/**
+ * Parses the time of a processing phase from the given sm2pspp statistics line.
+ *
+ * @param[in] line - JSON statistics line
+ * @param[in] phase - phase name
+ * @param[in] key - time key within the phase object
+ * @param[out] value - receives the time in seconds
+ * @return 1 on success, 0 if not found
+ */
+static int b_parsePhase(const char * line, const char * phase, const char * key, double * value) {
+	char pattern[64];
+	const char * ptr = strstr(line, "\"phases\":{");
+	if (ptr == NULL) return 0;
+	snprintf(pattern, sizeof(pattern), "\"%s\":{", phase);
+	ptr = strstr(ptr, pattern);
+	if (ptr == NULL) return 0;
+	const char * end = strchr(ptr, '}');
+	snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+	ptr = strstr(ptr, pattern);
+	if (ptr == NULL || end == NULL || ptr > end) return 0;
+	char * last;
+	*value = strtod(ptr + strlen(pattern), &last);
+	return (last != ptr + strlen(pattern)) ? 1 : 0;
+}
+
+
+/**
+ * Reads the statistics line from the given standard error output of sm2pspp. All other lines are
+ * passed on to standard error.
+ *
+ * @param[in] log - captured standard error output
+ * @param[out] run - receives the phase times
+ * @return 1 on success, 0 if the statistics line is missing or incomplete
+ */
+static int b_readStats(const char * log, tRun * run) {
+	char line[MAX_STATS_LINE];
+	int res = 0;
+	FILE * fp = fopen(log, "r");
+	if (fp == NULL) return 0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (strncmp(line, "{\"file\":", 8) != 0) {
+			fputs(line, stderr);
+			continue;
+		}
+		res = 1;
+		for (size_t i = 0; i < PHASE_COUNT; i++) {
+			if (b_parsePhase(line, b_phaseName[i], "wall_s", run->phaseWall + i) == 0) res = 0;
+			if (b_parsePhase(line, b_phaseName[i], "cpu_s", run->phaseCpu + i) == 0) res = 0;
+		}
+	}
+	fclose(fp);
+	return res;
+}
+
+
+/**
+ * Runs sm2pspp once for the given file and measures it. The standard error output is captured
+ * in the given log file to obtain the phase times.
+ *
+ * @param[in] argv - null-terminated sm2pspp command-line (first element is the executable)
+ * @param[in] log - log file for the standard error output
+ * @param[out] run - receives the measurement
+ * @return 1 on success, 0 on error
+ */
+static int b_run(char ** argv, const char * log, tRun * run) {
+	struct timespec start, end;
+	struct rusage usage;
+	int status = 0;
+	const int err = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (err < 0) return 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	const pid_t pid = fork();
+	if (pid < 0) {
+		close(err);
+		return 0;
+	}
+	if (pid == 0) {
+		/* child: keep standard output clean for the results */
+		const int null = open("/dev/null", O_WRONLY);
+		if (null >= 0) dup2(null, STDOUT_FILENO);
+		dup2(err, STDERR_FILENO);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+	close(err);
+	while (wait4(pid, &status, 0, &usage) < 0) {
+		if (errno != EINTR) return 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	run->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	run->wall = (double)(end.tv_sec - start.tv_sec) + ((double)(end.tv_nsec - start.tv_nsec) / 1000000000.0);
+	run->user = b_seconds(&(usage.ru_utime));
+	run->sys = b_seconds(&(usage.ru_stime));
+	run->maxRss = usage.ru_maxrss;
+	if (b_readStats(log, run) == 0 && run->status == 0) run->status = -1;
+	return 1;
+}
+
+
+/**
+ * Compares two doubles for qsort().
+ *
+ * @param[in] a - left-hand value
+ * @param[in] b - right-hand value
+ * @return -1, 0 or 1
+ */
+static int b_compare(const void * a, const void * b) {
+	const double lhs = *((const double *)a);
+	const double rhs = *((const double *)b);
+	return (lhs < rhs) ? -1 : ((lhs > rhs) ? 1 : 0);
+}
+
+
+/**
+ * Returns the median of the given values. The values are sorted in place.
+ *
+ * @param[in,out] values - values
+ * @param[in] count - number of values
+ * @return median
+ */
+static double b_median(double * values, const size_t count) {
+	qsort(values, count, sizeof(*values), b_compare);
+	if ((count % 2) != 0) return values[count / 2];
+	return (values[(count / 2) - 1] + values[count / 2]) / 2.0;
+}
+
+
+/**
+ * Writes the common JSON fields of a result line.
+ *
+ * @param[in] type - record type
+ * @param[in] file - input file
+ * @param[in] size - input file size in bytes
+ * @param[in] cache - page cache state
+ * @param[in] options - extra sm2pspp options
+ */
+static void b_jsonHead(const char * type, const char * file, const uint64_t size, const tCache cache, const char * options) {
+	printf("{\"type\":\"%s\",\"file\":", type);
+	b_jsonString(file);
+	printf(",\"bytes\":%llu,\"cache\":\"%s\",\"options\":", (unsigned long long)size, (cache == CACHE_COLD) ? "cold" : "warm");
+	b_jsonString(options);
+}
+
+
+/**
+ * Writes the given phase times as JSON field.
+ *
+ * @param[in] wall - wall time per phase in seconds
+ * @param[in] cpu - CPU time per phase in seconds
+ */
+static void b_jsonPhases(const double * wall, const double * cpu) {
+	printf(",\"phases\":{");
+	for (size_t i = 0; i < PHASE_COUNT; i++) {
+		printf("%s\"%s\":{\"wall_s\":%.6f,\"cpu_s\":%.6f}", (i > 0) ? "," : "", b_phaseName[i], wall[i], cpu[i]);
+	}
+	putchar('}');
+}
+
+
+/**
+ * Runs a series of benchmarks for the given file and cache state.
+ *
+ * @param[in,out] argv - sm2pspp command-line, the last argument is replaced by the work copy
+ * @param[in] argc - number of arguments in argv
+ * @param[in] file - input file
+ * @param[in] cache - page cache state
+ * @param[in] runs - number of runs
+ * @param[in] options - extra sm2pspp options for the output
+ * @return 1 on success, 0 on error
+ */
+static int b_series(char ** argv, const int argc, const char * file, const tCache cache, const size_t runs, const char * options) {
+	struct stat st;
+	double wall[MAX_RUNS], user[MAX_RUNS], sys[MAX_RUNS];
+	double phaseWall[PHASE_COUNT][MAX_RUNS], phaseCpu[PHASE_COUNT][MAX_RUNS];
+	double mPhaseWall[PHASE_COUNT], mPhaseCpu[PHASE_COUNT];
+	long maxRss = 0;
+	size_t ok = 0;
+	const size_t workLen = strlen(file) + 11;
+	char * work = (char *)malloc(2 * workLen);
+	if (work == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory.\n");
+		return 0;
+	}
+	char * log = work + workLen;
+	snprintf(work, workLen, "%s.bench", file);
+	snprintf(log, workLen, "%s.bench.log", file);
+	if (stat(file, &st) != 0) {
+		fprintf(stderr, "Error: Failed to get size of '%s'.\n", file);
+		free(work);
+		return 0;
+	}
+	const uint64_t size = (uint64_t)st.st_size;
+	argv[argc - 1] = work;
+	for (size_t r = 0; r < runs; r++) {
+		tRun run;
+		if (b_prepare(file, work, cache) == 0) {
+			fprintf(stderr, "Error: Failed to prepare work copy '%s'.\n", work);
+			break;
+		}
+		if (b_run(argv, log, &run) == 0) {
+			fprintf(stderr, "Error: Failed to run '%s'.\n", argv[0]);
+			break;
+		}
+		const double mbs = (run.wall > 0.0) ? ((double)size / 1048576.0) / run.wall : 0.0;
+		b_jsonHead("run", file, size, cache, options);
+		printf(",\"run\":%u,\"status\":%i,\"wall_s\":%.6f,\"user_s\":%.6f,\"sys_s\":%.6f,\"mb_s\":%.3f,\"max_rss_kib\":%li",
+			(unsigned)(r + 1), run.status, run.wall, run.user, run.sys, mbs, run.maxRss);
+		if (run.status == 0) b_jsonPhases(run.phaseWall, run.phaseCpu);
+		printf("}\n");
+		fflush(stdout);
+		if (run.status != 0) continue;
+		wall[ok] = run.wall;
+		user[ok] = run.user;
+		sys[ok] = run.sys;
+		for (size_t i = 0; i < PHASE_COUNT; i++) {
+			phaseWall[i][ok] = run.phaseWall[i];
+			phaseCpu[i][ok] = run.phaseCpu[i];
+		}
+		if (run.maxRss > maxRss) maxRss = run.maxRss;
+		ok++;
+	}
+	unlink(work);
+	unlink(log);
+	free(work);
+	if (ok > 0) {
+		const double mWall = b_median(wall, ok);
+		const double mbs = (mWall > 0.0) ? ((double)size / 1048576.0) / mWall : 0.0;
+		b_jsonHead("median", file, size, cache, options);
+		printf(",\"runs\":%u,\"wall_min_s\":%.6f,\"wall_s\":%.6f,\"user_s\":%.6f,\"sys_s\":%.6f,\"mb_s\":%.3f,\"max_rss_kib\":%li",
+			(unsigned)ok, wall[0], mWall, b_median(user, ok), b_median(sys, ok), mbs, maxRss);
+		for (size_t i = 0; i < PHASE_COUNT; i++) {
+			mPhaseWall[i] = b_median(phaseWall[i], ok);
+			mPhaseCpu[i] = b_median(phaseCpu[i], ok);
+		}
+		b_jsonPhases(mPhaseWall, mPhaseCpu);
+		printf("}\n");
+		fflush(stdout);
+	}
+	return (ok == runs) ? 1 : 0;
+}
+
+
+int main(int argc, char ** argv) {
+	int res = EXIT_SUCCESS;
+	int argi = 1;
+	size_t runs = 3;
+	tCache cache = CACHE_BOTH;
+	char * args[MAX_ARGS + 4];
+	int argCount = 1;
+	char options[1024] = "";
+
+	for (; argi < argc && argv[argi][0] == '-'; argi++) {
+		if (strcmp(argv[argi], "--") == 0) {
+			argi++;
+			break;
+		}
+		if ((argi + 1) >= argc) goto onUsage;
+		if (strcmp(argv[argi], "-r") == 0) {
+			runs = (size_t)strtoul(argv[++argi], NULL, 10);
+			if (runs < 1 || runs > MAX_RUNS) goto onUsage;
+		} else if (strcmp(argv[argi], "-c") == 0) {
+			argi++;
+			if (strcmp(argv[argi], "warm") == 0) {
+				cache = CACHE_WARM;
+			} else if (strcmp(argv[argi], "cold") == 0) {
+				cache = CACHE_COLD;
+			} else if (strcmp(argv[argi], "both") == 0) {
+				cache = CACHE_BOTH;
+			} else {
+				goto onUsage;
+			}
+		} else if (strcmp(argv[argi], "-a") == 0) {
+			if (argCount > MAX_ARGS) goto onUsage;
+			args[argCount++] = argv[++argi];
+			if ((strlen(options) + strlen(argv[argi]) + 2) > sizeof(options)) goto onUsage;
+			if (options[0] != 0) strcat(options, " ");
+			strcat(options, argv[argi]);
+		} else {
+			goto onUsage;
+		}
+	}
+	if ((argc - argi) < 2) goto onUsage;
+	args[0] = argv[argi++];
+	args[argCount++] = (char *)"--stats-json"; /* phase times */
+	args[argCount++] = NULL; /* replaced by the work copy */
+	args[argCount] = NULL;
+	b_buffer = (char *)malloc(COPY_BUFFER_SIZE);
+	if (b_buffer == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory.\n");
+		return EXIT_FAILURE;
+	}
+	for (; argi < argc; argi++) {
+		if ((cache & CACHE_WARM) != 0 && b_series(args, argCount, argv[argi], CACHE_WARM, runs, options) == 0) res = EXIT_FAILURE;
+		if ((cache & CACHE_COLD) != 0 && b_series(args, argCount, argv[argi], CACHE_COLD, runs, options) == 0) res = EXIT_FAILURE;
+	}
+	free(b_buffer);
+	return res;
+onUsage:
+	fprintf(stderr, "Usage: %s [-r runs] [-c warm|cold|both] [-a argument]... <sm2pspp> <file>...\n", argv[0]);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file fwsim.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Marlin-like firmware simulator on a pseudo-terminal for testing sm2pspp --stream. The slave side
+ * of the pseudo-terminal is made available via the given symbolic link. Received lines are
+ * checked for line number and checksum like Marlin does and answered with "Resend:" and "ok" on
+ * errors. Valid commands are queued in a command buffer of the given size and answered with "ok"
+ * after the given execution time each. Further input is only read while the command buffer has
+ * space. The accepted commands are written without line number and checksum to the output file.
+ * Statistics are written to standard error on SIGINT or SIGTERM.
+ *
+ * Usage: fwsim [-b commands] [-t microseconds] [-e n] [-o output] <link>
+ *
+ * -b  command buffer size (defaults to 4)
+ * -t  execution time per command (defaults to 200)
+ * -e  corrupt one in n received lines on average to provoke resends (defaults to 0 for never)
+ * -o  file receiving the accepted commands
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+/* needed for posix_openpt() and ppoll() */
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/** Receive buffer size in bytes (Marlin RX_BUFFER_SIZE). */
+#define RX_BUFFER_SIZE 128
+
+/** Maximum line length in bytes including the line end (Marlin MAX_CMD_SIZE). */
+#define MAX_CMD_SIZE 96
+
+/** Maximum command buffer size. */
+#define MAX_BUFSIZE 256
+
+
+/** Simulator state. */
+typedef struct {
+	int master;                /**< master side of the pseudo-terminal */
+	FILE * out;                /**< accepted commands or NULL */
+	size_t bufsize;            /**< command buffer size */
+	size_t queued;             /**< number of commands in the command buffer */
+	uint64_t execTime;         /**< execution time per command in microseconds */
+	uint64_t due;              /**< monotonic time in microseconds at which the current command finishes */
+	unsigned long corrupt;     /**< corrupt one in n received lines on average (0 for never) */
+	uint64_t rnd;              /**< pseudo-random number generator state (xorshift64) */
+	long lastN;                /**< last accepted line number */
+	char rx[RX_BUFFER_SIZE];   /**< received data */
+	size_t rxLen;              /**< number of bytes in rx */
+	char line[MAX_CMD_SIZE];   /**< current line */
+	size_t lineLen;            /**< length of the current line (may exceed MAX_CMD_SIZE) */
+	/* statistics */
+	unsigned long received;    /**< number of received lines */
+	unsigned long accepted;    /**< number of accepted commands */
+	unsigned long checksumErrors; /**< number of lines with checksum errors */
+	unsigned long lineErrors;  /**< number of lines with unexpected line number */
+	unsigned long idle;        /**< number of times the command buffer ran empty */
+} tSim;
+
+
+/** Set by the signal handler to stop the simulation. */
+static volatile sig_atomic_t f_stop = 0;
+
+
+/**
+ * Signal handler to stop the simulation.
+ *
+ * @param[in] sig - signal number
+ */
+static void f_onStop(int sig) {
+	(void)sig;
+	f_stop = 1;
+}
+
+
+/**
+ * Returns the monotonic time in microseconds.
+ *
+ * @return time in microseconds
+ */
+static uint64_t f_nowUs(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)(now.tv_sec) * 1000000) + ((uint64_t)(now.tv_nsec) / 1000);
+}
+
+
+/**
+ * Writes the given response to the host.
+ *
+ * @param[in] sim - simulator state
+ * @param[in] str - response
+ */
+static void f_respond(tSim * sim, const char * str) {
+	size_t len = strlen(str);
+	while (len > 0) {
+		const ssize_t got = write(sim->master, str, len);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return;
+		str += got;
+		len -= (size_t)got;
+	}
+}
+
+
+/**
+ * Rejects the current line and requests the next expected line again like Marlin does.
+ *
+ * @param[in] sim - simulator state
+ * @param[in] error - error text
+ */
+static void f_reject(tSim * sim, const char * error) {
+	char buf[160];
+	snprintf(buf, sizeof(buf), "Error:%s, Last Line: %ld\nResend: %ld\nok\n", error, sim->lastN, sim->lastN + 1);
+	f_respond(sim, buf);
+}
+
+
+/**
+ * Checks the given received line and queues the command if valid.
+ *
+ * @param[in,out] sim - simulator state
+ * @param[in,out] line - null-terminated line
+ */
+static void f_handleLine(tSim * sim, char * line) {
+	char * cmd = line;
+	char * star;
+	long n = -1;
+	sim->received++;
+	if (sim->corrupt > 0 && line[0] != 0) {
+		/* a fixed period could hit the same resent line over and over */
+		sim->rnd ^= sim->rnd << 13;
+		sim->rnd ^= sim->rnd >> 7;
+		sim->rnd ^= sim->rnd << 17;
+		if ((sim->rnd % sim->corrupt) == 0) line[strlen(line) / 2] ^= 0x20;
+	}
+	while (*cmd == ' ') cmd++;
+	if (*cmd == 0) return;
+	if (*cmd == 'N') {
+		unsigned char checksum = 0;
+		n = strtol(cmd + 1, &cmd, 10);
+		star = strchr(line, '*');
+		if (star == NULL) {
+			sim->checksumErrors++;
+			f_reject(sim, "No Checksum with line number");
+			return;
+		}
+		for (const char * ptr = line; ptr < star; ptr++) checksum = (unsigned char)(checksum ^ (unsigned char)(*ptr));
+		if (strtol(star + 1, NULL, 10) != (long)checksum) {
+			sim->checksumErrors++;
+			f_reject(sim, "checksum mismatch");
+			return;
+		}
+		*star = 0;
+		while (*cmd == ' ') cmd++;
+		if (strncmp(cmd, "M110", 4) != 0 && n != (sim->lastN + 1)) {
+			sim->lineErrors++;
+			f_reject(sim, "Line Number is not Last Line Number+1");
+			return;
+		}
+		sim->lastN = n;
+		if (strncmp(cmd, "M110", 4) == 0) {
+			const char * param = strchr(cmd + 4, 'N');
+			if (param != NULL) sim->lastN = strtol(param + 1, NULL, 10);
+		}
+	}
+	if (sim->out != NULL) fprintf(sim->out, "%s\n", cmd);
+	if (sim->queued == 0) sim->due = f_nowUs() + sim->execTime;
+	sim->queued++;
+	sim->accepted++;
+}
+
+
+/**
+ * Moves complete lines from the receive buffer into the command buffer while it has space.
+ *
+ * @param[in,out] sim - simulator state
+ */
+static void f_parse(tSim * sim) {
+	size_t i = 0;
+	for (; i < sim->rxLen && sim->queued < sim->bufsize; i++) {
+		const char ch = sim->rx[i];
+		if (ch == '\n' || ch == '\r') {
+			if (sim->lineLen >= MAX_CMD_SIZE) {
+				sim->received++;
+				sim->checksumErrors++;
+				f_reject(sim, "Line too long");
+			} else {
+				sim->line[sim->lineLen] = 0;
+				f_handleLine(sim, sim->line);
+			}
+			sim->lineLen = 0;
+		} else {
+			if (sim->lineLen < (MAX_CMD_SIZE - 1)) sim->line[sim->lineLen] = ch;
+			sim->lineLen++;
+		}
+	}
+	sim->rxLen -= i;
+	memmove(sim->rx, sim->rx + i, sim->rxLen);
+}
+
+
+/**
+ * Finishes the current command if its execution time elapsed.
+ *
+ * @param[in,out] sim - simulator state
+ */
+static void f_execute(tSim * sim) {
+	const uint64_t now = f_nowUs();
+	if (sim->queued == 0 || now < sim->due) return;
+	sim->queued--;
+	f_respond(sim, "ok\n");
+	if (sim->queued > 0) {
+		sim->due = now + sim->execTime;
+	} else {
+		sim->idle++;
+	}
+}
+
+
+int main(int argc, char ** argv) {
+	int res = EXIT_FAILURE;
+	int argi = 1;
+	int slave = -1;
+	const char * outFile = NULL;
+	const char * linkPath = NULL;
+	struct termios tio;
+	struct sigaction sa;
+	tSim sim;
+	memset(&sim, 0, sizeof(sim));
+	sim.master = -1;
+	sim.bufsize = 4;
+	sim.execTime = 200;
+	sim.rnd = UINT64_C(0x2545F4914F6CDD1D);
+
+	for (; argi < argc && argv[argi][0] == '-'; argi++) {
+		if ((argi + 1) >= argc) goto onUsage;
+		if (strcmp(argv[argi], "-b") == 0) {
+			sim.bufsize = (size_t)strtoul(argv[++argi], NULL, 10);
+			if (sim.bufsize < 1 || sim.bufsize > MAX_BUFSIZE) goto onUsage;
+		} else if (strcmp(argv[argi], "-t") == 0) {
+			sim.execTime = (uint64_t)strtoull(argv[++argi], NULL, 10);
+		} else if (strcmp(argv[argi], "-e") == 0) {
+			sim.corrupt = strtoul(argv[++argi], NULL, 10);
+		} else if (strcmp(argv[argi], "-o") == 0) {
+			outFile = argv[++argi];
+		} else {
+			goto onUsage;
+		}
+	}
+	if ((argc - argi) != 1) goto onUsage;
+	linkPath = argv[argi];
+
+	/* create the pseudo-terminal; the slave side is kept open to survive host reconnects */
+	sim.master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (sim.master < 0 || grantpt(sim.master) != 0 || unlockpt(sim.master) != 0 || ptsname(sim.master) == NULL) {
+		fprintf(stderr, "Error: Failed to create pseudo-terminal.\n");
+		goto onError;
+	}
+	slave = open(ptsname(sim.master), O_RDWR | O_NOCTTY);
+	if (slave < 0 || tcgetattr(slave, &tio) != 0) {
+		fprintf(stderr, "Error: Failed to open pseudo-terminal.\n");
+		goto onError;
+	}
+	tio.c_iflag &= (tcflag_t)~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+	tio.c_oflag &= (tcflag_t)~OPOST;
+	tio.c_lflag &= (tcflag_t)~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+	tio.c_cflag &= (tcflag_t)~(CSIZE | PARENB);
+	tio.c_cflag |= CS8;
+	tcsetattr(slave, TCSANOW, &tio);
+	if (outFile != NULL) {
+		sim.out = fopen(outFile, "w");
+		if (sim.out == NULL) {
+			fprintf(stderr, "Error: Failed to create output file '%s'.\n", outFile);
+			goto onError;
+		}
+	}
+	unlink(linkPath);
+	if (symlink(ptsname(sim.master), linkPath) != 0) {
+		fprintf(stderr, "Error: Failed to create link '%s'.\n", linkPath);
+		linkPath = NULL;
+		goto onError;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = f_onStop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (f_stop == 0) {
+		struct pollfd pfd;
+		struct timespec timeout = {1, 0};
+		f_execute(&sim);
+		f_parse(&sim);
+		if (sim.queued > 0) {
+			const uint64_t now = f_nowUs();
+			const uint64_t wait = (sim.due > now) ? sim.due - now : 0;
+			timeout.tv_sec = (time_t)(wait / 1000000);
+			timeout.tv_nsec = (long)((wait % 1000000) * 1000);
+		}
+		/* input is only read while the command buffer has space */
+		pfd.fd = sim.master;
+		pfd.events = (sim.queued < sim.bufsize && sim.rxLen < sizeof(sim.rx)) ? POLLIN : 0;
+		pfd.revents = 0;
+		const int ready = ppoll(&pfd, 1, &timeout, NULL);
+		if (ready < 0 && errno != EINTR) break;
+		if (ready > 0 && (pfd.revents & POLLIN) != 0) {
+			const ssize_t got = read(sim.master, sim.rx + sim.rxLen, sizeof(sim.rx) - sim.rxLen);
+			if (got > 0) sim.rxLen += (size_t)got;
+		}
+	}
+	fprintf(stderr, "received %lu lines, accepted %lu commands, %lu checksum errors, %lu line number errors, buffer ran empty %lu times\n",
+		sim.received, sim.accepted, sim.checksumErrors, sim.lineErrors, sim.idle
+	);
+	res = EXIT_SUCCESS;
+onError:
+	if (linkPath != NULL) unlink(linkPath);
+	if (sim.out != NULL && fclose(sim.out) != 0) res = EXIT_FAILURE;
+	if (slave >= 0) close(slave);
+	if (sim.master >= 0) close(sim.master);
+	return res;
+onUsage:
+	fprintf(stderr, "Usage: %s [-b commands] [-t microseconds] [-e n] [-o output] <link>\n", argv[0]);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,459 @@
+/**
+ * @file gcodegen.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Synthetic PrusaSlicer G-Code generator for benchmarking. The given template (see template.gcode)
+ * provides the header with thumbnail and the trailing configuration block. A deterministic layer
+ * by layer tool path is inserted in between until the requested output size is reached.
+ *
+ * Usage: gcodegen [-s seed] <template> <size>[K|M|G|T] <output>
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/** Output buffer size in bytes. */
+#define OUT_BUFFER_SIZE 0x100000
+
+/** Number of extrusion moves per layer. */
+#define LAYER_MOVES 2000
+
+/** Approximate number of bytes per layer. Used to estimate max_z and the progress. */
+#define LAYER_BYTES (LAYER_MOVES * 29)
+
+/** Layer height in micrometers. */
+#define LAYER_HEIGHT 200
+
+/** Tool path boundaries in micrometers. */
+#define MIN_XY 20000
+#define MAX_X 300000
+#define MAX_Y 330000
+
+
+/** Output stream with byte accounting. */
+typedef struct {
+	FILE * fp;                 /**< output file */
+	char * buf;                /**< output buffer */
+	size_t used;               /**< bytes used in buffer */
+	uint64_t total;            /**< total bytes written */
+	int error;                 /**< set on write error */
+} tOutput;
+
+
+/** Deterministic tool path state. */
+typedef struct {
+	uint64_t rnd;              /**< xorshift64 state */
+	int64_t x;                 /**< current X position in micrometers */
+	int64_t y;                 /**< current Y position in micrometers */
+	int64_t e;                 /**< current extruder position in 10 nanometers */
+	int64_t layer;             /**< current layer number */
+} tPath;
+
+
+/** Extrusion types emitted per layer with their feed rate in mm/min. */
+static const struct {
+	const char * name;
+	int feed;
+} g_types[] = {
+	{"External perimeter", 900},
+	{"Perimeter", 1200},
+	{"Internal infill", 3000},
+	{"Solid infill", 1200},
+	{"Top solid infill", 900},
+	{"Gap fill", 1200}
+};
+
+
+/** Start G-Code emitted in front of the first layer. */
+static const char g_startGcode[] =
+	"M73 P0 R360\n"
+	"M201 X1000 Y1000 Z100 E10000 ; sets maximum accelerations, mm/sec^2\n"
+	"M203 X150 Y150 Z50 E25 ; sets maximum feedrates, mm/sec\n"
+	"M204 P1000 R1000 T1000 ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n"
+	"M205 X10.00 Y10.00 Z0.20 E2.50 ; sets the jerk limits, mm/sec\n"
+	"M205 S0 T0 ; sets the minimum extruding and travel feed rate, mm/sec\n"
+	"M107\n"
+	";TYPE:Custom\n"
+	"M82 ;absolute extrusion mode\n"
+	";Start GCode begin\n"
+	"; Required for dimensions estimate for sm2pspp\n"
+	"; max_x = 300\n"
+	"; max_y = 330\n";
+
+
+/** End G-Code emitted after the last layer. */
+static const char g_endGcode[] =
+	"M107\n"
+	";TYPE:Custom\n"
+	"; Filament-specific end gcode \n"
+	";END gcode for filament\n"
+	";End GCode begin\n"
+	"M104 S0 ;extruder heater off\n"
+	"M140 S0 ;heated bed heater off (if you have it)\n"
+	"G90 ;absolute positioning\n"
+	"G92 E0\n"
+	"M73 P100 R0\n";
+
+
+/**
+ * Flushes the output buffer.
+ *
+ * @param[in,out] out - output stream
+ */
+static void g_flush(tOutput * out) {
+	if (out->used > 0 && fwrite(out->buf, 1, out->used, out->fp) != out->used) out->error = 1;
+	out->used = 0;
+}
+
+
+/**
+ * Appends the given data to the output.
+ *
+ * @param[in,out] out - output stream
+ * @param[in] str - data
+ * @param[in] len - data length in bytes
+ */
+static void g_write(tOutput * out, const char * str, const size_t len) {
+	if ((OUT_BUFFER_SIZE - out->used) < len) {
+		g_flush(out);
+		if (len > OUT_BUFFER_SIZE) {
+			if (fwrite(str, 1, len, out->fp) != len) out->error = 1;
+			out->total += (uint64_t)len;
+			return;
+		}
+	}
+	memcpy(out->buf + out->used, str, len);
+	out->used += len;
+	out->total += (uint64_t)len;
+}
+
+
+/**
+ * Appends the given null-terminated string to the output.
+ *
+ * @param[in,out] out - output stream
+ * @param[in] str - string
+ */
+static void g_puts(tOutput * out, const char * str) {
+	g_write(out, str, strlen(str));
+}
+
+
+/**
+ * Formats the given fixed-point value with the given number of decimal places. Trailing zeros
+ * of the fraction are omitted like PrusaSlicer does.
+ *
+ * @param[out] ptr - output pointer (needs space for at least 24 characters)
+ * @param[in] value - fixed-point value
+ * @param[in] decimals - number of decimal places in value (1 to 6)
+ * @return pointer past the last written character
+ */
+static char * g_fixed(char * ptr, int64_t value, const int decimals) {
+	static const int64_t scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+	char tmp[24];
+	size_t n = 0;
+	if (value < 0) {
+		*ptr++ = '-';
+		value = -value;
+	}
+	int64_t frac = value % scale[decimals];
+	value /= scale[decimals];
+	do {
+		tmp[n++] = (char)('0' + (value % 10));
+		value /= 10;
+	} while (value > 0);
+	while (n > 0) *ptr++ = tmp[--n];
+	if (frac != 0) {
+		int digits = decimals;
+		while ((frac % 10) == 0) {
+			frac /= 10;
+			digits--;
+		}
+		*ptr++ = '.';
+		for (int i = digits - 1; i >= 0; i--) {
+			ptr[i] = (char)('0' + (frac % 10));
+			frac /= 10;
+		}
+		ptr += digits;
+	}
+	return ptr;
+}
+
+
+/**
+ * Returns the next pseudo random number (xorshift64).
+ *
+ * @param[in,out] path - tool path state
+ * @param[in] range - upper limit (exclusive)
+ * @return random number in the range [0, range)
+ */
+static int64_t g_random(tPath * path, const int64_t range) {
+	path->rnd ^= path->rnd << 13;
+	path->rnd ^= path->rnd >> 7;
+	path->rnd ^= path->rnd << 17;
+	return (int64_t)(path->rnd % (uint64_t)range);
+}
+
+
+/**
+ * Writes a single G1 move to a random nearby position.
+ *
+ * @param[in,out] out - output stream
+ * @param[in,out] path - tool path state
+ * @param[in] extrude - extrude while moving?
+ * @param[in] feed - feed rate in mm/min or 0 to omit
+ */
+static void g_move(tOutput * out, tPath * path, const int extrude, const int feed) {
+	char line[96];
+	char * ptr = line;
+	const int64_t step = extrude ? 20000 : 80000;
+	int64_t dx = g_random(path, 2 * step + 1) - step;
+	int64_t dy = g_random(path, 2 * step + 1) - step;
+	if ((path->x + dx) < MIN_XY || (path->x + dx) > MAX_X) dx = -dx;
+	if ((path->y + dy) < MIN_XY || (path->y + dy) > MAX_Y) dy = -dy;
+	path->x += dx;
+	path->y += dy;
+	memcpy(ptr, "G1 X", 4);
+	ptr = g_fixed(ptr + 4, path->x, 3);
+	memcpy(ptr, " Y", 2);
+	ptr = g_fixed(ptr + 2, path->y, 3);
+	if (extrude) {
+		/* about 0.033 mm filament per mm path (0.45 x 0.2 mm line with 1.75 mm filament) */
+		path->e += ((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy)) * 33 / 10 + 1;
+		memcpy(ptr, " E", 2);
+		ptr = g_fixed(ptr + 2, path->e, 5);
+	}
+	if (feed > 0) {
+		memcpy(ptr, " F", 2);
+		ptr = g_fixed(ptr + 2, (int64_t)feed, 0);
+	}
+	*ptr++ = '\n';
+	g_write(out, line, (size_t)(ptr - line));
+}
+
+
+/**
+ * Writes a complete layer including layer change, retraction and extrusion moves.
+ *
+ * @param[in,out] out - output stream
+ * @param[in,out] path - tool path state
+ * @param[in] progress - print progress in percent
+ * @param[in] remaining - remaining print time in minutes
+ */
+static void g_layer(tOutput * out, tPath * path, const int progress, const int remaining) {
+	char line[96];
+	char * ptr;
+	const int64_t z = (path->layer + 1) * LAYER_HEIGHT;
+	g_puts(out, ";LAYER_CHANGE\n;Z:");
+	ptr = g_fixed(line, z, 3);
+	*ptr++ = '\n';
+	g_write(out, line, (size_t)(ptr - line));
+	g_puts(out, ";HEIGHT:0.2\n");
+	ptr = line + sprintf(line, "M73 P%i R%i\n", progress, remaining);
+	g_write(out, line, (size_t)(ptr - line));
+	memcpy(line, "G1 E", 4);
+	ptr = g_fixed(line + 4, path->e - 500000, 5);
+	memcpy(ptr, " F3600\nG1 Z", 11);
+	ptr = g_fixed(ptr + 11, z, 3);
+	memcpy(ptr, " F9000\n", 7);
+	ptr += 7;
+	g_write(out, line, (size_t)(ptr - line));
+	g_move(out, path, 0, 4200);
+	memcpy(line, "G1 E", 4);
+	ptr = g_fixed(line + 4, path->e, 5);
+	memcpy(ptr, " F3600\n", 7);
+	ptr += 7;
+	g_write(out, line, (size_t)(ptr - line));
+	for (size_t t = 0; t < (sizeof(g_types) / sizeof(*g_types)); t++) {
+		ptr = line + sprintf(line, ";TYPE:%s\n;WIDTH:0.45\nG1 F%i\n", g_types[t].name, g_types[t].feed);
+		g_write(out, line, (size_t)(ptr - line));
+		for (size_t i = 0; i < (LAYER_MOVES / (sizeof(g_types) / sizeof(*g_types))); i++) {
+			g_move(out, path, 1, 0);
+		}
+	}
+	path->layer++;
+}
+
+
+/**
+ * Parses a size value with optional binary suffix (K, M, G or T).
+ *
+ * @param[in] str - string to parse
+ * @param[out] size - receives the parsed size
+ * @return 1 on success, 0 on error
+ */
+static int g_parseSize(const char * str, uint64_t * size) {
+	char * end = NULL;
+	const unsigned long long value = strtoull(str, &end, 10);
+	int shift = 0;
+	if (end == str) return 0;
+	switch (*end) {
+	case 'T': shift += 10; /* fall-through */
+	case 'G': shift += 10; /* fall-through */
+	case 'M': shift += 10; /* fall-through */
+	case 'K': shift += 10; end++; break;
+	default: break;
+	}
+	if (*end != 0 || value == 0) return 0;
+	*size = (uint64_t)value << shift;
+	return 1;
+}
+
+
+/**
+ * Reads the complete file into memory.
+ *
+ * @param[in] path - file path
+ * @param[out] len - receives the file size in bytes
+ * @return allocated file content or NULL on error
+ */
+static char * g_readFile(const char * path, size_t * len) {
+	char * res = NULL;
+	size_t size = 0;
+	size_t cap = 0;
+	FILE * fp = fopen(path, "rb");
+	if (fp == NULL) return NULL;
+	for (;;) {
+		if (size == cap) {
+			cap = (cap > 0) ? cap * 2 : 0x10000;
+			char * newRes = (char *)realloc(res, cap);
+			if (newRes == NULL) {
+				free(res);
+				res = NULL;
+				break;
+			}
+			res = newRes;
+		}
+		const size_t n = fread(res + size, 1, cap - size, fp);
+		if (n == 0) break;
+		size += n;
+	}
+	if (res != NULL && ferror(fp) != 0) {
+		free(res);
+		res = NULL;
+	}
+	fclose(fp);
+	*len = size;
+	return res;
+}
+
+
+/**
+ * Returns the offset at which the tool path is inserted into the template. This is after the last
+ * empty line in front of the first "; filament used" line, i.e. before the end G-Code.
+ *
+ * @param[in] tpl - template content
+ * @param[in] len - template length in bytes
+ * @return insertion offset
+ */
+static size_t g_splitOffset(const char * tpl, const size_t len) {
+	static const char needle[] = "\n; filament used";
+	size_t tail = len;
+	for (size_t i = 0; (i + sizeof(needle) - 1) <= len; i++) {
+		if (memcmp(tpl + i, needle, sizeof(needle) - 1) == 0) {
+			tail = i + 1;
+			break;
+		}
+	}
+	if (tail >= len) return len;
+	for (size_t i = tail; i > 1; i--) {
+		if (tpl[i - 1] == '\n' && tpl[i - 2] == '\n') return i;
+	}
+	return tail;
+}
+
+
+int main(int argc, char ** argv) {
+	int res = EXIT_FAILURE;
+	int argi = 1;
+	uint64_t size = 0;
+	size_t tplLen = 0;
+	char * tpl = NULL;
+	tOutput out;
+	tPath path;
+	memset(&out, 0, sizeof(out));
+	memset(&path, 0, sizeof(path));
+	path.rnd = UINT64_C(0x2545F4914F6CDD1D);
+	path.x = MAX_X / 2;
+	path.y = MAX_Y / 2;
+
+	if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+		path.rnd = (uint64_t)strtoull(argv[2], NULL, 0);
+		if (path.rnd == 0) path.rnd = 1;
+		argi += 2;
+	}
+	if ((argc - argi) != 3) {
+		fprintf(stderr, "Usage: %s [-s seed] <template> <size>[K|M|G|T] <output>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (g_parseSize(argv[argi + 1], &size) == 0) {
+		fprintf(stderr, "Error: Invalid size '%s'.\n", argv[argi + 1]);
+		return EXIT_FAILURE;
+	}
+	tpl = g_readFile(argv[argi], &tplLen);
+	if (tpl == NULL) {
+		fprintf(stderr, "Error: Failed to read template '%s'.\n", argv[argi]);
+		return EXIT_FAILURE;
+	}
+	out.buf = (char *)malloc(OUT_BUFFER_SIZE);
+	if (out.buf == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory.\n");
+		goto onError;
+	}
+	out.fp = fopen(argv[argi + 2], "wb");
+	if (out.fp == NULL) {
+		fprintf(stderr, "Error: Failed to create output file '%s'.\n", argv[argi + 2]);
+		goto onError;
+	}
+
+	{
+		const size_t split = g_splitOffset(tpl, tplLen);
+		const uint64_t fixed = (uint64_t)tplLen + sizeof(g_startGcode) + sizeof(g_endGcode) + 32;
+		const uint64_t body = (size > fixed) ? size - fixed : 0;
+		const uint64_t layers = (body / LAYER_BYTES) + 1;
+		char line[64];
+		g_write(&out, tpl, split);
+		g_puts(&out, g_startGcode);
+		memcpy(line, "; max_z = ", 10);
+		char * ptr = g_fixed(line + 10, (int64_t)layers * LAYER_HEIGHT, 3);
+		*ptr++ = '\n';
+		g_write(&out, line, (size_t)(ptr - line));
+		g_puts(&out, ";Start GCode end\nG21 ; set units to millimeters\nG90 ; use absolute coordinates\nM82 ; use absolute distances for extrusion\nG92 E0\n");
+		while ((out.total + (LAYER_BYTES / 2) + (uint64_t)sizeof(g_endGcode) + (uint64_t)(tplLen - split)) < size && out.error == 0) {
+			const int progress = (int)((path.layer * 100) / (int64_t)layers);
+			g_layer(&out, &path, (progress > 99) ? 99 : progress, (int)((layers > (uint64_t)path.layer) ? layers - (uint64_t)path.layer : 0));
+		}
+		g_puts(&out, g_endGcode);
+		g_write(&out, tpl + split, tplLen - split);
+		g_flush(&out);
+	}
+	if (out.error != 0 || fclose(out.fp) != 0) {
+		out.fp = NULL;
+		fprintf(stderr, "Error: Failed to write output file '%s'.\n", argv[argi + 2]);
+		goto onError;
+	}
+	out.fp = NULL;
+	res = EXIT_SUCCESS;
+onError:
+	if (out.fp != NULL) fclose(out.fp);
+	if (out.buf != NULL) free(out.buf);
+	free(tpl);
+	return res;
+}
@@ -0,0 +1,446 @@
+/**
+ * @file httpsim.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Snapmaker 2.0 terminal simulator on the local loopback interface for testing sm2pspp --upload.
+ * The server listens on a free TCP port which is written to the given file once ready. Each
+ * request needs to be a POST to the file upload endpoint with a valid multipart/form-data body
+ * containing the file and, if required, the access token. Malformed requests are answered with a
+ * 4xx status, all others with the given status. The uploaded files are written to the output
+ * directory if the status is 2xx. One line per request is written to standard error.
+ *
+ * Usage: httpsim [-s status] [-k token] [-p path] [-o directory] <port file>
+ *
+ * -s  HTTP status of valid requests (defaults to 200, 0 closes the connection without response)
+ * -k  access token required for each upload (defaults to none)
+ * -p  path prefix of the upload endpoint (defaults to none)
+ * -o  directory receiving the uploaded files
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+/* needed for ppoll() and memmem() */
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+
+/** Path of the file upload endpoint of the Snapmaker 2.0 terminal. */
+#define ENDPOINT "/api/v1/upload"
+
+/** Maximum length of the request head in bytes. */
+#define MAX_HEAD_SIZE 8192
+
+/** Maximum length of the request body in bytes. */
+#define MAX_BODY_SIZE (256 * 1024 * 1024)
+
+/** Time in seconds to wait for the request data. */
+#define RECV_TIMEOUT 30
+
+
+/** Server configuration. */
+typedef struct {
+	int status;                /**< HTTP status of valid requests (0 for no response) */
+	const char * token;        /**< required access token or NULL */
+	const char * prefix;       /**< path prefix of the upload endpoint */
+	const char * outDir;       /**< directory receiving the uploaded files or NULL */
+} tConfig;
+
+
+/** Part of a multipart/form-data body. */
+typedef struct {
+	char name[64];             /**< form field name */
+	char filename[256];        /**< file name or empty */
+	const char * data;         /**< part content */
+	size_t size;               /**< part content length in bytes */
+} tPart;
+
+
+/** Set by the signal handler to stop the server. */
+static volatile sig_atomic_t h_stop = 0;
+
+
+/**
+ * Signal handler to stop the server.
+ *
+ * @param[in] sig - signal number
+ */
+static void h_onStop(int sig) {
+	(void)sig;
+	h_stop = 1;
+}
+
+
+/**
+ * Returns the reason phrase of the given HTTP status.
+ *
+ * @param[in] status - HTTP status
+ * @return reason phrase
+ */
+static const char * h_reason(const int status) {
+	switch (status) {
+	case 200: return "OK";
+	case 201: return "Created";
+	case 204: return "No Content";
+	case 302: return "Found";
+	case 400: return "Bad Request";
+	case 401: return "Unauthorized";
+	case 404: return "Not Found";
+	case 411: return "Length Required";
+	case 413: return "Payload Too Large";
+	case 500: return "Internal Server Error";
+	default: return "Unknown";
+	}
+}
+
+
+/**
+ * Sends the response with the given status and closes the connection.
+ *
+ * @param[in] fd - connected socket
+ * @param[in] status - HTTP status
+ */
+static void h_respond(const int fd, const int status) {
+	char buf[256];
+	const char * body = (status >= 200 && status <= 299) ? "{\"code\":200}" : "{\"code\":-1}";
+	const int len = snprintf(buf, sizeof(buf),
+		"HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: close\r\n\r\n%s",
+		status, h_reason(status), (unsigned)strlen(body), body
+	);
+	for (int done = 0; done < len; ) {
+		const ssize_t got = send(fd, buf + done, (size_t)(len - done), MSG_NOSIGNAL);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) break;
+		done += (int)got;
+	}
+	shutdown(fd, SHUT_WR);
+}
+
+
+/**
+ * Returns the value of the given header field within the given request head.
+ *
+ * @param[in] head - null-terminated request head
+ * @param[in] field - header field name including the colon
+ * @return start of the value (terminated by CR LF) or NULL if not found
+ */
+static const char * h_header(const char * head, const char * field) {
+	const size_t len = strlen(field);
+	for (const char * ptr = strstr(head, "\r\n"); ptr != NULL; ptr = strstr(ptr, "\r\n")) {
+		ptr += 2;
+		if (strncasecmp(ptr, field, len) == 0) {
+			ptr += len;
+			while (*ptr == ' ' || *ptr == '\t') ptr++;
+			return ptr;
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ * Copies the quoted parameter value of the given name from the given header line.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] size - output buffer size in bytes
+ * @param[in] line - header line (terminated by CR LF)
+ * @param[in] param - parameter name including the equal sign and the opening quote
+ * @return 1 on success, 0 if not found or too long
+ */
+static int h_param(char * dst, const size_t size, const char * line, const char * param) {
+	const char * end = strstr(line, "\r\n");
+	const char * ptr = strstr(line, param);
+	if (end == NULL || ptr == NULL || ptr > end) return 0;
+	/* skip matches within other parameter names (e.g. name= within filename=) */
+	while (ptr > line && ptr[-1] != ' ' && ptr[-1] != ';') {
+		ptr = strstr(ptr + 1, param);
+		if (ptr == NULL || ptr > end) return 0;
+	}
+	ptr += strlen(param);
+	const char * quote = (const char *)memchr(ptr, '"', (size_t)(end - ptr));
+	if (quote == NULL || (size_t)(quote - ptr) >= size) return 0;
+	memcpy(dst, ptr, (size_t)(quote - ptr));
+	dst[quote - ptr] = 0;
+	return 1;
+}
+
+
+/**
+ * Parses the next part of the given multipart/form-data body.
+ *
+ * @param[out] part - receives the part
+ * @param[in,out] ptr - current position after the preceding boundary line
+ * @param[in] end - end of the body
+ * @param[in] delim - CR LF followed by the boundary delimiter
+ * @param[out] last - set to 1 if this was the last part
+ * @return 1 on success, 0 if malformed
+ */
+static int h_part(tPart * part, const char ** ptr, const char * end, const char * delim, int * last) {
+	const char * head = *ptr;
+	const char * headEnd = (const char *)memmem(head, (size_t)(end - head), "\r\n\r\n", 4);
+	const size_t delimLen = strlen(delim);
+	char headers[1024];
+	memset(part, 0, sizeof(*part));
+	if (headEnd == NULL || (size_t)(headEnd - head + 5) > sizeof(headers)) return 0;
+	/* keep a leading line break to find the header fields */
+	headers[0] = '\r';
+	headers[1] = '\n';
+	memcpy(headers + 2, head, (size_t)(headEnd - head) + 2);
+	headers[headEnd - head + 4] = 0;
+	const char * disp = h_header(headers, "Content-Disposition:");
+	if (disp == NULL || strncmp(disp, "form-data;", 10) != 0) return 0;
+	if (h_param(part->name, sizeof(part->name), disp, "name=\"") != 1) return 0;
+	h_param(part->filename, sizeof(part->filename), disp, "filename=\"");
+	part->data = headEnd + 4;
+	const char * next = (const char *)memmem(part->data, (size_t)(end - part->data), delim, delimLen);
+	if (next == NULL) return 0;
+	part->size = (size_t)(next - part->data);
+	next += delimLen;
+	if ((end - next) >= 4 && memcmp(next, "--\r\n", 4) == 0) {
+		*last = 1;
+		next += 4;
+	} else if ((end - next) >= 2 && memcmp(next, "\r\n", 2) == 0) {
+		*last = 0;
+		next += 2;
+	} else {
+		return 0;
+	}
+	*ptr = next;
+	return 1;
+}
+
+
+/**
+ * Writes the given uploaded file to the output directory.
+ *
+ * @param[in] cfg - server configuration
+ * @param[in] file - file part
+ * @return 1 on success, 0 on error
+ */
+static int h_store(const tConfig * cfg, const tPart * file) {
+	char path[4096];
+	if (cfg->outDir == NULL) return 1;
+	if (strchr(file->filename, '/') != NULL || strcmp(file->filename, ".") == 0 || strcmp(file->filename, "..") == 0) return 0;
+	snprintf(path, sizeof(path), "%s/%s", cfg->outDir, file->filename);
+	FILE * fp = fopen(path, "wb");
+	if (fp == NULL) return 0;
+	const int res = (fwrite(file->data, 1, file->size, fp) == file->size) ? 1 : 0;
+	return (fclose(fp) == 0) ? res : 0;
+}
+
+
+/**
+ * Receives and checks the request of the given connection and responds to it.
+ *
+ * @param[in] cfg - server configuration
+ * @param[in] fd - connected socket
+ */
+static void h_handle(const tConfig * cfg, const int fd) {
+	char head[MAX_HEAD_SIZE + 1];
+	char path[1024];
+	char method[16];
+	char boundary[128];
+	char delim[136];
+	char token[256] = {0};
+	char * body = NULL;
+	const char * bodyStart = NULL;
+	size_t len = 0;
+	size_t size = 0;
+	int status = 400;
+	int hasToken = 0;
+	tPart file;
+	memset(&file, 0, sizeof(file));
+	path[0] = 0;
+	/* request head */
+	for (;;) {
+		if (len >= MAX_HEAD_SIZE) goto onEnd;
+		const ssize_t got = recv(fd, head + len, MAX_HEAD_SIZE - len, 0);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) goto onEnd;
+		len += (size_t)got;
+		head[len] = 0;
+		bodyStart = strstr(head, "\r\n\r\n");
+		if (bodyStart != NULL) break;
+	}
+	bodyStart += 4;
+	if (sscanf(head, "%15s %1023s HTTP/1.1\r\n", method, path) != 2) goto onEnd;
+	{
+		char endpoint[1100];
+		snprintf(endpoint, sizeof(endpoint), "%s" ENDPOINT, cfg->prefix);
+		if (strcmp(method, "POST") != 0 || strcmp(path, endpoint) != 0) {
+			status = 404;
+			goto onEnd;
+		}
+	}
+	const char * length = h_header(head, "Content-Length:");
+	if (length == NULL) {
+		status = 411;
+		goto onEnd;
+	}
+	size = (size_t)strtoull(length, NULL, 10);
+	if (size > MAX_BODY_SIZE) {
+		status = 413;
+		goto onEnd;
+	}
+	const char * type = h_header(head, "Content-Type:");
+	if (type == NULL || strncmp(type, "multipart/form-data;", 20) != 0 || sscanf(strstr(type, "boundary=") != NULL ? strstr(type, "boundary=") + 9 : "", "%127[^\r\n; ]", boundary) != 1) goto onEnd;
+	/* request body */
+	body = (char *)malloc(size + 1);
+	if (body == NULL) {
+		status = 500;
+		goto onEnd;
+	}
+	len -= (size_t)(bodyStart - head);
+	if (len > size) goto onEnd;
+	memcpy(body, bodyStart, len);
+	while (len < size) {
+		const ssize_t got = recv(fd, body + len, size - len, 0);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) goto onEnd;
+		len += (size_t)got;
+	}
+	/* multipart parts */
+	{
+		const char * ptr = body;
+		const char * end = body + size;
+		int last = 0;
+		snprintf(delim, sizeof(delim), "\r\n--%s", boundary);
+		if (size < (strlen(delim) + 2) || memcmp(body, delim + 2, strlen(delim) - 2) != 0 || memcmp(body + strlen(delim) - 2, "\r\n", 2) != 0) goto onEnd;
+		ptr += strlen(delim);
+		while (last == 0) {
+			tPart part;
+			if (h_part(&part, &ptr, end, delim, &last) != 1) goto onEnd;
+			if (strcmp(part.name, "token") == 0 && part.size < sizeof(token)) {
+				memcpy(token, part.data, part.size);
+				token[part.size] = 0;
+				hasToken = 1;
+			} else if (strcmp(part.name, "file") == 0 && part.filename[0] != 0) {
+				file = part;
+			}
+		}
+		if (ptr != end || file.data == NULL) goto onEnd;
+	}
+	if (cfg->token != NULL && (hasToken == 0 || strcmp(token, cfg->token) != 0)) {
+		status = 401;
+		goto onEnd;
+	}
+	status = cfg->status;
+	if (status >= 200 && status <= 299 && h_store(cfg, &file) != 1) status = 500;
+onEnd:
+	fprintf(stderr, "%s: file '%s' with %lu bytes, token '%s' -> %d\n",
+		path, file.filename, (unsigned long)file.size, (hasToken != 0) ? token : "", status
+	);
+	if (status != 0) h_respond(fd, status);
+	if (body != NULL) free(body);
+}
+
+
+int main(int argc, char ** argv) {
+	int res = EXIT_FAILURE;
+	int argi = 1;
+	int fd = -1;
+	const char * portFile = NULL;
+	char tmpFile[4096];
+	struct sockaddr_in addr;
+	socklen_t addrLen = sizeof(addr);
+	struct sigaction sa;
+	tConfig cfg;
+	cfg.status = 200;
+	cfg.token = NULL;
+	cfg.prefix = "";
+	cfg.outDir = NULL;
+
+	for (; argi < argc && argv[argi][0] == '-'; argi++) {
+		if ((argi + 1) >= argc) goto onUsage;
+		if (strcmp(argv[argi], "-s") == 0) {
+			cfg.status = atoi(argv[++argi]);
+			if (cfg.status < 0 || cfg.status > 599) goto onUsage;
+		} else if (strcmp(argv[argi], "-k") == 0) {
+			cfg.token = argv[++argi];
+		} else if (strcmp(argv[argi], "-p") == 0) {
+			cfg.prefix = argv[++argi];
+		} else if (strcmp(argv[argi], "-o") == 0) {
+			cfg.outDir = argv[++argi];
+		} else {
+			goto onUsage;
+		}
+	}
+	if ((argc - argi) != 1) goto onUsage;
+	portFile = argv[argi];
+
+	/* listen on a free port of the loopback interface */
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0 || getsockname(fd, (struct sockaddr *)&addr, &addrLen) != 0) {
+		fprintf(stderr, "Error: Failed to listen on the loopback interface.\n");
+		goto onError;
+	}
+	/* the port file appears completely or not at all */
+	snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", portFile);
+	{
+		FILE * fp = fopen(tmpFile, "w");
+		if (fp == NULL || fprintf(fp, "%u\n", (unsigned)ntohs(addr.sin_port)) < 0 || fclose(fp) != 0 || rename(tmpFile, portFile) != 0) {
+			fprintf(stderr, "Error: Failed to create port file '%s'.\n", portFile);
+			goto onError;
+		}
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = h_onStop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (h_stop == 0) {
+		struct pollfd pfd;
+		const struct timespec timeout = {1, 0};
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		const int ready = ppoll(&pfd, 1, &timeout, NULL);
+		if (ready < 0 && errno != EINTR) break;
+		if (ready > 0 && (pfd.revents & POLLIN) != 0) {
+			const int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+			if (client < 0) continue;
+			const struct timeval recvTimeout = {RECV_TIMEOUT, 0};
+			setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+			h_handle(&cfg, client);
+			close(client);
+		}
+	}
+	res = EXIT_SUCCESS;
+onError:
+	if (fd >= 0) close(fd);
+	return res;
+onUsage:
+	fprintf(stderr, "Usage: %s [-s status] [-k token] [-p path] [-o directory] <port file>\n", argv[0]);
+	return EXIT_FAILURE;
+}
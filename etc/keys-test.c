@@ -0,0 +1,173 @@
+/**
+ * @file keys-test.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Checks the parameter keys and comment markers of libsm2pspp.c. The first and last character given
+ * for the dispatch hash need to match the key. Each key needs to be found with its associated id
+ * while truncated and modified keys with the same dispatch hash are not.
+ *
+ * Usage: keys-test
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* the key lists and lookup functions are static */
+#include "../src/libsm2pspp.c"
+
+
+/** Maximum key length in bytes. */
+#define MAX_KEY_LENGTH 64
+
+
+/** Lookup function of a key list. Returns the associated id or the given value for no match. */
+typedef int (* tFindFn)(const tPToken *);
+
+
+/** Tested key. */
+typedef struct {
+	const char * str;          /**< key string */
+	size_t length;             /**< key length in bytes */
+	char first;                /**< first character given for the dispatch hash */
+	char last;                 /**< last character given for the dispatch hash */
+	int id;                    /**< associated id */
+} tKey;
+
+
+/** Expands to the initializer of a tKey entry. */
+#define T_KEY(str, first, last, id) {str, sizeof(str) - 1, first, last, (int)(id)},
+
+
+/** Parameter keys. */
+static const tKey t_parameter[] = {
+	P_PARAMETER_KEYS(T_KEY)
+};
+
+
+/** Comment markers. */
+static const tKey t_marker[] = {
+	P_MARKER_KEYS(T_KEY)
+};
+
+
+#undef T_KEY
+
+
+/**
+ * Wraps p_findParameter() as tFindFn.
+ *
+ * @param[in] token - key token
+ * @return value index or VAL_COUNT if not recognized
+ */
+static int t_findParameter(const tPToken * token) {
+	return (int)p_findParameter(token);
+}
+
+
+/**
+ * Wraps p_findMarker() as tFindFn.
+ *
+ * @param[in] token - comment token
+ * @return matching marker or MARK_NONE
+ */
+static int t_findMarker(const tPToken * token) {
+	return (int)p_findMarker(token);
+}
+
+
+/**
+ * Looks up the given string with the passed function.
+ *
+ * @param[in] fn - lookup function
+ * @param[in] str - string to look up
+ * @param[in] len - string length in bytes
+ * @return associated id
+ */
+static int t_find(const tFindFn fn, const char * str, const size_t len) {
+	tPToken token;
+	token.start = str;
+	token.length = len;
+	return fn(&token);
+}
+
+
+/**
+ * Checks the given key list.
+ *
+ * @param[in] name - list name
+ * @param[in] key - key list
+ * @param[in] count - number of keys
+ * @param[in] fn - lookup function
+ * @param[in] none - id returned for no match
+ * @return 1 on success, else 0
+ */
+static int t_check(const char * name, const tKey * key, const size_t count, const tFindFn fn, const int none) {
+	char buf[MAX_KEY_LENGTH];
+	int res = 1;
+	for (size_t i = 0; i < count; i++) {
+		const size_t len = key[i].length;
+		if (len < 2 || len >= MAX_KEY_LENGTH) {
+			fprintf(stderr, "%s: key \"%s\" has an unsupported length\n", name, key[i].str);
+			res = 0;
+			continue;
+		}
+		if (key[i].str[0] != key[i].first || key[i].str[len - 1] != key[i].last) {
+			fprintf(stderr, "%s: key \"%s\" is given with '%c' and '%c' as first and last character\n", name, key[i].str, key[i].first, key[i].last);
+			res = 0;
+			continue;
+		}
+		if (t_find(fn, key[i].str, len) != key[i].id) {
+			fprintf(stderr, "%s: key \"%s\" was not found\n", name, key[i].str);
+			res = 0;
+		}
+		/* same dispatch hash, different content */
+		memcpy(buf, key[i].str, len);
+		buf[len / 2] = '\x01';
+		if (t_find(fn, buf, len) != none) {
+			fprintf(stderr, "%s: modified key \"%s\" was found\n", name, key[i].str);
+			res = 0;
+		}
+		/* prefix */
+		if (t_find(fn, key[i].str, len - 1) == key[i].id) {
+			fprintf(stderr, "%s: truncated key \"%s\" was found\n", name, key[i].str);
+			res = 0;
+		}
+	}
+	return res;
+}
+
+
+int main(int argc, char ** argv) {
+	int res = EXIT_SUCCESS;
+	if (argc > 1) {
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (t_check("parameter", t_parameter, sizeof(t_parameter) / sizeof(*t_parameter), t_findParameter, (int)VAL_COUNT) != 0) {
+		printf("OK      parameter keys\n");
+	} else {
+		printf("FAILED  parameter keys\n");
+		res = EXIT_FAILURE;
+	}
+	if (t_check("marker", t_marker, sizeof(t_marker) / sizeof(*t_marker), t_findMarker, (int)MARK_NONE) != 0) {
+		printf("OK      marker keys\n");
+	} else {
+		printf("FAILED  marker keys\n");
+		res = EXIT_FAILURE;
+	}
+	return res;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file lcount-test.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * Compares each line break counting variant of lcount.c supported by the CPU with the scalar
+ * reference. The data is generated with different line break densities, random lengths and
+ * misaligned start addresses. Counts of random chunk splits need to add up to the count of the
+ * whole data. Long runs of line breaks check the 8-bit accumulators beyond 255 blocks.
+ *
+ * Usage: lcount-test [-n iterations] [-s seed]
+ *
+ * -n  number of random test cases per variant (defaults to 20000)
+ * -s  seed of the pseudo-random number generator (defaults to 1)
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* the variants are static */
+#include "../src/lcount.c"
+
+
+/** Maximum random data length in bytes. */
+#define MAX_LENGTH 20000
+
+/** Maximum misalignment of the data start in bytes. */
+#define MAX_OFFSET 64
+
+/** Length of the line break runs in bytes (more than 255 blocks for every variant). */
+#define RUN_LENGTH (1024 * 1024 + 77)
+
+
+/** Line break counting function. */
+typedef size_t (* tCountFn)(const char *, const size_t);
+
+
+/** Tested variant. */
+typedef struct {
+	const char * name;         /**< variant name */
+	tCountFn fn;               /**< counting function */
+	int supported;             /**< 1 if supported by the CPU, else 0 */
+} tVariant;
+
+
+/** Pseudo-random number generator state (xorshift64). */
+static uint64_t t_rnd = 1;
+
+
+/**
+ * Returns the next pseudo-random number.
+ *
+ * @return pseudo-random number
+ */
+static uint64_t t_next(void) {
+	t_rnd ^= t_rnd << 13;
+	t_rnd ^= t_rnd >> 7;
+	t_rnd ^= t_rnd << 17;
+	return t_rnd;
+}
+
+
+/**
+ * Fills the given buffer with random bytes. One in `density` bytes is a line break on average.
+ * A density of 1 gives line breaks only.
+ *
+ * @param[out] buf - buffer to fill
+ * @param[in] len - buffer length in bytes
+ * @param[in] density - line break density
+ */
+static void t_fill(char * buf, const size_t len, const uint64_t density) {
+	for (size_t i = 0; i < len; i++) {
+		const uint64_t r = t_next();
+		buf[i] = ((r % density) == 0) ? '\n' : (char)(r >> 32);
+	}
+}
+
+
+/**
+ * Checks the given variant against the scalar reference.
+ *
+ * @param[in] var - variant to check
+ * @param[in,out] buf - data buffer (at least MAX_OFFSET + RUN_LENGTH bytes)
+ * @param[in] iterations - number of random test cases
+ * @return 1 on success, else 0
+ */
+static int t_check(const tVariant * var, char * buf, const unsigned long iterations) {
+	static const uint64_t density[] = {1, 2, 7, 40, 1000, UINT64_MAX};
+	for (unsigned long it = 0; it < iterations; it++) {
+		const size_t offset = (size_t)(t_next() % MAX_OFFSET);
+		const size_t len = (size_t)(t_next() % (MAX_LENGTH + 1));
+		char * data = buf + offset;
+		t_fill(data, len, density[t_next() % (sizeof(density) / sizeof(*density))]);
+		const size_t expected = lc_countScalar(data, len);
+		const size_t got = var->fn(data, len);
+		if (got != expected) {
+			fprintf(stderr, "%s: counted %zu instead of %zu line breaks for %zu bytes at offset %zu\n", var->name, got, expected, len, offset);
+			return 0;
+		}
+		/* chunk splits */
+		size_t sum = 0;
+		for (size_t pos = 0; pos < len; ) {
+			const size_t rnd = (size_t)(t_next() % 300);
+			const size_t chunk = PCF_MIN(rnd, len - pos);
+			sum += var->fn(data + pos, chunk);
+			pos += chunk;
+		}
+		if (sum != expected) {
+			fprintf(stderr, "%s: chunks counted %zu instead of %zu line breaks for %zu bytes at offset %zu\n", var->name, sum, expected, len, offset);
+			return 0;
+		}
+	}
+	/* every length and offset of short data, then long runs for the accumulators */
+	for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+		for (size_t len = 0; len <= 1024; len++) {
+			t_fill(buf + offset, len, 3);
+			const size_t expected = lc_countScalar(buf + offset, len);
+			const size_t got = var->fn(buf + offset, len);
+			if (got != expected) {
+				fprintf(stderr, "%s: counted %zu instead of %zu line breaks for %zu bytes at offset %zu\n", var->name, got, expected, len, offset);
+				return 0;
+			}
+		}
+	}
+	for (size_t offset = 0; offset < MAX_OFFSET; offset += 7) {
+		memset(buf + offset, '\n', RUN_LENGTH);
+		const size_t got = var->fn(buf + offset, RUN_LENGTH);
+		if (got != RUN_LENGTH) {
+			fprintf(stderr, "%s: counted %zu instead of %zu line breaks in a run at offset %zu\n", var->name, got, (size_t)RUN_LENGTH, offset);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+int main(int argc, char ** argv) {
+	unsigned long iterations = 20000;
+	int res = EXIT_SUCCESS;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+			iterations = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc) {
+			t_rnd = (uint64_t)strtoull(argv[++i], NULL, 10);
+			if (t_rnd == 0) t_rnd = 1;
+		} else {
+			fprintf(stderr, "Usage: %s [-n iterations] [-s seed]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	const tVariant variant[] = {
+#ifdef LC_HAS_SSE2
+		{"SSE2", lc_countSse2, 1},
+#endif /* LC_HAS_SSE2 */
+#ifdef LC_HAS_X86_DISPATCH
+		{"AVX2", lc_countAvx2, __builtin_cpu_supports("avx2") ? 1 : 0},
+		{"AVX-512", lc_countAvx512, __builtin_cpu_supports("avx512bw") ? 1 : 0},
+#endif /* LC_HAS_X86_DISPATCH */
+#ifdef LC_HAS_NEON
+		{"NEON", lc_countNeon, 1},
+#endif /* LC_HAS_NEON */
+		{"dispatch", lc_count, 1}
+	};
+	char * buf = (char *)malloc(MAX_OFFSET + RUN_LENGTH);
+	if (buf == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory.\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < (sizeof(variant) / sizeof(*variant)); i++) {
+		if (variant[i].supported == 0) {
+			printf("SKIPPED lc_count %s (not supported by the CPU)\n", variant[i].name);
+		} else if (t_check(variant + i, buf, iterations) != 0) {
+			printf("OK      lc_count %s\n", variant[i].name);
+		} else {
+			printf("FAILED  lc_count %s\n", variant[i].name);
+			res = EXIT_FAILURE;
+		}
+	}
+	free(buf);
+	return res;
+}
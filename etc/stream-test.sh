@@ -0,0 +1,73 @@
+#!/bin/sh
+# @file stream-test.sh
+# @author Daniel Starke
+# @date 2026-10-16
+# @version 2026-10-16
+#
+# Streams generated G-Code to the firmware simulator (fwsim.c) with different buffer sizes,
+# windows and transmission error rates. Each run needs to succeed and the firmware needs to
+# have accepted exactly the G-Code commands of the processed file in order.
+#
+# Usage: stream-test.sh <sm2pspp> <fwsim> <gcodegen>
+#
+# DISCLAIMER
+# This file has no copyright assigned and is placed in the Public Domain.
+# All contributions are also assumed to be in the Public Domain.
+# Other contributions are not permitted.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+# OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+# ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+# OTHER DEALINGS IN THE SOFTWARE.
+
+if [ $# -ne 3 ]; then
+	echo "Usage: $0 <sm2pspp> <fwsim> <gcodegen>" >&2
+	exit 1
+fi
+sm2pspp="$1"
+fwsim="$2"
+tmp=$(mktemp -d) || exit 1
+pid=
+trap '[ -n "${pid}" ] && kill ${pid} 2>/dev/null; rm -rf "${tmp}"' EXIT
+"$3" "$(dirname "$0")/template.gcode" 64K "${tmp}/source.gcode" || exit 1
+failed=0
+
+# run <name> <fwsim options> <sm2pspp options>
+run() {
+	cp "${tmp}/source.gcode" "${tmp}/input.gcode"
+	rm -f "${tmp}/tty" "${tmp}/received"
+	${fwsim} -o "${tmp}/received" $2 "${tmp}/tty" 2> "${tmp}/fwsim.log" &
+	pid=$!
+	for i in $(seq 1 50); do
+		[ -e "${tmp}/tty" ] && break
+		sleep 0.1
+	done
+	${sm2pspp} --stream "${tmp}/tty" $3 "${tmp}/input.gcode" > "${tmp}/report" 2> "${tmp}/error"
+	res=$?
+	kill ${pid}
+	wait ${pid}
+	pid=
+	# the firmware receives the commands without comments, white-spaces and empty lines
+	sed -e 's/;.*//' -e 's/^[[:space:]]*//' -e 's/[[:space:]]*$//' -e '/^$/d' "${tmp}/input.gcode" > "${tmp}/expected"
+	grep -v '^M110 N0$' "${tmp}/received" > "${tmp}/commands"
+	if [ ${res} -ne 0 ] || ! grep -q "commands/s" "${tmp}/report" || ! cmp -s "${tmp}/expected" "${tmp}/commands"; then
+		echo "FAILED  $1"
+		grep -v "Warning" "${tmp}/error"
+		failed=1
+	else
+		echo "OK      $1: $(sed 's/^[^:]*: //' "${tmp}/report")"
+	fi
+}
+
+run "default" "" ""
+run "single command window" "-b 1" "--stream-window 1"
+run "large window" "-b 16" "--stream-window 16"
+run "fast firmware" "-t 0" ""
+run "slow firmware" "-t 2000" ""
+run "transmission errors" "-e 20" ""
+run "frequent transmission errors" "-e 3" "--stream-window 8"
+run "errors with single command window" "-b 1 -e 5" "--stream-window 1"
+exit ${failed}
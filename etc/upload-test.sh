@@ -0,0 +1,101 @@
+#!/bin/sh
+# @file upload-test.sh
+# @author Daniel Starke
+# @date 2026-10-16
+# @version 2026-10-16
+#
+# Uploads generated G-Code to the Snapmaker 2.0 terminal simulator (httpsim.c) with and without
+# access token, with path prefix and with different server responses. Successful runs need to
+# have uploaded exactly the processed file under its name. Runs with rejected, unsuccessful or
+# missing responses need to fail with the upload error while the local file is still processed.
+#
+# Usage: upload-test.sh <sm2pspp> <httpsim> <gcodegen>
+#
+# DISCLAIMER
+# This file has no copyright assigned and is placed in the Public Domain.
+# All contributions are also assumed to be in the Public Domain.
+# Other contributions are not permitted.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+# OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+# ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+# OTHER DEALINGS IN THE SOFTWARE.
+
+if [ $# -ne 3 ]; then
+	echo "Usage: $0 <sm2pspp> <httpsim> <gcodegen>" >&2
+	exit 1
+fi
+sm2pspp="$1"
+httpsim="$2"
+tmp=$(mktemp -d) || exit 1
+pid=
+trap '[ -n "${pid}" ] && kill ${pid} 2>/dev/null; rm -rf "${tmp}"' EXIT
+"$3" "$(dirname "$0")/template.gcode" 256K "${tmp}/source.gcode" || exit 1
+cp "${tmp}/source.gcode" "${tmp}/processed.gcode"
+${sm2pspp} "${tmp}/processed.gcode" 2> /dev/null || exit 1
+failed=0
+
+# run <name> <expected result> <source> <httpsim options> <URL path> <sm2pspp options>
+run() {
+	cp "${tmp}/$3.gcode" "${tmp}/input.gcode"
+	rm -rf "${tmp}/port" "${tmp}/uploaded"
+	mkdir "${tmp}/uploaded"
+	${httpsim} -o "${tmp}/uploaded" $4 "${tmp}/port" 2> "${tmp}/httpsim.log" &
+	pid=$!
+	for i in $(seq 1 50); do
+		[ -e "${tmp}/port" ] && break
+		sleep 0.1
+	done
+	port=$(cat "${tmp}/port" 2> /dev/null)
+	if [ "$2" = "refused" ]; then
+		# the port is not in use anymore
+		kill ${pid}
+		wait ${pid}
+		pid=
+		echo "no connection" > "${tmp}/httpsim.log"
+	fi
+	${sm2pspp} --upload "http://127.0.0.1:${port}$5" $6 "${tmp}/input.gcode" > "${tmp}/report" 2> "${tmp}/error"
+	res=$?
+	if [ -n "${pid}" ]; then
+		kill ${pid}
+		wait ${pid}
+		pid=
+	fi
+	ok=1
+	# the local file is processed in any case
+	cmp -s "${tmp}/processed.gcode" "${tmp}/input.gcode" || ok=0
+	if [ "$2" = "success" ]; then
+		[ ${res} -eq 0 ] || ok=0
+		cmp -s "${tmp}/processed.gcode" "${tmp}/uploaded/input.gcode" || ok=0
+	else
+		[ ${res} -ne 0 ] || ok=0
+		grep -q "Failed to upload" "${tmp}/error" || ok=0
+		[ -z "$(ls "${tmp}/uploaded")" ] || ok=0
+	fi
+	if [ ${ok} -eq 0 ]; then
+		echo "FAILED  $1"
+		grep -v "Warning" "${tmp}/error"
+		cat "${tmp}/httpsim.log"
+		failed=1
+	else
+		echo "OK      $1: $(cat "${tmp}/httpsim.log")"
+	fi
+}
+
+run "without token" success source "" "" ""
+run "with token" success source "-k secret" "" "--token secret"
+run "token not required" success source "" "" "--token secret"
+run "already processed" success processed "" "" ""
+run "path prefix" success source "-p /terminal" "/terminal/" ""
+run "created" success source "-s 201" "" ""
+run "wrong token" failure source "-k secret" "" "--token wrong"
+run "missing token" failure source "-k secret" "" ""
+run "wrong path" failure source "-p /terminal" "" ""
+run "redirect" failure source "-s 302" "" ""
+run "server error" failure source "-s 500" "" ""
+run "no response" failure source "-s 0" "" ""
+run "connection refused" refused source "" "" ""
+exit ${failed}
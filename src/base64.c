@@ -0,0 +1,518 @@
+/**
+ * @file base64.c
+ * @author Daniel Starke
+ * @see base64.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "base64.h"
+
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+/** SSE2 is available at compile time. */
+#define B64_HAS_SSE2 1
+#include <emmintrin.h>
+#endif /* SSE2 */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/** AVX2 is selected at run-time. */
+#define B64_HAS_X86_DISPATCH 1
+#include <immintrin.h>
+#endif /* GCC/Clang on x86 */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+/** NEON is available at compile time. */
+#define B64_HAS_NEON 1
+#include <arm_neon.h>
+#endif /* NEON */
+
+
+/** Character classes of the Base64 filter. */
+typedef enum {
+	B64_ALPHABET,              /**< Base64 alphabet including padding (kept) */
+	B64_SEPARATOR,             /**< comment prefix, white-space or line break (skipped) */
+	B64_INVALID                /**< anything else (skipped) */
+} tB64Class;
+
+
+/**
+ * Returns the character class of the given character.
+ *
+ * @param[in] ch - character
+ * @return character class
+ */
+static tB64Class b64_class(const char ch) {
+	if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '+' || ch == '/' || ch == '=') {
+		return B64_ALPHABET;
+	}
+	if (ch == ';' || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') return B64_SEPARATOR;
+	return B64_INVALID;
+}
+
+
+/**
+ * Compacts the given data one byte at a time. Used for the remaining bytes of the vectorized
+ * variants.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] n - number of bytes already written to the output buffer
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[in,out] bad - set to 1 if an invalid character was found
+ * @return number of bytes written to the output buffer in total
+ */
+static size_t b64_compactTail(char * dst, size_t n, const char * src, const size_t len, int * bad) {
+	for (size_t i = 0; i < len; i++) {
+		const tB64Class cls = b64_class(src[i]);
+		dst[n] = src[i];
+		if (cls == B64_ALPHABET) n++;
+		if (cls == B64_INVALID) *bad = 1;
+	}
+	return n;
+}
+
+
+/**
+ * Checks the padding of the given compacted Base64 data. The length needs to be a multiple of
+ * four and padding characters may only be given at the last two positions.
+ *
+ * @param[in] buf - compacted Base64 data
+ * @param[in] len - data length in bytes
+ * @return 1 if valid, else 0
+ */
+static int b64_checkPadding(const char * buf, const size_t len) {
+	if ((len % 4) != 0) return 0;
+	const char * pad = (const char *)memchr(buf, '=', len);
+	if (pad == NULL) return 1;
+	if ((size_t)(buf + len - pad) > 2) return 0;
+	for (; pad < (buf + len); pad++) {
+		if (*pad != '=') return 0;
+	}
+	return 1;
+}
+
+
+#ifdef B64_HAS_X86_DISPATCH
+/**
+ * Byte shuffle control per 8 bit mask. Moves the bytes of all set bits to the front of an 8 byte
+ * group. Unused positions are set to zero.
+ */
+static const uint64_t b64_shuffle[256] = {
+	0x8080808080808080ULL, 0x8080808080808000ULL, 0x8080808080808001ULL, 0x8080808080800100ULL,
+	0x8080808080808002ULL, 0x8080808080800200ULL, 0x8080808080800201ULL, 0x8080808080020100ULL,
+	0x8080808080808003ULL, 0x8080808080800300ULL, 0x8080808080800301ULL, 0x8080808080030100ULL,
+	0x8080808080800302ULL, 0x8080808080030200ULL, 0x8080808080030201ULL, 0x8080808003020100ULL,
+	0x8080808080808004ULL, 0x8080808080800400ULL, 0x8080808080800401ULL, 0x8080808080040100ULL,
+	0x8080808080800402ULL, 0x8080808080040200ULL, 0x8080808080040201ULL, 0x8080808004020100ULL,
+	0x8080808080800403ULL, 0x8080808080040300ULL, 0x8080808080040301ULL, 0x8080808004030100ULL,
+	0x8080808080040302ULL, 0x8080808004030200ULL, 0x8080808004030201ULL, 0x8080800403020100ULL,
+	0x8080808080808005ULL, 0x8080808080800500ULL, 0x8080808080800501ULL, 0x8080808080050100ULL,
+	0x8080808080800502ULL, 0x8080808080050200ULL, 0x8080808080050201ULL, 0x8080808005020100ULL,
+	0x8080808080800503ULL, 0x8080808080050300ULL, 0x8080808080050301ULL, 0x8080808005030100ULL,
+	0x8080808080050302ULL, 0x8080808005030200ULL, 0x8080808005030201ULL, 0x8080800503020100ULL,
+	0x8080808080800504ULL, 0x8080808080050400ULL, 0x8080808080050401ULL, 0x8080808005040100ULL,
+	0x8080808080050402ULL, 0x8080808005040200ULL, 0x8080808005040201ULL, 0x8080800504020100ULL,
+	0x8080808080050403ULL, 0x8080808005040300ULL, 0x8080808005040301ULL, 0x8080800504030100ULL,
+	0x8080808005040302ULL, 0x8080800504030200ULL, 0x8080800504030201ULL, 0x8080050403020100ULL,
+	0x8080808080808006ULL, 0x8080808080800600ULL, 0x8080808080800601ULL, 0x8080808080060100ULL,
+	0x8080808080800602ULL, 0x8080808080060200ULL, 0x8080808080060201ULL, 0x8080808006020100ULL,
+	0x8080808080800603ULL, 0x8080808080060300ULL, 0x8080808080060301ULL, 0x8080808006030100ULL,
+	0x8080808080060302ULL, 0x8080808006030200ULL, 0x8080808006030201ULL, 0x8080800603020100ULL,
+	0x8080808080800604ULL, 0x8080808080060400ULL, 0x8080808080060401ULL, 0x8080808006040100ULL,
+	0x8080808080060402ULL, 0x8080808006040200ULL, 0x8080808006040201ULL, 0x8080800604020100ULL,
+	0x8080808080060403ULL, 0x8080808006040300ULL, 0x8080808006040301ULL, 0x8080800604030100ULL,
+	0x8080808006040302ULL, 0x8080800604030200ULL, 0x8080800604030201ULL, 0x8080060403020100ULL,
+	0x8080808080800605ULL, 0x8080808080060500ULL, 0x8080808080060501ULL, 0x8080808006050100ULL,
+	0x8080808080060502ULL, 0x8080808006050200ULL, 0x8080808006050201ULL, 0x8080800605020100ULL,
+	0x8080808080060503ULL, 0x8080808006050300ULL, 0x8080808006050301ULL, 0x8080800605030100ULL,
+	0x8080808006050302ULL, 0x8080800605030200ULL, 0x8080800605030201ULL, 0x8080060503020100ULL,
+	0x8080808080060504ULL, 0x8080808006050400ULL, 0x8080808006050401ULL, 0x8080800605040100ULL,
+	0x8080808006050402ULL, 0x8080800605040200ULL, 0x8080800605040201ULL, 0x8080060504020100ULL,
+	0x8080808006050403ULL, 0x8080800605040300ULL, 0x8080800605040301ULL, 0x8080060504030100ULL,
+	0x8080800605040302ULL, 0x8080060504030200ULL, 0x8080060504030201ULL, 0x8006050403020100ULL,
+	0x8080808080808007ULL, 0x8080808080800700ULL, 0x8080808080800701ULL, 0x8080808080070100ULL,
+	0x8080808080800702ULL, 0x8080808080070200ULL, 0x8080808080070201ULL, 0x8080808007020100ULL,
+	0x8080808080800703ULL, 0x8080808080070300ULL, 0x8080808080070301ULL, 0x8080808007030100ULL,
+	0x8080808080070302ULL, 0x8080808007030200ULL, 0x8080808007030201ULL, 0x8080800703020100ULL,
+	0x8080808080800704ULL, 0x8080808080070400ULL, 0x8080808080070401ULL, 0x8080808007040100ULL,
+	0x8080808080070402ULL, 0x8080808007040200ULL, 0x8080808007040201ULL, 0x8080800704020100ULL,
+	0x8080808080070403ULL, 0x8080808007040300ULL, 0x8080808007040301ULL, 0x8080800704030100ULL,
+	0x8080808007040302ULL, 0x8080800704030200ULL, 0x8080800704030201ULL, 0x8080070403020100ULL,
+	0x8080808080800705ULL, 0x8080808080070500ULL, 0x8080808080070501ULL, 0x8080808007050100ULL,
+	0x8080808080070502ULL, 0x8080808007050200ULL, 0x8080808007050201ULL, 0x8080800705020100ULL,
+	0x8080808080070503ULL, 0x8080808007050300ULL, 0x8080808007050301ULL, 0x8080800705030100ULL,
+	0x8080808007050302ULL, 0x8080800705030200ULL, 0x8080800705030201ULL, 0x8080070503020100ULL,
+	0x8080808080070504ULL, 0x8080808007050400ULL, 0x8080808007050401ULL, 0x8080800705040100ULL,
+	0x8080808007050402ULL, 0x8080800705040200ULL, 0x8080800705040201ULL, 0x8080070504020100ULL,
+	0x8080808007050403ULL, 0x8080800705040300ULL, 0x8080800705040301ULL, 0x8080070504030100ULL,
+	0x8080800705040302ULL, 0x8080070504030200ULL, 0x8080070504030201ULL, 0x8007050403020100ULL,
+	0x8080808080800706ULL, 0x8080808080070600ULL, 0x8080808080070601ULL, 0x8080808007060100ULL,
+	0x8080808080070602ULL, 0x8080808007060200ULL, 0x8080808007060201ULL, 0x8080800706020100ULL,
+	0x8080808080070603ULL, 0x8080808007060300ULL, 0x8080808007060301ULL, 0x8080800706030100ULL,
+	0x8080808007060302ULL, 0x8080800706030200ULL, 0x8080800706030201ULL, 0x8080070603020100ULL,
+	0x8080808080070604ULL, 0x8080808007060400ULL, 0x8080808007060401ULL, 0x8080800706040100ULL,
+	0x8080808007060402ULL, 0x8080800706040200ULL, 0x8080800706040201ULL, 0x8080070604020100ULL,
+	0x8080808007060403ULL, 0x8080800706040300ULL, 0x8080800706040301ULL, 0x8080070604030100ULL,
+	0x8080800706040302ULL, 0x8080070604030200ULL, 0x8080070604030201ULL, 0x8007060403020100ULL,
+	0x8080808080070605ULL, 0x8080808007060500ULL, 0x8080808007060501ULL, 0x8080800706050100ULL,
+	0x8080808007060502ULL, 0x8080800706050200ULL, 0x8080800706050201ULL, 0x8080070605020100ULL,
+	0x8080808007060503ULL, 0x8080800706050300ULL, 0x8080800706050301ULL, 0x8080070605030100ULL,
+	0x8080800706050302ULL, 0x8080070605030200ULL, 0x8080070605030201ULL, 0x8007060503020100ULL,
+	0x8080808007060504ULL, 0x8080800706050400ULL, 0x8080800706050401ULL, 0x8080070605040100ULL,
+	0x8080800706050402ULL, 0x8080070605040200ULL, 0x8080070605040201ULL, 0x8007060504020100ULL,
+	0x8080800706050403ULL, 0x8080070605040300ULL, 0x8080070605040301ULL, 0x8007060504030100ULL,
+	0x8080070605040302ULL, 0x8007060504030200ULL, 0x8007060504030201ULL, 0x0706050403020100ULL
+};
+#endif /* B64_HAS_X86_DISPATCH */
+
+
+#ifdef B64_HAS_SSE2
+/**
+ * Returns a mask of all bytes within the given character range using SSE2. The bytes are shifted
+ * to use a signed compare.
+ *
+ * @param[in] x - input bytes
+ * @param[in] lo - first character of the range
+ * @param[in] hi - last character of the range
+ * @return byte mask
+ */
+static __m128i b64_rangeSse2(const __m128i x, const char lo, const char hi) {
+	const __m128i t = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - lo)));
+	return _mm_cmplt_epi8(t, _mm_set1_epi8((char)(-128 + (hi - lo) + 1)));
+}
+
+
+/**
+ * Compacts the given data using SSE2. The bytes are classified 16 at a time. Blocks without
+ * skipped characters are stored as they are. All others are compacted via their bit mask.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[in,out] bad - set to 1 if an invalid character was found
+ * @return number of bytes written to the output buffer
+ */
+static size_t b64_compactSse2(char * dst, const char * src, const size_t len, int * bad) {
+	const __m128i ones = _mm_set1_epi8(-1);
+	__m128i invalid = _mm_setzero_si128();
+	size_t n = 0;
+	size_t i = 0;
+	for (; (len - i) >= 16; i += 16) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i alpha = _mm_or_si128(
+			_mm_or_si128(b64_rangeSse2(x, 'A', 'Z'), b64_rangeSse2(x, 'a', 'z')),
+			_mm_or_si128(b64_rangeSse2(x, '/', '9'), _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('+')), _mm_cmpeq_epi8(x, _mm_set1_epi8('='))))
+		);
+		const __m128i sep = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(';')), _mm_cmpeq_epi8(x, _mm_set1_epi8(' '))),
+			_mm_or_si128(b64_rangeSse2(x, '\t', '\n'), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r')))
+		);
+		invalid = _mm_or_si128(invalid, _mm_andnot_si128(_mm_or_si128(alpha, sep), ones));
+		const unsigned mask = (unsigned)_mm_movemask_epi8(alpha);
+		if (mask == 0xFFFF) {
+			_mm_storeu_si128((__m128i *)(dst + n), x);
+			n += 16;
+		} else {
+			for (size_t k = 0; k < 16; k++) {
+				dst[n] = src[i + k];
+				n += (mask >> k) & 1;
+			}
+		}
+	}
+	if (_mm_movemask_epi8(invalid) != 0) *bad = 1;
+	return b64_compactTail(dst, n, src + i, len - i, bad);
+}
+#endif /* B64_HAS_SSE2 */
+
+
+#ifdef B64_HAS_X86_DISPATCH
+/**
+ * Returns a mask of all bytes within the given character range using AVX2. See b64_rangeSse2().
+ *
+ * @param[in] x - input bytes
+ * @param[in] lo - first character of the range
+ * @param[in] hi - last character of the range
+ * @return byte mask
+ */
+__attribute__((target("avx2")))
+static __m256i b64_rangeAvx2(const __m256i x, const char lo, const char hi) {
+	const __m256i t = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - lo)));
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + (hi - lo) + 1)), t);
+}
+
+
+/**
+ * Compacts the given data using AVX2. The bytes are classified 32 at a time. Each 8 byte group is
+ * compacted with a byte shuffle taken from b64_shuffle and stored at the current output position.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[in,out] bad - set to 1 if an invalid character was found
+ * @return number of bytes written to the output buffer
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t b64_compactAvx2(char * dst, const char * src, const size_t len, int * bad) {
+	const __m256i ones = _mm256_set1_epi8(-1);
+	const uint64_t upper = 0x0808080808080808ULL; /* shuffle offset of the upper 8 bytes per lane */
+	__m256i invalid = _mm256_setzero_si256();
+	size_t n = 0;
+	size_t i = 0;
+	for (; (len - i) >= 32; i += 32) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i alpha = _mm256_or_si256(
+			_mm256_or_si256(b64_rangeAvx2(x, 'A', 'Z'), b64_rangeAvx2(x, 'a', 'z')),
+			_mm256_or_si256(b64_rangeAvx2(x, '/', '9'), _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('='))))
+		);
+		const __m256i sep = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(';')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' '))),
+			_mm256_or_si256(b64_rangeAvx2(x, '\t', '\n'), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')))
+		);
+		invalid = _mm256_or_si256(invalid, _mm256_andnot_si256(_mm256_or_si256(alpha, sep), ones));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(alpha);
+		if (mask == 0xFFFFFFFF) {
+			_mm256_storeu_si256((__m256i *)(dst + n), x);
+			n += 32;
+			continue;
+		}
+		const __m256i y = _mm256_shuffle_epi8(x, _mm256_set_epi64x(
+			(long long)(b64_shuffle[mask >> 24] + upper),
+			(long long)(b64_shuffle[(mask >> 16) & 0xFF]),
+			(long long)(b64_shuffle[(mask >> 8) & 0xFF] + upper),
+			(long long)(b64_shuffle[mask & 0xFF])
+		));
+		const __m128i lo = _mm256_castsi256_si128(y);
+		const __m128i hi = _mm256_extracti128_si256(y, 1);
+		_mm_storel_epi64((__m128i *)(dst + n), lo);
+		n += (size_t)__builtin_popcount(mask & 0xFF);
+		_mm_storel_epi64((__m128i *)(dst + n), _mm_unpackhi_epi64(lo, lo));
+		n += (size_t)__builtin_popcount((mask >> 8) & 0xFF);
+		_mm_storel_epi64((__m128i *)(dst + n), hi);
+		n += (size_t)__builtin_popcount((mask >> 16) & 0xFF);
+		_mm_storel_epi64((__m128i *)(dst + n), _mm_unpackhi_epi64(hi, hi));
+		n += (size_t)__builtin_popcount(mask >> 24);
+	}
+	if (_mm256_movemask_epi8(invalid) != 0) *bad = 1;
+	return b64_compactTail(dst, n, src + i, len - i, bad);
+}
+#endif /* B64_HAS_X86_DISPATCH */
+
+
+#ifdef B64_HAS_NEON
+/**
+ * Returns a mask of all bytes within the given character range using NEON.
+ *
+ * @param[in] x - input bytes
+ * @param[in] lo - first character of the range
+ * @param[in] hi - last character of the range
+ * @return byte mask
+ */
+static uint8x16_t b64_rangeNeon(const uint8x16_t x, const uint8_t lo, const uint8_t hi) {
+	return vcltq_u8(vsubq_u8(x, vdupq_n_u8(lo)), vdupq_n_u8((uint8_t)(hi - lo + 1)));
+}
+
+
+/**
+ * Compacts the given data using NEON. See b64_compactSse2().
+ *
+ * @param[out] dst - output buffer
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[in,out] bad - set to 1 if an invalid character was found
+ * @return number of bytes written to the output buffer
+ */
+static size_t b64_compactNeon(char * dst, const char * src, const size_t len, int * bad) {
+	uint8x16_t invalid = vdupq_n_u8(0);
+	uint8_t mask[16];
+	size_t n = 0;
+	size_t i = 0;
+	for (; (len - i) >= 16; i += 16) {
+		const uint8x16_t x = vld1q_u8((const uint8_t *)(src + i));
+		const uint8x16_t alpha = vorrq_u8(
+			vorrq_u8(b64_rangeNeon(x, 'A', 'Z'), b64_rangeNeon(x, 'a', 'z')),
+			vorrq_u8(b64_rangeNeon(x, '/', '9'), vorrq_u8(vceqq_u8(x, vdupq_n_u8('+')), vceqq_u8(x, vdupq_n_u8('='))))
+		);
+		const uint8x16_t sep = vorrq_u8(
+			vorrq_u8(vceqq_u8(x, vdupq_n_u8(';')), vceqq_u8(x, vdupq_n_u8(' '))),
+			vorrq_u8(b64_rangeNeon(x, '\t', '\n'), vceqq_u8(x, vdupq_n_u8('\r')))
+		);
+		invalid = vorrq_u8(invalid, vmvnq_u8(vorrq_u8(alpha, sep)));
+		/* horizontal minimum of the mask */
+		uint8x8_t all = vand_u8(vget_low_u8(alpha), vget_high_u8(alpha));
+		all = vpmin_u8(all, all);
+		all = vpmin_u8(all, all);
+		all = vpmin_u8(all, all);
+		if (vget_lane_u8(all, 0) == 0xFF) {
+			vst1q_u8((uint8_t *)(dst + n), x);
+			n += 16;
+		} else {
+			vst1q_u8(mask, alpha);
+			for (size_t k = 0; k < 16; k++) {
+				dst[n] = src[i + k];
+				n += mask[k] & 1;
+			}
+		}
+	}
+	/* horizontal maximum of the invalid characters */
+	uint8x8_t any = vorr_u8(vget_low_u8(invalid), vget_high_u8(invalid));
+	any = vpmax_u8(any, any);
+	any = vpmax_u8(any, any);
+	any = vpmax_u8(any, any);
+	if (vget_lane_u8(any, 0) != 0) *bad = 1;
+	return b64_compactTail(dst, n, src + i, len - i, bad);
+}
+#endif /* B64_HAS_NEON */
+
+
+/**
+ * Compacts the given Base64 data one byte at a time. This is the reference for the vectorized
+ * variants. See b64_compact().
+ *
+ * @param[out] dst - output buffer (at least len bytes)
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[out] valid - set to 1 if the data is valid Base64, else 0 (may be NULL)
+ * @return number of bytes written to the output buffer
+ */
+size_t b64_compactScalar(char * dst, const char * src, const size_t len, int * valid) {
+	int bad = 0;
+	if (dst == NULL || src == NULL) return 0;
+	const size_t res = b64_compactTail(dst, 0, src, len, &bad);
+	if (valid != NULL) *valid = (bad == 0 && b64_checkPadding(dst, res) != 0) ? 1 : 0;
+	return res;
+}
+
+
+/**
+ * Compacts the given Base64 data with the fastest variant supported by the CPU. Only characters
+ * of the Base64 alphabet are copied to the output buffer. Comment prefixes, white-spaces and line
+ * breaks are skipped. The data is validated at the same time. It is considered invalid if any
+ * other character is found or the padding is wrong. Invalid characters are skipped. The output
+ * buffer may be the input buffer. Bytes after the returned length may be overwritten.
+ *
+ * @param[out] dst - output buffer (at least len bytes)
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @param[out] valid - set to 1 if the data is valid Base64, else 0 (may be NULL)
+ * @return number of bytes written to the output buffer
+ */
+size_t b64_compact(char * dst, const char * src, const size_t len, int * valid) {
+	int bad = 0;
+	size_t res;
+	if (dst == NULL || src == NULL) return 0;
+#ifdef B64_HAS_X86_DISPATCH
+	if (len >= 32 && __builtin_cpu_supports("avx2")) {
+		res = b64_compactAvx2(dst, src, len, &bad);
+	} else
+#endif /* B64_HAS_X86_DISPATCH */
+	{
+#if defined(B64_HAS_SSE2)
+		res = b64_compactSse2(dst, src, len, &bad);
+#elif defined(B64_HAS_NEON)
+		res = b64_compactNeon(dst, src, len, &bad);
+#else /* no SIMD */
+		res = b64_compactTail(dst, 0, src, len, &bad);
+#endif /* no SIMD */
+	}
+	if (valid != NULL) *valid = (bad == 0 && b64_checkPadding(dst, res) != 0) ? 1 : 0;
+	return res;
+}
+
+
+/** Base64 alphabet in order of the encoded values. */
+static const char b64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**
+ * Returns the encoded value of the given Base64 character.
+ *
+ * @param[in] ch - character
+ * @return 6-bit value or -1 if not part of the Base64 alphabet
+ */
+static int b64_value(const char ch) {
+	if (ch >= 'A' && ch <= 'Z') return ch - 'A';
+	if (ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+	if (ch >= '0' && ch <= '9') return ch - '0' + 52;
+	if (ch == '+') return 62;
+	if (ch == '/') return 63;
+	return -1;
+}
+
+
+/**
+ * Decodes the given compacted Base64 data. See b64_compact().
+ *
+ * @param[out] dst - output buffer (at least len / 4 * 3 bytes)
+ * @param[in] src - compacted Base64 data
+ * @param[in] len - input data length in bytes
+ * @return number of bytes written to the output buffer or (size_t)-1 if the data is invalid
+ */
+size_t b64_decode(unsigned char * dst, const char * src, const size_t len) {
+	size_t n = 0;
+	if (dst == NULL || src == NULL || (len % 4) != 0) return (size_t)-1;
+	for (size_t i = 0; i < len; i += 4) {
+		const int a = b64_value(src[i]);
+		const int b = b64_value(src[i + 1]);
+		const int c = b64_value(src[i + 2]);
+		const int d = b64_value(src[i + 3]);
+		const int last = ((i + 4) == len) ? 1 : 0;
+		if (a < 0 || b < 0) return (size_t)-1;
+		dst[n++] = (unsigned char)((a << 2) | (b >> 4));
+		if (c < 0) {
+			if (last == 0 || src[i + 2] != '=' || src[i + 3] != '=') return (size_t)-1;
+			break;
+		}
+		dst[n++] = (unsigned char)(((b & 0x0F) << 4) | (c >> 2));
+		if (d < 0) {
+			if (last == 0 || src[i + 3] != '=') return (size_t)-1;
+			break;
+		}
+		dst[n++] = (unsigned char)(((c & 0x03) << 6) | d);
+	}
+	return n;
+}
+
+
+/**
+ * Encodes the given data as Base64 with padding.
+ *
+ * @param[out] dst - output buffer (at least (len + 2) / 3 * 4 bytes)
+ * @param[in] src - input data
+ * @param[in] len - input data length in bytes
+ * @return number of bytes written to the output buffer
+ */
+size_t b64_encode(char * dst, const unsigned char * src, const size_t len) {
+	size_t n = 0;
+	size_t i = 0;
+	if (dst == NULL || src == NULL) return 0;
+	for (; (i + 3) <= len; i += 3) {
+		const unsigned long v = ((unsigned long)src[i] << 16) | ((unsigned long)src[i + 1] << 8) | (unsigned long)src[i + 2];
+		dst[n++] = b64_alphabet[(v >> 18) & 0x3F];
+		dst[n++] = b64_alphabet[(v >> 12) & 0x3F];
+		dst[n++] = b64_alphabet[(v >> 6) & 0x3F];
+		dst[n++] = b64_alphabet[v & 0x3F];
+	}
+	if (i < len) {
+		const unsigned long v = ((unsigned long)src[i] << 16) | (((i + 1) < len) ? ((unsigned long)src[i + 1] << 8) : 0);
+		dst[n++] = b64_alphabet[(v >> 18) & 0x3F];
+		dst[n++] = b64_alphabet[(v >> 12) & 0x3F];
+		dst[n++] = ((i + 1) < len) ? b64_alphabet[(v >> 6) & 0x3F] : '=';
+		dst[n++] = '=';
+	}
+	return n;
+}
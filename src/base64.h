@@ -0,0 +1,44 @@
+/**
+ * @file base64.h
+ * @author Daniel Starke
+ * @see base64.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __BASE64_H__
+#define __BASE64_H__
+
+#include <stddef.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+size_t b64_compactScalar(char * dst, const char * src, const size_t len, int * valid);
+size_t b64_compact(char * dst, const char * src, const size_t len, int * valid);
+size_t b64_decode(unsigned char * dst, const char * src, const size_t len);
+size_t b64_encode(char * dst, const unsigned char * src, const size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __BASE64_H__ */
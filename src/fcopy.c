@@ -0,0 +1,257 @@
+/**
+ * @file fcopy.c
+ * @author Daniel Starke
+ * @see fcopy.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+/* needed for copy_file_range() */
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include "fcopy.h"
+#ifdef PCF_IS_NO_WIN
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef PCF_IS_LINUX
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/vfs.h>
+#endif /* PCF_IS_LINUX */
+#endif /* PCF_IS_NO_WIN */
+
+
+/** Maximum number of bytes transferred by a single system call. */
+#define FC_CHUNK_SIZE 0x40000000
+
+
+/** Buffer size of the read/write fallback. */
+#define FC_BUFFER_SIZE 0x10000
+
+
+#ifdef PCF_IS_NO_WIN
+/**
+ * Returns the block alignment needed to share data blocks with the given file by reference
+ * (reflink). Source and destination offsets of fc_copy() need to be congruent modulo this value
+ * for the copy to become a metadata-only operation.
+ *
+ * @param[in] fd - destination file descriptor
+ * @return block size or 0 if the file system does not support reflinks
+ */
+size_t fc_cloneAlignment(const int fd) {
+#if defined(PCF_IS_LINUX) && defined(FICLONERANGE)
+	struct statfs st;
+	if (fstatfs(fd, &st) != 0 || st.f_bsize <= 0) return 0;
+	switch ((unsigned long)(st.f_type)) {
+	case BTRFS_SUPER_MAGIC:
+	case XFS_SUPER_MAGIC:
+		return (size_t)(st.f_bsize);
+	default:
+		break;
+	}
+#else /* no reflink support */
+	PCF_UNUSED(fd)
+#endif /* no reflink support */
+	return 0;
+}
+
+
+/**
+ * Copies the given range by reading and writing it via a buffer.
+ *
+ * @param[in] dstFd - destination file descriptor (written at its current offset)
+ * @param[in] srcFd - source file descriptor
+ * @param[in] srcOffset - source file offset
+ * @param[in] length - number of bytes to copy
+ * @return 1 on success, 0 on error
+ */
+static int fc_readWrite(const int dstFd, const int srcFd, uint64_t srcOffset, uint64_t length) {
+	char * buf = (char *)malloc(FC_BUFFER_SIZE);
+	if (buf == NULL) return 0;
+	while (length > 0) {
+		const ssize_t got = pread(srcFd, buf, (size_t)PCF_MIN((uint64_t)FC_BUFFER_SIZE, length), (off_t)srcOffset);
+		if (got <= 0) {
+			if (got < 0 && errno == EINTR) continue;
+			free(buf);
+			return 0;
+		}
+		for (ssize_t written = 0; written < got; ) {
+			const ssize_t res = write(dstFd, buf + written, (size_t)(got - written));
+			if (res < 0) {
+				if (errno == EINTR) continue;
+				free(buf);
+				return 0;
+			}
+			written += res;
+		}
+		srcOffset += (uint64_t)got;
+		length -= (uint64_t)got;
+	}
+	free(buf);
+	return 1;
+}
+
+
+/**
+ * Copies the given range of the source file to the current offset of the destination file without
+ * passing the data through user space if possible. copy_file_range() is used first, followed by
+ * sendfile() and plain read/write as fallback.
+ *
+ * @param[in] dstFd - destination file descriptor (written at its current offset)
+ * @param[in] srcFd - source file descriptor
+ * @param[in] srcOffset - source file offset
+ * @param[in] length - number of bytes to copy
+ * @return 1 on success, 0 on error
+ */
+static int fc_transfer(const int dstFd, const int srcFd, uint64_t srcOffset, uint64_t length) {
+#ifdef PCF_IS_LINUX
+	/* in-kernel copy (may be a reflink or server-side copy) */
+	while (length > 0) {
+		loff_t inOff = (loff_t)srcOffset;
+		const ssize_t res = copy_file_range(srcFd, &inOff, dstFd, NULL, (size_t)PCF_MIN((uint64_t)FC_CHUNK_SIZE, length), 0);
+		if (res <= 0) {
+			if (res < 0 && errno == EINTR) continue;
+			break;
+		}
+		srcOffset += (uint64_t)res;
+		length -= (uint64_t)res;
+	}
+	/* in-kernel copy via page cache */
+	while (length > 0) {
+		off_t inOff = (off_t)srcOffset;
+		const ssize_t res = sendfile(dstFd, srcFd, &inOff, (size_t)PCF_MIN((uint64_t)FC_CHUNK_SIZE, length));
+		if (res <= 0) {
+			if (res < 0 && errno == EINTR) continue;
+			break;
+		}
+		srcOffset += (uint64_t)res;
+		length -= (uint64_t)res;
+	}
+#endif /* PCF_IS_LINUX */
+	if (length < 1) return 1;
+	return fc_readWrite(dstFd, srcFd, srcOffset, length);
+}
+
+
+/**
+ * Copies the given range of the source file to the current offset of the destination file. Data
+ * blocks are shared by reference (FICLONERANGE) where the file system supports this and both
+ * offsets are congruent modulo fc_cloneAlignment(). All remaining bytes are copied via
+ * copy_file_range(), sendfile() or plain read/write, whatever succeeds first. The destination file
+ * offset is advanced by the number of copied bytes.
+ *
+ * @param[in] dstFd - destination file descriptor
+ * @param[in] srcFd - source file descriptor
+ * @param[in] srcOffset - source file offset
+ * @param[in] length - number of bytes to copy
+ * @return 1 on success, 0 on error
+ */
+int fc_copy(const int dstFd, const int srcFd, const uint64_t srcOffset, const uint64_t length) {
+	if (dstFd < 0 || srcFd < 0) return 0;
+	if (length < 1) return 1;
+#if defined(PCF_IS_LINUX) && defined(FICLONERANGE)
+	const size_t align = fc_cloneAlignment(dstFd);
+	const off_t dstOffset = lseek(dstFd, 0, SEEK_CUR);
+	struct stat st;
+	if (align > 0 && dstOffset >= 0 && fstat(srcFd, &st) == 0 && ((uint64_t)dstOffset % align) == (srcOffset % align)) {
+		/* copy up to the next block boundary */
+		const uint64_t head = PCF_MIN((uint64_t)((align - (size_t)(srcOffset % align)) % align), length);
+		if (fc_transfer(dstFd, srcFd, srcOffset, head) != 1) return 0;
+		/* share complete blocks; the last block may be partial if it ends at the end of the source */
+		uint64_t cloneLength = length - head;
+		if ((srcOffset + length) != (uint64_t)(st.st_size)) cloneLength -= cloneLength % align;
+		if (cloneLength > 0) {
+			struct file_clone_range range;
+			range.src_fd = srcFd;
+			range.src_offset = srcOffset + head;
+			range.src_length = cloneLength;
+			range.dest_offset = (uint64_t)dstOffset + head;
+			if (ioctl(dstFd, FICLONERANGE, &range) == 0 && lseek(dstFd, (off_t)(range.dest_offset + cloneLength), SEEK_SET) >= 0) {
+				return fc_transfer(dstFd, srcFd, srcOffset + head + cloneLength, length - head - cloneLength);
+			}
+		}
+		return fc_transfer(dstFd, srcFd, srcOffset + head, length - head);
+	}
+#endif /* PCF_IS_LINUX and FICLONERANGE */
+	return fc_transfer(dstFd, srcFd, srcOffset, length);
+}
+#endif /* PCF_IS_NO_WIN */
+
+
+#ifdef PCF_IS_LINUX
+/**
+ * Returns the block size of the file system holding the given file. Offsets and lengths passed to
+ * fc_insertRange() and fc_collapseRange() need to be multiples of this value.
+ *
+ * @param[in] fd - file descriptor
+ * @return block size or 0 on error
+ */
+size_t fc_blockSize(const int fd) {
+	struct statfs st;
+	if (fstatfs(fd, &st) != 0 || st.f_bsize <= 0) return 0;
+	return (size_t)(st.f_bsize);
+}
+
+
+/**
+ * Inserts a hole of the given size at the passed offset without rewriting the data after it. All
+ * data from the offset on is shifted towards the end of the file. This is only supported by some
+ * file systems like ext4 and XFS.
+ *
+ * @param[in] fd - file descriptor opened for writing
+ * @param[in] offset - insert at this file offset (multiple of fc_blockSize())
+ * @param[in] length - number of bytes to insert (multiple of fc_blockSize())
+ * @return 1 on success, 0 on error (the file remains unchanged)
+ */
+int fc_insertRange(const int fd, const uint64_t offset, const uint64_t length) {
+#ifdef FALLOC_FL_INSERT_RANGE
+	return (fallocate(fd, FALLOC_FL_INSERT_RANGE, (off_t)offset, (off_t)length) == 0) ? 1 : 0;
+#else /* !FALLOC_FL_INSERT_RANGE */
+	PCF_UNUSED(fd)
+	PCF_UNUSED(offset)
+	PCF_UNUSED(length)
+	return 0;
+#endif /* !FALLOC_FL_INSERT_RANGE */
+}
+
+
+/**
+ * Removes the given range from the file without rewriting the data after it. All data after the
+ * range is shifted towards the start of the file. This is only supported by some file systems like
+ * ext4 and XFS. The range may not reach the end of the file.
+ *
+ * @param[in] fd - file descriptor opened for writing
+ * @param[in] offset - file offset of the range (multiple of fc_blockSize())
+ * @param[in] length - number of bytes to remove (multiple of fc_blockSize())
+ * @return 1 on success, 0 on error (the file remains unchanged)
+ */
+int fc_collapseRange(const int fd, const uint64_t offset, const uint64_t length) {
+#ifdef FALLOC_FL_COLLAPSE_RANGE
+	return (fallocate(fd, FALLOC_FL_COLLAPSE_RANGE, (off_t)offset, (off_t)length) == 0) ? 1 : 0;
+#else /* !FALLOC_FL_COLLAPSE_RANGE */
+	PCF_UNUSED(fd)
+	PCF_UNUSED(offset)
+	PCF_UNUSED(length)
+	return 0;
+#endif /* !FALLOC_FL_COLLAPSE_RANGE */
+}
+#endif /* PCF_IS_LINUX */
@@ -0,0 +1,50 @@
+/**
+ * @file fcopy.h
+ * @author Daniel Starke
+ * @see fcopy.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __FCOPY_H__
+#define __FCOPY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef PCF_IS_NO_WIN
+size_t fc_cloneAlignment(const int fd);
+int fc_copy(const int dstFd, const int srcFd, const uint64_t srcOffset, const uint64_t length);
+#endif /* PCF_IS_NO_WIN */
+#ifdef PCF_IS_LINUX
+size_t fc_blockSize(const int fd);
+int fc_insertRange(const int fd, const uint64_t offset, const uint64_t length);
+int fc_collapseRange(const int fd, const uint64_t offset, const uint64_t length);
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __FCOPY_H__ */
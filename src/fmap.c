@@ -0,0 +1,307 @@
+/**
+ * @file fmap.c
+ * @author Daniel Starke
+ * @see fmap.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fcopy.h"
+#include "fmap.h"
+#ifdef PCF_IS_WIN
+#include <windows.h>
+#else /* PCF_IS_NO_WIN */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* PCF_IS_NO_WIN */
+
+
+/**
+ * Reads the given file into an allocated buffer. This is the fallback if the file cannot be mapped.
+ *
+ * @param[in,out] fm - file map to fill
+ * @param[in] file - input file path
+ * @return FM_OK on success, else the error cause
+ */
+static tFileMapResult fm_read(tFileMap * fm, const TCHAR * file) {
+	FILE * fp = _tfopen(file, _T("rb"));
+	if (fp == NULL) return FM_ERR_OPEN;
+
+	/* get file size */
+	fseeko64(fp, 0, SEEK_END);
+	fm->size = (size_t)ftello64(fp);
+	if (fm->size < 1) {
+		fclose(fp);
+		return FM_OK;
+	}
+	fseek(fp, 0, SEEK_SET);
+
+	/* allocate input buffer from file data */
+	fm->data = (char *)malloc(fm->size);
+	if (fm->data == NULL) {
+		fclose(fp);
+		return FM_ERR_NO_MEM;
+	}
+	if (fread(fm->data, fm->size, 1, fp) < 1) {
+		fclose(fp);
+		return FM_ERR_READ;
+	}
+	fclose(fp);
+	return FM_OK;
+}
+
+
+/**
+ * Opens the given file for sequential reading. The file content is mapped into memory if possible
+ * or read into an allocated buffer otherwise. Use fm_close() to release the returned view in any
+ * case.
+ *
+ * @param[out] fm - file map to initialize
+ * @param[in] file - input file path
+ * @return FM_OK on success, else the error cause
+ */
+tFileMapResult fm_open(tFileMap * fm, const TCHAR * file) {
+	if (fm == NULL || file == NULL) return FM_ERR_OPEN;
+	memset(fm, 0, sizeof(*fm));
+#ifdef PCF_IS_NO_WIN
+	fm->fd = open(file, O_RDONLY);
+	if (fm->fd < 0) return FM_ERR_OPEN;
+	struct stat st;
+	if (fstat(fm->fd, &st) != 0 || S_ISREG(st.st_mode) == 0 || (unsigned long long)st.st_size > (unsigned long long)((size_t)-1)) {
+		close(fm->fd);
+		fm->fd = -1;
+		return fm_read(fm, file);
+	}
+	fm->size = (size_t)st.st_size;
+	if (fm->size < 1) return FM_OK;
+#if defined(POSIX_FADV_SEQUENTIAL) && defined(POSIX_FADV_WILLNEED)
+	posix_fadvise(fm->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	posix_fadvise(fm->fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif /* POSIX_FADV_SEQUENTIAL and POSIX_FADV_WILLNEED */
+	void * ptr = mmap(NULL, fm->size, PROT_READ, MAP_PRIVATE, fm->fd, 0);
+	if (ptr == MAP_FAILED) {
+		/* fallback to buffered read */
+		close(fm->fd);
+		fm->fd = -1;
+		fm->size = 0;
+		return fm_read(fm, file);
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(ptr, fm->size, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+	fm->data = (char *)ptr;
+	fm->mapped = 1;
+	return FM_OK;
+#else /* PCF_IS_WIN */
+	return fm_read(fm, file);
+#endif /* PCF_IS_WIN */
+}
+
+
+/**
+ * Releases all resources associated with the given file map.
+ *
+ * @param[in,out] fm - file map to close
+ */
+void fm_close(tFileMap * fm) {
+	if (fm == NULL) return;
+#ifdef PCF_IS_NO_WIN
+	if (fm->mapped != 0) {
+		if (fm->data != NULL) munmap(fm->data, fm->size);
+	} else
+#endif /* PCF_IS_NO_WIN */
+	{
+		if (fm->data != NULL) free(fm->data);
+	}
+#ifdef PCF_IS_NO_WIN
+	if (fm->fd >= 0) close(fm->fd);
+	fm->fd = -1;
+#endif /* PCF_IS_NO_WIN */
+	fm->data = NULL;
+	fm->size = 0;
+	fm->mapped = 0;
+}
+
+
+/**
+ * Returns the size of the given file without opening it.
+ *
+ * @param[in] file - file path
+ * @param[out] size - receives the file size in bytes
+ * @return 1 on success, 0 on error
+ */
+int fm_fileSize(const TCHAR * file, uint64_t * size) {
+	if (file == NULL || size == NULL) return 0;
+#ifdef PCF_IS_WIN
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	if (GetFileAttributesEx(file, GetFileExInfoStandard, &attr) == 0) return 0;
+	*size = (((uint64_t)(attr.nFileSizeHigh)) << 32) | (uint64_t)(attr.nFileSizeLow);
+#else /* PCF_IS_NO_WIN */
+	struct stat st;
+	if (stat(file, &st) != 0) return 0;
+	*size = (uint64_t)(st.st_size);
+#endif /* PCF_IS_NO_WIN */
+	return 1;
+}
+
+
+/**
+ * Checks whether the given file is a symbolic link or has more than one hard link. Replacing such
+ * a file by renaming another file over it would change its identity.
+ *
+ * @param[in] file - file path
+ * @return 1 if linked, else 0
+ */
+int fm_isLinked(const TCHAR * file) {
+	if (file == NULL) return 0;
+#ifdef PCF_IS_NO_WIN
+	struct stat st;
+	if (lstat(file, &st) != 0) return 0;
+	if (S_ISLNK(st.st_mode) || st.st_nlink > 1) return 1;
+#endif /* PCF_IS_NO_WIN */
+	return 0;
+}
+
+
+/**
+ * Creates a new temporary file next to the given file with the same owner and access permissions.
+ * The original file remains untouched until fm_replace() is called. This allows to write the
+ * output while the input is still mapped into memory or being read.
+ *
+ * @param[in] file - file to create the sibling for
+ * @param[out] tmpFile - receives the allocated path of the created file
+ * @return opened file for binary writing or NULL on error
+ */
+FILE * fm_createSibling(const TCHAR * file, TCHAR ** tmpFile) {
+	static const TCHAR suffix[] = _T(".XXXXXX");
+	if (file == NULL || tmpFile == NULL) return NULL;
+	const size_t len = _tcslen(file);
+	TCHAR * path = (TCHAR *)malloc((len + (sizeof(suffix) / sizeof(*suffix))) * sizeof(TCHAR));
+	if (path == NULL) return NULL;
+	memcpy(path, file, len * sizeof(TCHAR));
+	memcpy(path + len, suffix, sizeof(suffix));
+#ifdef PCF_IS_WIN
+#ifdef UNICODE
+	FILE * fp = (_wmktemp(path) != NULL) ? _tfopen(path, _T("wb")) : NULL;
+#else /* not UNICODE */
+	FILE * fp = (_mktemp(path) != NULL) ? _tfopen(path, _T("wb")) : NULL;
+#endif /* not UNICODE */
+	if (fp == NULL) {
+		free(path);
+		return NULL;
+	}
+#else /* PCF_IS_NO_WIN */
+	const int fd = mkstemp(path);
+	if (fd < 0) {
+		free(path);
+		return NULL;
+	}
+	struct stat st;
+	if (stat(file, &st) == 0) {
+		if (fchown(fd, st.st_uid, st.st_gid) != 0) {
+			/* without privileges only the group may be changed if at all */
+			const int ignored = fchown(fd, (uid_t)-1, st.st_gid);
+			PCF_UNUSED(ignored)
+		}
+		fchmod(fd, st.st_mode & 07777);
+	}
+	FILE * fp = fdopen(fd, "wb");
+	if (fp == NULL) {
+		close(fd);
+		unlink(path);
+		free(path);
+		return NULL;
+	}
+#endif /* PCF_IS_NO_WIN */
+	*tmpFile = path;
+	return fp;
+}
+
+
+#ifdef PCF_IS_NO_WIN
+/**
+ * Overwrites the content of the given file with the content of the passed temporary file. The
+ * identity of the file is kept.
+ *
+ * @param[in] tmpFile - temporary file created by fm_createSibling()
+ * @param[in] file - file to overwrite
+ * @return 1 on success, 0 on error
+ */
+static int fm_rewrite(const TCHAR * tmpFile, const TCHAR * file) {
+	int res = 0;
+	struct stat st;
+	const int srcFd = open(tmpFile, O_RDONLY);
+	if (srcFd < 0) return 0;
+	if (fstat(srcFd, &st) == 0) {
+		const int dstFd = open(file, O_WRONLY | O_TRUNC);
+		if (dstFd >= 0) {
+			res = fc_copy(dstFd, srcFd, 0, (uint64_t)(st.st_size));
+			if (close(dstFd) != 0) res = 0;
+		}
+	}
+	close(srcFd);
+	return res;
+}
+#endif /* PCF_IS_NO_WIN */
+
+
+/**
+ * Atomically replaces the given file with the passed temporary file. A symbolic or hard linked
+ * file is overwritten in-place instead (not atomic) to keep its identity. The temporary file is
+ * removed in any case.
+ *
+ * @param[in] tmpFile - temporary file created by fm_createSibling()
+ * @param[in] file - file to replace
+ * @return 1 on success, 0 on error
+ */
+int fm_replace(const TCHAR * tmpFile, const TCHAR * file) {
+	if (tmpFile == NULL || file == NULL) return 0;
+#ifdef PCF_IS_NO_WIN
+	if (fm_isLinked(file) != 0) {
+		const int res = fm_rewrite(tmpFile, file);
+		fm_discard(tmpFile);
+		return res;
+	}
+#endif /* PCF_IS_NO_WIN */
+#ifdef PCF_IS_WIN
+	if (MoveFileEx(tmpFile, file, MOVEFILE_REPLACE_EXISTING) == 0) {
+#else /* PCF_IS_NO_WIN */
+	if (_trename(tmpFile, file) != 0) {
+#endif /* PCF_IS_NO_WIN */
+		fm_discard(tmpFile);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Removes the given temporary file.
+ *
+ * @param[in] tmpFile - temporary file created by fm_createSibling()
+ */
+void fm_discard(const TCHAR * tmpFile) {
+	if (tmpFile == NULL) return;
+#ifdef PCF_IS_WIN
+	DeleteFile(tmpFile);
+#else /* PCF_IS_NO_WIN */
+	unlink(tmpFile);
+#endif /* PCF_IS_NO_WIN */
+}
@@ -0,0 +1,73 @@
+/**
+ * @file fmap.h
+ * @author Daniel Starke
+ * @see fmap.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __FMAP_H__
+#define __FMAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "target.h"
+#include "tchar.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Enumeration of possible file mapping results. */
+typedef enum {
+	FM_OK = 0,
+	FM_ERR_OPEN,
+	FM_ERR_NO_MEM,
+	FM_ERR_READ
+} tFileMapResult;
+
+
+/**
+ * Read-only view of a complete input file. The content is either mapped into memory or read into
+ * an allocated buffer if mapping is not possible.
+ */
+typedef struct {
+	char * data;               /**< pointer to the file content */
+	size_t size;               /**< file content size in bytes */
+	int mapped;                /**< 1 if data is a memory mapping, 0 if allocated */
+#ifdef PCF_IS_NO_WIN
+	int fd;                    /**< file descriptor of the mapped file or -1 */
+#endif /* PCF_IS_NO_WIN */
+} tFileMap;
+
+
+tFileMapResult fm_open(tFileMap * fm, const TCHAR * file);
+void fm_close(tFileMap * fm);
+int fm_fileSize(const TCHAR * file, uint64_t * size);
+int fm_isLinked(const TCHAR * file);
+FILE * fm_createSibling(const TCHAR * file, TCHAR ** tmpFile);
+int fm_replace(const TCHAR * tmpFile, const TCHAR * file);
+void fm_discard(const TCHAR * tmpFile);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __FMAP_H__ */
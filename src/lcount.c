@@ -0,0 +1,184 @@
+/**
+ * @file lcount.c
+ * @author Daniel Starke
+ * @see lcount.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include "lcount.h"
+
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+/** SSE2 is available at compile time. */
+#define LC_HAS_SSE2 1
+#include <emmintrin.h>
+#endif /* SSE2 */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/** AVX2 and AVX-512 are selected at run-time. */
+#define LC_HAS_X86_DISPATCH 1
+#include <immintrin.h>
+#endif /* GCC/Clang on x86 */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+/** NEON is available at compile time. */
+#define LC_HAS_NEON 1
+#include <arm_neon.h>
+#endif /* NEON */
+
+
+/**
+ * Counts the line breaks within the given data one byte at a time. This is the reference for the
+ * vectorized variants.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+size_t lc_countScalar(const char * buf, const size_t len) {
+	size_t res = 0;
+	if (buf == NULL) return 0;
+	for (size_t i = 0; i < len; i++) {
+		if (buf[i] == '\n') res++;
+	}
+	return res;
+}
+
+
+#ifdef LC_HAS_SSE2
+/**
+ * Counts the line breaks using SSE2. The compare results are accumulated in 8-bit lanes for up to
+ * 255 blocks and summed up horizontally afterwards.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+static size_t lc_countSse2(const char * buf, const size_t len) {
+	const __m128i nl = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+	size_t res = 0;
+	size_t i = 0;
+	while ((len - i) >= 16) {
+		__m128i acc = zero;
+		for (size_t n = PCF_MIN((len - i) / 16, (size_t)255); n > 0; n--, i += 16) {
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i)), nl));
+		}
+		const __m128i sum = _mm_sad_epu8(acc, zero);
+		res += (size_t)_mm_cvtsi128_si32(sum) + (size_t)_mm_extract_epi16(sum, 4);
+	}
+	return res + lc_countScalar(buf + i, len - i);
+}
+#endif /* LC_HAS_SSE2 */
+
+
+#ifdef LC_HAS_X86_DISPATCH
+/**
+ * Counts the line breaks using AVX2. See lc_countSse2().
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+__attribute__((target("avx2")))
+static size_t lc_countAvx2(const char * buf, const size_t len) {
+	const __m256i nl = _mm256_set1_epi8('\n');
+	const __m256i zero = _mm256_setzero_si256();
+	size_t res = 0;
+	size_t i = 0;
+	while ((len - i) >= 32) {
+		__m256i acc = zero;
+		for (size_t n = PCF_MIN((len - i) / 32, (size_t)255); n > 0; n--, i += 32) {
+			acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf + i)), nl));
+		}
+		const __m256i sum4 = _mm256_sad_epu8(acc, zero);
+		const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sum4), _mm256_extracti128_si256(sum4, 1));
+		res += (size_t)_mm_cvtsi128_si32(sum) + (size_t)_mm_extract_epi16(sum, 4);
+	}
+	return res + lc_countScalar(buf + i, len - i);
+}
+
+
+/**
+ * Counts the line breaks using AVX-512BW. The compare results are returned as bit mask and counted
+ * directly.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+__attribute__((target("avx512bw,popcnt")))
+static size_t lc_countAvx512(const char * buf, const size_t len) {
+	const __m512i nl = _mm512_set1_epi8('\n');
+	size_t res = 0;
+	size_t i = 0;
+	for (; (len - i) >= 64; i += 64) {
+		res += (size_t)__builtin_popcountll((unsigned long long)_mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *)(buf + i)), nl));
+	}
+	return res + lc_countScalar(buf + i, len - i);
+}
+#endif /* LC_HAS_X86_DISPATCH */
+
+
+#ifdef LC_HAS_NEON
+/**
+ * Counts the line breaks using NEON. See lc_countSse2().
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+static size_t lc_countNeon(const char * buf, const size_t len) {
+	const uint8x16_t nl = vdupq_n_u8('\n');
+	size_t res = 0;
+	size_t i = 0;
+	while ((len - i) >= 16) {
+		uint8x16_t acc = vdupq_n_u8(0);
+		for (size_t n = PCF_MIN((len - i) / 16, (size_t)255); n > 0; n--, i += 16) {
+			acc = vsubq_u8(acc, vceqq_u8(vld1q_u8((const uint8_t *)(buf + i)), nl));
+		}
+		const uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+		res += (size_t)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+	}
+	return res + lc_countScalar(buf + i, len - i);
+}
+#endif /* LC_HAS_NEON */
+
+
+/**
+ * Counts the line breaks within the given data with the fastest variant supported by the CPU.
+ * The data may be of any alignment. Consecutive chunks of the same input can be counted
+ * independently and summed up.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return number of line breaks
+ */
+size_t lc_count(const char * buf, const size_t len) {
+	if (buf == NULL) return 0;
+#ifdef LC_HAS_X86_DISPATCH
+	if (len >= 64 && __builtin_cpu_supports("avx512bw")) return lc_countAvx512(buf, len);
+	if (len >= 32 && __builtin_cpu_supports("avx2")) return lc_countAvx2(buf, len);
+#endif /* LC_HAS_X86_DISPATCH */
+#if defined(LC_HAS_SSE2)
+	return lc_countSse2(buf, len);
+#elif defined(LC_HAS_NEON)
+	return lc_countNeon(buf, len);
+#else /* no SIMD */
+	return lc_countScalar(buf, len);
+#endif /* no SIMD */
+}
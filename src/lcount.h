@@ -0,0 +1,42 @@
+/**
+ * @file lcount.h
+ * @author Daniel Starke
+ * @see lcount.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LCOUNT_H__
+#define __LCOUNT_H__
+
+#include <stddef.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+size_t lc_countScalar(const char * buf, const size_t len);
+size_t lc_count(const char * buf, const size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __LCOUNT_H__ */
@@ -0,0 +1,4326 @@
+/**
+ * @file libsm2pspp.c
+ * @author Daniel Starke
+ * @see libsm2pspp.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ * 
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsm2pspp.h"
+#include "base64.h"
+#include "fcopy.h"
+#include "fmap.h"
+#include "lcount.h"
+#include "parser.h"
+#include "serial.h"
+#include "thread.h"
+#include "upload.h"
+#include "uring.h"
+#ifdef PCF_IS_NO_WIN
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* PCF_IS_NO_WIN */
+#ifdef PCF_IS_LINUX
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif /* PCF_IS_LINUX */
+
+
+const TCHAR * fmsg[MSG_COUNT] = {
+	/* MSGT_SUCCESS                    */ _T(""), /* never used for output */
+	/* MSGT_ERR_NO_MEM                 */ _T("Error: Failed to allocate memory.\n"),
+	/* MSGT_ERR_FILE_NOT_FOUND         */ _T("Error: Input file not found.\n"),
+	/* MSGT_ERR_FILE_OPEN              */ _T("Error: Failed to open file for reading.\n"),
+	/* MSGT_ERR_FILE_READ              */ _T("Error: Failed to read data from file.\n"),
+	/* MSGT_ERR_FILE_CREATE            */ _T("Error: Failed to create file for writing.\n"),
+	/* MSGT_ERR_FILE_WRITE             */ _T("Error: Failed to write data to file.\n"),
+	/* MSGT_ERR_WATCH                  */ _T("Error: Failed to watch directory.\n"),
+	/* MSGT_ERR_SERVE                  */ _T("Error: Failed to serve on socket.\n"),
+	/* MSGT_ERR_UPLOAD                 */ _T("Error: Failed to upload file.\n"),
+	/* MSGT_ERR_STREAM                 */ _T("Error: Failed to stream file to printer.\n"),
+	/* MSGT_WARN_NO_FILAMENT_USED      */ _T("Warning: Filament used value not found.\n"),
+	/* MSGT_WARN_NO_LAYER_HEIGHT       */ _T("Warning: Layer height value not found.\n"),
+	/* MSGT_WARN_NO_EST_TIME           */ _T("Warning: Estimated time value not found.\n"),
+	/* MSGT_WARN_NO_NOZZLE_TEMP        */ _T("Warning: Nozzle temperature value not found.\n"),
+	/* MSGT_WARN_NO_PLATE_TEMP         */ _T("Warning: Building plate temperature value not found.\n"),
+	/* MSGT_WARN_NO_PRINT_SPEED        */ _T("Warning: Print speed value not found.\n"),
+	/* MSGT_WARN_NO_THUMBNAIL          */ _T("Warning: Thumbnail data not found.\n"),
+	/* MSGT_WARN_NO_MAX_SIZE           */ _T("Warning: Size data not found.\n"),
+	/* MSGT_WARN_SLOT_TOO_SMALL        */ _T("Warning: Reserved header slot is too small.\n"),
+	/* MSGT_WARN_INVALID_THUMBNAIL     */ _T("Warning: Thumbnail data is not valid Base64.\n"),
+	/* MSGT_WARN_THUMBNAIL_RECODE      */ _T("Warning: Thumbnail image could not be re-encoded.\n"),
+	/* MSGT_WARN_THUMBNAIL_TOO_LARGE   */ _T("Warning: Thumbnail image exceeds the size limit.\n")
+};
+
+
+/**
+ * Parses the given dhms time token and returns the value in seconds.
+ * 
+ * @param[in] aToken - input token
+ * @return time in seconds
+ */
+static size_t p_dtms(const tPToken * aToken) {
+	if (aToken->start == NULL || aToken->length <= 0) return 0;
+	size_t res = 0;
+	size_t val = 0;
+	for (size_t i = 0; i < aToken->length; i++) {
+		const char ch = aToken->start[i];
+		switch (ch) {
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			val = (val * 10) + ((size_t)(ch - '0'));
+			break;
+		case 'd':
+			res = res + (val * 86400);
+			val = 0;
+			break;
+		case 'h':
+			res = res + (val * 3600);
+			val = 0;
+			break;
+		case 'm':
+			res = res + (val * 60);
+			val = 0;
+			break;
+		case 's':
+			res = res + val;
+			val = 0;
+			break;
+		default:
+			break;
+		}
+	}
+	return res;
+}
+
+
+/**
+ * Converts the given token into a float value. Simple float values are assumed.
+ * 
+ * @param[in] aToken - token to convert
+ * @return float value from the token
+ */
+static float p_float(const tPToken * aToken) {
+	if (aToken->start == NULL || aToken->length <= 0) return 0.0f;
+	size_t val = 0;
+	size_t frac = 0;
+	float fracDiv = 1.0f;
+	int isFrac = 0;
+	for (size_t i = 0; i < aToken->length; i++) {
+		const char ch = aToken->start[i];
+		switch (ch) {
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			if (isFrac == 0) {
+				val = (val * 10) + ((size_t)(ch - '0'));
+			} else {
+				frac = (frac * 10) + ((size_t)(ch - '0'));
+				fracDiv *= 10.0f;
+			}
+			break;
+		case '.':
+			isFrac = 1;
+			break;
+		default:
+			break;
+		}
+	}
+	return (float)val + ((float)frac / fracDiv);
+}
+
+
+/** Byte range within the input file. */
+typedef struct {
+	uint64_t start;            /**< offset from the start of the file */
+	uint64_t length;           /**< number of bytes */
+} tFileRange;
+
+
+/** Indices of the collected G-Code parameter values. */
+typedef enum {
+	VAL_FILAMENT_USED,
+	VAL_LAYER_HEIGHT,
+	VAL_EST_TIME,
+	VAL_NOZZLE_TEMP,
+	VAL_PLATE_TEMP,
+	VAL_PRINT_SPEED,
+	VAL_MAX_X,
+	VAL_MAX_Y,
+	VAL_MAX_Z,
+	VAL_COUNT
+} tValue;
+
+
+/** Recognized comment markers. */
+typedef enum {
+	MARK_NONE,
+	MARK_PROCESSED,
+	MARK_THUMBNAIL_BEGIN,
+	MARK_THUMBNAIL_END,
+	MARK_SLOT_BEGIN,
+	MARK_SLOT_END
+} tMarker;
+
+
+/**
+ * Returns the dispatch hash of a key from its length and its first and last character. The result
+ * is a constant expression for constant arguments to be usable as case label.
+ */
+#define P_KEY_HASH(len, first, last) ((((uint32_t)(len)) << 16) | (((uint32_t)(unsigned char)(first)) << 8) | ((uint32_t)(unsigned char)(last)))
+
+
+/**
+ * Recognized parameter keys with their first and last character and the associated value. The
+ * keys need to differ in length, first or last character. Collisions fail to compile as duplicate
+ * case labels. Mismatching characters are found by etc/keys-test.c (`make test`). See
+ * p_findParameter().
+ */
+#define P_PARAMETER_KEYS(X) \
+	X("filament used [mm]",          'f', ']', VAL_FILAMENT_USED) \
+	X("layer_height",                'l', 't', VAL_LAYER_HEIGHT) \
+	X("first_layer_temperature",     'f', 'e', VAL_NOZZLE_TEMP) \
+	X("first_layer_bed_temperature", 'f', 'e', VAL_PLATE_TEMP) \
+	X("max_print_speed",             'm', 'd', VAL_PRINT_SPEED) \
+	X("max_x",                       'm', 'x', VAL_MAX_X) \
+	X("max_y",                       'm', 'y', VAL_MAX_Y) \
+	X("max_z",                       'm', 'z', VAL_MAX_Z)
+
+
+/** Parameter key which is matched by its start. */
+#define P_PARAMETER_EST_TIME "estimated printing time"
+
+
+/** Recognized comment markers. See P_PARAMETER_KEYS and p_findMarker(). */
+#define P_MARKER_KEYS(X) \
+	X("post-processed by sm2pspp",   'p', 'p', MARK_PROCESSED) \
+	X("thumbnail begin",             't', 'n', MARK_THUMBNAIL_BEGIN) \
+	X("thumbnail end",               't', 'd', MARK_THUMBNAIL_END) \
+	X("sm2pspp header slot begin",   's', 'n', MARK_SLOT_BEGIN) \
+	X("sm2pspp header slot end",     's', 'd', MARK_SLOT_END)
+
+
+/**
+ * Case label of the key dispatch switch. Returns the associated id if the key matches. The first
+ * and last character are given separately as case labels need integer constant expressions.
+ */
+#define P_KEY_CASE(str, first, last, id) \
+	case P_KEY_HASH(sizeof(str) - 1, first, last): \
+		if (memcmp(key, str, sizeof(str) - 1) == 0) return id; \
+		break;
+
+
+/**
+ * Returns the value associated with the given parameter key token.
+ * 
+ * @param[in] aToken - key token
+ * @return value index or VAL_COUNT if not recognized
+ */
+static tValue p_findParameter(const tPToken * aToken) {
+	const char * key = aToken->start;
+	const size_t len = aToken->length;
+	if (key == NULL || len < 1) return VAL_COUNT;
+	if (len <= 0xFFFF) {
+		switch (P_KEY_HASH(len, key[0], key[len - 1])) {
+		P_PARAMETER_KEYS(P_KEY_CASE)
+		default: break;
+		}
+	}
+	if (len >= (sizeof(P_PARAMETER_EST_TIME) - 1) && memcmp(key, P_PARAMETER_EST_TIME, sizeof(P_PARAMETER_EST_TIME) - 1) == 0) {
+		return VAL_EST_TIME;
+	}
+	return VAL_COUNT;
+}
+
+
+/**
+ * Returns the marker matching the given comment token.
+ * 
+ * @param[in] aToken - comment token
+ * @return matching marker or MARK_NONE
+ */
+static tMarker p_findMarker(const tPToken * aToken) {
+	const char * key = aToken->start;
+	const size_t len = aToken->length;
+	if (key == NULL || len < 1 || len > 0xFFFF) return MARK_NONE;
+	switch (P_KEY_HASH(len, key[0], key[len - 1])) {
+	P_MARKER_KEYS(P_KEY_CASE)
+	default: break;
+	}
+	return MARK_NONE;
+}
+
+
+#undef P_KEY_CASE
+
+
+/** Possible scanner states. */
+typedef enum {
+	ST_LINE_START,
+	ST_FIND_LINE_START,
+	ST_COMMENT,
+	ST_PARAMETER_VALUE,
+	ST_THUMBNAIL,
+	ST_THUMBNAIL_TAIL
+} tScanState;
+
+
+/** Maximum number of input file ranges output after the header. */
+#define BODY_RANGES (MAX_THUMBNAILS + 1)
+
+
+/** Thumbnail block of the input file. */
+typedef struct {
+	tFileRange block;          /**< thumbnail including the enclosing comments */
+	tFileRange data;           /**< Base64 encoded image data (PNG) */
+	size_t lines;              /**< number of lines of the block */
+} tThumbnailBlock;
+
+
+/**
+ * G-Code scanner context. All positions are kept as file offsets to allow scanning the input in
+ * consecutive chunks.
+ */
+typedef struct {
+	tScanState state;          /**< current parser state */
+	size_t lineNr;             /**< current line number */
+	uint64_t lineStart;        /**< file offset of the current line start */
+	uint64_t commentStart;     /**< file offset of the current comment line */
+	int processed;             /**< 1 if the file was already post-processed, else 0 */
+	int hasThumbnail;          /**< 1 if the start of the thumbnail data was found, else 0 */
+	tFileRange thumbnail;      /**< Base64 encoded data of the selected thumbnail image (PNG) */
+	size_t thumbnailCount;     /**< number of complete thumbnail blocks */
+	tThumbnailBlock thumbnailBlock[MAX_THUMBNAILS]; /**< thumbnail blocks in file order */
+	char * preview;            /**< allocated Base64 encoded toolpath preview (PNG) or NULL */
+	size_t previewLength;      /**< length of the toolpath preview in bytes */
+	tPToken value[VAL_COUNT];  /**< collected parameter values */
+	tPToken aToken;            /**< current key token (valid within the current line) */
+	tPToken * valueToken;      /**< current value token (valid within the current line) */
+	int hasSlot;               /**< 1 if the start of the reserved header slot was found, else 0 */
+	size_t slotLines;          /**< number of lines of the reserved header slot */
+	tFileRange slot;           /**< reserved header slot including the enclosing comments */
+} tScanner;
+
+
+/** Layout constraints of the generated header. */
+typedef struct {
+	size_t extraLines;         /**< number of lines added to the body */
+	size_t removedLines;       /**< number of lines removed from the body */
+	size_t align;              /**< output alignment in bytes or 0 */
+	uint64_t target;           /**< body output offset modulo the alignment */
+	size_t length;             /**< exact header length in bytes or 0 */
+} tHeaderLayout;
+
+
+/**
+ * Initializes the given scanner context.
+ * 
+ * @param[out] sc - scanner context
+ */
+static void p_scanInit(tScanner * sc) {
+	memset(sc, 0, sizeof(*sc));
+	sc->state = ST_LINE_START;
+	sc->lineNr = 1;
+}
+
+
+/**
+ * Scans the given chunk of the input file. Consecutive calls need to pass consecutive chunks. The
+ * passed chunk needs to stay valid until the collected value tokens are no longer needed unless
+ * they are pinned via p_scanPin() after this call. Only comment lines are processed character by
+ * character. All other lines are skipped via memchr() once their first character is known
+ * (see FEATURE_LINE_SKIP).
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in] buf - chunk data
+ * @param[in] len - chunk data length in bytes
+ * @param[in] offset - file offset of the chunk data
+ * @return 1 to continue, 0 if the file was already post-processed
+ */
+static int p_scan(tScanner * sc, const char * buf, const size_t len, const uint64_t offset) {
+#ifdef DEBUG
+	static const TCHAR * stateStr[] = {
+		_T("ST_LINE_START"),
+		_T("ST_FIND_LINE_START"),
+		_T("ST_COMMENT"),
+		_T("ST_PARAMETER_VALUE"),
+		_T("ST_THUMBNAIL"),
+		_T("ST_THUMBNAIL_TAIL")
+	};
+#endif /* DEBUG */
+	tPToken * const value = sc->value;
+	tPToken * const aToken = &(sc->aToken);
+	/* current thumbnail block (only accessed while fewer than MAX_THUMBNAILS were found) */
+	tThumbnailBlock * block = sc->thumbnailBlock + ((sc->thumbnailCount < MAX_THUMBNAILS) ? sc->thumbnailCount : 0);
+	for (const char * it = buf, * endIt = buf + len; it < endIt; it++) {
+		const char ch = *it;
+		uint64_t pos = offset + (uint64_t)(it - buf);
+#ifdef DEBUG
+		_ftprintf(stderr, _T("%u:%s: '%c'"), (unsigned)(sc->lineNr), stateStr[(int)(sc->state)], ch);
+		if (aToken->start != NULL) {
+#ifdef UNICODE
+			_ftprintf(stderr, _T(", token: \"%.*S\""), (unsigned)aToken->length, aToken->start);
+#else /* not UNICODE */
+			_ftprintf(stderr, _T(", token: \"%.*s\""), (unsigned)aToken->length, aToken->start);
+#endif /* not UNICODE */
+		}
+		if (sc->valueToken != NULL && sc->valueToken->start != NULL) {
+#ifdef UNICODE
+			_ftprintf(stderr, _T(", value: \"%.*S\""), (unsigned)sc->valueToken->length, sc->valueToken->start);
+#else /* not UNICODE */
+			_ftprintf(stderr, _T(", value: \"%.*s\""), (unsigned)sc->valueToken->length, sc->valueToken->start);
+#endif /* not UNICODE */
+		}
+		_ftprintf(stderr, _T("\n"));
+#endif /* DEBUG */
+		switch (sc->state) {
+		case ST_LINE_START:
+			 if (ch == ';') {
+				/* comment */
+				memset(aToken, 0, sizeof(*aToken));
+				sc->commentStart = pos;
+				sc->state = ST_COMMENT;
+			} else if (isspace(ch) == 0) {
+				/* code */
+				sc->state = ST_FIND_LINE_START;
+			}
+			/* spaces */
+			break;
+		case ST_FIND_LINE_START:
+#ifdef FEATURE_LINE_SKIP
+			if (ch != '\n') {
+				/* skip the rest of the line */
+				const char * lineEnd = (const char *)memchr(it, '\n', (size_t)(endIt - it));
+				if (lineEnd == NULL) return 1;
+				it = lineEnd;
+				pos = offset + (uint64_t)(it - buf);
+			}
+#else /* !FEATURE_LINE_SKIP */
+			if (ch != '\n') break;
+#endif /* !FEATURE_LINE_SKIP */
+			/* new line */
+			sc->state = ST_LINE_START;
+			break;
+		case ST_COMMENT:
+			if (ch == '\n') {
+				/* end of comment line */
+				switch (p_findMarker(aToken)) {
+				case MARK_SLOT_BEGIN:
+					if (sc->hasSlot == 0) {
+						sc->hasSlot = 1;
+						sc->slot.start = sc->commentStart;
+						sc->slotLines = sc->lineNr;
+					}
+					break;
+				case MARK_SLOT_END:
+					if (sc->hasSlot != 0 && sc->slot.length == 0) {
+						sc->slot.length = pos + 1 - sc->slot.start;
+						sc->slotLines = sc->lineNr + 1 - sc->slotLines;
+					}
+					break;
+				default:
+					break;
+				}
+				sc->state = ST_LINE_START;
+			} else if (aToken->start == NULL) {
+				if (isspace(ch) == 0) {
+					/* start of first word in comment */
+					aToken->start = it;
+					aToken->length = 1;
+				}
+			} else if (ch == ' ' && aToken->length > 0) {
+				const tMarker marker = p_findMarker(aToken);
+				if (marker == MARK_PROCESSED) {
+					/* already post-processed file */
+					sc->processed = 1;
+					return 0;
+				} else if (marker == MARK_THUMBNAIL_BEGIN) {
+					memset(aToken, 0, sizeof(*aToken));
+					if (sc->thumbnailCount < MAX_THUMBNAILS) {
+						memset(block, 0, sizeof(*block));
+						block->block.start = sc->lineStart;
+						block->lines = 1;
+						sc->state = ST_THUMBNAIL;
+					} else {
+						sc->state = ST_FIND_LINE_START;
+					}
+				}
+			} else if (ch == '=') {
+				/* end of commented parameter key */
+				if (aToken->length == 0) {
+					aToken->length = (size_t)(it - aToken->start);
+				}
+				const tValue val = p_findParameter(aToken);
+				if (val != VAL_COUNT) {
+					sc->valueToken = value + val;
+				} else {
+					sc->state = ST_FIND_LINE_START;
+				}
+				if (sc->valueToken != NULL) {
+					memset(aToken, 0, sizeof(*aToken));
+					if (sc->valueToken->start == NULL) {
+						sc->state = ST_PARAMETER_VALUE;
+					} else {
+						/* ignore duplicate keys */
+						sc->valueToken = NULL;
+						sc->state = ST_FIND_LINE_START;
+					}
+				}
+			} else if (isspace(ch) == 0) {
+				/* ignore trailing spaces */
+				aToken->length = (size_t)(it - aToken->start + 1);
+			}
+			break;
+		case ST_PARAMETER_VALUE:
+			if (ch == '\n') {
+				/* end of comment line */
+				sc->valueToken = NULL;
+				sc->state = ST_LINE_START;
+			} else if (sc->valueToken->start == NULL) {
+				if (isspace(ch) == 0) {
+					/* start of comment parameter value */
+					sc->valueToken->start = it;
+					sc->valueToken->length = 1;
+				}
+			} else if (isspace(ch) == 0) {
+				/* ignore trailing spaces */
+				sc->valueToken->length = (size_t)(it - sc->valueToken->start + 1);
+			}
+			break;
+		case ST_THUMBNAIL:
+			if (ch == '\n') {
+				/* count thumbnail lines to compensate cut */
+				block->lines++;
+			}
+			if (block->data.start == 0) {
+				if (ch == '\n') {
+					/* start of thumbnail data */
+					sc->hasThumbnail = 1;
+					block->data.start = pos + 1;
+				}
+			} else if (ch == ';') {
+				/* start of comment */
+				aToken->start = it + 1;
+				aToken->length = 0;
+			} else if (aToken->start != NULL) {
+				if (isspace(aToken->start[0]) != 0) {
+					/* ignore leading spaces */
+					aToken->start = it;
+					aToken->length = 1;
+				} else {
+					aToken->length++;
+					if (p_findMarker(aToken) == MARK_THUMBNAIL_END) {
+						/* got complete Base64 encoded thumbnail image data (PNG) */
+						block->data.length = sc->lineStart - block->data.start;
+						block->block.length = pos - block->block.start;
+						if (sc->thumbnailCount == 0) sc->thumbnail = block->data;
+						sc->thumbnailCount++;
+						if (sc->thumbnailCount < MAX_THUMBNAILS) block++;
+						sc->state = ST_THUMBNAIL_TAIL;
+					}
+				}
+			}
+			break;
+		case ST_THUMBNAIL_TAIL:
+			if (ch == '\n') {
+				/* new line */
+				tFileRange * const last = &(sc->thumbnailBlock[sc->thumbnailCount - 1].block);
+				last->length = pos + 1 - last->start;
+				sc->state = ST_LINE_START;
+			}
+			break;
+		}
+		if (*it == '\n') {
+			sc->lineNr++;
+			sc->lineStart = pos + 1;
+		} else if (*it == '\r') {
+			sc->lineStart = pos + 1;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * Returns the offset after the first line break at or after the given offset.
+ * 
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @param[in] offset - start searching here
+ * @return offset of the next line start or len if none
+ */
+static size_t p_nextLine(const char * buf, const size_t len, const size_t offset) {
+	if (offset >= len) return len;
+	const char * it = (const char *)memchr(buf + offset, '\n', len - offset);
+	return (it != NULL) ? (size_t)(it - buf + 1) : len;
+}
+
+
+/**
+ * Returns the start offset of the trailing block of comment and empty lines. PrusaSlicer outputs
+ * the statistics and the configuration in this block.
+ * 
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return start offset of the trailing comment block or len if none
+ */
+static size_t p_tailStart(const char * buf, const size_t len) {
+	size_t tail = len;
+	while (tail > 0) {
+		/* find the start of the line ending at tail */
+		size_t start = tail - 1;
+		while (start > 0 && buf[start - 1] != '\n') start--;
+		size_t i = start;
+		while (i < tail && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\r' || buf[i] == '\n')) i++;
+		if (i < tail && buf[i] != ';') break; /* code line */
+		tail = start;
+	}
+	return tail;
+}
+
+
+/**
+ * Returns whether the head region scanned by p_scanSelective() extends beyond the given offset.
+ * 
+ * @param[in] sc - scanner context
+ * @param[in] offset - line start offset of the next chunk
+ * @return 1 if the next chunk is part of the head region, else 0
+ */
+static int p_scanInHead(const tScanner * sc, const uint64_t offset) {
+	uint64_t limit = SCAN_HEAD_SIZE;
+	/* complete thumbnail blocks are needed */
+	if (sc->state == ST_THUMBNAIL) return 1;
+	if (sc->thumbnailCount > 0) {
+		const tFileRange * last = &(sc->thumbnailBlock[sc->thumbnailCount - 1].block);
+		limit += last->start + last->length;
+	}
+	/* complete reserved header slot is needed */
+	if (sc->hasSlot != 0 && sc->slot.length == 0) return 1;
+	return (offset < limit) ? 1 : 0;
+}
+
+
+/**
+ * Returns whether the scanner collected all values and the thumbnail data.
+ * 
+ * @param[in] sc - scanner context
+ * @return 1 if complete, else 0
+ */
+static int p_scanComplete(const tScanner * sc) {
+	for (size_t i = 0; i < VAL_COUNT; i++) {
+		if (sc->value[i].start == NULL || sc->value[i].length == 0) return 0;
+	}
+	return (sc->hasThumbnail != 0 && sc->thumbnail.length != 0) ? 1 : 0;
+}
+
+
+/** Chunk of a concurrently scanned input file. */
+typedef struct {
+	const char * buf;          /**< chunk data */
+	size_t len;                /**< chunk data length in bytes */
+	uint64_t offset;           /**< file offset of the chunk data */
+	int countOnly;             /**< 1 to count the line breaks and collect the values only, 0 to scan the chunk */
+	size_t lines;              /**< number of line breaks (if countOnly is set) */
+	int thumbnail;             /**< 1 if a thumbnail block begins within the chunk (if countOnly is set) */
+	int res;                   /**< p_scan() result (if countOnly is not set) */
+	tScanner sc;               /**< scanner context of the chunk (only values if countOnly is set) */
+} tScanChunk;
+
+
+/**
+ * Collects the commented parameter values of the given data like p_scan() without passing every
+ * line through it. Only lines containing a '=' can hold a value and only comment lines whose first
+ * word starts with 't' can begin a thumbnail block. These are found via memchr() and scanned each
+ * with a fresh scanner context. Values already collected are kept (first occurrence wins). The
+ * search stops at the first thumbnail block as the caller needs to scan the data completely then.
+ * 
+ * @param[in,out] sc - scanner context receiving the values
+ * @param[in] buf - data starting at a line start
+ * @param[in] len - data length in bytes
+ * @param[in] offset - file offset of the data
+ * @return 1 if a thumbnail block begins within the data, else 0
+ */
+static int p_scanValues(tScanner * sc, const char * buf, const size_t len, const uint64_t offset) {
+	tScanner lineSc;
+	const char * eq = (const char *)memchr(buf, '=', len);
+	const char * semi = (const char *)memchr(buf, ';', len);
+	size_t start = 0;
+	while (eq != NULL || semi != NULL) {
+		const char * hit = (semi == NULL || (eq != NULL && eq < semi)) ? eq : semi;
+		size_t lineStart = (size_t)(hit - buf);
+		while (lineStart > start && buf[lineStart - 1] != '\n') lineStart--;
+		const size_t lineEnd = p_nextLine(buf, len, (size_t)(hit - buf));
+		int candidate = (hit == eq) ? 1 : 0;
+		if (candidate == 0) {
+			/* comment line with a first word starting like "thumbnail begin" */
+			const char * it = buf + lineStart;
+			while (it < hit && isspace(*it) != 0) it++;
+			if (it == hit) {
+				for (it++; it < (buf + lineEnd) && *it != '\n' && isspace(*it) != 0; it++);
+				if (it < (buf + lineEnd) && *it == 't') candidate = 1;
+			}
+		}
+		if (candidate != 0) {
+			p_scanInit(&lineSc);
+			p_scan(&lineSc, buf + lineStart, lineEnd - lineStart, offset + (uint64_t)lineStart);
+			if (lineSc.state == ST_THUMBNAIL) return 1;
+			for (size_t i = 0; i < VAL_COUNT; i++) {
+				if (sc->value[i].start == NULL) sc->value[i] = lineSc.value[i];
+			}
+		}
+		start = lineEnd;
+		if (eq != NULL && eq < (buf + start)) eq = (const char *)memchr(buf + start, '=', len - start);
+		if (semi != NULL && semi < (buf + start)) semi = (const char *)memchr(buf + start, ';', len - start);
+	}
+	return 0;
+}
+
+
+/**
+ * Scans or counts the lines of a single chunk with a fresh scanner context.
+ * 
+ * @param[in,out] arg - chunk
+ */
+static void p_scanChunk(void * arg) {
+	tScanChunk * chunk = (tScanChunk *)arg;
+	p_scanInit(&(chunk->sc));
+	if (chunk->countOnly != 0) {
+		chunk->lines = lc_count(chunk->buf, chunk->len);
+		chunk->thumbnail = p_scanValues(&(chunk->sc), chunk->buf, chunk->len, chunk->offset);
+		return;
+	}
+	chunk->sc.lineStart = chunk->offset;
+	chunk->res = p_scan(&(chunk->sc), chunk->buf, chunk->len, chunk->offset);
+}
+
+
+/**
+ * Splits the given data at line boundaries into chunks of at least SCAN_CHUNK_SIZE bytes and
+ * processes them concurrently via p_scanChunk().
+ * 
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @param[in] offset - file offset of the data
+ * @param[in] threads - maximum number of threads
+ * @param[in] countOnly - 1 to count the line breaks and collect the values only, 0 to scan the chunks
+ * @param[out] count - receives the number of chunks
+ * @return allocated chunks or NULL if not split
+ */
+static tScanChunk * p_processChunks(const char * buf, const size_t len, const uint64_t offset, const size_t threads, const int countOnly, size_t * count) {
+	const size_t n = PCF_MIN(threads, len / SCAN_CHUNK_SIZE);
+	tThread * thread = NULL;
+	size_t started = 0;
+	if (n < 2) return NULL;
+	tScanChunk * chunk = (tScanChunk *)calloc(n, sizeof(tScanChunk));
+	if (chunk == NULL) return NULL;
+	thread = (tThread *)malloc((n - 1) * sizeof(tThread));
+	if (thread == NULL) {
+		free(chunk);
+		return NULL;
+	}
+	/* split at line starts */
+	for (size_t i = 0, start = 0; i < n; i++) {
+		const size_t end = (i + 1 < n) ? PCF_MAX(start, p_nextLine(buf, len, ((i + 1) * (len / n)) - 1)) : len;
+		chunk[i].buf = buf + start;
+		chunk[i].len = end - start;
+		chunk[i].offset = offset + (uint64_t)start;
+		chunk[i].countOnly = countOnly;
+		start = end;
+	}
+	/* the calling thread processes the first chunk and those without thread */
+	while (started < (n - 1) && th_create(thread + started, p_scanChunk, chunk + started + 1) == 1) started++;
+	p_scanChunk(chunk);
+	for (size_t i = started + 1; i < n; i++) p_scanChunk(chunk + i);
+	for (size_t i = 0; i < started; i++) th_join(thread + i);
+	free(thread);
+	*count = n;
+	return chunk;
+}
+
+
+/**
+ * Counts the line breaks of the given data and collects the values missing so far via
+ * p_scanValues() using up to the given number of threads.
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in] buf - data starting at a line start
+ * @param[in] len - data length in bytes
+ * @param[in] offset - file offset of the data
+ * @param[in] threads - maximum number of threads
+ * @return 1 if a thumbnail block begins within the data, else 0
+ */
+static int p_scanBody(tScanner * sc, const char * buf, const size_t len, const uint64_t offset, const size_t threads) {
+	size_t count = 0;
+	int res = 0;
+	tScanChunk * chunk = p_processChunks(buf, len, offset, threads, 1, &count);
+	if (chunk == NULL) {
+		sc->lineNr += lc_count(buf, len);
+		return p_scanValues(sc, buf, len, offset);
+	}
+	for (size_t i = 0; i < count; i++) {
+		sc->lineNr += chunk[i].lines;
+		if (chunk[i].thumbnail != 0) res = 1;
+		/* first occurrence wins */
+		for (size_t j = 0; j < VAL_COUNT; j++) {
+			if (sc->value[j].start == NULL) sc->value[j] = chunk[i].sc.value[j];
+		}
+	}
+	free(chunk);
+	return res;
+}
+
+
+/**
+ * Merges the scanner state of the following chunk into the given scanner context. The chunk may
+ * not depend on the thumbnail or reserved header slot state.
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in] chunkSc - chunk scanner context
+ */
+static void p_scanMerge(tScanner * sc, const tScanner * chunkSc) {
+	/* first occurrence wins */
+	for (size_t i = 0; i < VAL_COUNT; i++) {
+		if (sc->value[i].start == NULL) sc->value[i] = chunkSc->value[i];
+	}
+	sc->state = chunkSc->state;
+	sc->lineNr += chunkSc->lineNr - 1;
+	sc->lineStart = chunkSc->lineStart;
+	sc->commentStart = chunkSc->commentStart;
+	sc->processed = chunkSc->processed;
+	sc->aToken = chunkSc->aToken;
+	sc->valueToken = (chunkSc->valueToken != NULL) ? sc->value + (chunkSc->valueToken - chunkSc->value) : NULL;
+}
+
+
+/**
+ * Scans the given complete input file like p_scan() using up to the given number of threads. Each
+ * thread scans a chunk starting at a line start with a fresh scanner context. The chunk results
+ * are merged in order: Values missing so far are taken from the chunk and the line counts are
+ * summed up. This gives the same result as a sequential scan because all scanner states besides
+ * the thumbnail and the reserved header slot are local to a line. Chunks which continue or contain
+ * one of these are scanned again sequentially with the merged scanner context.
+ * 
+ * @param[in,out] sc - initialized scanner context
+ * @param[in] buf - input file content
+ * @param[in] len - input file length in bytes
+ * @param[in] threads - maximum number of threads
+ * @return 1 to continue, 0 if the file was already post-processed
+ */
+static int p_scanParallel(tScanner * sc, const char * buf, const size_t len, const size_t threads) {
+	size_t count = 0;
+	int res;
+	tScanChunk * chunk = p_processChunks(buf, len, 0, threads, 0, &count);
+	if (chunk == NULL) return p_scan(sc, buf, len, 0);
+	*sc = chunk[0].sc;
+	if (sc->valueToken != NULL) sc->valueToken = sc->value + (chunk[0].sc.valueToken - chunk[0].sc.value);
+	res = chunk[0].res;
+	for (size_t i = 1; i < count && res != 0; i++) {
+		const tScanner * chunkSc = &(chunk[i].sc);
+		if (sc->state != ST_LINE_START || (sc->hasSlot != 0 && sc->slot.length == 0)
+			|| chunkSc->state == ST_THUMBNAIL || chunkSc->hasThumbnail != 0 || chunkSc->thumbnailCount != 0
+			|| chunkSc->hasSlot != 0) {
+			/* chunk depends on the preceding scanner state */
+			res = p_scan(sc, chunk[i].buf, chunk[i].len, chunk[i].offset);
+			continue;
+		}
+		p_scanMerge(sc, chunkSc);
+		res = chunk[i].res;
+	}
+	free(chunk);
+	return res;
+}
+
+
+/**
+ * Scans the given complete input file selectively. The first line is probed for the
+ * post-processed marker. The head region up to SCAN_HEAD_SIZE bytes after the thumbnail and the
+ * trailing comment block are scanned with p_scan(). Only the line breaks are counted in between via
+ * lc_count() and the lines which may hold a value are scanned via p_scanValues(). This keeps the
+ * first occurrence of each value like a complete scan, i.e. a value in the body takes precedence
+ * over the same key in the trailing comment block. The whole file is scanned with p_scanParallel()
+ * if values are missing afterwards or a thumbnail block begins in between. This way all original
+ * thumbnail blocks are found like with a complete scan.
+ * 
+ * @param[in,out] sc - initialized scanner context
+ * @param[in] buf - input file content
+ * @param[in] len - input file length in bytes
+ * @param[in] threads - maximum number of threads
+ * @return 1 to continue, 0 if the file was already post-processed
+ */
+static int p_scanSelective(tScanner * sc, const char * buf, const size_t len, const size_t threads) {
+	size_t head = 0;
+	size_t end = p_nextLine(buf, len, 0);
+	/* scan head region starting with the first line */
+	for (;;) {
+		if (p_scan(sc, buf + head, end - head, (uint64_t)head) == 0) return 0;
+		head = end;
+		if (head >= len || p_scanInHead(sc, (uint64_t)head) == 0) break;
+		end = p_nextLine(buf, len, PCF_MIN(len, head + SCAN_HEAD_SIZE) - 1);
+	}
+	/* count lines and collect values of the body */
+	const size_t tail = PCF_MAX(head, p_tailStart(buf, len));
+	if (p_scanBody(sc, buf + head, tail - head, (uint64_t)head, threads) == 0) {
+		sc->lineStart = (uint64_t)tail;
+		/* scan tail region */
+		if (p_scan(sc, buf + tail, len - tail, (uint64_t)tail) == 0) return 0;
+		if (p_scanComplete(sc) != 0) return 1;
+	}
+	/* fallback to a full scan for values or thumbnail blocks outside the scanned regions */
+	p_scanInit(sc);
+	return p_scanParallel(sc, buf, len, threads);
+}
+
+
+/**
+ * Drops all line local scanner states. This needs to be called if the last chunk passed to
+ * p_scan() ended within a line. Parameter values within such a line are ignored.
+ * 
+ * @param[in,out] sc - scanner context
+ */
+static void p_scanBreakLine(tScanner * sc) {
+	switch (sc->state) {
+	case ST_COMMENT:
+	case ST_PARAMETER_VALUE:
+		if (sc->valueToken != NULL) memset(sc->valueToken, 0, sizeof(*(sc->valueToken)));
+		sc->valueToken = NULL;
+		sc->state = ST_FIND_LINE_START;
+		break;
+	default:
+		break;
+	}
+	memset(&(sc->aToken), 0, sizeof(sc->aToken));
+}
+
+
+/**
+ * Copies all collected parameter values which are not copied yet into owned storage. Call this
+ * after each p_scan() if the passed chunk does not remain valid.
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in,out] owned - owned value storage (VAL_COUNT entries, initialized with NULL)
+ * @return 1 on success, 0 on allocation error
+ */
+static int p_scanPin(tScanner * sc, char ** owned) {
+	for (size_t i = 0; i < VAL_COUNT; i++) {
+		tPToken * value = sc->value + i;
+		if (value->start == NULL || owned[i] != NULL) continue;
+		owned[i] = p_copyToken(value);
+		if (owned[i] == NULL) return 0;
+		value->start = owned[i];
+	}
+	return 1;
+}
+
+
+/**
+ * Reports all missing parameter values via the given callback function.
+ * 
+ * @param[in] sc - scanner context
+ * @param[in] file - input file path
+ * @param[in] cb - error output callback function
+ * @return 1 to continue, 0 to abort
+ */
+static int p_checkValues(const tScanner * sc, const TCHAR * file, const tCallback cb) {
+#define ON_MISSING(val, msg) do { \
+	if (sc->value[val].start == NULL || sc->value[val].length == 0) { \
+		if (cb(msg, file, sc->lineNr) != 1) return 0; \
+	} \
+} while (0)
+
+	ON_MISSING(VAL_FILAMENT_USED, MSGT_WARN_NO_FILAMENT_USED);
+	ON_MISSING(VAL_LAYER_HEIGHT, MSGT_WARN_NO_LAYER_HEIGHT);
+	ON_MISSING(VAL_EST_TIME, MSGT_WARN_NO_EST_TIME);
+	ON_MISSING(VAL_NOZZLE_TEMP, MSGT_WARN_NO_NOZZLE_TEMP);
+	ON_MISSING(VAL_PLATE_TEMP, MSGT_WARN_NO_PLATE_TEMP);
+	ON_MISSING(VAL_PRINT_SPEED, MSGT_WARN_NO_PRINT_SPEED);
+	if ((sc->hasThumbnail == 0 || sc->thumbnail.length == 0) && sc->preview == NULL) {
+		if (cb(MSGT_WARN_NO_THUMBNAIL, file, sc->lineNr) != 1) return 0;
+	}
+	ON_MISSING(VAL_MAX_X, MSGT_WARN_NO_MAX_SIZE);
+	ON_MISSING(VAL_MAX_Y, MSGT_WARN_NO_MAX_SIZE);
+	ON_MISSING(VAL_MAX_Z, MSGT_WARN_NO_MAX_SIZE);
+	return 1;
+
+#undef ON_MISSING
+}
+
+
+/**
+ * Reports the given thumbnail warning via the passed callback function.
+ * 
+ * @param[in] warning - thumbnail warning or MSGT_SUCCESS
+ * @param[in] sc - scanner context
+ * @param[in] file - input file path
+ * @param[in] cb - error output callback function
+ * @return 1 to continue, 0 to abort
+ */
+static int p_checkThumbnail(const tMessage warning, const tScanner * sc, const TCHAR * file, const tCallback cb) {
+	if (warning == MSGT_SUCCESS) return 1;
+	return (cb(warning, file, sc->lineNr) == 1) ? 1 : 0;
+}
+
+
+/**
+ * Returns whether the given message is a thumbnail warning.
+ * 
+ * @param[in] msg - message ID
+ * @return 1 if it is a thumbnail warning, else 0
+ */
+static int p_isThumbnailWarning(const tMessage msg) {
+	switch (msg) {
+	case MSGT_WARN_INVALID_THUMBNAIL:
+	case MSGT_WARN_THUMBNAIL_RECODE:
+	case MSGT_WARN_THUMBNAIL_TOO_LARGE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+
+/** Number of bytes read from the start of each thumbnail block to determine the image size. */
+#define THUMBNAIL_PEEK_SIZE 256
+
+
+/**
+ * Returns the image size of the given thumbnail block start. The size is taken from the PNG
+ * header of the image data if possible, else from the size declared in the first line of the
+ * block (e.g. "; thumbnail begin 300x150 11880").
+ * 
+ * @param[in,out] head - start of the thumbnail block (the image data is compacted in-place)
+ * @param[in] len - length of head in bytes
+ * @param[in] data - image data range relative to head
+ * @param[out] width - receives the width in pixels
+ * @param[out] height - receives the height in pixels
+ * @return 1 on success, 0 if the size is unknown
+ */
+static int p_thumbnailSize(char * head, const size_t len, const tFileRange * data, size_t * width, size_t * height) {
+	const size_t lineLen = (size_t)PCF_MIN((uint64_t)len, data->start);
+	int found = 0;
+	/* declared size after "begin" */
+	for (size_t i = 0; i + 5 < lineLen && found == 0; i++) {
+		if (memcmp(head + i, "begin", 5) != 0) continue;
+		size_t w = 0, h = 0;
+		size_t pos = i + 5;
+		while (pos < lineLen && head[pos] == ' ') pos++;
+		for (; pos < lineLen && isdigit(head[pos]) != 0 && w <= 0xFFFF; pos++) w = (w * 10) + (size_t)(head[pos] - '0');
+		if (pos >= lineLen || head[pos] != 'x') break;
+		for (pos++; pos < lineLen && isdigit(head[pos]) != 0 && h <= 0xFFFF; pos++) h = (h * 10) + (size_t)(head[pos] - '0');
+		if (w > 0 && h > 0) {
+			*width = w;
+			*height = h;
+			found = 1;
+		}
+	}
+	/* actual size from the PNG header */
+	if (data->start < (uint64_t)len) {
+		const size_t start = (size_t)(data->start);
+		const size_t n = b64_compact(head + start, head + start, (size_t)PCF_MIN((uint64_t)(len - start), data->length), NULL);
+		if (tn_peekSize(head + start, n, width, height) == 1) found = 1;
+	}
+	return found;
+}
+
+
+/**
+ * Selects the thumbnail block closest to the preferred size if several were found. The size of
+ * each image is determined without decoding it. See p_thumbnailSize().
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in] thumb - thumbnail options or NULL for the default size
+ * @param[in] inputBuf - input file content or NULL
+ * @param[in,out] in - input file (used if inputBuf is NULL)
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_selectThumbnail(tScanner * sc, const tThumbnailOptions * thumb, const char * inputBuf, FILE * in) {
+	const size_t width = (thumb != NULL && thumb->selectWidth > 0) ? thumb->selectWidth : DEFAULT_THUMBNAIL_WIDTH;
+	const size_t height = (thumb != NULL && thumb->selectHeight > 0) ? thumb->selectHeight : DEFAULT_THUMBNAIL_HEIGHT;
+	char head[THUMBNAIL_PEEK_SIZE];
+	size_t best = 0;
+	int found = 0;
+	if (sc->thumbnailCount < 2) return MSGT_SUCCESS;
+	for (size_t i = 0; i < sc->thumbnailCount; i++) {
+		const tThumbnailBlock * block = sc->thumbnailBlock + i;
+		const size_t len = (size_t)PCF_MIN(block->block.length, (uint64_t)sizeof(head));
+		tFileRange data;
+		size_t w, h;
+		if (block->data.length == 0) continue;
+		if (inputBuf != NULL) {
+			memcpy(head, inputBuf + block->block.start, len);
+		} else if (fseeko64(in, (int64_t)(block->block.start), SEEK_SET) != 0 || fread(head, len, 1, in) != 1) {
+			return MSGT_ERR_FILE_READ;
+		}
+		data.start = block->data.start - block->block.start;
+		data.length = block->data.length;
+		if (p_thumbnailSize(head, len, &data, &w, &h) != 1) continue;
+		/* sum of the absolute dimension differences */
+		const size_t dist = ((w > width) ? (w - width) : (width - w)) + ((h > height) ? (h - height) : (height - h));
+		if (found == 0 || dist < best) {
+			sc->thumbnail = block->data;
+			best = dist;
+			found = 1;
+		}
+	}
+	return MSGT_SUCCESS;
+}
+
+
+/**
+ * Renders a toolpath preview as thumbnail if requested and no thumbnail was found. See
+ * pv_renderBuffer(). The input is parsed from the passed input file if no content is given. No
+ * thumbnail is added if the G-Code holds no extrusion moves.
+ * 
+ * @param[in,out] sc - scanner context
+ * @param[in] thumb - thumbnail options or NULL
+ * @param[in] inputBuf - input file content or NULL
+ * @param[in,out] in - input file (used if inputBuf is NULL)
+ * @param[in] len - input file content length in bytes
+ * @param[in] threads - maximum number of threads
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_renderPreview(tScanner * sc, const tThumbnailOptions * thumb, const char * inputBuf, FILE * in, const size_t len, const size_t threads) {
+	tPreviewResult res;
+	if (thumb == NULL || thumb->preview == PV_NONE) return MSGT_SUCCESS;
+	if (sc->hasThumbnail != 0 && sc->thumbnail.length != 0) return MSGT_SUCCESS;
+	if (inputBuf != NULL) {
+		res = pv_renderBuffer(inputBuf, len, thumb->preview, threads, &(sc->preview), &(sc->previewLength));
+	} else {
+		res = pv_renderFile(in, thumb->preview, &(sc->preview), &(sc->previewLength));
+	}
+	switch (res) {
+	case PV_OK: sc->hasThumbnail = 1; break;
+	case PV_ERR_NO_MEM: return MSGT_ERR_NO_MEM;
+	case PV_ERR_READ: return MSGT_ERR_FILE_READ;
+	default: break; /* reported as missing thumbnail */
+	}
+	return MSGT_SUCCESS;
+}
+
+
+/** Buffer size of the formatted header text before and after the thumbnail data. */
+#define HEADER_TEXT_SIZE 1024
+
+
+/**
+ * Formats the Snapmaker 2.0 specific header up to the thumbnail data.
+ * 
+ * @param[out] buf - output buffer
+ * @param[in] size - output buffer size in bytes
+ * @param[in] sc - scanner context
+ * @return formatted length in bytes (negative or not less than size on error)
+ */
+static int p_formatHeaderStart(char * buf, const size_t size, const tScanner * sc) {
+	const tPToken * value = sc->value;
+	return snprintf(buf, size,
+		";post-processed by sm2pspp (https://github.com/daniel-starke/sm2pspp)\n"
+		";Header Start\n\n"
+		";FLAVOR:Marlin\n"
+		";TIME:6666\n\n\n"
+		";Filament used: %.0fm\n"
+		";Layer height: %.2f\n"
+		";header_type: 3dp\n"
+		"%s",
+		p_float(value + VAL_FILAMENT_USED) / 1000.0f,
+		p_float(value + VAL_LAYER_HEIGHT),
+		(sc->hasThumbnail != 0) ? ";thumbnail: data:image/png;base64," : ""
+	);
+}
+
+
+/**
+ * Returns the ranges of the input file which are output after the header.
+ * 
+ * @param[in] sc - scanner context
+ * @param[in] size - input file size in bytes
+ * @param[out] range - receives the body ranges (BODY_RANGES entries)
+ * @return number of ranges
+ */
+static size_t p_bodyRanges(const tScanner * sc, const uint64_t size, tFileRange * range) {
+	size_t count = 0;
+	uint64_t start = 0;
+#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
+	/* cut out all original thumbnails */
+	for (size_t i = 0; i < sc->thumbnailCount; i++) {
+		const tFileRange * block = &(sc->thumbnailBlock[i].block);
+		range[count].start = start;
+		range[count].length = block->start - start;
+		start = block->start + block->length;
+		count++;
+	}
+#else /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
+	PCF_UNUSED(sc)
+#endif /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
+	range[count].start = start;
+	range[count].length = size - start;
+	return count + 1;
+}
+
+
+/**
+ * Initializes the header layout to place the last body range at an output offset congruent to its
+ * input offset modulo the given alignment. This allows the file system to share its data blocks
+ * with the input file.
+ * 
+ * @param[out] layout - header layout
+ * @param[in] sc - scanner context
+ * @param[in] size - input file size in bytes
+ * @param[in] align - output alignment in bytes or 0
+ */
+static void p_initLayout(tHeaderLayout * layout, const tScanner * sc, const uint64_t size, const size_t align) {
+	tFileRange range[BODY_RANGES];
+	/* the last body range is the largest one */
+	const size_t last = p_bodyRanges(sc, size, range) - 1;
+	memset(layout, 0, sizeof(*layout));
+#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
+	for (size_t i = 0; i < sc->thumbnailCount; i++) layout->removedLines += sc->thumbnailBlock[i].lines;
+#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
+	layout->align = align;
+	layout->target = range[last].start;
+	for (size_t i = 0; i < last; i++) layout->target -= range[i].length;
+}
+
+
+/**
+ * Fills the given buffer with a filler line of its length including the line break. The line is
+ * a comment which is ignored by the printer.
+ * 
+ * @param[out] buf - output buffer
+ * @param[in] len - line length in bytes
+ */
+static void p_writeFiller(char * buf, const size_t len) {
+	if (len < 1) return;
+	if (len > 1) {
+		buf[0] = ';';
+		memset(buf + 1, ' ', len - 2);
+	}
+	buf[len - 1] = '\n';
+}
+
+
+/**
+ * Formats the Snapmaker 2.0 specific header following the thumbnail data up to the final empty
+ * line.
+ * 
+ * @param[out] buf - output buffer
+ * @param[in] size - output buffer size in bytes
+ * @param[in] sc - scanner context
+ * @param[in] layout - header layout
+ * @return formatted length in bytes (negative or not less than size on error)
+ */
+static int p_formatHeaderEnd(char * buf, const size_t size, const tScanner * sc, const tHeaderLayout * layout) {
+	const tPToken * value = sc->value;
+	return snprintf(buf, size,
+		"%s"
+		";file_total_lines: %lu\n"
+		";estimated_time(s): %.0f\n"
+		";nozzle_temperature(°C): %.0f\n"
+		";build_plate_temperature(°C): %.0f\n"
+		";work_speed(mm/minute): %.0f\n"
+		";max_x(mm): %.2f\n"
+		";max_y(mm): %.2f\n"
+		";max_z(mm): %.2f\n"
+		";min_x(mm): 0\n" /* not set by Snapmaker Luban */
+		";min_y(mm): 0\n" /* not set by Snapmaker Luban */
+		";min_z(mm): 0\n\n" /* not set by Snapmaker Luban */
+		";Header End\n",
+		(sc->hasThumbnail != 0) ? "\n" : "",
+		(unsigned long)(sc->lineNr + 25 + layout->extraLines - layout->removedLines),
+		(float)p_dtms(value + VAL_EST_TIME),
+		p_float(value + VAL_NOZZLE_TEMP),
+		p_float(value + VAL_PLATE_TEMP),
+		p_float(value + VAL_PRINT_SPEED) * 60.0f,
+		p_float(value + VAL_MAX_X),
+		p_float(value + VAL_MAX_Y),
+		p_float(value + VAL_MAX_Z)
+	);
+}
+
+
+#ifdef PCF_IS_WIN
+/**
+ * Copies the given byte range of the input file to the output file via the passed buffer.
+ * 
+ * @param[in,out] fp - output file
+ * @param[in,out] in - input file
+ * @param[in,out] buf - transfer buffer
+ * @param[in] bufSize - transfer buffer size in bytes
+ * @param[in] range - input file range to copy
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_copyRange(FILE * fp, FILE * in, char * buf, const size_t bufSize, const tFileRange * range) {
+	uint64_t remaining = range->length;
+	if (remaining < 1) return MSGT_SUCCESS;
+	if (fseeko64(in, (int64_t)(range->start), SEEK_SET) != 0) return MSGT_ERR_FILE_READ;
+	while (remaining > 0) {
+		const size_t len = (size_t)PCF_MIN((uint64_t)bufSize, remaining);
+		if (fread(buf, len, 1, in) < 1) return MSGT_ERR_FILE_READ;
+		if (fwrite(buf, len, 1, fp) < 1) return MSGT_ERR_FILE_WRITE;
+		remaining -= (uint64_t)len;
+	}
+	return MSGT_SUCCESS;
+}
+#endif /* PCF_IS_WIN */
+
+
+/**
+ * Appends a segment to the given output list. Empty segments are skipped.
+ * 
+ * @param[in,out] out - output list
+ * @param[in] data - segment data
+ * @param[in] len - segment length in bytes
+ */
+static void p_addSegment(tOutputList * out, const char * data, const size_t len) {
+	if (len < 1 || out->count >= OUTPUT_SEGMENTS) return;
+	out->vec[out->count].iov_base = (void *)data;
+	out->vec[out->count].iov_len = len;
+	out->count++;
+	out->length += (uint64_t)len;
+}
+
+
+/**
+ * Writes all segments of the given output list to the passed output file. This is done with a
+ * single writev() call on POSIX systems unless the output is written partially.
+ * 
+ * @param[in,out] fp - output file
+ * @param[in] out - output list
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_writeOutput(FILE * fp, const tOutputList * out) {
+#ifdef PCF_IS_NO_WIN
+	tIoVec vec[OUTPUT_SEGMENTS];
+	size_t first = 0;
+	memcpy(vec, out->vec, out->count * sizeof(tIoVec));
+	if (fflush(fp) != 0) return MSGT_ERR_FILE_WRITE;
+	while (first < out->count) {
+		const ssize_t got = writev(fileno(fp), vec + first, (int)(out->count - first));
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return MSGT_ERR_FILE_WRITE;
+		/* skip written segments */
+		size_t rest = (size_t)got;
+		while (first < out->count && rest >= vec[first].iov_len) {
+			rest -= vec[first].iov_len;
+			first++;
+		}
+		if (first < out->count) {
+			vec[first].iov_base = (char *)(vec[first].iov_base) + rest;
+			vec[first].iov_len -= rest;
+		}
+	}
+#else /* PCF_IS_WIN */
+	for (size_t i = 0; i < out->count; i++) {
+		if (fwrite(out->vec[i].iov_base, out->vec[i].iov_len, 1, fp) < 1) return MSGT_ERR_FILE_WRITE;
+	}
+#endif /* PCF_IS_WIN */
+	return MSGT_SUCCESS;
+}
+
+
+#ifdef PCF_IS_NO_WIN
+/**
+ * Writes the given data at the passed file offset. Interrupted and partial writes are continued.
+ * 
+ * @param[in] fd - output file descriptor
+ * @param[in] data - data to write
+ * @param[in] len - data length in bytes
+ * @param[in] offset - output file offset
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_writeAt(const int fd, const char * data, const size_t len, const uint64_t offset) {
+	for (size_t written = 0; written < len; ) {
+		const ssize_t got = pwrite(fd, data + written, len - written, (off_t)(offset + written));
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return MSGT_ERR_FILE_WRITE;
+		written += (size_t)got;
+	}
+	return MSGT_SUCCESS;
+}
+
+
+/**
+ * Transfers the body ranges of the input file to the output file. The data is copied within the
+ * kernel or shared by reference if supported. See fc_copy().
+ * 
+ * @param[in,out] fp - output file
+ * @param[in] fd - input file descriptor
+ * @param[in] sc - scanner context
+ * @param[in] size - input file size in bytes
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_transferBody(FILE * fp, const int fd, const tScanner * sc, const uint64_t size) {
+	tFileRange range[BODY_RANGES];
+	const size_t count = p_bodyRanges(sc, size, range);
+	if (fflush(fp) != 0) return MSGT_ERR_FILE_WRITE;
+	for (size_t i = 0; i < count; i++) {
+		if (fc_copy(fileno(fp), fd, range[i].start, range[i].length) != 1) return MSGT_ERR_FILE_WRITE;
+	}
+	return MSGT_SUCCESS;
+}
+#endif /* PCF_IS_NO_WIN */
+
+
+/**
+ * Re-encodes the compacted thumbnail data within the given header buffer. The buffer is enlarged
+ * if the re-encoded thumbnail data is larger. The original data is kept if re-encoding fails.
+ * 
+ * @param[in,out] buf - allocated header buffer
+ * @param[in,out] size - header buffer size in bytes
+ * @param[in] offset - thumbnail data offset within the header buffer
+ * @param[in,out] len - thumbnail data length in bytes
+ * @param[in] thumb - thumbnail re-encoding options
+ * @param[out] warning - set to the thumbnail warning if re-encoding failed
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_recodeThumbnail(char ** buf, size_t * size, const size_t offset, size_t * len, const tThumbnailOptions * thumb, tMessage * warning) {
+	char * data = NULL;
+	size_t dataLen = 0;
+	switch (tn_recode(*buf + offset, *len, thumb, &data, &dataLen)) {
+	case TN_OK: break;
+	case TN_KEEP: return MSGT_SUCCESS;
+	case TN_ERR_NO_MEM: return MSGT_ERR_NO_MEM;
+	case TN_ERR_TOO_LARGE: *warning = MSGT_WARN_THUMBNAIL_TOO_LARGE; return MSGT_SUCCESS;
+	default: *warning = MSGT_WARN_THUMBNAIL_RECODE; return MSGT_SUCCESS;
+	}
+	if (dataLen > *len) {
+		char * newBuf = (char *)realloc(*buf, *size + dataLen - *len);
+		if (newBuf == NULL) {
+			free(data);
+			return MSGT_ERR_NO_MEM;
+		}
+		*buf = newBuf;
+		*size += dataLen - *len;
+	}
+	memcpy(*buf + offset, data, dataLen);
+	*len = dataLen;
+	free(data);
+	return MSGT_SUCCESS;
+}
+
+
+/**
+ * Renders the Snapmaker 2.0 specific header into a single allocated buffer. Its size is computed
+ * in advance from the formatted header text, the thumbnail data length and the layout. The
+ * thumbnail data is compacted to its Base64 characters and validated via b64_compact(). It is
+ * taken from the passed input file content or read from the passed input file if no content is
+ * given. Valid thumbnail data is re-encoded if requested. The empty line after the header is
+ * extended to a comment line as requested by the passed layout.
+ * 
+ * @param[in] sc - scanner context
+ * @param[in] layout - header layout
+ * @param[in] thumb - thumbnail re-encoding options or NULL
+ * @param[in] inputBuf - input file content or NULL
+ * @param[in,out] in - input file (used if inputBuf is NULL)
+ * @param[out] header - receives the allocated header (free after use)
+ * @param[out] headerLen - receives the header length in bytes
+ * @param[out] warning - receives the thumbnail warning or MSGT_SUCCESS
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_renderHeader(const tScanner * sc, const tHeaderLayout * layout, const tThumbnailOptions * thumb, const char * inputBuf, FILE * in, char ** header, size_t * headerLen, tMessage * warning) {
+	char start[HEADER_TEXT_SIZE];
+	char end[HEADER_TEXT_SIZE];
+	const size_t thumbnailLen = (sc->preview != NULL) ? sc->previewLength : (size_t)(sc->thumbnail.length);
+	const int startLen = p_formatHeaderStart(start, sizeof(start), sc);
+	const int endLen = p_formatHeaderEnd(end, sizeof(end), sc, layout);
+	size_t size;
+	size_t len = 0;
+	size_t fill = 1;
+	char * res;
+	*header = NULL;
+	*headerLen = 0;
+	*warning = MSGT_SUCCESS;
+	if (startLen < 0 || startLen >= HEADER_TEXT_SIZE || endLen < 0 || endLen >= HEADER_TEXT_SIZE) return MSGT_ERR_NO_MEM;
+	size = (size_t)startLen + thumbnailLen + (size_t)endLen + PCF_MAX(layout->align, layout->length) + 1;
+	res = (char *)malloc(size);
+	if (res == NULL) return MSGT_ERR_NO_MEM;
+	memcpy(res, start, (size_t)startLen);
+	len = (size_t)startLen;
+	if (thumbnailLen > 0) {
+		size_t n;
+		int valid;
+		if (sc->preview != NULL) {
+			memcpy(res + len, sc->preview, thumbnailLen);
+			n = thumbnailLen;
+			valid = 1;
+		} else if (inputBuf != NULL) {
+			n = b64_compact(res + len, inputBuf + sc->thumbnail.start, thumbnailLen, &valid);
+		} else if (fseeko64(in, (int64_t)(sc->thumbnail.start), SEEK_SET) == 0 && fread(res + len, thumbnailLen, 1, in) == 1) {
+			/* compact in-place */
+			n = b64_compact(res + len, res + len, thumbnailLen, &valid);
+		} else {
+			free(res);
+			return MSGT_ERR_FILE_READ;
+		}
+		if (valid == 0) {
+			*warning = MSGT_WARN_INVALID_THUMBNAIL;
+		} else if (thumb != NULL && thumb->recode != 0) {
+			const tMessage msg = p_recodeThumbnail(&res, &size, len, &n, thumb, warning);
+			if (msg != MSGT_SUCCESS) {
+				free(res);
+				return msg;
+			}
+		}
+		len += n;
+	}
+	memcpy(res + len, end, (size_t)endLen);
+	len += (size_t)endLen;
+	/* extend the final empty line */
+	if (layout->length > 0) {
+		if (len < layout->length) fill = layout->length - len;
+	} else if (layout->align > 1) {
+		const size_t align = layout->align;
+		fill = (size_t)(((layout->target % align) + (2 * align) - (((uint64_t)len + 1) % align)) % align) + 1;
+	}
+	p_writeFiller(res + len, fill);
+	*header = res;
+	*headerLen = len + fill;
+	return MSGT_SUCCESS;
+}
+
+
+#ifdef PCF_IS_NO_WIN
+/**
+ * Writes the header into the reserved header slot of the input file. The slot is overwritten
+ * completely with the header which is padded by a filler line to the exact slot size. Nothing else
+ * of the file is touched. The slot is left unchanged if the header does not fit.
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] sc - scanner context with a complete slot
+ * @param[in] inputBuf - input file content or NULL
+ * @param[in,out] in - input file (used if inputBuf is NULL)
+ * @param[in] thumb - thumbnail re-encoding options or NULL
+ * @param[in] cb - error output callback function
+ * @return MSGT_SUCCESS on success, MSGT_WARN_SLOT_TOO_SMALL if the header does not fit, the
+ * thumbnail warning if aborted by the callback function, else the error cause
+ */
+static tMessage p_writeSlot(const TCHAR * file, const tScanner * sc, const char * inputBuf, FILE * in, const tThumbnailOptions * thumb, const tCallback cb) {
+	tMessage res;
+	char * header = NULL;
+	size_t headerLen = 0;
+	tMessage warning;
+	tHeaderLayout layout;
+	
+	/* replace all lines of the slot by the header */
+	memset(&layout, 0, sizeof(layout));
+	layout.removedLines = sc->slotLines;
+	layout.length = (size_t)(sc->slot.length);
+	res = p_renderHeader(sc, &layout, thumb, inputBuf, in, &header, &headerLen, &warning);
+	if (res != MSGT_SUCCESS) return res;
+	if ((uint64_t)headerLen != sc->slot.length) {
+		free(header);
+		return MSGT_WARN_SLOT_TOO_SMALL;
+	}
+	if (p_checkThumbnail(warning, sc, file, cb) != 1) {
+		free(header);
+		return warning;
+	}
+	
+	const int fd = open(file, O_WRONLY);
+	if (fd < 0) {
+		free(header);
+		return MSGT_ERR_FILE_CREATE;
+	}
+	res = p_writeAt(fd, header, headerLen, sc->slot.start);
+	if (close(fd) != 0 && res == MSGT_SUCCESS) res = MSGT_ERR_FILE_WRITE;
+	free(header);
+	return res;
+}
+#endif /* PCF_IS_NO_WIN */
+
+
+#ifdef PCF_IS_LINUX
+/**
+ * Inserts the header in-place at the start of the input file without rewriting its body. A block
+ * aligned range is inserted at the start of the file for the header via fallocate() and the block
+ * aligned part of the original thumbnail is removed the same way. The remaining bytes of the
+ * original thumbnail are replaced by a single comment line. The inserted range is collapsed again
+ * if the header cannot be written to restore the original file for the fallback. A failure while
+ * removing the original thumbnail leaves a valid processed file behind but is reported.
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] inputBuf - input file content (no longer valid after the call unless done is 0)
+ * @param[in] sc - scanner context
+ * @param[in] thumb - thumbnail re-encoding options or NULL
+ * @param[out] done - set to 1 if the header was inserted, 0 if not supported or rolled back
+ * @param[in] cb - error output callback function
+ * @return MSGT_SUCCESS on success or if not supported, the thumbnail warning if aborted by the
+ * callback function, else the error cause
+ */
+static tMessage p_insertHeader(const TCHAR * file, const char * inputBuf, const tScanner * sc, const tThumbnailOptions * thumb, int * done, const tCallback cb) {
+	tMessage res = MSGT_SUCCESS;
+	char * header = NULL;
+	size_t headerLen = 0;
+	tMessage warning;
+	char * filler = NULL;
+	tHeaderLayout layout;
+	size_t cut = 0;
+	*done = 0;
+	const int fd = open(file, O_RDWR);
+	if (fd < 0) return MSGT_SUCCESS;
+	const size_t blockSize = fc_blockSize(fd);
+	if (blockSize < 1) goto onEnd;
+	
+	/* create the header with a length multiple of the block size */
+	p_initLayout(&layout, sc, 0, blockSize);
+	layout.target = 0;
+#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
+	cut = sc->thumbnailCount;
+	layout.extraLines = cut; /* one filler line per original thumbnail */
+#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
+	res = p_renderHeader(sc, &layout, thumb, inputBuf, NULL, &header, &headerLen, &warning);
+	if (res != MSGT_SUCCESS) goto onEnd;
+	if ((headerLen % blockSize) != 0) goto onEnd;
+	if (p_checkThumbnail(warning, sc, file, cb) != 1) {
+		res = warning;
+		goto onEnd;
+	}
+	
+	/* open a block aligned gap at the start of the file */
+	if (fc_insertRange(fd, 0, (uint64_t)headerLen) != 1) goto onEnd;
+	*done = 1;
+	
+	/* output Snapmaker 2.0 specific header into the gap */
+	res = p_writeAt(fd, header, headerLen, 0);
+	if (res != MSGT_SUCCESS) {
+		/* remove the gap again to fall back to a rewrite of the unchanged file */
+		if (fc_collapseRange(fd, 0, (uint64_t)headerLen) == 1) {
+			*done = 0;
+			res = MSGT_SUCCESS;
+		}
+		goto onEnd;
+	}
+	
+#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
+	/* the last one first to keep the offsets of the preceding original thumbnails */
+	for (size_t i = cut; i > 0; i--) {
+		const tFileRange * block = &(sc->thumbnailBlock[i - 1].block);
+		/* collapse the block aligned part of the original thumbnail (keep at least one byte) */
+		const uint64_t start = (uint64_t)headerLen + block->start;
+		uint64_t end = start + block->length;
+		const uint64_t alignedStart = ((start + blockSize - 1) / blockSize) * blockSize;
+		const uint64_t alignedEnd = ((end - 1) / blockSize) * blockSize;
+		if (alignedEnd > alignedStart && fc_collapseRange(fd, alignedStart, alignedEnd - alignedStart) == 1) {
+			end -= alignedEnd - alignedStart;
+		}
+		/* replace the remaining bytes by a single comment line */
+		if (filler != NULL) free(filler);
+		filler = (char *)malloc((size_t)(end - start));
+		if (filler == NULL) {
+			res = MSGT_ERR_NO_MEM;
+			goto onEnd;
+		}
+		p_writeFiller(filler, (size_t)(end - start));
+		res = p_writeAt(fd, filler, (size_t)(end - start), start);
+		if (res != MSGT_SUCCESS) goto onEnd;
+	}
+#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
+onEnd:
+	if (close(fd) != 0 && *done != 0 && res == MSGT_SUCCESS) res = MSGT_ERR_FILE_WRITE;
+	if (filler != NULL) free(filler);
+	if (header != NULL) free(header);
+	return res;
+}
+#endif /* PCF_IS_LINUX */
+
+
+/**
+ * Finishes the output file. A temporary output file replaces the input file afterwards.
+ * 
+ * @param[in,out] fp - output file (closed afterwards)
+ * @param[in,out] tmpFile - temporary output file path or NULL (freed and set to NULL)
+ * @param[in] file - input file path
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_closeOutput(FILE * fp, TCHAR ** tmpFile, const TCHAR * file) {
+	tMessage res = MSGT_SUCCESS;
+	if (fclose(fp) != 0) res = MSGT_ERR_FILE_WRITE;
+	if (*tmpFile != NULL) {
+		if (res != MSGT_SUCCESS) {
+			fm_discard(*tmpFile);
+		} else if (fm_replace(*tmpFile, file) == 0) {
+			res = MSGT_ERR_FILE_CREATE;
+		}
+		free(*tmpFile);
+		*tmpFile = NULL;
+	}
+	return res;
+}
+
+
+/**
+ * Processes the given file completely in memory. See processFile().
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] inPlace - 1 to insert the header in-place if supported, else 0
+ * @param[in] threads - maximum number of threads used to scan the file
+ * @param[in] thumb - thumbnail re-encoding options or NULL
+ * @param[in,out] stats - receives the processing statistics or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int p_processBuffered(const TCHAR * file, const int inPlace, const size_t threads, const tThumbnailOptions * thumb, tStats * stats, const tCallback cb) {
+#define ON_ERROR(msg) do { \
+	cb(msg, file, sc.lineNr); \
+	goto onError; \
+} while (0)
+
+	int res = 0;
+	tMessage msg;
+	tFileMap input = {0};
+	const char * inputBuf = NULL;
+	size_t inputLen = 0;
+	size_t count;
+	char * header = NULL;
+	size_t headerLen = 0;
+	tMessage warning;
+	FILE * fp = NULL;
+	TCHAR * tmpFile = NULL;
+	tFileRange range[BODY_RANGES];
+	tOutputList out;
+	tHeaderLayout layout;
+	tScanner sc;
+	
+	p_scanInit(&sc);
+	memset(&out, 0, sizeof(out));
+	
+	/* map input file into memory or read it completely */
+	switch (fm_open(&input, file)) {
+	case FM_OK: break;
+	case FM_ERR_NO_MEM: ON_ERROR(MSGT_ERR_NO_MEM); break;
+	case FM_ERR_READ: ON_ERROR(MSGT_ERR_FILE_READ); break;
+	default: ON_ERROR(MSGT_ERR_FILE_OPEN); break;
+	}
+	inputBuf = input.data;
+	inputLen = input.size;
+	if (inputLen < 1) goto onSuccess;
+	
+	/* parse tokens */
+	st_enter(stats, ST_PHASE_SCAN);
+	if (p_scanSelective(&sc, inputBuf, inputLen, threads) == 0) goto onSuccess;
+	st_enter(stats, ST_PHASE_HEADER);
+	msg = p_selectThumbnail(&sc, thumb, inputBuf, NULL);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	msg = p_renderPreview(&sc, thumb, inputBuf, NULL, inputLen, threads);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	
+	/* check missing tokens */
+	if (p_checkValues(&sc, file, cb) != 1) goto onError;
+	
+#ifdef PCF_IS_NO_WIN
+	if (sc.slot.length != 0) {
+		/* write the header into the reserved slot */
+		msg = p_writeSlot(file, &sc, inputBuf, NULL, thumb, cb);
+		if (msg == MSGT_SUCCESS) goto onSuccess;
+		if (p_isThumbnailWarning(msg) != 0) goto onError;
+		if (msg != MSGT_WARN_SLOT_TOO_SMALL) ON_ERROR(msg);
+		if (cb(msg, file, sc.lineNr) != 1) goto onError;
+	}
+#endif /* PCF_IS_NO_WIN */
+	
+#ifdef PCF_IS_LINUX
+	if (inPlace != 0) {
+		int done = 0;
+		msg = p_insertHeader(file, inputBuf, &sc, thumb, &done, cb);
+		if (p_isThumbnailWarning(msg) != 0) goto onError;
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+		if (done != 0) goto onSuccess;
+	}
+#else /* !PCF_IS_LINUX */
+	PCF_UNUSED(inPlace)
+#endif /* !PCF_IS_LINUX */
+	
+	/* re-create file */
+	if (input.mapped != 0) {
+		/* the mapped input needs to stay valid until the output was written completely */
+		fp = fm_createSibling(file, &tmpFile);
+	} else {
+		fp = _tfopen(file, _T("wb"));
+	}
+	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_CREATE);
+	
+	p_initLayout(&layout, &sc, inputLen, 0);
+#ifdef PCF_IS_NO_WIN
+	if (tmpFile != NULL) layout.align = fc_cloneAlignment(fileno(fp));
+#endif /* PCF_IS_NO_WIN */
+	
+	/* render Snapmaker 2.0 specific start header */
+	msg = p_renderHeader(&sc, &layout, thumb, inputBuf, NULL, &header, &headerLen, &warning);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	if (p_checkThumbnail(warning, &sc, file, cb) != 1) goto onError;
+	p_addSegment(&out, header, headerLen);
+	
+	/* output header and remaining file */
+	st_enter(stats, ST_PHASE_BODY);
+#ifdef PCF_IS_NO_WIN
+	if (tmpFile != NULL && input.fd >= 0) {
+		msg = p_writeOutput(fp, &out);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+		msg = p_transferBody(fp, input.fd, &sc, inputLen);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	} else
+#endif /* PCF_IS_NO_WIN */
+	{
+		count = p_bodyRanges(&sc, inputLen, range);
+		for (size_t i = 0; i < count; i++) p_addSegment(&out, inputBuf + range[i].start, (size_t)(range[i].length));
+		msg = p_writeOutput(fp, &out);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	}
+	msg = p_closeOutput(fp, &tmpFile, file);
+	fp = NULL;
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+onSuccess:
+	res = 1;
+onError:
+	if (fp != NULL) fclose(fp);
+	if (tmpFile != NULL) {
+		/* discard incomplete output */
+		fm_discard(tmpFile);
+		free(tmpFile);
+	}
+	if (header != NULL) free(header);
+	if (sc.preview != NULL) free(sc.preview);
+	fm_close(&input);
+	if (stats != NULL) {
+		stats->bytes = (uint64_t)inputLen;
+		stats->lines = (uint64_t)(sc.lineNr - 1);
+	}
+	return res;
+	
+#undef ON_ERROR
+}
+
+
+/**
+ * Processes the given file in two passes through a buffer of LINE_BUFFER_SIZE bytes. The first
+ * pass collects all values, the second pass outputs header and body to a temporary file which
+ * replaces the input file afterwards. See processFile().
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in,out] ctx - reusable resources or NULL
+ * @param[in] thumb - thumbnail re-encoding options or NULL
+ * @param[in,out] stats - receives the processing statistics or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int p_processStreamed(const TCHAR * file, tContext * ctx, const tThumbnailOptions * thumb, tStats * stats, const tCallback cb) {
+#define ON_ERROR(msg) do { \
+	cb(msg, file, sc.lineNr); \
+	goto onError; \
+} while (0)
+
+	int res = 0;
+	tMessage msg;
+	char * buf = NULL;
+	char * owned[VAL_COUNT] = {0};
+	char * header = NULL;
+	size_t headerLen = 0;
+	tMessage warning;
+	size_t fill = 0;
+	uint64_t offset = 0;
+	FILE * in = NULL;
+	FILE * fp = NULL;
+	TCHAR * tmpFile = NULL;
+#ifdef PCF_IS_WIN
+	tFileRange range[BODY_RANGES];
+#endif /* PCF_IS_WIN */
+	tOutputList out;
+	tHeaderLayout layout;
+	tScanner sc;
+	
+	p_scanInit(&sc);
+	
+	in = _tfopen(file, _T("rb"));
+	if (in == NULL) ON_ERROR(MSGT_ERR_FILE_OPEN);
+	if (ctx != NULL && ctx->lineBuffer != NULL) {
+		buf = ctx->lineBuffer;
+	} else {
+		buf = (char *)malloc(LINE_BUFFER_SIZE);
+		if (buf == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+		if (ctx != NULL) ctx->lineBuffer = buf;
+	}
+	
+	/* first pass: parse tokens line-wise */
+	for (;;) {
+		const size_t got = fread(buf + fill, 1, LINE_BUFFER_SIZE - fill, in);
+		if (got < (LINE_BUFFER_SIZE - fill) && ferror(in) != 0) ON_ERROR(MSGT_ERR_FILE_READ);
+		fill += got;
+		if (fill < 1) break;
+		const int atEnd = feof(in);
+		size_t len = fill;
+		if (atEnd == 0) {
+			/* pass complete lines only */
+			while (len > 0 && buf[len - 1] != '\n') len--;
+			if (len < 1) len = fill;
+		}
+		st_enter(stats, ST_PHASE_SCAN);
+		if (p_scan(&sc, buf, len, offset) == 0) goto onSuccess;
+		if (buf[len - 1] != '\n' && atEnd == 0) p_scanBreakLine(&sc);
+		if (p_scanPin(&sc, owned) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+		memmove(buf, buf + len, fill - len);
+		fill -= len;
+		offset += (uint64_t)len;
+		st_enter(stats, ST_PHASE_READ);
+	}
+	if (offset < 1) goto onSuccess;
+	st_enter(stats, ST_PHASE_HEADER);
+	msg = p_selectThumbnail(&sc, thumb, NULL, in);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	msg = p_renderPreview(&sc, thumb, NULL, in, 0, 1);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	
+	/* check missing tokens */
+	if (p_checkValues(&sc, file, cb) != 1) goto onError;
+	
+#ifdef PCF_IS_NO_WIN
+	if (sc.slot.length != 0) {
+		/* write the header into the reserved slot */
+		msg = p_writeSlot(file, &sc, NULL, in, thumb, cb);
+		if (msg == MSGT_SUCCESS) goto onSuccess;
+		if (p_isThumbnailWarning(msg) != 0) goto onError;
+		if (msg != MSGT_WARN_SLOT_TOO_SMALL) ON_ERROR(msg);
+		if (cb(msg, file, sc.lineNr) != 1) goto onError;
+	}
+#endif /* PCF_IS_NO_WIN */
+	
+	/* second pass: output to temporary file */
+	fp = fm_createSibling(file, &tmpFile);
+	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_CREATE);
+	
+	p_initLayout(&layout, &sc, offset, 0);
+#ifdef PCF_IS_NO_WIN
+	layout.align = fc_cloneAlignment(fileno(fp));
+#endif /* PCF_IS_NO_WIN */
+	
+	/* output Snapmaker 2.0 specific start header */
+	msg = p_renderHeader(&sc, &layout, thumb, NULL, in, &header, &headerLen, &warning);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	if (p_checkThumbnail(warning, &sc, file, cb) != 1) goto onError;
+	memset(&out, 0, sizeof(out));
+	p_addSegment(&out, header, headerLen);
+	msg = p_writeOutput(fp, &out);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	
+	/* output remaining file */
+	st_enter(stats, ST_PHASE_BODY);
+#ifdef PCF_IS_NO_WIN
+	msg = p_transferBody(fp, fileno(in), &sc, offset);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+#else /* PCF_IS_WIN */
+	for (size_t i = 0, count = p_bodyRanges(&sc, offset, range); i < count; i++) {
+		msg = p_copyRange(fp, in, buf, LINE_BUFFER_SIZE, range + i);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	}
+#endif /* PCF_IS_WIN */
+	fclose(in);
+	in = NULL;
+	msg = p_closeOutput(fp, &tmpFile, file);
+	fp = NULL;
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+onSuccess:
+	res = 1;
+onError:
+	if (in != NULL) fclose(in);
+	if (fp != NULL) fclose(fp);
+	if (tmpFile != NULL) {
+		/* discard incomplete output */
+		fm_discard(tmpFile);
+		free(tmpFile);
+	}
+	if (header != NULL) free(header);
+	if (sc.preview != NULL) free(sc.preview);
+	for (size_t i = 0; i < VAL_COUNT; i++) {
+		if (owned[i] != NULL) free(owned[i]);
+	}
+	if (buf != NULL && ctx == NULL) free(buf);
+	if (stats != NULL) {
+		stats->bytes = offset;
+		stats->lines = (uint64_t)(sc.lineNr - 1);
+	}
+	return res;
+	
+#undef ON_ERROR
+}
+
+
+/**
+ * Processes the given PrusaSlicer generated G-Code content in memory. See processBuffer().
+ * 
+ * @param[in] name - input name used for messages and statistics
+ * @param[in] buf - PrusaSlicer generated G-Code
+ * @param[in] len - input length in bytes
+ * @param[in] opt - processing options (NULL for defaults; inPlace and lowMemory are ignored)
+ * @param[out] out - receives the output segments (free with freeOutput())
+ * @param[out] lines - receives the number of lines known to the scanner or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int p_processBuffer(const TCHAR * name, const char * buf, const size_t len, const tOptions * opt, tOutputList * out, uint64_t * lines, const tCallback cb) {
+#define ON_ERROR(msg) do { \
+	cb(msg, name, sc.lineNr); \
+	goto onError; \
+} while (0)
+
+	int res = 0;
+	tMessage msg;
+	tStats stats;
+	tStats * st = NULL;
+	size_t headerLen = 0;
+	tMessage warning;
+	size_t count;
+	const tThumbnailOptions * thumb = (opt != NULL) ? &(opt->thumbnail) : NULL;
+	tFileRange range[BODY_RANGES];
+	tHeaderLayout layout;
+	tScanner sc;
+	
+	if (out == NULL) return 0;
+	memset(out, 0, sizeof(*out));
+	if (name == NULL || cb == NULL || (buf == NULL && len > 0)) return 0;
+	p_scanInit(&sc);
+	if (opt != NULL && opt->statsCb != NULL) {
+		st = &stats;
+		st_begin(st);
+	}
+	if (len < 1) goto onUnchanged;
+	
+	/* parse tokens */
+	st_enter(st, ST_PHASE_SCAN);
+	if (p_scanSelective(&sc, buf, len, (opt != NULL) ? PCF_MAX(opt->scanThreads, (size_t)1) : 1) == 0) goto onUnchanged;
+	st_enter(st, ST_PHASE_HEADER);
+	msg = p_selectThumbnail(&sc, thumb, buf, NULL);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	msg = p_renderPreview(&sc, thumb, buf, NULL, len, (opt != NULL) ? PCF_MAX(opt->scanThreads, (size_t)1) : 1);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	
+	/* check missing tokens */
+	if (p_checkValues(&sc, name, cb) != 1) goto onError;
+	
+	if (sc.slot.length != 0) {
+		/* replace the reserved slot by the header */
+		memset(&layout, 0, sizeof(layout));
+		layout.removedLines = sc.slotLines;
+		layout.length = (size_t)(sc.slot.length);
+		msg = p_renderHeader(&sc, &layout, thumb, buf, NULL, &(out->header), &headerLen, &warning);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+		if ((uint64_t)headerLen == sc.slot.length) {
+			if (p_checkThumbnail(warning, &sc, name, cb) != 1) goto onError;
+			const size_t slotEnd = (size_t)(sc.slot.start + sc.slot.length);
+			p_addSegment(out, buf, (size_t)(sc.slot.start));
+			p_addSegment(out, out->header, headerLen);
+			p_addSegment(out, buf + slotEnd, len - slotEnd);
+			goto onSuccess;
+		}
+		free(out->header);
+		out->header = NULL;
+		if (cb(MSGT_WARN_SLOT_TOO_SMALL, name, sc.lineNr) != 1) goto onError;
+	}
+	
+	/* Snapmaker 2.0 specific header followed by the body */
+	p_initLayout(&layout, &sc, (uint64_t)len, 0);
+	msg = p_renderHeader(&sc, &layout, thumb, buf, NULL, &(out->header), &headerLen, &warning);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	if (p_checkThumbnail(warning, &sc, name, cb) != 1) goto onError;
+	st_enter(st, ST_PHASE_BODY);
+	p_addSegment(out, out->header, headerLen);
+	count = p_bodyRanges(&sc, (uint64_t)len, range);
+	for (size_t i = 0; i < count; i++) p_addSegment(out, buf + range[i].start, (size_t)(range[i].length));
+	goto onSuccess;
+onUnchanged:
+	p_addSegment(out, buf, len);
+onSuccess:
+	res = 1;
+onError:
+	if (res != 1) freeOutput(out);
+	if (sc.preview != NULL) free(sc.preview);
+	if (lines != NULL) *lines = (uint64_t)(sc.lineNr - 1);
+	if (st != NULL) {
+		st->bytes = (uint64_t)len;
+		st->lines = (uint64_t)(sc.lineNr - 1);
+		st_end(st);
+		opt->statsCb(name, st);
+	}
+	return res;
+	
+#undef ON_ERROR
+}
+
+
+#ifdef PCF_IS_LINUX
+/** Upload of a processed file running concurrently to the output of the local file. */
+typedef struct {
+	const tOptions * opt;      /**< processing options with upload URL and token */
+	const char * name;         /**< file name presented to the terminal */
+	const tOutputList * out;   /**< output segments to upload */
+	tUploadResult result;      /**< upload result */
+	uint64_t sent;             /**< number of uploaded bytes */
+	uint64_t wall;             /**< wall clock time of the upload in nanoseconds */
+} tUpload;
+
+
+/**
+ * Uploads the output segments to the Snapmaker 2.0 terminal. See up_send().
+ * 
+ * @param[in,out] arg - upload
+ */
+static void p_uploadWorker(void * arg) {
+	tUpload * up = (tUpload *)arg;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	up->result = up_send(up->opt->uploadUrl, up->opt->uploadToken, up->name, up->out->vec, up->out->count, &(up->sent));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	up->wall = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (uint64_t)(end.tv_nsec) - (uint64_t)(start.tv_nsec);
+}
+
+
+/**
+ * Writes the output of processBuffer() to the given file. A header within the reserved slot is
+ * written in-place. Otherwise, the file is re-created.
+ * 
+ * @param[in] file - output file path
+ * @param[in] input - input file
+ * @param[in] out - output segments
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_writeProcessed(const TCHAR * file, const tFileMap * input, const tOutputList * out) {
+	tMessage res;
+	FILE * fp;
+	TCHAR * tmpFile = NULL;
+	/* already processed */
+	if (out->header == NULL) return MSGT_SUCCESS;
+	if (out->count > 1 && out->vec[0].iov_base != out->header) {
+		/* header replaces the reserved slot */
+		const int fd = open(file, O_WRONLY);
+		if (fd < 0) return MSGT_ERR_FILE_CREATE;
+		res = p_writeAt(fd, out->header, out->vec[1].iov_len, (uint64_t)(out->vec[0].iov_len));
+		if (close(fd) != 0 && res == MSGT_SUCCESS) res = MSGT_ERR_FILE_WRITE;
+		return res;
+	}
+	if (input->mapped != 0) {
+		/* the mapped input needs to stay valid until the output was written completely */
+		fp = fm_createSibling(file, &tmpFile);
+	} else {
+		fp = _tfopen(file, _T("wb"));
+	}
+	if (fp == NULL) return MSGT_ERR_FILE_CREATE;
+	res = p_writeOutput(fp, out);
+	if (res != MSGT_SUCCESS) {
+		fclose(fp);
+		if (tmpFile != NULL) {
+			fm_discard(tmpFile);
+			free(tmpFile);
+		}
+		return res;
+	}
+	return p_closeOutput(fp, &tmpFile, file);
+}
+
+
+/**
+ * Processes the given file in memory and uploads the result to the Snapmaker 2.0 terminal. The
+ * upload is sent from the output segments by a separate thread while the local file is written.
+ * See processFile().
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] opt - processing options with upload URL
+ * @param[in,out] stats - receives the processing statistics or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int p_processUploaded(const TCHAR * file, const tOptions * opt, tStats * stats, const tCallback cb) {
+	int res = 0;
+	int started = 0;
+	tMessage msg;
+	tFileMap input = {0};
+	tOptions bufferOpt = *opt;
+	uint64_t lines = 0;
+	tOutputList out;
+	tUpload up;
+	tThread thread;
+	const char * name = strrchr(file, '/');
+	
+	memset(&out, 0, sizeof(out));
+	memset(&up, 0, sizeof(up));
+	bufferOpt.scanThreads = PCF_MAX(opt->scanThreads, (size_t)1);
+	bufferOpt.statsCb = NULL;
+	
+	/* map input file into memory or read it completely */
+	switch (fm_open(&input, file)) {
+	case FM_OK: break;
+	case FM_ERR_NO_MEM: cb(MSGT_ERR_NO_MEM, file, 1); goto onError;
+	case FM_ERR_READ: cb(MSGT_ERR_FILE_READ, file, 1); goto onError;
+	default: cb(MSGT_ERR_FILE_OPEN, file, 1); goto onError;
+	}
+	
+	/* scan and render the header; an already processed file is uploaded as it is */
+	st_enter(stats, ST_PHASE_SCAN);
+	if (p_processBuffer(file, input.data, input.size, &bufferOpt, &out, &lines, cb) != 1) goto onError;
+	
+	/* upload while the local file is written */
+	st_enter(stats, ST_PHASE_BODY);
+	up.opt = opt;
+	up.name = (name != NULL) ? name + 1 : file;
+	up.out = &out;
+	if (th_create(&thread, p_uploadWorker, &up) == 1) {
+		started = 1;
+	} else {
+		p_uploadWorker(&up);
+	}
+	msg = p_writeProcessed(file, &input, &out);
+	if (started != 0) th_join(&thread);
+	if (msg != MSGT_SUCCESS) {
+		cb(msg, file, 1);
+		goto onError;
+	}
+	if (up.result != UP_OK) {
+		cb(MSGT_ERR_UPLOAD, file, 0);
+		goto onError;
+	}
+	res = 1;
+onError:
+	if (stats != NULL) {
+		stats->bytes = (uint64_t)(input.size);
+		stats->lines = lines;
+		stats->uploadBytes = up.sent;
+		stats->uploadWall = up.wall;
+	}
+	freeOutput(&out);
+	fm_close(&input);
+	return res;
+}
+
+
+/**
+ * Processes the given file in memory and streams the result to the printer connected to the
+ * serial device of the options after the local file was written. See processFile() and sr_send().
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] opt - processing options with serial device
+ * @param[in,out] stats - receives the processing statistics or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+static int p_processPrinted(const TCHAR * file, const tOptions * opt, tStats * stats, const tCallback cb) {
+	int res = 0;
+	tMessage msg;
+	tFileMap input = {0};
+	tOptions bufferOpt = *opt;
+	uint64_t lines = 0;
+	tOutputList out;
+	tSerialStats serial;
+	tSerialResult sent;
+	struct timespec start, end;
+	int streamed = 0;
+	
+	memset(&out, 0, sizeof(out));
+	memset(&serial, 0, sizeof(serial));
+	bufferOpt.scanThreads = PCF_MAX(opt->scanThreads, (size_t)1);
+	bufferOpt.statsCb = NULL;
+	
+	/* map input file into memory or read it completely */
+	switch (fm_open(&input, file)) {
+	case FM_OK: break;
+	case FM_ERR_NO_MEM: cb(MSGT_ERR_NO_MEM, file, 1); goto onError;
+	case FM_ERR_READ: cb(MSGT_ERR_FILE_READ, file, 1); goto onError;
+	default: cb(MSGT_ERR_FILE_OPEN, file, 1); goto onError;
+	}
+	
+	/* scan and render the header; an already processed file is streamed as it is */
+	st_enter(stats, ST_PHASE_SCAN);
+	if (p_processBuffer(file, input.data, input.size, &bufferOpt, &out, &lines, cb) != 1) goto onError;
+	st_enter(stats, ST_PHASE_BODY);
+	msg = p_writeProcessed(file, &input, &out);
+	if (msg != MSGT_SUCCESS) {
+		cb(msg, file, 1);
+		goto onError;
+	}
+	
+	/* stream the processed output */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sent = sr_send(
+		opt->streamDevice,
+		(opt->streamBaud > 0) ? opt->streamBaud : SR_DEFAULT_BAUD,
+		(opt->streamWindow > 0) ? opt->streamWindow : SR_DEFAULT_WINDOW,
+		out.vec, out.count, &serial
+	);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	streamed = 1;
+	if (sent != SR_OK) {
+		cb(MSGT_ERR_STREAM, file, 0);
+		goto onError;
+	}
+	res = 1;
+onError:
+	if (stats != NULL) {
+		stats->bytes = (uint64_t)(input.size);
+		stats->lines = lines;
+		stats->streamCommands = serial.commands;
+		stats->streamResends = serial.resends;
+		stats->streamUnderruns = serial.underruns;
+		if (streamed != 0) {
+			stats->streamWall = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (uint64_t)(end.tv_nsec) - (uint64_t)(start.tv_nsec);
+		}
+	}
+	freeOutput(&out);
+	fm_close(&input);
+	return res;
+}
+#endif /* PCF_IS_LINUX */
+
+
+/**
+ * Processes the given PrusaSlicer generated G-Code file and converts
+ * it into a Snapmaker 2.0 terminal compatible G-Code file. This function
+ * may be called concurrently for different files with different contexts.
+ * The statistics callback of the options is called afterwards if set.
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code file
+ * @param[in] opt - processing options (NULL for defaults)
+ * @param[in,out] ctx - resources reused between calls or NULL
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure, -1 if aborted by callback function
+ */
+int processFile(const TCHAR * file, const tOptions * opt, tContext * ctx, const tCallback cb) {
+	tStats stats;
+	tStats * st = NULL;
+	int res;
+	if (file == NULL || cb == NULL) return 0;
+	if (opt != NULL && opt->statsCb != NULL) {
+		st = &stats;
+		st_begin(st);
+	}
+	if (opt == NULL) {
+		res = p_processBuffered(file, 0, 1, NULL, st, cb);
+	} else if (opt->uploadUrl != NULL) {
+#ifdef PCF_IS_LINUX
+		res = p_processUploaded(file, opt, st, cb);
+#else /* !PCF_IS_LINUX */
+		cb(MSGT_ERR_UPLOAD, file, 0);
+		res = 0;
+#endif /* !PCF_IS_LINUX */
+	} else if (opt->streamDevice != NULL) {
+#ifdef PCF_IS_LINUX
+		res = p_processPrinted(file, opt, st, cb);
+#else /* !PCF_IS_LINUX */
+		cb(MSGT_ERR_STREAM, file, 0);
+		res = 0;
+#endif /* !PCF_IS_LINUX */
+	} else if (opt->lowMemory != 0) {
+		res = p_processStreamed(file, ctx, &(opt->thumbnail), st, cb);
+	} else {
+		res = p_processBuffered(file, opt->inPlace, PCF_MAX(opt->scanThreads, (size_t)1), &(opt->thumbnail), st, cb);
+	}
+	if (st != NULL) {
+		st_end(st);
+		opt->statsCb(file, st);
+	}
+	return res;
+}
+
+
+/** Input spool of processStream(). */
+typedef struct {
+	char * buf;                /**< in-memory spool or NULL */
+	size_t capacity;           /**< allocated size of buf in bytes */
+	uint64_t length;           /**< number of spooled bytes */
+	uint64_t limit;            /**< maximum in-memory spool size in bytes */
+	FILE * fp;                 /**< temporary spool file if the limit was exceeded or NULL */
+} tSpool;
+
+
+/**
+ * Appends the given data to the spool. The data is kept in memory until the spool limit is
+ * exceeded. All spooled data is moved to a temporary file at this point. Further data is appended
+ * to this file. Hence, the spool offsets always equal the input offsets.
+ * 
+ * @param[in,out] sp - spool
+ * @param[in] data - data to append
+ * @param[in] len - data length in bytes
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_spoolAppend(tSpool * sp, const char * data, const size_t len) {
+	if (len < 1) return MSGT_SUCCESS;
+	if (sp->fp == NULL) {
+		const uint64_t need = sp->length + (uint64_t)len;
+		if (need <= sp->limit && need <= (uint64_t)((size_t)-1)) {
+			if (need > (uint64_t)(sp->capacity)) {
+				size_t newCapacity = PCF_MAX(sp->capacity, (size_t)LINE_BUFFER_SIZE);
+				while ((uint64_t)newCapacity < need && newCapacity < ((size_t)-1 / 2)) newCapacity *= 2;
+				newCapacity = (size_t)PCF_MIN(PCF_MAX((uint64_t)newCapacity, need), sp->limit);
+				char * newBuf = (char *)realloc(sp->buf, newCapacity);
+				if (newBuf == NULL) return MSGT_ERR_NO_MEM;
+				sp->buf = newBuf;
+				sp->capacity = newCapacity;
+			}
+			memcpy(sp->buf + sp->length, data, len);
+			sp->length = need;
+			return MSGT_SUCCESS;
+		}
+		/* move the spooled data to a temporary file */
+		sp->fp = tmpfile();
+		if (sp->fp == NULL) return MSGT_ERR_FILE_CREATE;
+		if (sp->length > 0 && fwrite(sp->buf, (size_t)(sp->length), 1, sp->fp) < 1) return MSGT_ERR_FILE_WRITE;
+		if (sp->buf != NULL) free(sp->buf);
+		sp->buf = NULL;
+		sp->capacity = 0;
+	}
+	if (fwrite(data, len, 1, sp->fp) < 1) return MSGT_ERR_FILE_WRITE;
+	sp->length += (uint64_t)len;
+	return MSGT_SUCCESS;
+}
+
+
+/**
+ * Outputs the given ranges of the spooled data with the passed header in front of the range at
+ * the given index. Everything is written with a single p_writeOutput() call if the spool is kept
+ * in memory.
+ * 
+ * @param[in,out] fp - output file
+ * @param[in] sp - spool
+ * @param[in,out] buf - transfer buffer
+ * @param[in] bufSize - transfer buffer size in bytes
+ * @param[in] header - header data or NULL
+ * @param[in] headerLen - header length in bytes
+ * @param[in] headerPos - output the header before this range (count for after the last one)
+ * @param[in] range - spool ranges to output
+ * @param[in] count - number of spool ranges (at most OUTPUT_SEGMENTS - 1)
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_spoolWrite(FILE * fp, const tSpool * sp, char * buf, const size_t bufSize, const char * header, const size_t headerLen, const size_t headerPos, const tFileRange * range, const size_t count) {
+	tMessage res = MSGT_SUCCESS;
+	tOutputList out;
+#ifdef PCF_IS_NO_WIN
+	PCF_UNUSED(buf)
+	PCF_UNUSED(bufSize)
+#endif /* PCF_IS_NO_WIN */
+	memset(&out, 0, sizeof(out));
+	for (size_t i = 0; i <= count && res == MSGT_SUCCESS; i++) {
+		if (i == headerPos) p_addSegment(&out, header, headerLen);
+		if (i >= count) break;
+		if (sp->fp == NULL) {
+			p_addSegment(&out, sp->buf + range[i].start, (size_t)(range[i].length));
+			continue;
+		}
+		if (range[i].length < 1) continue;
+		/* output pending segments before the spool file range */
+		res = p_writeOutput(fp, &out);
+		memset(&out, 0, sizeof(out));
+		if (res != MSGT_SUCCESS) break;
+#ifdef PCF_IS_NO_WIN
+		if (fflush(fp) != 0 || fc_copy(fileno(fp), fileno(sp->fp), range[i].start, range[i].length) != 1) res = MSGT_ERR_FILE_WRITE;
+#else /* PCF_IS_WIN */
+		res = p_copyRange(fp, sp->fp, buf, bufSize, range + i);
+#endif /* PCF_IS_WIN */
+	}
+	if (res == MSGT_SUCCESS) res = p_writeOutput(fp, &out);
+	return res;
+}
+
+
+/**
+ * Processes the PrusaSlicer generated G-Code read from the given input stream and writes the
+ * Snapmaker 2.0 terminal compatible result to the given output stream. The input needs to be
+ * spooled completely because some header values are only given at its end. It is kept in memory up
+ * to the memory budget of the passed options and moved to a temporary file beyond that (or always
+ * in low-memory mode). The spooled data is written once and read once. Input which needs no
+ * processing is passed through unchanged.
+ * 
+ * @param[in] name - input name used for messages and statistics
+ * @param[in,out] in - input stream (binary mode)
+ * @param[in,out] out - output stream (binary mode)
+ * @param[in] opt - processing options (NULL for defaults; inPlace is ignored)
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+int processStream(const TCHAR * name, FILE * in, FILE * out, const tOptions * opt, const tCallback cb) {
+#define ON_ERROR(msg) do { \
+	cb(msg, name, sc.lineNr); \
+	goto onError; \
+} while (0)
+
+	int res = 0;
+	tMessage msg;
+	tStats stats;
+	tStats * st = NULL;
+	char * buf = NULL;
+	char * header = NULL;
+	char * owned[VAL_COUNT] = {0};
+	size_t headerLen = 0;
+	tMessage warning;
+	size_t fill = 0;
+	size_t count;
+	const tThumbnailOptions * thumb = (opt != NULL) ? &(opt->thumbnail) : NULL;
+	tSpool sp;
+	tFileRange range[BODY_RANGES];
+	tHeaderLayout layout;
+	tScanner sc;
+	
+	if (name == NULL || in == NULL || out == NULL || cb == NULL) return 0;
+	p_scanInit(&sc);
+	memset(&sp, 0, sizeof(sp));
+	if (opt == NULL) {
+		sp.limit = ((uint64_t)DEFAULT_MEMORY_BUDGET) << 20;
+	} else if (opt->lowMemory != 0) {
+		sp.limit = 0;
+	} else {
+		sp.limit = (opt->memoryBudget > 0) ? opt->memoryBudget : (uint64_t)-1;
+	}
+	if (opt != NULL && opt->statsCb != NULL) {
+		st = &stats;
+		st_begin(st);
+	}
+	buf = (char *)malloc(LINE_BUFFER_SIZE);
+	if (buf == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
+	
+	/* parse tokens line-wise while spooling the input */
+	for (;;) {
+		const size_t got = fread(buf + fill, 1, LINE_BUFFER_SIZE - fill, in);
+		if (got < (LINE_BUFFER_SIZE - fill) && ferror(in) != 0) ON_ERROR(MSGT_ERR_FILE_READ);
+		fill += got;
+		if (fill < 1) break;
+		const int atEnd = feof(in);
+		size_t len = fill;
+		if (atEnd == 0) {
+			/* pass complete lines only */
+			while (len > 0 && buf[len - 1] != '\n') len--;
+			if (len < 1) len = fill;
+		}
+		st_enter(st, ST_PHASE_SCAN);
+		if (p_scan(&sc, buf, len, sp.length) == 0) goto onUnchanged;
+		if (buf[len - 1] != '\n' && atEnd == 0) p_scanBreakLine(&sc);
+		if (p_scanPin(&sc, owned) != 1) ON_ERROR(MSGT_ERR_NO_MEM);
+		st_enter(st, ST_PHASE_READ);
+		msg = p_spoolAppend(&sp, buf, len);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+		memmove(buf, buf + len, fill - len);
+		fill -= len;
+	}
+	if (sp.length < 1) goto onSuccess;
+	if (sp.fp != NULL && fflush(sp.fp) != 0) ON_ERROR(MSGT_ERR_FILE_WRITE);
+	st_enter(st, ST_PHASE_HEADER);
+	msg = p_selectThumbnail(&sc, thumb, sp.buf, sp.fp);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	msg = p_renderPreview(&sc, thumb, sp.buf, sp.fp, (size_t)(sp.length), (opt != NULL) ? PCF_MAX(opt->scanThreads, (size_t)1) : 1);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	
+	/* check missing tokens */
+	if (p_checkValues(&sc, name, cb) != 1) goto onError;
+	
+	clearerr(out);
+	if (sc.slot.length != 0) {
+		/* replace the reserved slot by the header */
+		memset(&layout, 0, sizeof(layout));
+		layout.removedLines = sc.slotLines;
+		layout.length = (size_t)(sc.slot.length);
+		msg = p_renderHeader(&sc, &layout, thumb, sp.buf, sp.fp, &header, &headerLen, &warning);
+		if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+		if ((uint64_t)headerLen == sc.slot.length) {
+			if (p_checkThumbnail(warning, &sc, name, cb) != 1) goto onError;
+			range[0].start = 0;
+			range[0].length = sc.slot.start;
+			range[1].start = sc.slot.start + sc.slot.length;
+			range[1].length = sp.length - range[1].start;
+			st_enter(st, ST_PHASE_BODY);
+			msg = p_spoolWrite(out, &sp, buf, LINE_BUFFER_SIZE, header, headerLen, 1, range, 2);
+			if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+			goto onFlush;
+		}
+		free(header);
+		header = NULL;
+		if (cb(MSGT_WARN_SLOT_TOO_SMALL, name, sc.lineNr) != 1) goto onError;
+	}
+	
+	/* Snapmaker 2.0 specific header followed by the body */
+	p_initLayout(&layout, &sc, sp.length, 0);
+	msg = p_renderHeader(&sc, &layout, thumb, sp.buf, sp.fp, &header, &headerLen, &warning);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	if (p_checkThumbnail(warning, &sc, name, cb) != 1) goto onError;
+	st_enter(st, ST_PHASE_BODY);
+	count = p_bodyRanges(&sc, sp.length, range);
+	msg = p_spoolWrite(out, &sp, buf, LINE_BUFFER_SIZE, header, headerLen, 0, range, count);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	goto onFlush;
+onUnchanged:
+	/* pass through spooled data, buffered data and remaining input */
+	st_enter(st, ST_PHASE_BODY);
+	range[0].start = 0;
+	range[0].length = sp.length;
+	if (sp.fp != NULL && fflush(sp.fp) != 0) ON_ERROR(MSGT_ERR_FILE_WRITE);
+	msg = p_spoolWrite(out, &sp, buf, LINE_BUFFER_SIZE, NULL, 0, 0, range, 1);
+	if (msg != MSGT_SUCCESS) ON_ERROR(msg);
+	while (fill > 0) {
+		if (fwrite(buf, fill, 1, out) < 1) ON_ERROR(MSGT_ERR_FILE_WRITE);
+		sp.length += (uint64_t)fill;
+		fill = fread(buf, 1, LINE_BUFFER_SIZE, in);
+		if (fill < LINE_BUFFER_SIZE && ferror(in) != 0) ON_ERROR(MSGT_ERR_FILE_READ);
+	}
+onFlush:
+	if (fflush(out) != 0 || ferror(out) != 0) ON_ERROR(MSGT_ERR_FILE_WRITE);
+onSuccess:
+	res = 1;
+onError:
+	if (sp.fp != NULL) fclose(sp.fp);
+	if (sp.buf != NULL) free(sp.buf);
+	if (header != NULL) free(header);
+	if (sc.preview != NULL) free(sc.preview);
+	for (size_t i = 0; i < VAL_COUNT; i++) {
+		if (owned[i] != NULL) free(owned[i]);
+	}
+	if (buf != NULL) free(buf);
+	if (st != NULL) {
+		st->bytes = sp.length;
+		st->lines = (uint64_t)(sc.lineNr - 1);
+		st_end(st);
+		opt->statsCb(name, st);
+	}
+	return res;
+	
+#undef ON_ERROR
+}
+
+
+/**
+ * Processes the given PrusaSlicer generated G-Code content in memory. The result is returned as
+ * list of output segments which reference the rendered header and slices of the input buffer.
+ * The input is returned as single segment if it needs no processing (e.g. already processed).
+ * The input buffer needs to stay valid until the output has been consumed. This function may be
+ * called concurrently.
+ * 
+ * @param[in] name - input name used for messages and statistics
+ * @param[in] buf - PrusaSlicer generated G-Code
+ * @param[in] len - input length in bytes
+ * @param[in] opt - processing options (NULL for defaults; inPlace and lowMemory are ignored)
+ * @param[out] out - receives the output segments (free with freeOutput())
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+int processBuffer(const TCHAR * name, const char * buf, const size_t len, const tOptions * opt, tOutputList * out, const tCallback cb) {
+	return p_processBuffer(name, buf, len, opt, out, NULL, cb);
+}
+
+
+/**
+ * Processes the G-Code provided by the given reader callback in memory. The input is read
+ * completely into a buffer owned by the output. See processBuffer().
+ * 
+ * @param[in] name - input name used for messages and statistics
+ * @param[in] reader - reader callback function
+ * @param[in,out] user - user data passed to the reader callback function
+ * @param[in] opt - processing options (NULL for defaults; inPlace and lowMemory are ignored)
+ * @param[out] out - receives the output segments (free with freeOutput())
+ * @param[in] cb - error output callback function
+ * @return 1 on success, 0 on failure
+ */
+int processReader(const TCHAR * name, const tReader reader, void * user, const tOptions * opt, tOutputList * out, const tCallback cb) {
+	char * buf = NULL;
+	size_t len = 0;
+	size_t capacity = 0;
+	if (out == NULL) return 0;
+	memset(out, 0, sizeof(*out));
+	if (name == NULL || reader == NULL || cb == NULL) return 0;
+	for (;;) {
+		if ((capacity - len) < LINE_BUFFER_SIZE) {
+			const size_t newCapacity = (capacity > 0) ? 2 * capacity : LINE_BUFFER_SIZE;
+			char * newBuf = (char *)realloc(buf, newCapacity);
+			if (newBuf == NULL || newCapacity < capacity) {
+				if (newBuf != NULL) buf = newBuf;
+				cb(MSGT_ERR_NO_MEM, name, 0);
+				goto onError;
+			}
+			buf = newBuf;
+			capacity = newCapacity;
+		}
+		const size_t got = reader(user, buf + len, capacity - len);
+		if (got == 0) break;
+		if (got == (size_t)-1 || got > (capacity - len)) {
+			cb(MSGT_ERR_FILE_READ, name, 0);
+			goto onError;
+		}
+		len += got;
+	}
+	if (processBuffer(name, buf, len, opt, out, cb) != 1) goto onError;
+	out->input = buf;
+	return 1;
+onError:
+	if (buf != NULL) free(buf);
+	return 0;
+}
+
+
+/**
+ * Releases all resources of the given output list.
+ * 
+ * @param[in,out] out - output list to free
+ */
+void freeOutput(tOutputList * out) {
+	if (out == NULL) return;
+	if (out->header != NULL) free(out->header);
+	if (out->input != NULL) free(out->input);
+	memset(out, 0, sizeof(*out));
+}
+
+
+/**
+ * Releases all resources of the given context.
+ * 
+ * @param[in,out] ctx - context to free
+ */
+void freeContext(tContext * ctx) {
+	if (ctx == NULL) return;
+	if (ctx->lineBuffer != NULL) free(ctx->lineBuffer);
+	ctx->lineBuffer = NULL;
+}
+
+
+/** Shared state of the processFiles() worker threads. */
+typedef struct {
+	TCHAR * const * file;      /**< files to process */
+	size_t count;              /**< number of files */
+	const tOptions * opt;      /**< processing options */
+	int * result;              /**< processFile() result per file */
+	tCallback cb;              /**< error output callback function */
+	int threaded;              /**< 1 if mutex and condition variable are used, else 0 */
+	size_t next;               /**< index of the next file to process */
+	uint64_t used;             /**< memory budget reserved by running workers in bytes */
+	tMutex mutex;              /**< protects next and used */
+	tCondition released;       /**< signaled if memory budget was released */
+} tBatch;
+
+
+/**
+ * Reserves the memory budget needed to process the given file. Blocks until enough of the budget
+ * was released by other workers. At least one file is always processed.
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in] file - file to process
+ * @return reserved budget in bytes
+ */
+static uint64_t p_batchReserve(tBatch * batch, const TCHAR * file) {
+	const uint64_t budget = (batch->opt != NULL) ? batch->opt->memoryBudget : 0;
+	uint64_t need = 0;
+	if (batch->opt != NULL && batch->opt->lowMemory != 0) {
+		need = LINE_BUFFER_SIZE;
+	} else if (fm_fileSize(file, &need) != 1) {
+		need = 0;
+	}
+	if (budget > 0) need = PCF_MIN(need, budget);
+	if (batch->threaded != 0) {
+		th_lock(&(batch->mutex));
+		while (budget > 0 && batch->used > 0 && (batch->used + need) > budget) {
+			th_condWait(&(batch->released), &(batch->mutex));
+		}
+		batch->used += need;
+		th_unlock(&(batch->mutex));
+	}
+	return need;
+}
+
+
+/**
+ * Releases the memory budget reserved via p_batchReserve().
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in] need - reserved budget in bytes
+ */
+static void p_batchRelease(tBatch * batch, const uint64_t need) {
+	if (batch->threaded == 0) return;
+	th_lock(&(batch->mutex));
+	batch->used -= need;
+	th_condBroadcast(&(batch->released));
+	th_unlock(&(batch->mutex));
+}
+
+
+/**
+ * Worker thread of processFiles(). Processes files until none are left. Each file reserves its
+ * size from the memory budget before being processed.
+ * 
+ * @param[in,out] arg - shared batch state
+ */
+static void p_batchWorker(void * arg) {
+	tBatch * batch = (tBatch *)arg;
+	tContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	for (;;) {
+		size_t i;
+		if (batch->threaded != 0) th_lock(&(batch->mutex));
+		i = batch->next;
+		if (i < batch->count) batch->next++;
+		if (batch->threaded != 0) th_unlock(&(batch->mutex));
+		if (i >= batch->count) break;
+		
+		const uint64_t need = p_batchReserve(batch, batch->file[i]);
+		batch->result[i] = processFile(batch->file[i], batch->opt, &ctx, batch->cb);
+		p_batchRelease(batch, need);
+	}
+	freeContext(&ctx);
+}
+
+
+#ifdef PCF_IS_LINUX
+/** Maximum number of bytes per io_uring read or write request. */
+#define URING_CHUNK 0x100000
+
+
+/** Maximum number of io_uring submission queue entries of processFiles(). */
+#define URING_MAX_ENTRIES 4096
+
+
+/** Maximum number of attempts to create a temporary output file with a unique name. */
+#define URING_MAX_ATTEMPTS 100
+
+
+/** Encodes the io_uring request user data from file slot, request type and chunk index. */
+#define URING_USER(slot, req, chunk) ((((uint64_t)(slot)) << 40) | (((uint64_t)(req)) << 32) | ((uint64_t)(chunk) & 0xFFFFFFFF))
+
+
+/** Request types of p_processUring(). */
+typedef enum {
+	UREQ_OPEN,
+	UREQ_STAT,
+	UREQ_READ,
+	UREQ_CLOSE_IN,
+	UREQ_CREATE,
+	UREQ_WRITE,
+	UREQ_SYNC,
+	UREQ_CLOSE_OUT,
+	UREQ_RENAME
+} tUringRequest;
+
+
+/** Processing steps of a file handled by p_processUring(). */
+typedef enum {
+	USTEP_IDLE,                /**< slot unused */
+	USTEP_OPEN,                /**< waiting for open and status of the input file */
+	USTEP_BUDGET,              /**< waiting for memory budget */
+	USTEP_READ,                /**< reading the input file */
+	USTEP_CREATE,              /**< creating the output file */
+	USTEP_WRITE,               /**< writing the output file */
+	USTEP_FINISH               /**< waiting for the remaining requests */
+} tUringStep;
+
+
+/** File in flight of p_processUring(). */
+typedef struct {
+	tUringStep step;           /**< current processing step */
+	size_t index;              /**< file index */
+	int failed;                /**< 1 if processing failed, else 0 */
+	int in;                    /**< input file descriptor or -1 */
+	int out;                   /**< output file descriptor or -1 */
+	tUringStat st;             /**< input file status */
+	uint64_t size;             /**< input file size in bytes */
+	unsigned mode;             /**< input file mode */
+	unsigned uid;              /**< input file owner user ID */
+	unsigned gid;              /**< input file owner group ID */
+	uint64_t need;             /**< reserved memory budget in bytes */
+	char * buf;                /**< input file content */
+	uint64_t issued;           /**< next chunk index to request */
+	uint64_t done;             /**< number of completed chunks */
+	uint64_t chunks;           /**< end of the chunk index range of the current step */
+	size_t pending;            /**< number of requests in flight */
+	char * tmpFile;            /**< temporary output file path or NULL to write into the input file */
+	int rewrite;               /**< 1 to overwrite the linked input file in-place, 0 for the reserved slot */
+	int creating;              /**< 1 if the output file creation is in flight, else 0 */
+	int created;               /**< 1 if the temporary output file exists, else 0 */
+	size_t attempts;           /**< number of attempts to create the output file */
+	uint64_t segStart[OUTPUT_SEGMENTS]; /**< output file offset per segment */
+	uint64_t segChunk[OUTPUT_SEGMENTS + 1]; /**< index of the first write chunk per segment */
+	tOutputList output;        /**< processing output */
+} tUringFile;
+
+
+/**
+ * Reads the given number of bytes at the passed file offset. Interrupted and partial reads are
+ * continued.
+ * 
+ * @param[in] fd - input file descriptor
+ * @param[out] data - receives the read data
+ * @param[in] len - number of bytes to read
+ * @param[in] offset - input file offset
+ * @return MSGT_SUCCESS on success, else the error cause
+ */
+static tMessage p_readAt(const int fd, char * data, const size_t len, const uint64_t offset) {
+	for (size_t got = 0; got < len; ) {
+		const ssize_t res = pread(fd, data + got, len - got, (off_t)(offset + got));
+		if (res < 0 && errno == EINTR) continue;
+		if (res <= 0) return MSGT_ERR_FILE_READ;
+		got += (size_t)res;
+	}
+	return MSGT_SUCCESS;
+}
+
+
+/**
+ * Marks the given file as failed. Only the first error is reported.
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in,out] f - file in flight
+ * @param[in] msg - error cause
+ */
+static void p_uringFail(tBatch * batch, tUringFile * f, const tMessage msg) {
+	if (f->failed == 0) batch->cb(msg, batch->file[f->index], 1);
+	f->failed = 1;
+}
+
+
+/**
+ * Sets a new random temporary output file path next to the input file.
+ * 
+ * @param[in,out] f - file in flight
+ * @param[in] file - input file path
+ * @param[in,out] rng - random number generator state
+ * @return 1 on success, 0 on allocation error
+ */
+static int p_uringTmpName(tUringFile * f, const char * file, uint64_t * rng) {
+	static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+	const size_t len = strlen(file);
+	if (f->tmpFile == NULL) {
+		f->tmpFile = (char *)malloc(len + 8);
+		if (f->tmpFile == NULL) return 0;
+		memcpy(f->tmpFile, file, len);
+		f->tmpFile[len] = '.';
+		f->tmpFile[len + 7] = 0;
+	}
+	for (size_t i = 1; i < 7; i++) {
+		/* xorshift64 */
+		*rng ^= *rng << 13;
+		*rng ^= *rng >> 7;
+		*rng ^= *rng << 17;
+		f->tmpFile[len + i] = chars[*rng % (sizeof(chars) - 1)];
+	}
+	return 1;
+}
+
+
+/**
+ * Processes the read input file and prepares the output file creation.
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in,out] f - file in flight
+ * @param[in,out] rng - random number generator state
+ */
+static void p_uringProcess(tBatch * batch, tUringFile * f, uint64_t * rng) {
+	const TCHAR * file = batch->file[f->index];
+	f->step = USTEP_FINISH;
+	if (processBuffer(file, f->buf, (size_t)(f->size), batch->opt, &(f->output), batch->cb) != 1) {
+		f->failed = 1;
+		return;
+	}
+	if (f->output.header == NULL) return; /* unchanged */
+	/* compute the output offset and the first write chunk of each segment */
+	f->segChunk[0] = 0;
+	for (size_t i = 0; i < f->output.count; i++) {
+		const uint64_t len = (uint64_t)(f->output.vec[i].iov_len);
+		f->segStart[i] = (i > 0) ? f->segStart[i - 1] + (uint64_t)(f->output.vec[i - 1].iov_len) : 0;
+		f->segChunk[i + 1] = f->segChunk[i] + ((len + URING_CHUNK - 1) / URING_CHUNK);
+	}
+	if (f->output.vec[0].iov_base != f->output.header) {
+		/* only the header is written into the reserved slot */
+		f->issued = f->segChunk[1];
+		f->chunks = f->segChunk[2];
+	} else {
+		/* renaming over a linked input file would change its identity; the input is in memory */
+		f->rewrite = fm_isLinked(file);
+		if (f->rewrite == 0 && p_uringTmpName(f, file, rng) != 1) {
+			p_uringFail(batch, f, MSGT_ERR_NO_MEM);
+			return;
+		}
+		f->issued = 0;
+		f->chunks = f->segChunk[f->output.count];
+	}
+	f->done = f->issued;
+	f->attempts = 0;
+	f->step = USTEP_CREATE;
+}
+
+
+/**
+ * Advances the given file to the next processing step and prepares its next requests as far as
+ * the submission queue allows.
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in,out] ur - io_uring instance
+ * @param[in,out] f - file in flight
+ * @param[in] slot - file slot index
+ * @param[in,out] rng - random number generator state
+ */
+static void p_uringStep(tBatch * batch, tUring * ur, tUringFile * f, const size_t slot, uint64_t * rng) {
+	const uint64_t budget = batch->opt->memoryBudget;
+	for (;;) {
+		const tUringStep step = f->step;
+		if (f->failed != 0 && step != USTEP_IDLE) f->step = USTEP_FINISH;
+		switch (f->step) {
+		case USTEP_IDLE:
+			if (batch->next >= batch->count || ur_space(ur) < 2) return;
+			memset(f, 0, sizeof(*f));
+			f->index = batch->next++;
+			f->in = -1;
+			f->out = -1;
+			/* the status is only requested if the file could be opened */
+			ur_openat(ur, batch->file[f->index], O_RDONLY | O_CLOEXEC, 0, URING_USER(slot, UREQ_OPEN, 0), 1);
+			ur_statx(ur, batch->file[f->index], &(f->st), URING_USER(slot, UREQ_STAT, 0), 0);
+			f->pending = 2;
+			f->step = USTEP_OPEN;
+			break;
+		case USTEP_OPEN:
+			if (f->pending == 0) f->step = USTEP_BUDGET;
+			break;
+		case USTEP_BUDGET:
+			if (f->size > (uint64_t)((size_t)-1)) {
+				p_uringFail(batch, f, MSGT_ERR_NO_MEM);
+				break;
+			}
+			f->need = (budget > 0) ? PCF_MIN(f->size, budget) : f->size;
+			if (batch->used > 0 && budget > 0 && (batch->used + f->need) > budget) {
+				f->need = 0;
+				return;
+			}
+			batch->used += f->need;
+			if (f->size > 0) {
+				f->buf = (char *)malloc((size_t)(f->size));
+				if (f->buf == NULL) {
+					p_uringFail(batch, f, MSGT_ERR_NO_MEM);
+					break;
+				}
+			}
+			f->issued = 0;
+			f->done = 0;
+			f->chunks = (f->size + URING_CHUNK - 1) / URING_CHUNK;
+			f->step = USTEP_READ;
+			break;
+		case USTEP_READ:
+			while (f->issued < f->chunks && ur_space(ur) > 0) {
+				const uint64_t offset = f->issued * URING_CHUNK;
+				ur_read(ur, f->in, f->buf + offset, (unsigned)PCF_MIN(f->size - offset, (uint64_t)URING_CHUNK), offset, URING_USER(slot, UREQ_READ, f->issued), 0);
+				f->issued++;
+				f->pending++;
+			}
+			if (f->done < f->chunks) return;
+			p_uringProcess(batch, f, rng);
+			break;
+		case USTEP_CREATE:
+			if (f->in >= 0) {
+				if (ur_space(ur) < 1) return;
+				ur_close(ur, f->in, URING_USER(slot, UREQ_CLOSE_IN, 0), 0);
+				f->in = -1;
+				f->pending++;
+			}
+			if (f->out >= 0) {
+				f->step = USTEP_WRITE;
+				break;
+			}
+			if (f->creating != 0 || ur_space(ur) < 1) return;
+			if (f->tmpFile != NULL) {
+				ur_openat(ur, f->tmpFile, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, f->mode & 07777, URING_USER(slot, UREQ_CREATE, 0), 0);
+			} else {
+				ur_openat(ur, batch->file[f->index], O_WRONLY | O_CLOEXEC | ((f->rewrite != 0) ? O_TRUNC : 0), 0, URING_USER(slot, UREQ_CREATE, 0), 0);
+			}
+			f->creating = 1;
+			f->attempts++;
+			f->pending++;
+			return;
+		case USTEP_WRITE:
+			while (f->issued < f->chunks && ur_space(ur) > 0) {
+				size_t seg = 0;
+				while (f->segChunk[seg + 1] <= f->issued) seg++;
+				const uint64_t offset = (f->issued - f->segChunk[seg]) * URING_CHUNK;
+				const char * data = (const char *)(f->output.vec[seg].iov_base) + offset;
+				const uint64_t len = PCF_MIN((uint64_t)(f->output.vec[seg].iov_len) - offset, (uint64_t)URING_CHUNK);
+				ur_write(ur, f->out, data, (unsigned)len, f->segStart[seg] + offset, URING_USER(slot, UREQ_WRITE, f->issued), 0);
+				f->issued++;
+				f->pending++;
+			}
+			if (f->done < f->chunks) return;
+			f->step = USTEP_FINISH;
+			break;
+		case USTEP_FINISH:
+			if (f->in >= 0) {
+				if (ur_space(ur) < 1) return;
+				ur_close(ur, f->in, URING_USER(slot, UREQ_CLOSE_IN, 0), 0);
+				f->in = -1;
+				f->pending++;
+			}
+			if (f->out >= 0) {
+				if (f->failed == 0 && f->tmpFile != NULL) {
+					/* replace the input file once the output file was synced and closed successfully */
+					if (ur_space(ur) < 3) return;
+					ur_fsync(ur, f->out, URING_USER(slot, UREQ_SYNC, 0), 1);
+					ur_close(ur, f->out, URING_USER(slot, UREQ_CLOSE_OUT, f->out), 1);
+					ur_renameat(ur, f->tmpFile, batch->file[f->index], URING_USER(slot, UREQ_RENAME, 0), 0);
+					f->pending += 3;
+				} else {
+					if (ur_space(ur) < 1) return;
+					ur_close(ur, f->out, URING_USER(slot, UREQ_CLOSE_OUT, f->out), 0);
+					f->pending++;
+				}
+				f->out = -1;
+			}
+			if (f->pending > 0) return;
+			/* discard incomplete output */
+			if (f->tmpFile != NULL) {
+				if (f->created != 0) unlink(f->tmpFile);
+				free(f->tmpFile);
+			}
+			if (f->buf != NULL) free(f->buf);
+			freeOutput(&(f->output));
+			batch->used -= f->need;
+			batch->result[f->index] = (f->failed == 0) ? 1 : 0;
+			f->step = USTEP_IDLE;
+			break;
+		}
+		if (f->step == step && step != USTEP_IDLE) return;
+	}
+}
+
+
+/**
+ * Handles the completion of a request of p_processUring().
+ * 
+ * @param[in,out] batch - shared batch state
+ * @param[in,out] f - file in flight
+ * @param[in] req - completed request type
+ * @param[in] chunk - chunk index of the completed read or write request
+ * @param[in] res - request result
+ * @param[in,out] rng - random number generator state
+ */
+static void p_uringComplete(tBatch * batch, tUringFile * f, const tUringRequest req, const uint64_t chunk, const int32_t res, uint64_t * rng) {
+	f->pending--;
+	switch (req) {
+	case UREQ_OPEN:
+		if (res >= 0) {
+			f->in = (int)res;
+		} else {
+			p_uringFail(batch, f, MSGT_ERR_FILE_OPEN);
+		}
+		break;
+	case UREQ_STAT:
+		if (res >= 0) {
+			ur_statInfo(&(f->st), &(f->size), &(f->mode), &(f->uid), &(f->gid));
+		} else {
+			p_uringFail(batch, f, MSGT_ERR_FILE_OPEN);
+		}
+		break;
+	case UREQ_READ:
+		f->done++;
+		if (res < 0) {
+			p_uringFail(batch, f, MSGT_ERR_FILE_READ);
+		} else {
+			const uint64_t offset = chunk * URING_CHUNK;
+			const size_t len = (size_t)PCF_MIN(f->size - offset, (uint64_t)URING_CHUNK);
+			/* the input file shrank or the read was interrupted */
+			if ((size_t)res < len && (res == 0 || p_readAt(f->in, f->buf + offset + res, len - (size_t)res, offset + (uint64_t)res) != MSGT_SUCCESS)) {
+				p_uringFail(batch, f, MSGT_ERR_FILE_READ);
+			}
+		}
+		break;
+	case UREQ_CLOSE_IN:
+		break;
+	case UREQ_CREATE:
+		f->creating = 0;
+		if (res >= 0) {
+			f->out = (int)res;
+			if (f->tmpFile != NULL) {
+				f->created = 1;
+				if (fchown(f->out, (uid_t)(f->uid), (gid_t)(f->gid)) != 0) {
+					/* without privileges only the group may be changed if at all */
+					const int ignored = fchown(f->out, (uid_t)-1, (gid_t)(f->gid));
+					PCF_UNUSED(ignored)
+				}
+				/* the creation mode was subject to the umask */
+				fchmod(f->out, (mode_t)(f->mode & 07777));
+			}
+		} else if (res == -EEXIST && f->tmpFile != NULL && f->attempts < URING_MAX_ATTEMPTS) {
+			p_uringTmpName(f, batch->file[f->index], rng);
+		} else {
+			p_uringFail(batch, f, MSGT_ERR_FILE_CREATE);
+		}
+		break;
+	case UREQ_WRITE:
+		f->done++;
+		if (res < 0) {
+			p_uringFail(batch, f, MSGT_ERR_FILE_WRITE);
+		} else {
+			size_t seg = 0;
+			while (f->segChunk[seg + 1] <= chunk) seg++;
+			const uint64_t offset = (chunk - f->segChunk[seg]) * URING_CHUNK;
+			const char * data = (const char *)(f->output.vec[seg].iov_base) + offset;
+			const size_t len = (size_t)PCF_MIN((uint64_t)(f->output.vec[seg].iov_len) - offset, (uint64_t)URING_CHUNK);
+			if ((size_t)res < len && p_writeAt(f->out, data + res, len - (size_t)res, f->segStart[seg] + offset + (uint64_t)res) != MSGT_SUCCESS) {
+				p_uringFail(batch, f, MSGT_ERR_FILE_WRITE);
+			}
+		}
+		break;
+	case UREQ_SYNC:
+		if (res < 0) p_uringFail(batch, f, MSGT_ERR_FILE_WRITE);
+		break;
+	case UREQ_CLOSE_OUT:
+		/* canceled if the preceding sync failed; the chunk index holds the file descriptor */
+		if (res == -ECANCELED) close((int)chunk);
+		if (res < 0) p_uringFail(batch, f, MSGT_ERR_FILE_WRITE);
+		break;
+	case UREQ_RENAME:
+		if (res >= 0) {
+			f->created = 0;
+		} else {
+			p_uringFail(batch, f, MSGT_ERR_FILE_CREATE);
+		}
+		break;
+	}
+}
+
+
+/**
+ * Processes the files of the given batch with a single thread which keeps the I/O requests of up
+ * to ioDepth files in flight via io_uring. Each file is opened, read, processed via
+ * processBuffer() and written to a temporary file which replaces the input file. The reserved
+ * header slot and linked input files (see fm_isLinked()) are written in-place. Files not processed remain in the batch if io_uring is not
+ * available or fails.
+ * 
+ * @param[in,out] batch - shared batch state (not threaded)
+ * @param[in] cores - number of threads used to scan each file unless set in the options
+ */
+static void p_processUring(tBatch * batch, const size_t cores) {
+	const tOptions * batchOpt = batch->opt;
+	tOptions opt = *batchOpt;
+	const size_t slots = PCF_MIN(PCF_MIN(opt.ioDepth, batch->count), (size_t)(URING_MAX_ENTRIES / 4));
+	tUringFile * file;
+	tUring ur;
+	uint64_t rng;
+	size_t active;
+	int ok = 1;
+	if (slots < 1) return;
+	if (opt.scanThreads < 1) opt.scanThreads = cores;
+	file = (tUringFile *)calloc(slots, sizeof(tUringFile));
+	if (file == NULL) return;
+	if (ur_init(&ur, (unsigned)(slots * 4)) != 1) {
+		free(file);
+		return;
+	}
+	rng = (((uint64_t)getpid()) << 32) ^ (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)file;
+	if (rng == 0) rng = 1;
+	batch->opt = &opt;
+	for (;;) {
+		uint64_t user;
+		int32_t res;
+		active = 0;
+		for (size_t i = 0; i < slots; i++) {
+			if (ok != 0) p_uringStep(batch, &ur, file + i, i, &rng);
+			if (file[i].step != USTEP_IDLE) active++;
+		}
+		if (active == 0 || ok == 0) break;
+		if (ur_submit(&ur, 1) != 1) {
+			ok = 0;
+			continue;
+		}
+		while (ur_complete(&ur, &user, &res) == 1) {
+			p_uringComplete(batch, file + (size_t)(user >> 40), (tUringRequest)((user >> 32) & 0xFF), user & 0xFFFFFFFF, res, &rng);
+		}
+	}
+	/* the kernel cancels the requests of the remaining files on teardown */
+	ur_free(&ur);
+	if (active > 0) {
+		for (size_t i = 0; i < slots; i++) {
+			tUringFile * f = file + i;
+			if (f->step == USTEP_IDLE) continue;
+			p_uringFail(batch, f, MSGT_ERR_FILE_READ);
+			if (f->in >= 0) close(f->in);
+			if (f->out >= 0) close(f->out);
+			if (f->tmpFile != NULL) {
+				if (f->created != 0) unlink(f->tmpFile);
+				free(f->tmpFile);
+			}
+			if (f->buf != NULL) free(f->buf);
+			freeOutput(&(f->output));
+			batch->used -= f->need;
+		}
+	}
+	free(file);
+	batch->opt = batchOpt;
+}
+#endif /* PCF_IS_LINUX */
+
+
+/**
+ * Processes the given files via processFile() using a pool of worker threads. The number of
+ * threads and the memory budget are taken from the passed options. If there are less files than
+ * threads, the remaining threads are used to scan each file unless set in the options. If ioDepth
+ * is set, the files are read and written via io_uring with that many files in flight instead
+ * (Linux only, not with inPlace or lowMemory). It falls back to the thread pool if unsupported.
+ * 
+ * @param[in] file - PrusaSlicer generated G-Code files
+ * @param[in] count - number of files
+ * @param[in] opt - processing options (NULL for defaults)
+ * @param[out] result - receives the processFile() result per file
+ * @param[in] cb - error output callback function (needs to be safe for concurrent use)
+ * @return 1 if all files were processed successfully, else 0
+ */
+int processFiles(TCHAR * const * file, const size_t count, const tOptions * opt, int * result, const tCallback cb) {
+	tBatch batch;
+	tOptions batchOpt;
+	tThread * thread = NULL;
+	size_t threads = 0;
+	size_t cores;
+	size_t jobs;
+	int res = 1;
+	if (file == NULL || result == NULL || cb == NULL) return 0;
+	memset(&batch, 0, sizeof(batch));
+	if (opt != NULL) {
+		batchOpt = *opt;
+	} else {
+		memset(&batchOpt, 0, sizeof(batchOpt));
+	}
+	batch.file = file;
+	batch.count = count;
+	batch.opt = &batchOpt;
+	batch.result = result;
+	batch.cb = cb;
+	for (size_t i = 0; i < count; i++) result[i] = 0;
+	
+	/* start worker threads; the calling thread is one of them */
+	cores = (batchOpt.jobs > 0) ? batchOpt.jobs : th_cpuCount();
+#ifdef PCF_IS_LINUX
+	/* process the files with asynchronous I/O if possible; the remaining files are processed below */
+	if (batchOpt.ioDepth > 0 && batchOpt.inPlace == 0 && batchOpt.lowMemory == 0 && batchOpt.uploadUrl == NULL && batchOpt.streamDevice == NULL) p_processUring(&batch, cores);
+#endif /* PCF_IS_LINUX */
+	jobs = PCF_MAX(PCF_MIN(cores, count - batch.next), (size_t)1);
+	/* remaining cores are used to scan each file */
+	if (batchOpt.scanThreads < 1) batchOpt.scanThreads = cores / jobs;
+	if (jobs > 1 && th_mutexInit(&(batch.mutex)) == 1) {
+		if (th_condInit(&(batch.released)) == 1) {
+			batch.threaded = 1;
+		} else {
+			th_mutexDestroy(&(batch.mutex));
+		}
+	}
+	if (batch.threaded != 0) {
+		thread = (tThread *)malloc((jobs - 1) * sizeof(tThread));
+		if (thread != NULL) {
+			while (threads < (jobs - 1) && th_create(thread + threads, p_batchWorker, &batch) == 1) threads++;
+		}
+	}
+	p_batchWorker(&batch);
+	for (size_t i = 0; i < threads; i++) th_join(thread + i);
+	if (thread != NULL) free(thread);
+	if (batch.threaded != 0) {
+		th_condDestroy(&(batch.released));
+		th_mutexDestroy(&(batch.mutex));
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+		if (result[i] != 1) res = 0;
+	}
+	return res;
+}
+
+
+#ifdef PCF_IS_LINUX
+/** Changed file waiting for the end of the debounce interval. */
+typedef struct {
+	char * file;               /**< file path */
+	uint64_t due;              /**< monotonic time in milliseconds at which the file is queued */
+	off_t size;                /**< file size at the last change */
+	struct timespec mtime;     /**< file modification time at the last change */
+} tWatchEntry;
+
+
+/** Shared state of the processWatch() worker threads. */
+typedef struct {
+	tBatch batch;              /**< options, callback and memory budget (mutex protects all fields) */
+	tCondition queued;         /**< signaled if a file was queued or the workers shall stop */
+	char ** queue;             /**< files ready for processing in arrival order */
+	size_t count;              /**< number of queued files */
+	size_t capacity;           /**< capacity of the queue */
+	int stop;                  /**< 1 if the workers shall stop, else 0 */
+} tWatch;
+
+
+/**
+ * Returns the monotonic time in milliseconds.
+ * 
+ * @return milliseconds
+ */
+static uint64_t p_nowMs(void) {
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) return 0;
+	return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
+}
+
+
+/**
+ * Checks whether the given file was already post-processed. Only the head region is read and
+ * scanned like in p_scanSelective(). This finds the marker in the first line as well as the one of
+ * a header written into the reserved slot.
+ * 
+ * @param[in] file - G-Code file
+ * @return 1 if already post-processed, else 0
+ */
+static int p_isProcessed(const char * file) {
+	tScanner sc;
+	size_t fill = 0;
+	uint64_t offset = 0;
+	int res = 0;
+	const int fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return 0;
+	char * buf = (char *)malloc(SCAN_HEAD_SIZE);
+	if (buf == NULL) {
+		close(fd);
+		return 0;
+	}
+	p_scanInit(&sc);
+	for (;;) {
+		const ssize_t got = read(fd, buf + fill, SCAN_HEAD_SIZE - fill);
+		if (got < 0 && errno == EINTR) continue;
+		if (got < 0) break;
+		fill += (size_t)got;
+		if (fill < 1) break;
+		size_t len = fill;
+		if (got > 0) {
+			/* pass complete lines only */
+			while (len > 0 && buf[len - 1] != '\n') len--;
+			if (len < 1) len = fill;
+		}
+		/* the collected values are not needed and may refer to overwritten data */
+		if (p_scan(&sc, buf, len, offset) == 0) {
+			res = sc.processed;
+			break;
+		}
+		if (got == 0) break;
+		if (buf[len - 1] != '\n') p_scanBreakLine(&sc);
+		memmove(buf, buf + len, fill - len);
+		fill -= len;
+		offset += (uint64_t)len;
+		if (p_scanInHead(&sc, offset) == 0) break;
+	}
+	free(buf);
+	close(fd);
+	return res;
+}
+
+
+/**
+ * Returns whether the given file name has the G-Code extension (case-insensitive).
+ * 
+ * @param[in] name - file name
+ * @return 1 if G-Code, else 0
+ */
+static int p_isGcode(const char * name) {
+	static const char ext[] = ".gcode";
+	const size_t len = strlen(name);
+	if (len <= (sizeof(ext) - 1)) return 0;
+	for (size_t i = 0; i < (sizeof(ext) - 1); i++) {
+		if (tolower((unsigned char)(name[len - (sizeof(ext) - 1) + i])) != ext[i]) return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Adds the given file to the debounce list or postpones it if already listed. Files which cannot
+ * be accessed are ignored.
+ * 
+ * @param[in,out] list - debounce list
+ * @param[in,out] count - number of entries
+ * @param[in,out] capacity - capacity of the list
+ * @param[in] dir - watched directory
+ * @param[in] name - file name within the watched directory
+ * @param[in] now - current monotonic time in milliseconds
+ * @return 1 on success, 0 on allocation error
+ */
+static int p_watchTouch(tWatchEntry ** list, size_t * count, size_t * capacity, const char * dir, const char * name, const uint64_t now) {
+	const size_t dirLen = strlen(dir);
+	const size_t nameLen = strlen(name);
+	struct stat st;
+	char * file = (char *)malloc(dirLen + nameLen + 2);
+	if (file == NULL) return 0;
+	memcpy(file, dir, dirLen);
+	file[dirLen] = '/';
+	memcpy(file + dirLen + 1, name, nameLen + 1);
+	if (stat(file, &st) != 0 || S_ISREG(st.st_mode) == 0) {
+		free(file);
+		return 1;
+	}
+	tWatchEntry * entry = NULL;
+	for (size_t i = 0; i < *count; i++) {
+		if (strcmp((*list)[i].file, file) == 0) {
+			entry = *list + i;
+			free(file);
+			break;
+		}
+	}
+	if (entry == NULL) {
+		if (*count >= *capacity) {
+			tWatchEntry * newList = (tWatchEntry *)realloc(*list, 2 * (*capacity + 1) * sizeof(tWatchEntry));
+			if (newList == NULL) {
+				free(file);
+				return 0;
+			}
+			*list = newList;
+			*capacity = 2 * (*capacity + 1);
+		}
+		entry = *list + *count;
+		entry->file = file;
+		(*count)++;
+	}
+	entry->due = now + WATCH_DEBOUNCE;
+	entry->size = st.st_size;
+	entry->mtime = st.st_mtim;
+	return 1;
+}
+
+
+/**
+ * Adds all G-Code files of the given directory to the debounce list.
+ * 
+ * @param[in,out] list - debounce list
+ * @param[in,out] count - number of entries
+ * @param[in,out] capacity - capacity of the list
+ * @param[in] dir - watched directory
+ * @param[in] now - current monotonic time in milliseconds
+ * @return 1 on success, 0 on error
+ */
+static int p_watchScan(tWatchEntry ** list, size_t * count, size_t * capacity, const char * dir, const uint64_t now) {
+	struct dirent * ent;
+	int res = 1;
+	DIR * d = opendir(dir);
+	if (d == NULL) return 0;
+	while (res == 1 && (ent = readdir(d)) != NULL) {
+		if (p_isGcode(ent->d_name) == 0) continue;
+		res = p_watchTouch(list, count, capacity, dir, ent->d_name, now);
+	}
+	closedir(d);
+	return res;
+}
+
+
+/**
+ * Queues the given file for the worker threads unless already queued. The ownership of the file
+ * path is passed to the queue.
+ * 
+ * @param[in,out] watch - shared watch state
+ * @param[in] file - allocated file path
+ * @return 1 on success, 0 on allocation error
+ */
+static int p_watchQueue(tWatch * watch, char * file) {
+	int res = 1;
+	th_lock(&(watch->batch.mutex));
+	for (size_t i = 0; i < watch->count; i++) {
+		if (strcmp(watch->queue[i], file) == 0) {
+			free(file);
+			file = NULL;
+			break;
+		}
+	}
+	if (file != NULL && watch->count >= watch->capacity) {
+		char ** newQueue = (char **)realloc(watch->queue, 2 * (watch->capacity + 1) * sizeof(char *));
+		if (newQueue != NULL) {
+			watch->queue = newQueue;
+			watch->capacity = 2 * (watch->capacity + 1);
+		} else {
+			free(file);
+			file = NULL;
+			res = 0;
+		}
+	}
+	if (file != NULL) {
+		watch->queue[watch->count++] = file;
+		th_condBroadcast(&(watch->queued));
+	}
+	th_unlock(&(watch->batch.mutex));
+	return res;
+}
+
+
+/**
+ * Worker thread of processWatch(). Processes queued files until stopped. Already post-processed
+ * files are skipped. Each file reserves its size from the memory budget before being processed.
+ * 
+ * @param[in,out] arg - shared watch state
+ */
+static void p_watchWorker(void * arg) {
+	tWatch * watch = (tWatch *)arg;
+	tBatch * batch = &(watch->batch);
+	tContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	for (;;) {
+		char * file = NULL;
+		th_lock(&(batch->mutex));
+		while (watch->count == 0 && watch->stop == 0) th_condWait(&(watch->queued), &(batch->mutex));
+		if (watch->stop == 0) {
+			file = watch->queue[0];
+			watch->count--;
+			memmove(watch->queue, watch->queue + 1, watch->count * sizeof(char *));
+		}
+		th_unlock(&(batch->mutex));
+		if (file == NULL) break;
+		
+		if (p_isProcessed(file) == 0) {
+			const uint64_t need = p_batchReserve(batch, file);
+			processFile(file, batch->opt, &ctx, batch->cb);
+			p_batchRelease(batch, need);
+		}
+		free(file);
+	}
+	freeContext(&ctx);
+}
+#endif /* PCF_IS_LINUX */
+
+
+/**
+ * Watches the given directory for new G-Code files and processes them via processFile() using a
+ * pool of worker threads until stopped. Files are picked up once closed after writing or moved
+ * into the directory and queued if unchanged for WATCH_DEBOUNCE milliseconds. G-Code files
+ * already present are picked up at the start. Already post-processed files are skipped. These are
+ * recognized by reading up to the head region scanned by p_scanSelective(), i.e. the thumbnail
+ * blocks, the reserved header slot and SCAN_HEAD_SIZE bytes after them. The marker in the first
+ * line ends the check early. This includes the files written by the workers themselves. The
+ * number of threads and the memory budget are taken from the passed options. This is only
+ * supported on Linux (inotify).
+ * 
+ * @param[in] dir - directory to watch
+ * @param[in] opt - processing options (NULL for defaults)
+ * @param[in] stop - stops watching if set to a non-zero value (e.g. from a signal handler) or NULL
+ * @param[in] cb - error output callback function (needs to be safe for concurrent use)
+ * @return 1 if stopped, 0 on error
+ */
+int processWatch(const TCHAR * dir, const tOptions * opt, volatile sig_atomic_t * stop, const tCallback cb) {
+#ifdef PCF_IS_LINUX
+	union {
+		struct inotify_event event;
+		char buf[0x4000];
+	} ev;
+	tWatch watch;
+	tOptions watchOpt;
+	tWatchEntry * list = NULL;
+	size_t count = 0;
+	size_t capacity = 0;
+	tThread * thread = NULL;
+	size_t threads = 0;
+	size_t jobs;
+	int fd = -1;
+	int res = 0;
+	if (dir == NULL || cb == NULL) return 0;
+	memset(&watch, 0, sizeof(watch));
+	if (opt != NULL) {
+		watchOpt = *opt;
+	} else {
+		memset(&watchOpt, 0, sizeof(watchOpt));
+	}
+	jobs = (watchOpt.jobs > 0) ? watchOpt.jobs : th_cpuCount();
+	jobs = PCF_MAX(jobs, (size_t)1);
+	if (watchOpt.scanThreads < 1) watchOpt.scanThreads = 1;
+	watch.batch.opt = &watchOpt;
+	watch.batch.cb = cb;
+	watch.batch.threaded = 1;
+	
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+		cb(MSGT_ERR_WATCH, dir, 0);
+		if (fd >= 0) close(fd);
+		return 0;
+	}
+	if (th_mutexInit(&(watch.batch.mutex)) != 1) goto onNoMem;
+	if (th_condInit(&(watch.batch.released)) != 1) {
+		th_mutexDestroy(&(watch.batch.mutex));
+		goto onNoMem;
+	}
+	if (th_condInit(&(watch.queued)) != 1) {
+		th_condDestroy(&(watch.batch.released));
+		th_mutexDestroy(&(watch.batch.mutex));
+		goto onNoMem;
+	}
+	thread = (tThread *)malloc(jobs * sizeof(tThread));
+	if (thread != NULL) {
+		while (threads < jobs && th_create(thread + threads, p_watchWorker, &watch) == 1) threads++;
+	}
+	if (threads < 1) {
+		cb(MSGT_ERR_NO_MEM, dir, 0);
+		goto onStop;
+	}
+	
+	/* pick up existing files */
+	if (p_watchScan(&list, &count, &capacity, dir, p_nowMs()) != 1) {
+		cb(MSGT_ERR_WATCH, dir, 0);
+		goto onStop;
+	}
+	while (stop == NULL || *stop == 0) {
+		uint64_t now = p_nowMs();
+		uint64_t timeout = WATCH_POLL_INTERVAL;
+		struct pollfd pfd;
+		for (size_t i = 0; i < count; i++) {
+			timeout = PCF_MIN(timeout, (list[i].due > now) ? (list[i].due - now) : 0);
+		}
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, (int)timeout) < 0 && errno != EINTR) {
+			cb(MSGT_ERR_WATCH, dir, 0);
+			goto onStop;
+		}
+		now = p_nowMs();
+		
+		/* collect changed files */
+		for (;;) {
+			const ssize_t got = read(fd, ev.buf, sizeof(ev.buf));
+			if (got <= 0) break;
+			for (size_t pos = 0; pos + sizeof(struct inotify_event) <= (size_t)got; ) {
+				const struct inotify_event * event = (const struct inotify_event *)(ev.buf + pos);
+				pos += sizeof(struct inotify_event) + event->len;
+				if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) != 0) {
+					/* watched directory is gone */
+					cb(MSGT_ERR_WATCH, dir, 0);
+					goto onStop;
+				}
+				if ((event->mask & IN_Q_OVERFLOW) != 0) {
+					/* events were lost */
+					if (p_watchScan(&list, &count, &capacity, dir, now) != 1) {
+						cb(MSGT_ERR_WATCH, dir, 0);
+						goto onStop;
+					}
+					continue;
+				}
+				if (event->len < 1 || p_isGcode(event->name) == 0) continue;
+				if (p_watchTouch(&list, &count, &capacity, dir, event->name, now) != 1) {
+					cb(MSGT_ERR_NO_MEM, dir, 0);
+					goto onStop;
+				}
+			}
+		}
+		
+		/* queue files unchanged since the end of the debounce interval */
+		for (size_t i = 0; i < count; ) {
+			tWatchEntry * entry = list + i;
+			struct stat st;
+			if (entry->due > now) {
+				i++;
+				continue;
+			}
+			if (stat(entry->file, &st) != 0) {
+				/* removed in the meantime */
+				free(entry->file);
+				*entry = list[--count];
+				continue;
+			}
+			if (st.st_size != entry->size || st.st_mtim.tv_sec != entry->mtime.tv_sec || st.st_mtim.tv_nsec != entry->mtime.tv_nsec) {
+				/* still being written */
+				entry->due = now + WATCH_DEBOUNCE;
+				entry->size = st.st_size;
+				entry->mtime = st.st_mtim;
+				i++;
+				continue;
+			}
+			if (p_watchQueue(&watch, entry->file) != 1) {
+				entry->file = NULL;
+				cb(MSGT_ERR_NO_MEM, dir, 0);
+				goto onStop;
+			}
+			*entry = list[--count];
+		}
+	}
+	res = 1;
+onStop:
+	th_lock(&(watch.batch.mutex));
+	watch.stop = 1;
+	th_condBroadcast(&(watch.queued));
+	th_unlock(&(watch.batch.mutex));
+	for (size_t i = 0; i < threads; i++) th_join(thread + i);
+	th_condDestroy(&(watch.queued));
+	th_condDestroy(&(watch.batch.released));
+	th_mutexDestroy(&(watch.batch.mutex));
+	goto onEnd;
+onNoMem:
+	cb(MSGT_ERR_NO_MEM, dir, 0);
+onEnd:
+	if (thread != NULL) free(thread);
+	for (size_t i = 0; i < watch.count; i++) free(watch.queue[i]);
+	if (watch.queue != NULL) free(watch.queue);
+	for (size_t i = 0; i < count; i++) {
+		if (list[i].file != NULL) free(list[i].file);
+	}
+	if (list != NULL) free(list);
+	close(fd);
+	return res;
+#else /* !PCF_IS_LINUX */
+	(void)opt;
+	(void)stop;
+	if (dir == NULL || cb == NULL) return 0;
+	cb(MSGT_ERR_WATCH, dir, 0);
+	return 0;
+#endif /* !PCF_IS_LINUX */
+}
+
+
+#ifdef PCF_IS_LINUX
+/** Magic number and protocol version of processServe() requests. */
+#define SERVE_MAGIC 0x53503201
+
+
+/** Maximum number of files per processServe() request. */
+#define SERVE_MAX_FILES 0x10000
+
+
+/** Maximum file path length of a processServe() request in bytes. */
+#define SERVE_MAX_PATH 0x10000
+
+
+/** Record types sent by processServe(). */
+typedef enum {
+	SERVE_ACCEPT = 1,          /**< request accepted */
+	SERVE_MESSAGE,             /**< message to pass to the callback function of the client */
+	SERVE_RESULT               /**< processFile() result of a file */
+} tServeType;
+
+
+/**
+ * Request header sent by processRemote(). Followed by the length and the absolute path of each
+ * file. All values use the native byte order as the socket is local to the host.
+ */
+typedef struct {
+	uint32_t magic;            /**< SERVE_MAGIC */
+	uint32_t count;            /**< number of files */
+	uint64_t inPlace;          /**< see tOptions */
+	uint64_t lowMemory;        /**< see tOptions */
+	uint64_t scanThreads;      /**< see tOptions */
+	uint64_t recode;           /**< see tThumbnailOptions */
+	uint64_t colors;           /**< see tThumbnailOptions */
+	uint64_t width;            /**< see tThumbnailOptions */
+	uint64_t height;           /**< see tThumbnailOptions */
+	uint64_t maxSize;          /**< see tThumbnailOptions */
+	uint64_t selectWidth;      /**< see tThumbnailOptions */
+	uint64_t selectHeight;     /**< see tThumbnailOptions */
+	uint64_t preview;          /**< see tThumbnailOptions */
+} tServeRequest;
+
+
+/** Record sent by processServe(). Messages are answered by the client with the callback result. */
+typedef struct {
+	uint32_t type;             /**< record type (see tServeType) */
+	uint32_t index;            /**< file index within the request */
+	uint32_t value;            /**< message or processFile() result */
+	uint32_t line;             /**< message line number */
+} tServeRecord;
+
+
+/** File of a processServe() request. The file path follows this structure in the same allocation. */
+typedef struct {
+	int fd;                    /**< client connection */
+	uint32_t index;            /**< file index within the request */
+	int failed;                /**< 1 if the client connection failed, else 0 */
+} tServeFile;
+
+
+/** File processed by the current worker thread of processServe(). Used by p_serveCallback(). */
+static __thread tServeFile * p_serveFile = NULL;
+
+
+/** Shared state of the processServe() worker threads. */
+typedef struct {
+	tBatch batch;              /**< options, callback and memory budget (mutex protects all fields) */
+	tCondition queued;         /**< signaled if a client was queued or the workers shall stop */
+	int * queue;               /**< accepted client connections in arrival order */
+	size_t count;              /**< number of queued client connections */
+	size_t capacity;           /**< capacity of the queue */
+	int stop;                  /**< 1 if the workers shall stop, else 0 */
+} tServe;
+
+
+/**
+ * Sends the given data completely.
+ * 
+ * @param[in] fd - socket
+ * @param[in] data - data to send
+ * @param[in] len - data length in bytes
+ * @return 1 on success, 0 on error
+ */
+static int p_sendAll(const int fd, const void * data, const size_t len) {
+	for (size_t done = 0; done < len; ) {
+		const ssize_t got = send(fd, (const char *)data + done, len - done, MSG_NOSIGNAL);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return 0;
+		done += (size_t)got;
+	}
+	return 1;
+}
+
+
+/**
+ * Receives the given number of bytes.
+ * 
+ * @param[in] fd - socket
+ * @param[out] data - receives the data
+ * @param[in] len - number of bytes to receive
+ * @return 1 on success, 0 on error, timeout or closed connection
+ */
+static int p_recvAll(const int fd, void * data, const size_t len) {
+	for (size_t done = 0; done < len; ) {
+		const ssize_t got = recv(fd, (char *)data + done, len - done, 0);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return 0;
+		done += (size_t)got;
+	}
+	return 1;
+}
+
+
+/**
+ * Sends a record to the client.
+ * 
+ * @param[in] fd - client connection
+ * @param[in] type - record type
+ * @param[in] index - file index
+ * @param[in] value - message or result
+ * @param[in] line - message line number
+ * @return 1 on success, 0 on error
+ */
+static int p_serveSend(const int fd, const tServeType type, const uint32_t index, const uint32_t value, const uint32_t line) {
+	tServeRecord rec;
+	rec.type = (uint32_t)type;
+	rec.index = index;
+	rec.value = value;
+	rec.line = line;
+	return p_sendAll(fd, &rec, sizeof(rec));
+}
+
+
+/**
+ * Error output callback of processServe(). Passes the message to the client of the file processed
+ * by the calling thread (see p_serveFile) and returns its callback result.
+ * 
+ * @param[in] msg - error message ID
+ * @param[in] file - input file path
+ * @param[in] line - input file path line number (0 if not applicable)
+ * @return 1 to continue, 0 to abort file processing
+ */
+static int p_serveCallback(const tMessage msg, const TCHAR * file, const size_t line) {
+	tServeFile * sf = p_serveFile;
+	unsigned char reply = 0;
+	PCF_UNUSED(file)
+	if (sf == NULL || sf->failed != 0) return 0;
+	if (p_serveSend(sf->fd, SERVE_MESSAGE, sf->index, (uint32_t)msg, (uint32_t)line) != 1 || p_recvAll(sf->fd, &reply, 1) != 1) {
+		sf->failed = 1;
+		return 0;
+	}
+	return (reply == 1) ? 1 : 0;
+}
+
+
+/**
+ * Handles a single client request of processServe(). The files are processed one after another
+ * with the options of the client. Each file reserves its size from the memory budget before being
+ * processed.
+ * 
+ * @param[in,out] serve - shared server state
+ * @param[in,out] ctx - resources reused between requests
+ * @param[in] fd - client connection
+ */
+static void p_serveClient(tServe * serve, tContext * ctx, const int fd) {
+	tBatch * batch = &(serve->batch);
+	tServeFile ** file = NULL;
+	tServeRequest req;
+	tOptions opt = *(batch->opt);
+	uint32_t count = 0;
+	if (p_recvAll(fd, &req, sizeof(req)) != 1 || req.magic != SERVE_MAGIC) return;
+	if (req.count < 1 || req.count > SERVE_MAX_FILES || req.preview > (uint64_t)PV_TOP) return;
+	opt.inPlace = (req.inPlace != 0) ? 1 : 0;
+	opt.lowMemory = (req.lowMemory != 0) ? 1 : 0;
+	opt.scanThreads = (size_t)req.scanThreads;
+	opt.thumbnail.recode = (req.recode != 0) ? 1 : 0;
+	opt.thumbnail.colors = (size_t)req.colors;
+	opt.thumbnail.width = (size_t)req.width;
+	opt.thumbnail.height = (size_t)req.height;
+	opt.thumbnail.maxSize = (size_t)req.maxSize;
+	opt.thumbnail.selectWidth = (size_t)req.selectWidth;
+	opt.thumbnail.selectHeight = (size_t)req.selectHeight;
+	opt.thumbnail.preview = (tPreviewView)req.preview;
+	if (opt.scanThreads < 1) opt.scanThreads = 1;
+	
+	/* receive the absolute file paths */
+	file = (tServeFile **)calloc(req.count, sizeof(tServeFile *));
+	if (file == NULL) return;
+	for (count = 0; count < req.count; count++) {
+		uint32_t len = 0;
+		if (p_recvAll(fd, &len, sizeof(len)) != 1 || len < 1 || len > SERVE_MAX_PATH) goto onEnd;
+		file[count] = (tServeFile *)malloc(sizeof(tServeFile) + len + 1);
+		if (file[count] == NULL) goto onEnd;
+		char * path = (char *)(file[count] + 1);
+		file[count]->fd = fd;
+		file[count]->index = count;
+		file[count]->failed = 0;
+		if (p_recvAll(fd, path, len) != 1) {
+			free(file[count]);
+			goto onEnd;
+		}
+		path[len] = 0;
+		if (path[0] != '/' || strlen(path) != (size_t)len) {
+			free(file[count]);
+			goto onEnd;
+		}
+	}
+	if (p_serveSend(fd, SERVE_ACCEPT, 0, 0, 0) != 1) goto onEnd;
+	
+	for (uint32_t i = 0; i < count; i++) {
+		const char * path = (const char *)(file[i] + 1);
+		const uint64_t need = p_batchReserve(batch, path);
+		p_serveFile = file[i];
+		const int res = processFile(path, &opt, ctx, p_serveCallback);
+		p_serveFile = NULL;
+		p_batchRelease(batch, need);
+		if (file[i]->failed != 0 || p_serveSend(fd, SERVE_RESULT, i, (uint32_t)res, 0) != 1) break;
+	}
+onEnd:
+	for (uint32_t i = 0; i < count; i++) free(file[i]);
+	free(file);
+}
+
+
+/**
+ * Worker thread of processServe(). Handles queued client connections until stopped.
+ * 
+ * @param[in,out] arg - shared server state
+ */
+static void p_serveWorker(void * arg) {
+	tServe * serve = (tServe *)arg;
+	tBatch * batch = &(serve->batch);
+	tContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	for (;;) {
+		int fd = -1;
+		th_lock(&(batch->mutex));
+		while (serve->count == 0 && serve->stop == 0) th_condWait(&(serve->queued), &(batch->mutex));
+		if (serve->stop == 0) {
+			fd = serve->queue[0];
+			serve->count--;
+			memmove(serve->queue, serve->queue + 1, serve->count * sizeof(int));
+		}
+		th_unlock(&(batch->mutex));
+		if (fd < 0) break;
+		p_serveClient(serve, &ctx, fd);
+		close(fd);
+	}
+	freeContext(&ctx);
+}
+
+
+/**
+ * Queues the given client connection for the worker threads. The connection is closed on error.
+ * 
+ * @param[in,out] serve - shared server state
+ * @param[in] fd - client connection
+ * @return 1 on success, 0 on allocation error
+ */
+static int p_serveQueue(tServe * serve, const int fd) {
+	int res = 1;
+	th_lock(&(serve->batch.mutex));
+	if (serve->count >= serve->capacity) {
+		int * newQueue = (int *)realloc(serve->queue, 2 * (serve->capacity + 1) * sizeof(int));
+		if (newQueue != NULL) {
+			serve->queue = newQueue;
+			serve->capacity = 2 * (serve->capacity + 1);
+		} else {
+			res = 0;
+		}
+	}
+	if (res == 1) {
+		serve->queue[serve->count++] = fd;
+		th_condBroadcast(&(serve->queued));
+	} else {
+		close(fd);
+	}
+	th_unlock(&(serve->batch.mutex));
+	return res;
+}
+
+
+/**
+ * Fills the socket address for the given path.
+ * 
+ * @param[out] addr - socket address
+ * @param[in] path - socket path
+ * @return 1 on success, 0 if the path is too long
+ */
+static int p_socketAddress(struct sockaddr_un * addr, const char * path) {
+	const size_t len = strlen(path);
+	if (len < 1 || len >= sizeof(addr->sun_path)) return 0;
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	memcpy(addr->sun_path, path, len + 1);
+	return 1;
+}
+
+
+/**
+ * Connects to the given socket.
+ * 
+ * @param[in] addr - socket address
+ * @return connected socket or -1 on error
+ */
+static int p_socketConnect(const struct sockaddr_un * addr) {
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	while (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+		if (errno == EINTR) continue;
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+/**
+ * Creates the listening socket of processServe(). A stale socket file left by a terminated server
+ * is replaced. Only the owner can connect to the socket.
+ * 
+ * @param[in] addr - socket address
+ * @return listening socket or -1 on error
+ */
+static int p_socketListen(const struct sockaddr_un * addr) {
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (bind(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+		const int other = (errno == EADDRINUSE) ? p_socketConnect(addr) : -1;
+		if (errno != ECONNREFUSED || other >= 0 || unlink(addr->sun_path) != 0 || bind(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+			/* another server is running or the path is not usable */
+			if (other >= 0) close(other);
+			close(fd);
+			return -1;
+		}
+	}
+	/* restrict access before accepting connections */
+	if (chmod(addr->sun_path, S_IRUSR | S_IWUSR) != 0 || listen(fd, SOMAXCONN) != 0) {
+		unlink(addr->sun_path);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+#endif /* PCF_IS_LINUX */
+
+
+/**
+ * Serves requests of processRemote() on the given local socket until stopped. This keeps the
+ * process and its worker threads resident to avoid the process start-up for each file. Each
+ * client connection is handled by one of the worker threads. The files of a request are processed
+ * via processFile() with the processing options of the client. The number of threads and the
+ * memory budget are taken from the passed options. Messages are passed to the client and answered
+ * by its callback function. The socket file is only accessible by its owner and removed when
+ * stopped. This is only supported on Linux.
+ * 
+ * @param[in] path - socket path
+ * @param[in] opt - server options (NULL for defaults)
+ * @param[in] stop - stops serving if set to a non-zero value (e.g. from a signal handler) or NULL
+ * @param[in] cb - error output callback function for server errors
+ * @return 1 if stopped, 0 on error
+ */
+int processServe(const TCHAR * path, const tOptions * opt, volatile sig_atomic_t * stop, const tCallback cb) {
+#ifdef PCF_IS_LINUX
+	struct sockaddr_un addr;
+	tServe serve;
+	tOptions serveOpt;
+	tThread * thread = NULL;
+	size_t threads = 0;
+	size_t jobs;
+	int fd = -1;
+	int res = 0;
+	if (path == NULL || cb == NULL) return 0;
+	memset(&serve, 0, sizeof(serve));
+	if (opt != NULL) {
+		serveOpt = *opt;
+	} else {
+		memset(&serveOpt, 0, sizeof(serveOpt));
+	}
+	serveOpt.statsCb = NULL;
+	jobs = (serveOpt.jobs > 0) ? serveOpt.jobs : th_cpuCount();
+	jobs = PCF_MAX(jobs, (size_t)1);
+	serve.batch.opt = &serveOpt;
+	serve.batch.cb = cb;
+	serve.batch.threaded = 1;
+	
+	if (p_socketAddress(&addr, path) != 1 || (fd = p_socketListen(&addr)) < 0) {
+		cb(MSGT_ERR_SERVE, path, 0);
+		return 0;
+	}
+	if (th_mutexInit(&(serve.batch.mutex)) != 1) goto onNoMem;
+	if (th_condInit(&(serve.batch.released)) != 1) {
+		th_mutexDestroy(&(serve.batch.mutex));
+		goto onNoMem;
+	}
+	if (th_condInit(&(serve.queued)) != 1) {
+		th_condDestroy(&(serve.batch.released));
+		th_mutexDestroy(&(serve.batch.mutex));
+		goto onNoMem;
+	}
+	thread = (tThread *)malloc(jobs * sizeof(tThread));
+	if (thread != NULL) {
+		while (threads < jobs && th_create(thread + threads, p_serveWorker, &serve) == 1) threads++;
+	}
+	if (threads < 1) {
+		cb(MSGT_ERR_NO_MEM, path, 0);
+		goto onStop;
+	}
+	
+	while (stop == NULL || *stop == 0) {
+		const struct timeval timeout = { SERVE_TIMEOUT / 1000, (SERVE_TIMEOUT % 1000) * 1000 };
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		const int ready = poll(&pfd, 1, WATCH_POLL_INTERVAL);
+		if (ready < 0 && errno != EINTR) {
+			cb(MSGT_ERR_SERVE, path, 0);
+			goto onStop;
+		}
+		if (ready <= 0) continue;
+		const int client = accept(fd, NULL, NULL);
+		if (client < 0) continue; /* e.g. aborted by the client */
+		fcntl(client, F_SETFD, FD_CLOEXEC);
+		/* do not let a stalled client block a worker thread */
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		if (p_serveQueue(&serve, client) != 1) {
+			cb(MSGT_ERR_NO_MEM, path, 0);
+			goto onStop;
+		}
+	}
+	res = 1;
+onStop:
+	th_lock(&(serve.batch.mutex));
+	serve.stop = 1;
+	th_condBroadcast(&(serve.queued));
+	th_unlock(&(serve.batch.mutex));
+	for (size_t i = 0; i < threads; i++) th_join(thread + i);
+	th_condDestroy(&(serve.queued));
+	th_condDestroy(&(serve.batch.released));
+	th_mutexDestroy(&(serve.batch.mutex));
+	goto onEnd;
+onNoMem:
+	cb(MSGT_ERR_NO_MEM, path, 0);
+onEnd:
+	if (thread != NULL) free(thread);
+	for (size_t i = 0; i < serve.count; i++) close(serve.queue[i]);
+	if (serve.queue != NULL) free(serve.queue);
+	unlink(addr.sun_path);
+	close(fd);
+	return res;
+#else /* !PCF_IS_LINUX */
+	(void)opt;
+	(void)stop;
+	if (path == NULL || cb == NULL) return 0;
+	cb(MSGT_ERR_SERVE, path, 0);
+	return 0;
+#endif /* !PCF_IS_LINUX */
+}
+
+
+/**
+ * Hands the given files over to a server started via processServe() on the given local socket.
+ * The messages of the server are passed to the callback function and its result is returned to
+ * the server. Files not processed because the connection failed in the meantime are processed
+ * via processFile() in this process. The statistics callback of the options is not supported.
+ * This is only supported on Linux.
+ * 
+ * @param[in] path - socket path
+ * @param[in] file - PrusaSlicer generated G-Code files
+ * @param[in] count - number of files
+ * @param[in] opt - processing options (NULL for defaults; jobs and memoryBudget are taken from
+ * the server)
+ * @param[out] result - receives the processFile() result per file
+ * @param[in] cb - error output callback function
+ * @return 1 if all files were processed successfully, 0 on failure, -1 if no server is available
+ */
+int processRemote(const TCHAR * path, TCHAR * const * file, const size_t count, const tOptions * opt, int * result, const tCallback cb) {
+#ifdef PCF_IS_LINUX
+	struct sockaddr_un addr;
+	tServeRequest req;
+	tServeRecord rec;
+	tContext ctx;
+	char cwd[PATH_MAX];
+	size_t cwdLen;
+	size_t done = 0;
+	int fd;
+	int res = 1;
+	if (path == NULL || file == NULL || result == NULL || cb == NULL) return 0;
+	if (count < 1 || count > SERVE_MAX_FILES || p_socketAddress(&addr, path) != 1) return -1;
+	if (getcwd(cwd, sizeof(cwd)) == NULL) return -1;
+	cwdLen = strlen(cwd);
+	fd = p_socketConnect(&addr);
+	if (fd < 0) return -1;
+	memset(&req, 0, sizeof(req));
+	req.magic = SERVE_MAGIC;
+	req.count = (uint32_t)count;
+	if (opt != NULL) {
+		req.inPlace = (uint64_t)(opt->inPlace);
+		req.lowMemory = (uint64_t)(opt->lowMemory);
+		req.scanThreads = (uint64_t)(opt->scanThreads);
+		req.recode = (uint64_t)(opt->thumbnail.recode);
+		req.colors = (uint64_t)(opt->thumbnail.colors);
+		req.width = (uint64_t)(opt->thumbnail.width);
+		req.height = (uint64_t)(opt->thumbnail.height);
+		req.maxSize = (uint64_t)(opt->thumbnail.maxSize);
+		req.selectWidth = (uint64_t)(opt->thumbnail.selectWidth);
+		req.selectHeight = (uint64_t)(opt->thumbnail.selectHeight);
+		req.preview = (uint64_t)(opt->thumbnail.preview);
+	}
+	if (p_sendAll(fd, &req, sizeof(req)) != 1) goto onRefused;
+	for (size_t i = 0; i < count; i++) {
+		/* the server resolves relative paths against its own working directory */
+		const size_t len = strlen(file[i]);
+		const int relative = (file[i][0] != '/') ? 1 : 0;
+		const size_t total = (relative != 0) ? cwdLen + 1 + len : len;
+		const uint32_t total32 = (uint32_t)total;
+		if (len < 1 || total > SERVE_MAX_PATH || p_sendAll(fd, &total32, sizeof(total32)) != 1) goto onRefused;
+		if (relative != 0 && (p_sendAll(fd, cwd, cwdLen) != 1 || p_sendAll(fd, "/", 1) != 1)) goto onRefused;
+		if (p_sendAll(fd, file[i], len) != 1) goto onRefused;
+	}
+	if (p_recvAll(fd, &rec, sizeof(rec)) != 1 || rec.type != (uint32_t)SERVE_ACCEPT) goto onRefused;
+	
+	/* pass messages to the callback function until all results were received */
+	while (done < count && p_recvAll(fd, &rec, sizeof(rec)) == 1 && rec.index == (uint32_t)done) {
+		if (rec.type == (uint32_t)SERVE_MESSAGE && rec.value < (uint32_t)MSG_COUNT) {
+			const unsigned char reply = (unsigned char)((cb((tMessage)(rec.value), file[done], (size_t)(rec.line)) == 1) ? 1 : 0);
+			if (p_sendAll(fd, &reply, 1) != 1) break;
+		} else if (rec.type == (uint32_t)SERVE_RESULT) {
+			result[done++] = (int)(int32_t)(rec.value);
+		} else {
+			break;
+		}
+	}
+	close(fd);
+	
+	/* process the remaining files in this process */
+	memset(&ctx, 0, sizeof(ctx));
+	for (size_t i = done; i < count; i++) result[i] = processFile(file[i], opt, &ctx, cb);
+	freeContext(&ctx);
+	for (size_t i = 0; i < count; i++) {
+		if (result[i] != 1) res = 0;
+	}
+	return res;
+onRefused:
+	close(fd);
+	return -1;
+#else /* !PCF_IS_LINUX */
+	(void)path;
+	(void)file;
+	(void)count;
+	(void)opt;
+	(void)result;
+	(void)cb;
+	return -1;
+#endif /* !PCF_IS_LINUX */
+}
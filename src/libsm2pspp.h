@@ -0,0 +1,209 @@
+/**
+ * @file libsm2pspp.h
+ * @see libsm2pspp.c
+ * @author Daniel Starke
+ * @date 2026-10-16
+ * @version 2026-10-16
+ * 
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIBSM2PSPP_H__
+#define __LIBSM2PSPP_H__
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "stats.h"
+#include "target.h"
+#include "tchar.h"
+#include "thumbnail.h"
+#ifdef PCF_IS_NO_WIN
+#include <sys/uio.h>
+#endif /* PCF_IS_NO_WIN */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Input line buffer size. */
+#define LINE_BUFFER_SIZE 0x80000
+
+
+/** Minimum number of bytes per concurrently scanned chunk. */
+#define SCAN_CHUNK_SIZE 0x1000000
+
+
+/** Default memory budget in MiB for concurrently processed files. */
+#define DEFAULT_MEMORY_BUDGET 1024
+
+
+/** Number of bytes scanned after the thumbnail for values within the start G-Code. */
+#define SCAN_HEAD_SIZE 0x10000
+
+
+/** The original thumbnails are removed if this macro is defined. */
+#define FEATURE_REMOVE_ORIG_THUMBNAIL 1
+
+
+/** Code lines are skipped via memchr() while scanning unless NO_LINE_SKIP is defined (reference builds). */
+#ifndef NO_LINE_SKIP
+#define FEATURE_LINE_SKIP 1
+#endif /* NO_LINE_SKIP */
+
+
+/** Maximum number of thumbnail blocks per file. Further blocks are kept in the body. */
+#define MAX_THUMBNAILS 8
+
+
+/** Default thumbnail size selected among several thumbnails (Snapmaker terminal). */
+#define DEFAULT_THUMBNAIL_WIDTH 300
+#define DEFAULT_THUMBNAIL_HEIGHT 150
+
+
+/** Time in milliseconds a changed file needs to stay unchanged before processWatch() picks it up. */
+#define WATCH_DEBOUNCE 500
+
+
+/** Maximum time in milliseconds processWatch() waits before checking its stop flag. */
+#define WATCH_POLL_INTERVAL 1000
+
+
+/** Time in milliseconds processServe() waits for data from a client before closing the connection. */
+#define SERVE_TIMEOUT 10000
+
+
+/** Enumeration of possible error values. */
+typedef enum {
+	MSGT_SUCCESS = 0,
+	MSGT_ERR_NO_MEM,
+	MSGT_ERR_FILE_NOT_FOUND,
+	MSGT_ERR_FILE_OPEN,
+	MSGT_ERR_FILE_READ,
+	MSGT_ERR_FILE_CREATE,
+	MSGT_ERR_FILE_WRITE,
+	MSGT_ERR_WATCH,
+	MSGT_ERR_SERVE,
+	MSGT_ERR_UPLOAD,
+	MSGT_ERR_STREAM,
+	MSGT_WARN_NO_FILAMENT_USED,
+	MSGT_WARN_NO_LAYER_HEIGHT,
+	MSGT_WARN_NO_EST_TIME,
+	MSGT_WARN_NO_NOZZLE_TEMP,
+	MSGT_WARN_NO_PLATE_TEMP,
+	MSGT_WARN_NO_PRINT_SPEED,
+	MSGT_WARN_NO_THUMBNAIL,
+	MSGT_WARN_NO_MAX_SIZE,
+	MSGT_WARN_SLOT_TOO_SMALL,
+	MSGT_WARN_INVALID_THUMBNAIL,
+	MSGT_WARN_THUMBNAIL_RECODE,
+	MSGT_WARN_THUMBNAIL_TOO_LARGE,
+	MSG_COUNT
+} tMessage;
+
+
+/** Statistics callback type. Called after each processed file. */
+typedef void (* tStatsCallback)(const TCHAR * file, const tStats * stats);
+
+
+/** Processing options. */
+typedef struct {
+	int inPlace;               /**< 1 to insert the header without rewriting the file if possible */
+	int lowMemory;             /**< 1 to process the file in two passes with a fixed-size buffer */
+	size_t jobs;               /**< number of worker threads of processFiles() (0 for one per core) */
+	size_t scanThreads;        /**< number of threads scanning a single file (0 or 1 for one) */
+	uint64_t memoryBudget;     /**< input bytes processed concurrently by processFiles() (0 for unlimited) */
+	size_t ioDepth;            /**< files kept in flight by processFiles() via io_uring (0 to disable, Linux only) */
+	const TCHAR * uploadUrl;   /**< Snapmaker 2.0 terminal URL each file is uploaded to or NULL (Linux only, ignores inPlace and lowMemory) */
+	const TCHAR * uploadToken; /**< access token of the Snapmaker 2.0 terminal or NULL */
+	const TCHAR * streamDevice; /**< serial device each file is streamed to after processing or NULL (Linux only, ignores inPlace and lowMemory) */
+	unsigned long streamBaud;  /**< baud rate of the serial device (0 for SR_DEFAULT_BAUD) */
+	size_t streamWindow;       /**< commands sent ahead of the printer responses (0 for SR_DEFAULT_WINDOW) */
+	tThumbnailOptions thumbnail; /**< thumbnail re-encoding options */
+	tStatsCallback statsCb;    /**< receives the statistics of each file or NULL to disable them */
+} tOptions;
+
+
+/** Reusable resources of consecutive processFile() calls within the same thread. */
+typedef struct {
+	char * lineBuffer;         /**< LINE_BUFFER_SIZE bytes used by the low-memory mode or NULL */
+} tContext;
+
+
+/** Error callback type. */
+typedef int (* tCallback)(const tMessage msg, const TCHAR * file, const size_t line);
+
+
+/** Maximum number of output segments of processBuffer(). */
+#define OUTPUT_SEGMENTS (MAX_THUMBNAILS + 2)
+
+
+#ifdef PCF_IS_NO_WIN
+typedef struct iovec tIoVec;
+#else /* PCF_IS_WIN */
+/** Output segment with the same layout as struct iovec. */
+typedef struct {
+	void * iov_base;           /**< start of the segment */
+	size_t iov_len;            /**< segment length in bytes */
+} tIoVec;
+#endif /* PCF_IS_WIN */
+
+
+/**
+ * Output of processBuffer() and processReader(). The segments reference the allocated header and
+ * slices of the input buffer. The output is the concatenation of all segments.
+ */
+typedef struct {
+	tIoVec vec[OUTPUT_SEGMENTS]; /**< output segments (can be passed to writev()) */
+	size_t count;              /**< number of used output segments */
+	uint64_t length;           /**< total output length in bytes */
+	char * header;             /**< allocated header or NULL */
+	char * input;              /**< input buffer owned by the output (processReader()) or NULL */
+} tOutputList;
+
+
+/**
+ * Reader callback type for processReader().
+ *
+ * @param[in,out] user - user data
+ * @param[out] buf - receives the read data
+ * @param[in] size - maximum number of bytes to read
+ * @return number of bytes read, 0 at the end of the input or (size_t)-1 on error
+ */
+typedef size_t (* tReader)(void * user, char * buf, const size_t size);
+
+
+extern const TCHAR * fmsg[MSG_COUNT];
+
+
+int processFile(const TCHAR * file, const tOptions * opt, tContext * ctx, const tCallback cb);
+int processBuffer(const TCHAR * name, const char * buf, const size_t len, const tOptions * opt, tOutputList * out, const tCallback cb);
+int processReader(const TCHAR * name, const tReader reader, void * user, const tOptions * opt, tOutputList * out, const tCallback cb);
+int processStream(const TCHAR * name, FILE * in, FILE * out, const tOptions * opt, const tCallback cb);
+void freeOutput(tOutputList * out);
+void freeContext(tContext * ctx);
+int processFiles(TCHAR * const * file, const size_t count, const tOptions * opt, int * result, const tCallback cb);
+int processWatch(const TCHAR * dir, const tOptions * opt, volatile sig_atomic_t * stop, const tCallback cb);
+int processServe(const TCHAR * path, const tOptions * opt, volatile sig_atomic_t * stop, const tCallback cb);
+int processRemote(const TCHAR * path, TCHAR * const * file, const size_t count, const tOptions * opt, int * result, const tCallback cb);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __LIBSM2PSPP_H__ */
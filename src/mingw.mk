@@ -5,9 +5,11 @@ LDFLAGS = -s -static -fno-ident -municode
 #CFLAGS = -Og -g3 -ggdb -gdwarf-3 -fno-omit-frame-pointer -fvar-tracking-assignments -fbounds-check -fstack-protector-strong -fno-ident
 #LDFLAGS = -fno-ident -static
 PATHS = 
-LIBS = 
+LIBS = -lpsapi
 OBJEXT = .o
 BINEXT = .exe
+SOEXT = .dll
+SOFLAGS = -shared
 
 ifeq (, $(findstring __MINGW64__, $(shell $(CC) -dM -E - </dev/null 2>/dev/null)))
  # patch to handle missing symbols in mingw32 correctly
@@ -0,0 +1,1003 @@
+/**
+ * @file preview.c
+ * @author Daniel Starke
+ * @see preview.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "preview.h"
+#include "tchar.h"
+#include "thread.h"
+#include "thumbnail.h"
+
+
+/** Height map cell size in millimeters. */
+#define PV_CELL_SIZE 0.25
+
+
+/** Height map value unit in millimeters. */
+#define PV_Z_UNIT 0.02
+
+
+/** Height map cells per tile and axis as power of two. */
+#define PV_TILE_BITS 6
+#define PV_TILE_SIZE (1 << PV_TILE_BITS)
+#define PV_TILE_MASK (PV_TILE_SIZE - 1)
+
+
+/** Height map tiles per axis. The map covers -2048 mm to 2048 mm. */
+#define PV_DIR_SIZE 256
+
+
+/** Height map cells per axis and cell index of the coordinate origin. */
+#define PV_CELLS (PV_DIR_SIZE * PV_TILE_SIZE)
+#define PV_ORIGIN (PV_CELLS / 2)
+
+
+/** Input block size in bytes. Blocks are the unit of sampling. */
+#define PV_BLOCK_SIZE 0x100000
+
+
+/** Maximum number of input bytes parsed. Larger inputs are sampled block-wise. */
+#define PV_MAX_BYTES 0x10000000
+
+
+/** Maximum number of concurrent parsers (each holds its own height map). */
+#define PV_MAX_THREADS 16
+
+
+/** Number of leading bytes searched for the extrusion mode (M82/M83). */
+#define PV_HEAD_SIZE 0x100000
+
+
+/** Number of bytes searched backwards for the initial position of the first and further blocks. */
+#define PV_BACKTRACK_FIRST 0x1000000
+#define PV_BACKTRACK 0x10000
+
+
+/** Maximum line length in bytes expected at the end of a block read from a file. */
+#define PV_LINE_MAX 0x10000
+
+
+/** Minimal extrusion length in millimeters. */
+#define PV_MIN_E 0.00001
+
+
+/** Image margin in pixels. */
+#define PV_MARGIN 4
+
+
+/** Number of brightness levels (keeps the image within a PNG palette). */
+#define PV_SHADES 64
+
+
+/** Image base color. */
+#define PV_RED 0xFF
+#define PV_GREEN 0x8C
+#define PV_BLUE 0x1A
+
+
+/** Isometric projection factors (1/sqrt(2), 1/sqrt(6) and 2/sqrt(6)). */
+#define PV_ISO_U 0.70710678118654752
+#define PV_ISO_V 0.40824829046386302
+#define PV_ISO_Z 0.81649658092772603
+
+
+/** Bit of the given axis within a mask. */
+#define PV_BIT(axis) (1u << (axis))
+
+
+/** Enumeration of the parsed axes. */
+typedef enum {
+	PV_X,
+	PV_Y,
+	PV_Z,
+	PV_E,
+	PV_AXES
+} tPvAxis;
+
+
+/** All positioning axes. */
+#define PV_XYZ (PV_BIT(PV_X) | PV_BIT(PV_Y) | PV_BIT(PV_Z))
+
+
+/** G-Code interpreter state. */
+typedef struct {
+	double pos[PV_AXES];       /**< current position per axis */
+	unsigned known;            /**< bit mask of the axes with known position */
+	int relative;              /**< 1 for relative positioning (G91), else 0 */
+	int relativeE;             /**< 1 for relative extrusion (M83), else 0 */
+} tPvState;
+
+
+/** Sparse height map with the maximum height per cell (0 if empty). */
+typedef struct {
+	uint16_t ** tile;          /**< PV_DIR_SIZE x PV_DIR_SIZE tiles or NULL if empty */
+	int noMem;                 /**< 1 if a tile allocation failed, else 0 */
+} tPvMap;
+
+
+/** Parser of an input range. */
+typedef struct {
+	const char * buf;          /**< input data */
+	size_t start;              /**< range start (line start) */
+	size_t end;                /**< range end (line start) */
+	size_t stride;             /**< parse every n-th block (1 for all) */
+	size_t lastBlock;          /**< index of the last input block (always parsed) */
+	int relativeE;             /**< initial extrusion mode */
+	tPvMap map;                /**< height map of the range */
+} tPvWorker;
+
+
+/** Dense height map reduced to the image resolution. */
+typedef struct {
+	uint16_t * h;              /**< heights row by row */
+	size_t width;              /**< number of cells per row */
+	size_t height;             /**< number of rows */
+	double cell;               /**< cell size in millimeters */
+	double x;                  /**< X coordinate of the first cell */
+	double y;                  /**< Y coordinate of the first cell */
+	uint16_t maxH;             /**< maximum height */
+} tPvGrid;
+
+
+/** Image band rendered by one thread. */
+typedef struct {
+	const tPvGrid * grid;      /**< reduced height map */
+	tPreviewView view;         /**< rendered view */
+	double scale;              /**< pixels per millimeter */
+	double offU;               /**< horizontal pixel offset */
+	double offV;               /**< vertical pixel offset */
+	unsigned char * rgba;      /**< output image */
+	uint32_t * depth;          /**< depth buffer (isometric view) */
+	size_t row0;               /**< first row */
+	size_t row1;               /**< end row (exclusive) */
+} tPvBand;
+
+
+/**
+ * Runs the given function for each item concurrently. The calling thread processes the first item
+ * and those without thread.
+ *
+ * @param[in] fn - function to run
+ * @param[in,out] arg - items
+ * @param[in] size - item size in bytes
+ * @param[in] count - number of items
+ */
+static void pv_parallel(tThreadFn fn, void * arg, const size_t size, const size_t count) {
+	char * item = (char *)arg;
+	tThread * thread = NULL;
+	size_t started = 0;
+	if (count < 1) return;
+	if (count > 1) thread = (tThread *)malloc((count - 1) * sizeof(tThread));
+	if (thread != NULL) {
+		while (started < (count - 1) && th_create(thread + started, fn, item + ((started + 1) * size)) == 1) started++;
+	}
+	fn(item);
+	for (size_t i = started + 1; i < count; i++) fn(item + (i * size));
+	for (size_t i = 0; i < started; i++) th_join(thread + i);
+	if (thread != NULL) free(thread);
+}
+
+
+/**
+ * Returns the first line start at or after the given offset.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @param[in] pos - offset
+ * @return line start offset or len if none
+ */
+static size_t pv_lineStart(const char * buf, const size_t len, const size_t pos) {
+	if (pos == 0 || pos >= len || buf[pos - 1] == '\n') return PCF_MIN(pos, len);
+	const char * it = (const char *)memchr(buf + pos, '\n', len - pos);
+	return (it != NULL) ? (size_t)(it - buf + 1) : len;
+}
+
+
+/**
+ * Parses a decimal number without exponent.
+ *
+ * @param[in,out] ptr - start of the number (set to the end of the number)
+ * @param[in] end - end of the line
+ * @param[out] val - receives the value
+ * @return 1 on success, 0 if no digits were found
+ */
+static int pv_number(const char ** ptr, const char * end, double * val) {
+	const char * it = *ptr;
+	double res = 0.0;
+	double scale = 1.0;
+	int frac = 0;
+	int digits = 0;
+	int neg = 0;
+	if (it < end && (*it == '-' || *it == '+')) {
+		neg = (*it == '-') ? 1 : 0;
+		it++;
+	}
+	for (; it < end; it++) {
+		const char ch = *it;
+		if (ch >= '0' && ch <= '9') {
+			if (frac != 0) {
+				scale *= 0.1;
+				res += (double)(ch - '0') * scale;
+			} else {
+				res = (res * 10.0) + (double)(ch - '0');
+			}
+			digits = 1;
+		} else if (ch == '.' && frac == 0) {
+			frac = 1;
+		} else {
+			break;
+		}
+	}
+	*ptr = it;
+	if (digits == 0) return 0;
+	*val = (neg != 0) ? -res : res;
+	return 1;
+}
+
+
+/**
+ * Parses the G command number of the given line.
+ *
+ * @param[in,out] ptr - character after the 'G' (set to the first parameter)
+ * @param[in] end - end of the line
+ * @return command number
+ */
+static unsigned pv_command(const char ** ptr, const char * end) {
+	const char * it = *ptr;
+	unsigned cmd = 0;
+	for (; it < end && *it >= '0' && *it <= '9'; it++) {
+		if (cmd < 1000) cmd = (cmd * 10) + (unsigned)(*it - '0');
+	}
+	*ptr = it;
+	return cmd;
+}
+
+
+/**
+ * Parses the axis parameters of a G command up to the line end or comment.
+ *
+ * @param[in] it - first parameter
+ * @param[in] end - end of the line
+ * @param[out] val - receives the parameter values per axis
+ * @return bit mask of the given axes
+ */
+static unsigned pv_params(const char * it, const char * end, double * val) {
+	unsigned has = 0;
+	while (it < end && *it != ';') {
+		tPvAxis axis;
+		switch (*it++) {
+		case 'X': axis = PV_X; break;
+		case 'Y': axis = PV_Y; break;
+		case 'Z': axis = PV_Z; break;
+		case 'E': axis = PV_E; break;
+		default: continue;
+		}
+		if (pv_number(&it, end, val + axis) != 0) has |= PV_BIT(axis);
+	}
+	return has;
+}
+
+
+/**
+ * Returns the given tile of the height map. The tile is allocated if needed.
+ *
+ * @param[in,out] map - height map
+ * @param[in] index - tile index
+ * @return tile or NULL on allocation error
+ */
+static uint16_t * pv_tile(tPvMap * map, const size_t index) {
+	uint16_t ** tile = map->tile + index;
+	if (*tile == NULL) {
+		*tile = (uint16_t *)calloc(PV_TILE_SIZE * PV_TILE_SIZE, sizeof(uint16_t));
+		if (*tile == NULL) map->noMem = 1;
+	}
+	return *tile;
+}
+
+
+/**
+ * Draws an extrusion segment into the height map. The segment is sampled once per cell along its
+ * major axis in fixed point arithmetic and drawn two cells wide. Segments leaving the map are
+ * ignored.
+ *
+ * @param[in,out] map - height map
+ * @param[in] from - start position
+ * @param[in] to - end position (defines the height)
+ */
+static void pv_segment(tPvMap * map, const double * from, const double * to) {
+	const double x0 = (from[PV_X] / PV_CELL_SIZE) + PV_ORIGIN;
+	const double y0 = (from[PV_Y] / PV_CELL_SIZE) + PV_ORIGIN;
+	const double x1 = (to[PV_X] / PV_CELL_SIZE) + PV_ORIGIN;
+	const double y1 = (to[PV_Y] / PV_CELL_SIZE) + PV_ORIGIN;
+	const double limit = (double)(PV_CELLS - 1);
+	if (x0 < 0.0 || y0 < 0.0 || x1 < 0.0 || y1 < 0.0 || x0 >= limit || y0 >= limit || x1 >= limit || y1 >= limit) return;
+	const double z = to[PV_Z] / PV_Z_UNIT;
+	const uint16_t h = (uint16_t)((z < 0.0) ? 1.0 : ((z > 65534.0) ? 65535.0 : (z + 1.0)));
+	const double dx = x1 - x0;
+	const double dy = y1 - y0;
+	const int horizontal = (fabs(dx) >= fabs(dy)) ? 1 : 0;
+	const size_t steps = (size_t)((horizontal != 0) ? fabs(dx) : fabs(dy)) + 1;
+	/* 16 fractional bits */
+	const int32_t sx = (int32_t)((dx * 65536.0) / (double)steps);
+	const int32_t sy = (int32_t)((dy * 65536.0) / (double)steps);
+	for (int pass = 0; pass < 2; pass++) {
+		/* second pass is offset by one cell along the minor axis */
+		int32_t fx = (int32_t)(x0 * 65536.0) + ((pass != 0 && horizontal == 0) ? 65536 : 0);
+		int32_t fy = (int32_t)(y0 * 65536.0) + ((pass != 0 && horizontal != 0) ? 65536 : 0);
+		size_t index = (size_t)-1;
+		uint16_t * tile = NULL;
+		for (size_t i = 0; i <= steps; i++, fx += sx, fy += sy) {
+			const size_t cx = (size_t)(fx >> 16);
+			const size_t cy = (size_t)(fy >> 16);
+			const size_t tileIndex = ((cy >> PV_TILE_BITS) * PV_DIR_SIZE) + (cx >> PV_TILE_BITS);
+			if (tileIndex != index) {
+				tile = pv_tile(map, tileIndex);
+				if (tile == NULL) return;
+				index = tileIndex;
+			}
+			uint16_t * cell = tile + ((cy & PV_TILE_MASK) << PV_TILE_BITS) + (cx & PV_TILE_MASK);
+			if (*cell < h) *cell = h;
+		}
+	}
+}
+
+
+/**
+ * Interprets a single G-Code line. Extrusion moves are drawn into the height map.
+ *
+ * @param[in,out] st - interpreter state
+ * @param[in,out] map - height map
+ * @param[in] it - first non-space character of the line
+ * @param[in] end - end of the line
+ */
+static void pv_line(tPvState * st, tPvMap * map, const char * it, const char * end) {
+	double val[PV_AXES];
+	double next[PV_AXES];
+	unsigned known;
+	int extrude = 0;
+	if (*it == 'M') {
+		/* extrusion mode */
+		if ((end - it) >= 3 && it[1] == '8' && (it[2] == '2' || it[2] == '3') && ((end - it) == 3 || it[3] < '0' || it[3] > '9')) {
+			st->relativeE = (it[2] == '3') ? 1 : 0;
+		}
+		return;
+	}
+	it++;
+	const unsigned cmd = pv_command(&it, end);
+	if (cmd == 90 || cmd == 91) {
+		st->relative = (cmd == 91) ? 1 : 0;
+		return;
+	}
+	if (cmd > 3 && cmd != 92) return;
+	const unsigned has = pv_params(it, end, val);
+	if (has == 0) return;
+	if (cmd == 92) {
+		/* set position */
+		for (int axis = 0; axis < PV_AXES; axis++) {
+			if ((has & PV_BIT(axis)) == 0) continue;
+			st->pos[axis] = val[axis];
+			st->known |= PV_BIT(axis);
+		}
+		return;
+	}
+	/* move */
+	memcpy(next, st->pos, sizeof(next));
+	known = st->known;
+	for (int axis = PV_X; axis <= PV_Z; axis++) {
+		if ((has & PV_BIT(axis)) == 0) continue;
+		if (st->relative == 0) {
+			next[axis] = val[axis];
+			known |= PV_BIT(axis);
+		} else {
+			next[axis] += val[axis];
+		}
+	}
+	if ((has & PV_BIT(PV_E)) != 0) {
+		if (st->relativeE != 0 || st->relative != 0) {
+			extrude = (val[PV_E] > PV_MIN_E) ? 1 : 0;
+		} else {
+			extrude = ((st->known & PV_BIT(PV_E)) != 0 && val[PV_E] > (st->pos[PV_E] + PV_MIN_E)) ? 1 : 0;
+			next[PV_E] = val[PV_E];
+			known |= PV_BIT(PV_E);
+		}
+	}
+	if (cmd != 0 && extrude != 0 && (st->known & known & PV_XYZ) == PV_XYZ) {
+		if (next[PV_X] != st->pos[PV_X] || next[PV_Y] != st->pos[PV_Y]) pv_segment(map, st->pos, next);
+	}
+	memcpy(st->pos, next, sizeof(next));
+	st->known = known;
+}
+
+
+/**
+ * Interprets the given G-Code lines. Only G and M commands are inspected.
+ *
+ * @param[in,out] st - interpreter state
+ * @param[in,out] map - height map
+ * @param[in] it - first line start
+ * @param[in] end - end of the data
+ */
+static void pv_parse(tPvState * st, tPvMap * map, const char * it, const char * end) {
+	while (it < end) {
+		const char * lineEnd = (const char *)memchr(it, '\n', (size_t)(end - it));
+		if (lineEnd == NULL) lineEnd = end;
+		while (it < lineEnd && (*it == ' ' || *it == '\t')) it++;
+		if (it < lineEnd && (*it == 'G' || *it == 'M')) pv_line(st, map, it, lineEnd);
+		it = lineEnd + 1;
+	}
+}
+
+
+/**
+ * Returns the extrusion mode set last within the given data.
+ *
+ * @param[in] buf - data
+ * @param[in] len - data length in bytes
+ * @return 1 for relative extrusion (M83), 0 for absolute extrusion (M82 or default)
+ */
+static int pv_extrusionMode(const char * buf, const size_t len) {
+	tPvState st;
+	memset(&st, 0, sizeof(st));
+	for (const char * it = buf, * end = buf + len; it < end; ) {
+		const char * lineEnd = (const char *)memchr(it, '\n', (size_t)(end - it));
+		if (lineEnd == NULL) lineEnd = end;
+		while (it < lineEnd && (*it == ' ' || *it == '\t')) it++;
+		if (it < lineEnd && *it == 'M') pv_line(&st, NULL, it, lineEnd);
+		it = lineEnd + 1;
+	}
+	return st.relativeE;
+}
+
+
+/**
+ * Recovers the position before the given line start by searching the preceding lines backwards.
+ * The last height is kept if none was found.
+ *
+ * @param[in,out] st - interpreter state
+ * @param[in] buf - data
+ * @param[in] start - line start
+ * @param[in] limit - maximum number of bytes searched
+ */
+static void pv_recover(tPvState * st, const char * buf, const size_t start, const size_t limit) {
+	const size_t stop = (start > limit) ? (start - limit) : 0;
+	const double z = st->pos[PV_Z];
+	const unsigned zKnown = st->known & PV_BIT(PV_Z);
+	double val[PV_AXES];
+	st->known = 0;
+	st->relative = 0;
+	for (size_t lineEnd = start; lineEnd > stop && st->known != (PV_XYZ | PV_BIT(PV_E)); ) {
+		size_t lineStart = lineEnd - 1; /* skip the line break */
+		while (lineStart > stop && buf[lineStart - 1] != '\n') lineStart--;
+		if (lineStart == stop && stop > 0) break; /* incomplete line */
+		const char * it = buf + lineStart;
+		const char * end = buf + lineEnd;
+		while (it < end && (*it == ' ' || *it == '\t')) it++;
+		if (it < end && *it == 'G') {
+			it++;
+			const unsigned cmd = pv_command(&it, end);
+			if (cmd <= 3 || cmd == 92) {
+				const unsigned has = pv_params(it, end, val) & ~(st->known);
+				for (int axis = 0; axis < PV_AXES; axis++) {
+					if ((has & PV_BIT(axis)) != 0) st->pos[axis] = val[axis];
+				}
+				st->known |= has;
+			}
+		}
+		lineEnd = lineStart;
+	}
+	if ((st->known & PV_BIT(PV_Z)) == 0 && zKnown != 0) {
+		st->pos[PV_Z] = z;
+		st->known |= zKnown;
+	}
+}
+
+
+/**
+ * Returns whether the given input block is parsed.
+ *
+ * @param[in] block - block index
+ * @param[in] stride - parse every n-th block
+ * @param[in] lastBlock - index of the last block
+ * @return 1 if parsed, else 0
+ */
+static int pv_sampled(const uint64_t block, const size_t stride, const uint64_t lastBlock) {
+	return (stride <= 1 || (block % stride) == 0 || block == lastBlock) ? 1 : 0;
+}
+
+
+/**
+ * Returns the number of blocks per parsed block to stay within PV_MAX_BYTES.
+ *
+ * @param[in] len - input length in bytes
+ * @return parse every n-th block
+ */
+static size_t pv_stride(const uint64_t len) {
+	return (size_t)((len + PV_MAX_BYTES - 1) / PV_MAX_BYTES);
+}
+
+
+/**
+ * Parses the sampled blocks of the given worker range. Consecutive blocks continue the interpreter
+ * state. The state is recovered from the preceding lines otherwise.
+ *
+ * @param[in,out] arg - worker
+ */
+static void pv_work(void * arg) {
+	tPvWorker * w = (tPvWorker *)arg;
+	tPvState st;
+	size_t next = w->start;
+	int cont = 0;
+	memset(&st, 0, sizeof(st));
+	st.relativeE = w->relativeE;
+	st.known = PV_BIT(PV_Z); /* build plate height unless recovered */
+	for (size_t block = w->start / PV_BLOCK_SIZE; (block * PV_BLOCK_SIZE) < w->end; block++) {
+		if (pv_sampled(block, w->stride, w->lastBlock) == 0) {
+			cont = 0;
+			continue;
+		}
+		size_t start = next;
+		if (cont == 0) {
+			start = pv_lineStart(w->buf, w->end, PCF_MAX(block * PV_BLOCK_SIZE, w->start));
+			pv_recover(&st, w->buf, start, (start == w->start) ? PV_BACKTRACK_FIRST : PV_BACKTRACK);
+		}
+		const size_t end = pv_lineStart(w->buf, w->end, PCF_MIN((block + 1) * PV_BLOCK_SIZE, w->end));
+		if (start < end) {
+			pv_parse(&st, &(w->map), w->buf + start, w->buf + end);
+			next = end;
+		}
+		cont = 1;
+	}
+}
+
+
+/**
+ * Initializes the given height map.
+ *
+ * @param[out] map - height map
+ * @return 1 on success, 0 on allocation error
+ */
+static int pv_mapInit(tPvMap * map) {
+	map->noMem = 0;
+	map->tile = (uint16_t **)calloc(PV_DIR_SIZE * PV_DIR_SIZE, sizeof(uint16_t *));
+	return (map->tile != NULL) ? 1 : 0;
+}
+
+
+/**
+ * Frees the given height map.
+ *
+ * @param[in,out] map - height map
+ */
+static void pv_mapFree(tPvMap * map) {
+	if (map->tile == NULL) return;
+	for (size_t i = 0; i < (PV_DIR_SIZE * PV_DIR_SIZE); i++) {
+		if (map->tile[i] != NULL) free(map->tile[i]);
+	}
+	free(map->tile);
+	map->tile = NULL;
+}
+
+
+/**
+ * Merges the source height map into the destination height map. The source map is emptied.
+ *
+ * @param[in,out] dst - destination height map
+ * @param[in,out] src - source height map
+ */
+static void pv_mapMerge(tPvMap * dst, tPvMap * src) {
+	dst->noMem |= src->noMem;
+	for (size_t i = 0; i < (PV_DIR_SIZE * PV_DIR_SIZE); i++) {
+		uint16_t * s = src->tile[i];
+		uint16_t * d = dst->tile[i];
+		if (s == NULL) continue;
+		src->tile[i] = NULL;
+		if (d == NULL) {
+			dst->tile[i] = s;
+			continue;
+		}
+		for (size_t j = 0; j < (PV_TILE_SIZE * PV_TILE_SIZE); j++) {
+			if (d[j] < s[j]) d[j] = s[j];
+		}
+		free(s);
+	}
+}
+
+
+/**
+ * Projects the given position to image plane coordinates in millimeters.
+ *
+ * @param[in] view - preview view
+ * @param[in] x - X coordinate
+ * @param[in] y - Y coordinate
+ * @param[in] z - Z coordinate
+ * @param[out] u - receives the horizontal coordinate (left to right)
+ * @param[out] v - receives the vertical coordinate (top to bottom)
+ */
+static void pv_project(const tPreviewView view, const double x, const double y, const double z, double * u, double * v) {
+	if (view == PV_TOP) {
+		*u = x;
+		*v = -y;
+	} else {
+		*u = (x - y) * PV_ISO_U;
+		*v = -((x + y) * PV_ISO_V) - (z * PV_ISO_Z);
+	}
+}
+
+
+/**
+ * Returns the height of the given grid cell or the passed default height if outside or empty.
+ *
+ * @param[in] grid - reduced height map
+ * @param[in] x - cell X index
+ * @param[in] y - cell Y index
+ * @param[in] h - default height
+ * @return height
+ */
+static double pv_height(const tPvGrid * grid, const size_t x, const size_t y, const uint16_t h) {
+	if (x >= grid->width || y >= grid->height) return (double)h;
+	const uint16_t res = grid->h[(y * grid->width) + x];
+	return (double)((res != 0) ? res : h);
+}
+
+
+/**
+ * Returns the brightness of the top surface of the given grid cell. The surface normal is derived
+ * from the neighboring cells and lit from the back left.
+ *
+ * @param[in] grid - reduced height map
+ * @param[in] x - cell X index
+ * @param[in] y - cell Y index
+ * @return brightness from 0 to 1
+ */
+static double pv_light(const tPvGrid * grid, const size_t x, const size_t y) {
+	const uint16_t h = grid->h[(y * grid->width) + x];
+	const double f = PV_Z_UNIT / (2.0 * grid->cell);
+	const double nx = -(pv_height(grid, x + 1, y, h) - pv_height(grid, x - 1, y, h)) * f;
+	const double ny = -(pv_height(grid, x, y + 1, h) - pv_height(grid, x, y - 1, h)) * f;
+	/* light direction (-1, 1, 1.5) normalized */
+	const double d = ((-nx + ny) + 1.5) / (sqrt((nx * nx) + (ny * ny) + 1.0) * 2.0615528128088303);
+	return 0.35 + (0.65 * ((d > 0.0) ? d : 0.0));
+}
+
+
+/**
+ * Sets the given pixel to the base color with the given brightness.
+ *
+ * @param[out] px - RGBA pixel
+ * @param[in] level - brightness from 0 to 1
+ */
+static void pv_pixel(unsigned char * px, const double level) {
+	const unsigned q = (unsigned)((((level > 1.0) ? 1.0 : level) * (PV_SHADES - 1)) + 0.5);
+	px[0] = (unsigned char)((PV_RED * q) / (PV_SHADES - 1));
+	px[1] = (unsigned char)((PV_GREEN * q) / (PV_SHADES - 1));
+	px[2] = (unsigned char)((PV_BLUE * q) / (PV_SHADES - 1));
+	px[3] = 0xFF;
+}
+
+
+/**
+ * Renders the rows of the given image band.
+ *
+ * @param[in,out] arg - image band
+ */
+static void pv_drawBand(void * arg) {
+	const tPvBand * band = (const tPvBand *)arg;
+	const tPvGrid * grid = band->grid;
+	const double s = band->scale;
+	const double maxH = (double)(grid->maxH);
+	if (band->view == PV_TOP) {
+		/* sample the cell below each pixel */
+		for (size_t row = band->row0; row < band->row1; row++) {
+			const double y = -(((double)row + 0.5) - band->offV) / s;
+			const double gy = floor((y - grid->y) / grid->cell);
+			for (size_t col = 0; col < PV_WIDTH; col++) {
+				const double x = (((double)col + 0.5) - band->offU) / s;
+				const double gx = floor((x - grid->x) / grid->cell);
+				if (gx < 0.0 || gy < 0.0 || gx >= (double)(grid->width) || gy >= (double)(grid->height)) continue;
+				const uint16_t h = grid->h[((size_t)gy * grid->width) + (size_t)gx];
+				if (h == 0) continue;
+				pv_pixel(band->rgba + (4 * ((row * PV_WIDTH) + col)), pv_light(grid, (size_t)gx, (size_t)gy) * (0.6 + (0.4 * (double)h / maxH)));
+			}
+		}
+		return;
+	}
+	/* draw each cell as column from the build plate to its height with depth test */
+	const double hw = grid->cell * PV_ISO_U * s; /* half width of the top face */
+	const double hh = grid->cell * PV_ISO_V * s; /* half height of the top face */
+	for (size_t gy = 0; gy < grid->height; gy++) {
+		for (size_t gx = 0; gx < grid->width; gx++) {
+			const uint16_t h = grid->h[(gy * grid->width) + gx];
+			if (h == 0) continue;
+			const double x = grid->x + (((double)gx + 0.5) * grid->cell);
+			const double y = grid->y + (((double)gy + 0.5) * grid->cell);
+			double u, top, bottom;
+			pv_project(PV_ISO, x, y, (double)h * PV_Z_UNIT, &u, &top);
+			pv_project(PV_ISO, x, y, 0.0, &u, &bottom);
+			u = (u * s) + band->offU;
+			top = (top * s) + band->offV;
+			bottom = (bottom * s) + band->offV;
+			const double r0 = PCF_MAX(floor(top - hh), (double)(band->row0));
+			const double r1 = PCF_MIN(ceil(bottom + hh), (double)(band->row1));
+			const double c0 = PCF_MAX(floor(u - hw), 0.0);
+			const double c1 = PCF_MIN(ceil(u + hw), (double)PV_WIDTH);
+			if (r0 >= r1 || c0 >= c1) continue;
+			/* nearer cells have a larger depth value */
+			const uint32_t depth = (uint32_t)((grid->width + grid->height) - (gx + gy));
+			const double topLevel = pv_light(grid, gx, gy) * (0.85 + (0.15 * (double)h / maxH));
+			for (size_t row = (size_t)r0; row < (size_t)r1; row++) {
+				const double rel = PCF_MIN(PCF_MAX((bottom - (double)row) / PCF_MAX(bottom - top, 1.0), 0.0), 1.0);
+				for (size_t col = (size_t)c0; col < (size_t)c1; col++) {
+					const size_t i = (row * PV_WIDTH) + col;
+					if (band->depth[i] > depth) continue;
+					band->depth[i] = depth;
+					if ((double)row < (top + hh)) {
+						pv_pixel(band->rgba + (4 * i), topLevel);
+					} else {
+						/* left side faces -X, right side faces -Y */
+						pv_pixel(band->rgba + (4 * i), (((double)col < u) ? 0.45 : 0.6) + (0.15 * rel));
+					}
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ * Renders the given height map fitted into the preview image.
+ *
+ * @param[in] map - height map
+ * @param[in] view - preview view
+ * @param[in] threads - maximum number of threads
+ * @param[out] rgba - PV_WIDTH x PV_HEIGHT RGBA pixels (cleared)
+ * @return PV_OK on success, else the error cause
+ */
+static tPreviewResult pv_draw(const tPvMap * map, const tPreviewView view, const size_t threads, unsigned char * rgba) {
+	size_t minX = PV_CELLS, minY = PV_CELLS, maxX = 0, maxY = 0;
+	uint16_t maxH = 0;
+	double minU = 0.0, maxU = 0.0, minV = 0.0, maxV = 0.0;
+	tPvGrid grid;
+	tPvBand band[PV_MAX_THREADS];
+	uint32_t * depth = NULL;
+	/* bounding box */
+	for (size_t i = 0; i < (PV_DIR_SIZE * PV_DIR_SIZE); i++) {
+		const uint16_t * tile = map->tile[i];
+		if (tile == NULL) continue;
+		for (size_t j = 0; j < (PV_TILE_SIZE * PV_TILE_SIZE); j++) {
+			if (tile[j] == 0) continue;
+			const size_t cx = ((i % PV_DIR_SIZE) << PV_TILE_BITS) + (j & PV_TILE_MASK);
+			const size_t cy = ((i / PV_DIR_SIZE) << PV_TILE_BITS) + (j >> PV_TILE_BITS);
+			minX = PCF_MIN(minX, cx);
+			minY = PCF_MIN(minY, cy);
+			maxX = PCF_MAX(maxX, cx);
+			maxY = PCF_MAX(maxY, cy);
+			maxH = PCF_MAX(maxH, tile[j]);
+		}
+	}
+	if (maxH == 0) return PV_ERR_EMPTY;
+	/* fit the projected bounding box into the image */
+	const double x0 = ((double)minX - PV_ORIGIN) * PV_CELL_SIZE;
+	const double y0 = ((double)minY - PV_ORIGIN) * PV_CELL_SIZE;
+	const double x1 = ((double)maxX + 1 - PV_ORIGIN) * PV_CELL_SIZE;
+	const double y1 = ((double)maxY + 1 - PV_ORIGIN) * PV_CELL_SIZE;
+	for (int i = 0; i < 8; i++) {
+		double u, v;
+		pv_project(view, ((i & 1) != 0) ? x1 : x0, ((i & 2) != 0) ? y1 : y0, ((i & 4) != 0) ? (double)maxH * PV_Z_UNIT : 0.0, &u, &v);
+		minU = (i == 0) ? u : PCF_MIN(minU, u);
+		maxU = (i == 0) ? u : PCF_MAX(maxU, u);
+		minV = (i == 0) ? v : PCF_MIN(minV, v);
+		maxV = (i == 0) ? v : PCF_MAX(maxV, v);
+	}
+	const double du = PCF_MAX(maxU - minU, PV_CELL_SIZE);
+	const double dv = PCF_MAX(maxV - minV, PV_CELL_SIZE);
+	const double scale = PCF_MIN((PV_WIDTH - (2 * PV_MARGIN)) / du, (PV_HEIGHT - (2 * PV_MARGIN)) / dv);
+	/* reduce the height map to about one cell per pixel */
+	const size_t factor = (size_t)PCF_MAX(floor(1.0 / (scale * PV_CELL_SIZE)), 1.0);
+	grid.width = ((maxX - minX) / factor) + 1;
+	grid.height = ((maxY - minY) / factor) + 1;
+	grid.cell = (double)factor * PV_CELL_SIZE;
+	grid.x = x0;
+	grid.y = y0;
+	grid.maxH = maxH;
+	grid.h = (uint16_t *)calloc(grid.width * grid.height, sizeof(uint16_t));
+	if (grid.h == NULL) return PV_ERR_NO_MEM;
+	for (size_t i = 0; i < (PV_DIR_SIZE * PV_DIR_SIZE); i++) {
+		const uint16_t * tile = map->tile[i];
+		if (tile == NULL) continue;
+		for (size_t j = 0; j < (PV_TILE_SIZE * PV_TILE_SIZE); j++) {
+			if (tile[j] == 0) continue;
+			const size_t gx = ((((i % PV_DIR_SIZE) << PV_TILE_BITS) + (j & PV_TILE_MASK)) - minX) / factor;
+			const size_t gy = ((((i / PV_DIR_SIZE) << PV_TILE_BITS) + (j >> PV_TILE_BITS)) - minY) / factor;
+			uint16_t * cell = grid.h + (gy * grid.width) + gx;
+			if (*cell < tile[j]) *cell = tile[j];
+		}
+	}
+	if (view != PV_TOP) {
+		depth = (uint32_t *)calloc(PV_WIDTH * PV_HEIGHT, sizeof(uint32_t));
+		if (depth == NULL) {
+			free(grid.h);
+			return PV_ERR_NO_MEM;
+		}
+	}
+	/* render in bands of rows */
+	const size_t count = PCF_MAX(PCF_MIN(PCF_MIN(threads, (size_t)PV_MAX_THREADS), (size_t)(PV_HEIGHT / 16)), (size_t)1);
+	for (size_t i = 0; i < count; i++) {
+		band[i].grid = &grid;
+		band[i].view = view;
+		band[i].scale = scale;
+		band[i].offU = ((PV_WIDTH - (du * scale)) / 2.0) - (minU * scale);
+		band[i].offV = ((PV_HEIGHT - (dv * scale)) / 2.0) - (minV * scale);
+		band[i].rgba = rgba;
+		band[i].depth = depth;
+		band[i].row0 = (i * PV_HEIGHT) / count;
+		band[i].row1 = ((i + 1) * PV_HEIGHT) / count;
+	}
+	pv_parallel(pv_drawBand, band, sizeof(tPvBand), count);
+	if (depth != NULL) free(depth);
+	free(grid.h);
+	return PV_OK;
+}
+
+
+/**
+ * Renders the height map as Base64 encoded PNG image.
+ *
+ * @param[in] map - height map
+ * @param[in] view - preview view
+ * @param[in] threads - maximum number of threads
+ * @param[out] dst - receives the allocated Base64 encoded PNG image (free after use)
+ * @param[out] dstLen - receives the output length in bytes
+ * @return PV_OK on success, else the error cause
+ */
+static tPreviewResult pv_encode(const tPvMap * map, const tPreviewView view, const size_t threads, char ** dst, size_t * dstLen) {
+	tPreviewResult res;
+	if (map->noMem != 0) return PV_ERR_NO_MEM;
+	unsigned char * rgba = (unsigned char *)calloc(PV_WIDTH * PV_HEIGHT, 4);
+	if (rgba == NULL) return PV_ERR_NO_MEM;
+	res = pv_draw(map, view, threads, rgba);
+	if (res == PV_OK) {
+		switch (tn_encodeImage(rgba, PV_WIDTH, PV_HEIGHT, dst, dstLen)) {
+		case TN_OK: break;
+		case TN_ERR_UNSUPPORTED: res = PV_ERR_UNSUPPORTED; break;
+		default: res = PV_ERR_NO_MEM; break;
+		}
+	}
+	free(rgba);
+	return res;
+}
+
+
+/**
+ * Renders a toolpath preview of the given G-Code. The extrusion moves are parsed concurrently in
+ * line aligned ranges into separate height maps. Inputs larger than PV_MAX_BYTES are sampled in
+ * evenly distributed blocks. The merged height map is rendered in bands of rows concurrently.
+ *
+ * @param[in] buf - G-Code
+ * @param[in] len - G-Code length in bytes
+ * @param[in] view - preview view
+ * @param[in] threads - maximum number of threads
+ * @param[out] dst - receives the allocated Base64 encoded PNG image (free after use)
+ * @param[out] dstLen - receives the output length in bytes
+ * @return PV_OK on success, else the error cause
+ */
+tPreviewResult pv_renderBuffer(const char * buf, const size_t len, const tPreviewView view, const size_t threads, char ** dst, size_t * dstLen) {
+	tPreviewResult res = PV_ERR_NO_MEM;
+	tPvWorker * worker;
+	if (buf == NULL || dst == NULL || dstLen == NULL) return PV_ERR_EMPTY;
+	*dst = NULL;
+	*dstLen = 0;
+	if (tn_supported() == 0) return PV_ERR_UNSUPPORTED;
+	if (len < 1 || view == PV_NONE) return PV_ERR_EMPTY;
+	const size_t count = PCF_MAX(PCF_MIN(PCF_MIN(threads, (size_t)PV_MAX_THREADS), len / PV_BLOCK_SIZE), (size_t)1);
+	worker = (tPvWorker *)calloc(count, sizeof(tPvWorker));
+	if (worker == NULL) return PV_ERR_NO_MEM;
+	const int relativeE = pv_extrusionMode(buf, PCF_MIN(len, (size_t)PV_HEAD_SIZE));
+	for (size_t i = 0, start = 0; i < count; i++) {
+		const size_t end = (i + 1 < count) ? PCF_MAX(start, pv_lineStart(buf, len, (i + 1) * (len / count))) : len;
+		worker[i].buf = buf;
+		worker[i].start = start;
+		worker[i].end = end;
+		worker[i].stride = pv_stride(len);
+		worker[i].lastBlock = (len - 1) / PV_BLOCK_SIZE;
+		worker[i].relativeE = relativeE;
+		if (pv_mapInit(&(worker[i].map)) != 1) goto onEnd;
+		start = end;
+	}
+	pv_parallel(pv_work, worker, sizeof(tPvWorker), count);
+	for (size_t i = 1; i < count; i++) pv_mapMerge(&(worker[0].map), &(worker[i].map));
+	res = pv_encode(&(worker[0].map), view, threads, dst, dstLen);
+onEnd:
+	for (size_t i = 0; i < count; i++) pv_mapFree(&(worker[i].map));
+	free(worker);
+	return res;
+}
+
+
+/**
+ * Renders a toolpath preview of the given G-Code file like pv_renderBuffer(). The file is read
+ * and parsed sequentially block by block.
+ *
+ * @param[in,out] fp - G-Code file
+ * @param[in] view - preview view
+ * @param[out] dst - receives the allocated Base64 encoded PNG image (free after use)
+ * @param[out] dstLen - receives the output length in bytes
+ * @return PV_OK on success, else the error cause
+ */
+tPreviewResult pv_renderFile(FILE * fp, const tPreviewView view, char ** dst, size_t * dstLen) {
+	tPreviewResult res = PV_ERR_NO_MEM;
+	char * buf = NULL;
+	tPvMap map;
+	tPvState st;
+	int64_t size;
+	uint64_t len, lastBlock;
+	uint64_t next = 0;
+	size_t stride;
+	int cont = 0;
+	if (fp == NULL || dst == NULL || dstLen == NULL) return PV_ERR_EMPTY;
+	*dst = NULL;
+	*dstLen = 0;
+	if (tn_supported() == 0) return PV_ERR_UNSUPPORTED;
+	if (view == PV_NONE) return PV_ERR_EMPTY;
+	if (fseeko64(fp, 0, SEEK_END) != 0 || (size = (int64_t)ftello64(fp)) < 0) return PV_ERR_READ;
+	if (size < 1) return PV_ERR_EMPTY;
+	if (pv_mapInit(&map) != 1) return PV_ERR_NO_MEM;
+	buf = (char *)malloc(PV_BACKTRACK + PV_BLOCK_SIZE + PV_LINE_MAX);
+	if (buf == NULL) goto onEnd;
+	memset(&st, 0, sizeof(st));
+	st.known = PV_BIT(PV_Z); /* starts at the build plate */
+	len = (uint64_t)size;
+	stride = pv_stride(len);
+	lastBlock = (len - 1) / PV_BLOCK_SIZE;
+	for (uint64_t block = 0; block <= lastBlock; block++) {
+		if (pv_sampled(block, stride, lastBlock) == 0) {
+			cont = 0;
+			continue;
+		}
+		const uint64_t blockStart = block * PV_BLOCK_SIZE;
+		const uint64_t blockEnd = PCF_MIN(blockStart + PV_BLOCK_SIZE, len);
+		const uint64_t winStart = (cont != 0) ? next : ((blockStart > PV_BACKTRACK) ? (blockStart - PV_BACKTRACK) : 0);
+		const uint64_t winEnd = PCF_MIN(blockEnd + PV_LINE_MAX, len);
+		if (winStart >= winEnd) continue;
+		const size_t winLen = (size_t)(winEnd - winStart);
+		if (fseeko64(fp, (int64_t)winStart, SEEK_SET) != 0 || fread(buf, winLen, 1, fp) != 1) {
+			res = PV_ERR_READ;
+			goto onEnd;
+		}
+		if (block == 0) st.relativeE = pv_extrusionMode(buf, PCF_MIN(winLen, (size_t)PV_HEAD_SIZE));
+		size_t start = 0;
+		if (cont == 0) {
+			start = pv_lineStart(buf, winLen, (size_t)(blockStart - winStart));
+			pv_recover(&st, buf, start, start);
+		}
+		const size_t end = (blockEnd < winEnd) ? pv_lineStart(buf, winLen, (size_t)(blockEnd - winStart)) : winLen;
+		if (start < end) {
+			pv_parse(&st, &map, buf + start, buf + end);
+			next = winStart + end;
+		}
+		cont = 1;
+	}
+	res = pv_encode(&map, view, 1, dst, dstLen);
+onEnd:
+	if (buf != NULL) free(buf);
+	pv_mapFree(&map);
+	return res;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file preview.h
+ * @author Daniel Starke
+ * @see preview.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __PREVIEW_H__
+#define __PREVIEW_H__
+
+#include <stddef.h>
+#include <stdio.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Preview image width in pixels (Snapmaker terminal thumbnail size). */
+#define PV_WIDTH 300
+
+
+/** Preview image height in pixels (Snapmaker terminal thumbnail size). */
+#define PV_HEIGHT 150
+
+
+/** Enumeration of possible preview views. */
+typedef enum {
+	PV_NONE = 0,               /**< no preview */
+	PV_ISO,                    /**< isometric view from the front left */
+	PV_TOP                     /**< top-down view */
+} tPreviewView;
+
+
+/** Enumeration of possible preview rendering results. */
+typedef enum {
+	PV_OK = 0,
+	PV_ERR_NO_MEM,
+	PV_ERR_READ,
+	PV_ERR_EMPTY,              /**< no extrusion moves found */
+	PV_ERR_UNSUPPORTED         /**< built without zlib */
+} tPreviewResult;
+
+
+tPreviewResult pv_renderBuffer(const char * buf, const size_t len, const tPreviewView view, const size_t threads, char ** dst, size_t * dstLen);
+tPreviewResult pv_renderFile(FILE * fp, const tPreviewView view, char ** dst, size_t * dstLen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __PREVIEW_H__ */
@@ -0,0 +1,516 @@
+/**
+ * @file serial.c
+ * @author Daniel Starke
+ * @see serial.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serial.h"
+#ifdef PCF_IS_LINUX
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/** Receive buffer size. Longer response lines are split. */
+#define SR_RX_SIZE 512
+
+
+/** Line sent to the printer. */
+typedef struct {
+	char text[SR_LINE_SIZE];   /**< line with line number, checksum and line feed */
+	size_t len;                /**< length of text in bytes */
+} tSerialLine;
+
+
+/** Streaming state. */
+typedef struct {
+	int fd;                    /**< serial device */
+	const struct iovec * vec;  /**< G-Code segments */
+	size_t count;              /**< number of G-Code segments */
+	size_t seg;                /**< current segment */
+	size_t pos;                /**< read position within the current segment */
+	int eof;                   /**< 1 if all commands were read from the segments, else 0 */
+	tSerialLine * history;     /**< sent lines by line number modulo capacity */
+	size_t capacity;           /**< number of history entries */
+	size_t window;             /**< maximum number of commands in flight */
+	size_t inflight;           /**< number of sent commands without response */
+	uint64_t next;             /**< line number sent next */
+	uint64_t generated;        /**< line number of the next command read from the segments */
+	int draining;              /**< 1 if waiting for the responses before a resend, else 0 */
+	char rx[SR_RX_SIZE];       /**< received data */
+	size_t rxLen;              /**< number of bytes in rx */
+	size_t rxUsed;             /**< number of bytes of rx returned as line already */
+	tSerialStats * stats;      /**< streaming statistics */
+} tSerial;
+
+
+/**
+ * Returns the termios speed value of the given baud rate.
+ *
+ * @param[in] baud - baud rate
+ * @param[out] speed - receives the speed value
+ * @return 1 on success, 0 if not supported
+ */
+static int sr_speed(const unsigned long baud, speed_t * speed) {
+	switch (baud) {
+	case 9600: *speed = B9600; break;
+	case 19200: *speed = B19200; break;
+	case 38400: *speed = B38400; break;
+	case 57600: *speed = B57600; break;
+	case 115200: *speed = B115200; break;
+#ifdef B230400
+	case 230400: *speed = B230400; break;
+#endif /* B230400 */
+#ifdef B460800
+	case 460800: *speed = B460800; break;
+#endif /* B460800 */
+#ifdef B500000
+	case 500000: *speed = B500000; break;
+#endif /* B500000 */
+#ifdef B921600
+	case 921600: *speed = B921600; break;
+#endif /* B921600 */
+#ifdef B1000000
+	case 1000000: *speed = B1000000; break;
+#endif /* B1000000 */
+	default: return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Returns the monotonic time in milliseconds.
+ *
+ * @return time in milliseconds
+ */
+static uint64_t sr_nowMs(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)(now.tv_sec) * 1000) + ((uint64_t)(now.tv_nsec) / 1000000);
+}
+
+
+/**
+ * Checks whether the given character is a white-space character within a G-Code line.
+ *
+ * @param[in] ch - character to check
+ * @return 1 if white-space, else 0
+ */
+static int sr_isSpace(const char ch) {
+	return (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f') ? 1 : 0;
+}
+
+
+/**
+ * Opens the given serial device in raw mode with 8N1 and the given baud rate. Pending data is
+ * discarded.
+ *
+ * @param[in] device - serial device path
+ * @param[in] baud - baud rate
+ * @return file descriptor or -1 on error
+ */
+static int sr_open(const char * device, const unsigned long baud) {
+	struct termios tio;
+	speed_t speed;
+	int fd;
+	if (sr_speed(baud, &speed) != 1) return -1;
+	fd = open(device, O_RDWR | O_NOCTTY);
+	if (fd < 0) return -1;
+	if (tcgetattr(fd, &tio) != 0) goto onError;
+	tio.c_iflag &= (tcflag_t)~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+	tio.c_oflag &= (tcflag_t)~OPOST;
+	tio.c_lflag &= (tcflag_t)~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+	tio.c_cflag &= (tcflag_t)~(CSIZE | PARENB | CSTOPB);
+#ifdef CRTSCTS
+	tio.c_cflag &= (tcflag_t)~CRTSCTS;
+#endif /* CRTSCTS */
+	tio.c_cflag |= CS8 | CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	if (cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0) goto onError;
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) goto onError;
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+onError:
+	close(fd);
+	return -1;
+}
+
+
+/**
+ * Writes the given lines completely. Interrupted and partial writes are continued.
+ *
+ * @param[in] fd - serial device
+ * @param[in,out] vec - lines to write (modified)
+ * @param[in] count - number of lines
+ * @return 1 on success, 0 on error
+ */
+static int sr_writeAll(const int fd, struct iovec * vec, size_t count) {
+	while (count > 0) {
+		ssize_t got = writev(fd, vec, (int)count);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return 0;
+		while (count > 0 && (size_t)got >= vec->iov_len) {
+			got -= (ssize_t)(vec->iov_len);
+			vec++;
+			count--;
+		}
+		if (count > 0) {
+			vec->iov_base = (char *)(vec->iov_base) + got;
+			vec->iov_len -= (size_t)got;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * Returns the next received line. Carriage returns at the end are removed. The line stays valid
+ * until the next call.
+ *
+ * @param[in,out] sr - streaming state
+ * @param[in] timeout - time in milliseconds to wait for a complete line
+ * @param[out] line - receives the null-terminated line
+ * @return 1 on success, 0 on timeout, -1 on error
+ */
+static int sr_readLine(tSerial * sr, const int timeout, char ** line) {
+	struct pollfd pfd;
+	if (sr->rxUsed > 0) {
+		sr->rxLen -= sr->rxUsed;
+		memmove(sr->rx, sr->rx + sr->rxUsed, sr->rxLen);
+		sr->rxUsed = 0;
+	}
+	for (;;) {
+		char * end = (char *)memchr(sr->rx, '\n', sr->rxLen);
+		if (end == NULL && sr->rxLen >= (sizeof(sr->rx) - 1)) end = sr->rx + sr->rxLen;
+		if (end != NULL) {
+			sr->rxUsed = PCF_MIN((size_t)(end - sr->rx) + 1, sr->rxLen);
+			*end = 0;
+			while (end > sr->rx && end[-1] == '\r') *(--end) = 0;
+			*line = sr->rx;
+			return 1;
+		}
+		pfd.fd = sr->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		const int ready = poll(&pfd, 1, timeout);
+		if (ready < 0 && errno == EINTR) continue;
+		if (ready < 0) return -1;
+		if (ready == 0) return 0;
+		const ssize_t got = read(sr->fd, sr->rx + sr->rxLen, sizeof(sr->rx) - 1 - sr->rxLen);
+		if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+		if (got <= 0) return -1;
+		sr->rxLen += (size_t)got;
+	}
+}
+
+
+/**
+ * Formats the given command as line with line number and checksum as expected by Marlin.
+ *
+ * @param[out] line - receives the formatted line
+ * @param[in] number - line number
+ * @param[in] cmd - G-Code command
+ * @param[in] len - length of the command in bytes (up to SR_LINE_SIZE)
+ * @return 1 on success, 0 if the line exceeds SR_LINE_SIZE
+ */
+static int sr_formatLine(tSerialLine * line, const uint64_t number, const char * cmd, const size_t len) {
+	char buf[SR_LINE_SIZE + 32];
+	unsigned char checksum = 0;
+	int n = snprintf(buf, sizeof(buf), "N%llu %.*s", (unsigned long long)number, (int)len, cmd);
+	for (int i = 0; i < n; i++) checksum = (unsigned char)(checksum ^ (unsigned char)(buf[i]));
+	n += snprintf(buf + n, sizeof(buf) - (size_t)n, "*%u\n", (unsigned)checksum);
+	if (n > SR_LINE_SIZE) return 0;
+	memcpy(line->text, buf, (size_t)n);
+	line->len = (size_t)n;
+	return 1;
+}
+
+
+/**
+ * Reads the next G-Code command from the segments. Comments, leading and trailing white-spaces
+ * and empty lines are skipped.
+ *
+ * @param[in,out] sr - streaming state
+ * @param[out] cmd - receives the command (SR_LINE_SIZE bytes)
+ * @param[out] len - receives the length of the command in bytes
+ * @return 1 on success, 0 if no command is left, -1 if the command is too long
+ */
+static int sr_nextCommand(tSerial * sr, char * cmd, size_t * len) {
+	size_t n = 0;
+	size_t end = 0;
+	int comment = 0;
+	for (;;) {
+		char ch = '\n';
+		if (sr->seg < sr->count) {
+			if (sr->pos >= sr->vec[sr->seg].iov_len) {
+				sr->seg++;
+				sr->pos = 0;
+				continue;
+			}
+			ch = ((const char *)(sr->vec[sr->seg].iov_base))[sr->pos++];
+		} else if (n == 0) {
+			sr->eof = 1;
+			return 0;
+		}
+		if (ch == '\n') {
+			/* end of line (or last line without line feed) */
+			if (end > 0) {
+				if (end > SR_LINE_SIZE) return -1;
+				*len = end;
+				return 1;
+			}
+			n = 0;
+			comment = 0;
+			continue;
+		}
+		if (comment != 0 || ch == ';') {
+			comment = 1;
+			continue;
+		}
+		if (n == 0 && sr_isSpace(ch) != 0) continue;
+		if (n < SR_LINE_SIZE) cmd[n] = ch;
+		n++;
+		if (sr_isSpace(ch) == 0) end = n;
+	}
+}
+
+
+/**
+ * Handles a single response line of the printer.
+ *
+ * @param[in,out] sr - streaming state
+ * @param[in] line - response line
+ * @return SR_OK on success, else the error cause
+ */
+static tSerialResult sr_handleResponse(tSerial * sr, const char * line) {
+	const char * num = NULL;
+	if (strncmp(line, "ok", 2) == 0) {
+		/* spurious responses do not enlarge the window */
+		if (sr->inflight > 0) sr->inflight--;
+		if (sr->inflight == 0) sr->draining = 0;
+		return SR_OK;
+	}
+	if (strncmp(line, "Resend:", 7) == 0) {
+		num = line + 7;
+	} else if (strncmp(line, "rs ", 3) == 0) {
+		num = line + 3;
+	} else if (strncmp(line, "!!", 2) == 0 || strncmp(line, "start", 5) == 0 || strncmp(line, "Error:Printer halted", 20) == 0) {
+		return SR_ERR_PRINTER;
+	}
+	if (num == NULL) return SR_OK;
+	/* lines sent before the last resend are answered with the same request again */
+	if (sr->draining != 0) return SR_OK;
+	while (sr_isSpace(*num) != 0) num++;
+	char * end = NULL;
+	const uint64_t number = (uint64_t)strtoull(num, &end, 10);
+	if (end == num) return SR_ERR_PRINTER;
+	if (number == sr->next) return SR_OK;
+	/* only lines still held by the history can be sent again */
+	if (number < 1 || number > sr->next || (sr->generated - number) > sr->capacity) return SR_ERR_PRINTER;
+	sr->next = number;
+	sr->draining = (sr->inflight > 0) ? 1 : 0;
+	return SR_OK;
+}
+
+
+/**
+ * Resets the line number of the printer to zero. The reset is repeated every
+ * SR_HANDSHAKE_INTERVAL milliseconds until the printer responds. This gives the printer time to
+ * boot if opening the device reset it. Responses to repeated resets are discarded.
+ *
+ * @param[in,out] sr - streaming state
+ * @return SR_OK on success, else the error cause
+ */
+static tSerialResult sr_handshake(tSerial * sr) {
+	tSerialLine reset;
+	struct iovec vec;
+	const uint64_t start = sr_nowMs();
+	size_t sent = 0;
+	char * line;
+	(void)sr_formatLine(&reset, 0, "M110 N0", 7);
+	for (;;) {
+		const uint64_t due = sr_nowMs() + SR_HANDSHAKE_INTERVAL;
+		uint64_t now;
+		vec.iov_base = reset.text;
+		vec.iov_len = reset.len;
+		if (sr_writeAll(sr->fd, &vec, 1) != 1) return SR_ERR_IO;
+		sent++;
+		while ((now = sr_nowMs()) < due) {
+			const int res = sr_readLine(sr, (int)(due - now), &line);
+			if (res < 0) return SR_ERR_IO;
+			if (res > 0 && strncmp(line, "ok", 2) == 0) goto onAcknowledged;
+		}
+		if ((now - start) >= SR_TIMEOUT) return SR_ERR_TIMEOUT;
+	}
+onAcknowledged:
+	if (sent > 1) {
+		/* drop late responses to the repeated resets */
+		for (;;) {
+			const int res = sr_readLine(sr, SR_HANDSHAKE_INTERVAL / 4, &line);
+			if (res < 0) return SR_ERR_IO;
+			if (res == 0) break;
+		}
+	}
+	return SR_OK;
+}
+
+
+/**
+ * Streams the commands to the printer until all were acknowledged. Up to the window size of
+ * commands are sent ahead of the "ok" responses to keep the receive buffer of the firmware filled.
+ * Each command is expected to be answered by exactly one "ok". A resend request rewinds to the
+ * requested line once all commands in flight were answered.
+ *
+ * @param[in,out] sr - streaming state
+ * @return SR_OK on success, else the error cause
+ */
+static tSerialResult sr_stream(tSerial * sr) {
+	char cmd[SR_LINE_SIZE];
+	struct iovec * vec;
+	tSerialResult res = SR_OK;
+	vec = (struct iovec *)malloc(sr->window * sizeof(struct iovec));
+	if (vec == NULL) return SR_ERR_NO_MEM;
+	for (;;) {
+		size_t n = 0;
+		/* fill the window */
+		while (sr->draining == 0 && sr->inflight < sr->window) {
+			tSerialLine * line;
+			if (sr->next == sr->generated) {
+				size_t len;
+				if (sr->eof != 0) break;
+				const int got = sr_nextCommand(sr, cmd, &len);
+				if (got < 0) {
+					res = SR_ERR_COMMAND;
+					goto onEnd;
+				}
+				if (got == 0) break;
+				if (sr_formatLine(sr->history + (sr->generated % sr->capacity), sr->generated, cmd, len) != 1) {
+					res = SR_ERR_COMMAND;
+					goto onEnd;
+				}
+				sr->generated++;
+				sr->stats->commands++;
+			} else {
+				sr->stats->resends++;
+			}
+			if (n == 0 && sr->inflight == 0 && sr->next > 1) sr->stats->underruns++;
+			line = sr->history + (sr->next % sr->capacity);
+			vec[n].iov_base = line->text;
+			vec[n].iov_len = line->len;
+			n++;
+			sr->next++;
+			sr->inflight++;
+		}
+		if (n > 0 && sr_writeAll(sr->fd, vec, n) != 1) {
+			res = SR_ERR_IO;
+			goto onEnd;
+		}
+		if (sr->eof != 0 && sr->next == sr->generated && sr->inflight == 0) break;
+		/* wait for a response and handle all received ones */
+		{
+			char * line;
+			int got = sr_readLine(sr, SR_TIMEOUT, &line);
+			if (got == 0) {
+				res = SR_ERR_TIMEOUT;
+				goto onEnd;
+			}
+			while (got > 0) {
+				res = sr_handleResponse(sr, line);
+				if (res != SR_OK) goto onEnd;
+				got = sr_readLine(sr, 0, &line);
+			}
+			if (got < 0) {
+				res = SR_ERR_IO;
+				goto onEnd;
+			}
+		}
+	}
+onEnd:
+	free(vec);
+	return res;
+}
+
+
+/**
+ * Checks whether the given baud rate can be used with sr_send().
+ *
+ * @param[in] baud - baud rate
+ * @return 1 if supported, else 0
+ */
+int sr_checkBaud(const unsigned long baud) {
+	speed_t speed;
+	return sr_speed(baud, &speed);
+}
+
+
+/**
+ * Streams the G-Code commands of the concatenated segments to the printer connected to the given
+ * serial device. Each command is sent with line number and checksum. Comments and empty lines are
+ * not sent. The line number of the printer is reset to zero first. The function returns once
+ * the printer acknowledged all commands.
+ *
+ * @param[in] device - serial device path (e.g. /dev/ttyACM0)
+ * @param[in] baud - baud rate
+ * @param[in] window - maximum number of commands sent ahead of the "ok" responses (1 to SR_MAX_WINDOW)
+ * @param[in] vec - G-Code segments
+ * @param[in] count - number of G-Code segments
+ * @param[out] stats - receives the streaming statistics (may be NULL)
+ * @return SR_OK on success, else the error cause
+ */
+tSerialResult sr_send(const char * device, const unsigned long baud, const size_t window, const struct iovec * vec, const size_t count, tSerialStats * stats) {
+	tSerialResult res;
+	tSerialStats dummy;
+	tSerial * sr;
+	if (stats == NULL) stats = &dummy;
+	memset(stats, 0, sizeof(*stats));
+	if (device == NULL || (vec == NULL && count > 0) || window < 1 || window > SR_MAX_WINDOW) return SR_ERR_OPEN;
+	sr = (tSerial *)calloc(1, sizeof(tSerial));
+	if (sr == NULL) return SR_ERR_NO_MEM;
+	/* a resend request refers to one of the commands in flight */
+	sr->capacity = window + 1;
+	sr->history = (tSerialLine *)malloc(sr->capacity * sizeof(tSerialLine));
+	if (sr->history == NULL) {
+		free(sr);
+		return SR_ERR_NO_MEM;
+	}
+	sr->vec = vec;
+	sr->count = count;
+	sr->window = window;
+	sr->next = 1;
+	sr->generated = 1;
+	sr->stats = stats;
+	sr->fd = sr_open(device, baud);
+	if (sr->fd < 0) {
+		res = SR_ERR_OPEN;
+	} else {
+		res = sr_handshake(sr);
+		if (res == SR_OK) res = sr_stream(sr);
+		close(sr->fd);
+	}
+	free(sr->history);
+	free(sr);
+	return res;
+}
+#endif /* PCF_IS_LINUX */
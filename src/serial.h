@@ -0,0 +1,92 @@
+/**
+ * @file serial.h
+ * @author Daniel Starke
+ * @see serial.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __SERIAL_H__
+#define __SERIAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "target.h"
+#ifdef PCF_IS_LINUX
+#include <sys/uio.h>
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Time in milliseconds to wait for any response of the printer before giving up. */
+#define SR_TIMEOUT 60000
+
+
+/** Time in milliseconds between the initial line number resets until the printer responds. */
+#define SR_HANDSHAKE_INTERVAL 2000
+
+
+/** Default baud rate of the serial device. */
+#define SR_DEFAULT_BAUD 115200
+
+
+/** Default number of commands sent ahead of the "ok" responses (Marlin BUFSIZE). */
+#define SR_DEFAULT_WINDOW 4
+
+
+/** Maximum number of commands sent ahead of the "ok" responses. */
+#define SR_MAX_WINDOW 128
+
+
+/** Maximum length of a sent line including line number, checksum and line feed (Marlin MAX_CMD_SIZE). */
+#define SR_LINE_SIZE 96
+
+
+/** Enumeration of possible streaming results. */
+typedef enum {
+	SR_OK = 0,
+	SR_ERR_NO_MEM,
+	SR_ERR_OPEN,               /**< device not found, not a terminal or unsupported baud rate */
+	SR_ERR_IO,                 /**< device read or write failed or hung up */
+	SR_ERR_TIMEOUT,            /**< no response of the printer within SR_TIMEOUT */
+	SR_ERR_COMMAND,            /**< G-Code command with line number and checksum exceeds SR_LINE_SIZE */
+	SR_ERR_PRINTER             /**< printer halted, was reset or requested an unknown line */
+} tSerialResult;
+
+
+/** Streaming statistics. */
+typedef struct {
+	uint64_t commands;         /**< number of G-Code commands sent (without resends) */
+	uint64_t resends;          /**< number of commands sent again on request of the printer */
+	uint64_t underruns;        /**< number of times the printer ran out of commands while more were left */
+} tSerialStats;
+
+
+#ifdef PCF_IS_LINUX
+int sr_checkBaud(const unsigned long baud);
+tSerialResult sr_send(const char * device, const unsigned long baud, const size_t window, const struct iovec * vec, const size_t count, tSerialStats * stats);
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __SERIAL_H__ */
@@ -2,7 +2,7 @@
  * @file sm2pspp.c
  * @author Daniel Starke
  * @date 2021-01-30
- * @version 2021-02-12
+ * @version 2026-10-16
  * 
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -24,31 +24,38 @@
 FILE * fin = NULL;
 FILE * fout = NULL;
 FILE * ferr = NULL;
+static volatile sig_atomic_t stopWatch = 0;
 
 
-const TCHAR * fmsg[MSG_COUNT] = {
-	/* MSGT_SUCCESS                    */ _T(""), /* never used for output */
-	/* MSGT_ERR_NO_MEM                 */ _T("Error: Failed to allocate memory.\n"),
-	/* MSGT_ERR_FILE_NOT_FOUND         */ _T("Error: Input file not found.\n"),
-	/* MSGT_ERR_FILE_OPEN              */ _T("Error: Failed to open file for reading.\n"),
-	/* MSGT_ERR_FILE_READ              */ _T("Error: Failed to read data from file.\n"),
-	/* MSGT_ERR_FILE_CREATE            */ _T("Error: Failed to create file for writing.\n"),
-	/* MSGT_ERR_FILE_WRITE             */ _T("Error: Failed to write data to file.\n"),
-	/* MSGT_WARN_NO_FILAMENT_USED      */ _T("Warning: Filament used value not found.\n"),
-	/* MSGT_WARN_NO_LAYER_HEIGHT       */ _T("Warning: Layer height value not found.\n"),
-	/* MSGT_WARN_NO_EST_TIME           */ _T("Warning: Estimated time value not found.\n"),
-	/* MSGT_WARN_NO_NOZZLE_TEMP        */ _T("Warning: Nozzle temperature value not found.\n"),
-	/* MSGT_WARN_NO_PLATE_TEMP         */ _T("Warning: Building plate temperature value not found.\n"),
-	/* MSGT_WARN_NO_PRINT_SPEED        */ _T("Warning: Print speed value not found.\n"),
-	/* MSGT_WARN_NO_THUMBNAIL          */ _T("Warning: Thumbnail data not found.\n")
-	/* MSGT_WARN_NO_MAX_SIZE           */ _T("Warning: Size data not found.\n")
-};
+/**
+ * Signal handler to stop watching a directory or serving requests.
+ * 
+ * @param[in] sig - signal number
+ */
+static void onStopSignal(int sig) {
+	(void)sig;
+	stopWatch = 1;
+}
 
 
 /**
  * Main entry point.
  */
 int _tmain(int argc, TCHAR ** argv) {
+	tOptions opt;
+	TCHAR ** file = NULL;
+	const TCHAR * watchDir = NULL;
+	const TCHAR * serveSocket = NULL;
+	int * result = NULL;
+	size_t argCount = 0;
+	size_t count = 0;
+	size_t capacity = 0;
+	int fromList = 0;
+	int remote = 0;
+	int localOpt = 0;
+	int res = EXIT_FAILURE;
+	int i;
+	
 	/* set the output file descriptors */
 	fin  = stdin;
 	fout = stdout;
@@ -66,14 +73,311 @@ int _tmain(int argc, TCHAR ** argv) {
 	} else {
 		_setmode(_fileno(ferr), _O_U8TEXT);
 	}
+	_setmode(_fileno(fin), _O_U8TEXT);
 #endif /* UNICODE */
 
-	if (argc < 2) {
+	/* parse command-line options */
+	memset(&opt, 0, sizeof(opt));
+	opt.memoryBudget = ((uint64_t)DEFAULT_MEMORY_BUDGET) << 20;
+	for (i = 1; i < argc; i++) {
+		const TCHAR * arg = argv[i];
+		if (_tcscmp(arg, _T("-i")) == 0 || _tcscmp(arg, _T("--in-place")) == 0) {
+			opt.inPlace = 1;
+		} else if (_tcscmp(arg, _T("-m")) == 0 || _tcscmp(arg, _T("--low-memory")) == 0) {
+			opt.lowMemory = 1;
+		} else if (_tcscmp(arg, _T("-l")) == 0 || _tcscmp(arg, _T("--from-list")) == 0) {
+			fromList = 1;
+		} else if (_tcscmp(arg, _T("-s")) == 0 || _tcscmp(arg, _T("--stats")) == 0) {
+			opt.statsCb = &statsCallback;
+		} else if (_tcscmp(arg, _T("--stats-json")) == 0) {
+			opt.statsCb = &statsJsonCallback;
+		} else if (_tcscmp(arg, _T("-j")) == 0 || _tcscmp(arg, _T("--jobs")) == 0
+			|| _tcscmp(arg, _T("-b")) == 0 || _tcscmp(arg, _T("--memory-budget")) == 0
+			|| _tcscmp(arg, _T("--io-depth")) == 0) {
+			const int isJobs = (_tcscmp(arg, _T("-j")) == 0 || _tcscmp(arg, _T("--jobs")) == 0) ? 1 : 0;
+			const int isDepth = (_tcscmp(arg, _T("--io-depth")) == 0) ? 1 : 0;
+			TCHAR * end = NULL;
+			const long val = ((i + 1) < argc) ? _tcstol(argv[i + 1], &end, 10) : -1;
+			if (end == NULL || end == argv[i + 1] || *end != 0 || val < 0) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			if (isJobs != 0) {
+				opt.jobs = (size_t)val;
+			} else if (isDepth != 0) {
+				opt.ioDepth = (size_t)val;
+			} else {
+				opt.memoryBudget = ((uint64_t)val) << 20;
+			}
+			localOpt = 1;
+			i++;
+		} else if (_tcscmp(arg, _T("-t")) == 0 || _tcscmp(arg, _T("--thumbnail-recode")) == 0) {
+			opt.thumbnail.recode = 1;
+		} else if (_tcscmp(arg, _T("--thumbnail-colors")) == 0 || _tcscmp(arg, _T("--thumbnail-max")) == 0) {
+			const int isColors = (_tcscmp(arg, _T("--thumbnail-colors")) == 0) ? 1 : 0;
+			TCHAR * end = NULL;
+			const long val = ((i + 1) < argc) ? _tcstol(argv[i + 1], &end, 10) : -1;
+			if (end == NULL || end == argv[i + 1] || *end != 0 || val < 1 || (isColors != 0 && (val < 2 || val > 256))) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			if (isColors != 0) {
+				opt.thumbnail.colors = (size_t)val;
+			} else {
+				opt.thumbnail.maxSize = (size_t)val;
+			}
+			opt.thumbnail.recode = 1;
+			i++;
+		} else if (_tcscmp(arg, _T("--thumbnail-size")) == 0 || _tcscmp(arg, _T("--thumbnail-select")) == 0) {
+			const int isSelect = (_tcscmp(arg, _T("--thumbnail-select")) == 0) ? 1 : 0;
+			TCHAR * end = NULL;
+			TCHAR * endHeight = NULL;
+			const long width = ((i + 1) < argc) ? _tcstol(argv[i + 1], &end, 10) : -1;
+			const long height = (end != NULL && end != argv[i + 1] && *end == _T('x')) ? _tcstol(end + 1, &endHeight, 10) : -1;
+			if (endHeight == NULL || endHeight == (end + 1) || *endHeight != 0 || width < 0 || height < 0 || (width + height) < 1 || width > 1024 || height > 1024 || (isSelect != 0 && (width < 1 || height < 1))) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			if (isSelect != 0) {
+				opt.thumbnail.selectWidth = (size_t)width;
+				opt.thumbnail.selectHeight = (size_t)height;
+			} else {
+				opt.thumbnail.width = (size_t)width;
+				opt.thumbnail.height = (size_t)height;
+				opt.thumbnail.recode = 1;
+			}
+			i++;
+		} else if (_tcscmp(arg, _T("-w")) == 0 || _tcscmp(arg, _T("--watch")) == 0) {
+			if ((i + 1) >= argc || *(argv[i + 1]) == 0) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			watchDir = argv[++i];
+		} else if (_tcscmp(arg, _T("--serve")) == 0) {
+			if ((i + 1) >= argc || *(argv[i + 1]) == 0) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			serveSocket = argv[++i];
+		} else if (_tcscmp(arg, _T("--remote")) == 0) {
+			remote = 1;
+		} else if (_tcscmp(arg, _T("--upload")) == 0 || _tcscmp(arg, _T("--token")) == 0) {
+			if ((i + 1) >= argc || *(argv[i + 1]) == 0) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			if (_tcscmp(arg, _T("--upload")) == 0) {
+#ifdef PCF_IS_LINUX
+				if (up_checkUrl(argv[i + 1]) != 1) {
+					_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+					return EXIT_FAILURE;
+				}
+#endif /* PCF_IS_LINUX */
+				opt.uploadUrl = argv[++i];
+			} else {
+				opt.uploadToken = argv[++i];
+			}
+		} else if (_tcscmp(arg, _T("--stream")) == 0) {
+			if ((i + 1) >= argc || *(argv[i + 1]) == 0) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			opt.streamDevice = argv[++i];
+		} else if (_tcscmp(arg, _T("--baud")) == 0 || _tcscmp(arg, _T("--stream-window")) == 0) {
+			const int isBaud = (_tcscmp(arg, _T("--baud")) == 0) ? 1 : 0;
+			TCHAR * end = NULL;
+			const long val = ((i + 1) < argc) ? _tcstol(argv[i + 1], &end, 10) : -1;
+			if (end == NULL || end == argv[i + 1] || *end != 0 || val < 1 || (isBaud == 0 && val > SR_MAX_WINDOW)) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+#ifdef PCF_IS_LINUX
+			if (isBaud != 0 && sr_checkBaud((unsigned long)val) != 1) {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+#endif /* PCF_IS_LINUX */
+			if (isBaud != 0) {
+				opt.streamBaud = (unsigned long)val;
+			} else {
+				opt.streamWindow = (size_t)val;
+			}
+			i++;
+		} else if (_tcscmp(arg, _T("-p")) == 0 || _tcscmp(arg, _T("--preview")) == 0) {
+			const TCHAR * val = ((i + 1) < argc) ? argv[i + 1] : _T("");
+			if (_tcscmp(val, _T("iso")) == 0) {
+				opt.thumbnail.preview = PV_ISO;
+			} else if (_tcscmp(val, _T("top")) == 0) {
+				opt.thumbnail.preview = PV_TOP;
+			} else {
+				_ftprintf(ferr, _T("Error: Invalid value for option '%s'.\n"), arg);
+				return EXIT_FAILURE;
+			}
+			i++;
+		} else if (_tcscmp(arg, _T("--")) == 0) {
+			i++;
+			break;
+		} else if (arg[0] == _T('-') && arg[1] != 0) {
+			_ftprintf(ferr, _T("Error: Unknown option '%s'.\n"), arg);
+			return EXIT_FAILURE;
+		} else {
+			break;
+		}
+	}
+
+	if (i >= argc && fromList == 0 && watchDir == NULL && serveSocket == NULL) {
 		printHelp();
 		return EXIT_FAILURE;
 	}
 	
-	return (processFile(argv[1], &errorCallback) == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (opt.thumbnail.recode != 0 && tn_supported() == 0) {
+		_ftprintf(ferr, _T("Error: Thumbnail re-encoding is not supported by this build.\n"));
+		return EXIT_FAILURE;
+	}
+	
+	if (opt.thumbnail.preview != PV_NONE && tn_supported() == 0) {
+		_ftprintf(ferr, _T("Error: Toolpath preview rendering is not supported by this build.\n"));
+		return EXIT_FAILURE;
+	}
+	
+#ifndef PCF_IS_LINUX
+	if (opt.uploadUrl != NULL) {
+		_ftprintf(ferr, _T("Error: Upload is not supported by this build.\n"));
+		return EXIT_FAILURE;
+	}
+	if (opt.streamDevice != NULL) {
+		_ftprintf(ferr, _T("Error: Streaming is not supported by this build.\n"));
+		return EXIT_FAILURE;
+	}
+#endif /* !PCF_IS_LINUX */
+	
+#ifndef PCF_IS_LINUX
+	if (remote != 0) {
+		_ftprintf(ferr, _T("Error: Server handoff is not supported by this build.\n"));
+		return EXIT_FAILURE;
+	}
+#endif /* !PCF_IS_LINUX */
+	
+	/* the server processes the files with its own workers, memory budget and callbacks */
+	if (remote != 0) {
+		if (watchDir != NULL || serveSocket != NULL) {
+			_ftprintf(ferr, _T("Error: Server handoff requires input files.\n"));
+			return EXIT_FAILURE;
+		}
+		if (localOpt != 0 || opt.statsCb != NULL || opt.uploadUrl != NULL || opt.streamDevice != NULL) {
+			_ftprintf(ferr, _T("Error: Server handoff cannot be combined with --jobs, --memory-budget, --io-depth, --stats, --upload or --stream.\n"));
+			return EXIT_FAILURE;
+		}
+	}
+	
+	/* upload and stream are sent from the processed output in memory */
+	if ((opt.uploadUrl != NULL || opt.streamDevice != NULL) && (opt.inPlace != 0 || opt.lowMemory != 0)) {
+		_ftprintf(ferr, _T("Error: %s cannot be combined with in-place or low memory processing.\n"), (opt.uploadUrl != NULL) ? _T("Upload") : _T("Streaming"));
+		return EXIT_FAILURE;
+	}
+	
+	/* stream a single file to the printer */
+	if (opt.streamDevice != NULL) {
+		if (watchDir != NULL || serveSocket != NULL || fromList != 0 || (argc - i) != 1 || _tcscmp(argv[i], _T("-")) == 0) {
+			_ftprintf(ferr, _T("Error: Streaming requires exactly one input file.\n"));
+			return EXIT_FAILURE;
+		}
+		if (opt.uploadUrl != NULL) {
+			_ftprintf(ferr, _T("Error: Streaming cannot be combined with upload.\n"));
+			return EXIT_FAILURE;
+		}
+		/* the streaming statistics are always reported */
+		if (opt.statsCb == NULL) opt.statsCb = &streamCallback;
+	}
+	
+	/* process new files of the watched directory until interrupted */
+	if (watchDir != NULL) {
+		if (i < argc || fromList != 0) {
+			_ftprintf(ferr, _T("Error: Watch mode cannot be combined with input files.\n"));
+			return EXIT_FAILURE;
+		}
+		signal(SIGINT, onStopSignal);
+		signal(SIGTERM, onStopSignal);
+		return (processWatch(watchDir, &opt, &stopWatch, &errorCallback) == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	
+	/* serve requests of other instances until interrupted */
+	if (serveSocket != NULL) {
+		if (i < argc || fromList != 0) {
+			_ftprintf(ferr, _T("Error: Server mode cannot be combined with input files.\n"));
+			return EXIT_FAILURE;
+		}
+		signal(SIGINT, onStopSignal);
+		signal(SIGTERM, onStopSignal);
+		return (processServe(serveSocket, &opt, &stopWatch, &errorCallback) == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	
+	/* process standard input to standard output */
+	for (int n = i; n < argc; n++) {
+		if (_tcscmp(argv[n], _T("-")) != 0) continue;
+		if ((argc - i) != 1 || fromList != 0) {
+			_ftprintf(ferr, _T("Error: Standard input cannot be combined with other input files.\n"));
+			return EXIT_FAILURE;
+		}
+		if (opt.uploadUrl != NULL) {
+			_ftprintf(ferr, _T("Error: Standard input cannot be combined with upload.\n"));
+			return EXIT_FAILURE;
+		}
+		if (remote != 0) {
+			_ftprintf(ferr, _T("Error: Standard input cannot be combined with server handoff.\n"));
+			return EXIT_FAILURE;
+		}
+#ifdef PCF_IS_WIN
+		_setmode(_fileno(fin), _O_BINARY);
+		_setmode(_fileno(fout), _O_BINARY);
+#endif /* PCF_IS_WIN */
+		return (processStream(_T("<stdin>"), fin, fout, &opt, &errorCallback) == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	
+	/* collect input files */
+	argCount = (size_t)(argc - i);
+	capacity = argCount + 1;
+	file = (TCHAR **)malloc(capacity * sizeof(TCHAR *));
+	if (file == NULL) {
+		_ftprintf(ferr, _T("%s"), fmsg[MSGT_ERR_NO_MEM]);
+		goto onEnd;
+	}
+	for (count = 0; count < argCount; count++) file[count] = argv[i + (int)count];
+	if (fromList != 0 && readFileList(fin, &file, &count, &capacity) != 1) {
+		_ftprintf(ferr, _T("%s"), fmsg[MSGT_ERR_NO_MEM]);
+		goto onEnd;
+	}
+	if (count < 1) goto onEnd;
+	result = (int *)malloc(count * sizeof(int));
+	if (result == NULL) {
+		_ftprintf(ferr, _T("%s"), fmsg[MSGT_ERR_NO_MEM]);
+		goto onEnd;
+	}
+	
+	/* process files; hand them over to a running server if requested */
+	res = -1;
+	if (remote != 0) {
+		TCHAR * socketPath = defaultSocket();
+		if (socketPath != NULL) {
+			res = processRemote(socketPath, file, count, &opt, result, &errorCallback);
+			free(socketPath);
+		}
+	}
+	if (res < 0) res = processFiles(file, count, &opt, result, &errorCallback);
+	res = (res == 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (count > 1) {
+		/* output summary */
+		for (size_t n = 0; n < count; n++) {
+			_ftprintf(fout, _T("%-7s %s\n"), (result[n] == 1) ? _T("OK") : ((result[n] < 0) ? _T("ABORTED") : _T("FAILED")), file[n]);
+		}
+	}
+onEnd:
+	if (file != NULL) {
+		for (size_t n = argCount; n < count; n++) free(file[n]);
+		free(file);
+	}
+	if (result != NULL) free(result);
+	return res;
 }
 
 
@@ -82,7 +386,87 @@ int _tmain(int argc, TCHAR ** argv) {
  */
 void printHelp(void) {
 	_ftprintf(ferr,
-	_T("sm2pspp <g-code file>\n")
+	_T("sm2pspp [options] <g-code file> ...\n")
+	_T("sm2pspp [options] - < input.gcode > output.gcode\n")
+	_T("sm2pspp [options] --watch <directory>\n")
+	_T("sm2pspp [options] --serve <socket>\n")
+	_T("sm2pspp [options] --stream <device> <g-code file>\n")
+	_T("\n")
+	_T("Pass - as only file to read the G-Code from standard input and write the result\n")
+	_T("to standard output. The input is kept in memory up to the memory budget and\n")
+	_T("spooled to a temporary file beyond that (or always with --low-memory).\n")
+	_T("\n")
+	_T("-i, --in-place\n")
+	_T("      Insert the header at the start of the file without rewriting the G-Code if\n")
+	_T("      supported by the file system (e.g. ext4 or XFS on Linux).\n")
+	_T("-m, --low-memory\n")
+	_T("      Process the file in two passes through a fixed-size buffer instead of\n")
+	_T("      loading it completely. The memory usage is independent of the file size.\n")
+	_T("-w, --watch <directory>\n")
+	_T("      Process new G-Code files written or moved into the given directory until\n")
+	_T("      interrupted (Linux only). Already post-processed files are skipped.\n")
+	_T("--serve <socket>\n")
+	_T("      Keep running and process the files passed by other instances via the given\n")
+	_T("      local socket until interrupted (Linux only). The files of other instances\n")
+	_T("      are only handed over with --remote.\n")
+	_T("--remote\n")
+	_T("      Hand the files over to the server listening on $SM2PSPP_SOCKET or else on\n")
+	_T("      $XDG_RUNTIME_DIR/sm2pspp.sock (Linux only). The files are processed\n")
+	_T("      locally if no server is running. Cannot be combined with --jobs,\n")
+	_T("      --memory-budget, --io-depth, --stats, --upload or --stream.\n")
+	_T("--upload <url>\n")
+	_T("      Upload each processed file to the Snapmaker 2.0 terminal at the given URL\n")
+	_T("      (e.g. http://192.168.1.20:8080) while the local file is written (Linux\n")
+	_T("      only). Already processed files are uploaded as they are.\n")
+	_T("--token <token>\n")
+	_T("      Access token of the Snapmaker 2.0 terminal sent with each upload.\n")
+	_T("--stream <device>\n")
+	_T("      Stream the processed file to the printer connected to the given serial\n")
+	_T("      device (e.g. /dev/ttyACM0) with line numbers and checksums (Linux only).\n")
+	_T("      Reports the commands per second and the printer buffer underruns.\n")
+	_T("--baud <rate>\n")
+	_T("      Baud rate of the serial device. Defaults to ") _T2(TO_STR2(SR_DEFAULT_BAUD)) _T(".\n")
+	_T("--stream-window <number>\n")
+	_T("      Number of commands sent ahead of the printer responses. Should match the\n")
+	_T("      command buffer size of the firmware. Defaults to ") _T2(TO_STR2(SR_DEFAULT_WINDOW)) _T(".\n")
+	);
+	_ftprintf(ferr,
+	_T("-l, --from-list\n")
+	_T("      Read additional file paths from standard input. One path per line.\n")
+	_T("-j, --jobs <number>\n")
+	_T("      Number of files processed in parallel. Defaults to the number of cores.\n")
+	_T("-b, --memory-budget <MiB>\n")
+	_T("      Maximum size of all files processed in parallel. Larger files are processed\n")
+	_T("      one at a time. Defaults to ") _T2(TO_STR2(DEFAULT_MEMORY_BUDGET)) _T(" MiB. Set to 0 for no limit.\n")
+	_T("--io-depth <number>\n")
+	_T("      Read and write the given number of files concurrently via io_uring with a\n")
+	_T("      single processing thread (Linux only). Not used with --in-place or\n")
+	_T("      --low-memory. Defaults to 0 which disables it.\n")
+	_T("-s, --stats\n")
+	_T("      Output wall and CPU time per processing phase, throughput, peak memory usage\n")
+	_T("      and number of write system calls for each file to standard error.\n")
+	_T("      CPU time, memory usage and write calls are measured for the whole process.\n")
+	_T("      The upload time and throughput are added with --upload and the streaming\n")
+	_T("      time, commands per second, underruns and resends with --stream.\n")
+	_T("--stats-json\n")
+	_T("      Same as --stats but outputs a single line JSON object per file.\n")
+	_T("-p, --preview <iso|top>\n")
+	_T("      Render an isometric or top-down toolpath preview of ") _T2(TO_STR2(PV_WIDTH)) _T("x") _T2(TO_STR2(PV_HEIGHT)) _T(" pixels as\n")
+	_T("      thumbnail if the file contains none. Files larger than 256 MiB are sampled.\n")
+	_T("--thumbnail-select <width>x<height>\n")
+	_T("      Use the thumbnail closest to the given size if the file contains several.\n")
+	_T("      Defaults to ") _T2(TO_STR2(DEFAULT_THUMBNAIL_WIDTH)) _T("x") _T2(TO_STR2(DEFAULT_THUMBNAIL_HEIGHT)) _T(". All original thumbnails are removed.\n")
+	_T("-t, --thumbnail-recode\n")
+	_T("      Re-encode the thumbnail PNG image losslessly with optimized filters and\n")
+	_T("      compression to shrink the header. The original is kept if it is smaller.\n")
+	_T("--thumbnail-colors <number>\n")
+	_T("      Reduce the thumbnail to a palette of 2 to 256 colors (lossy).\n")
+	_T("--thumbnail-size <width>x<height>\n")
+	_T("      Resample the thumbnail to the given size. Pass 0 for width or height to\n")
+	_T("      keep the aspect ratio.\n")
+	_T("--thumbnail-max <bytes>\n")
+	_T("      Shrink the thumbnail until its Base64 encoded size does not exceed the given\n")
+	_T("      number of bytes.\n")
 	_T("\n")
 	_T("sm2pspp ") _T2(PROGRAM_VERSION_STR) _T("\n")
 	_T("https://github.com/daniel-starke/sm2pspp\n")
@@ -91,454 +475,241 @@ void printHelp(void) {
 
 
 /**
- * Helper function to compare the start of a token against a given string.
+ * Reads file paths line by line from the given file and appends them to the passed list. Empty
+ * lines are skipped. The appended paths are allocated.
  * 
- * @param[in] lhs - token to compare with
- * @param[in] rhs - string to compare with
- * @return same as strcmp
+ * @param[in,out] fp - input file
+ * @param[in,out] list - allocated list of file paths
+ * @param[in,out] count - number of entries in the list
+ * @param[in,out] capacity - number of allocated entries of the list
+ * @return 1 on success, 0 on allocation error
  */
-static int p_cmpTokenStart(const tPToken * lhs, const char * rhs) {
-	const size_t rhsLen = strlen(rhs);
-	tPToken aToken;
-	aToken.start = lhs->start;
-	aToken.length = (lhs->length > rhsLen) ? rhsLen : lhs->length;
-	return p_cmpToken(&aToken, rhs);
+int readFileList(FILE * fp, TCHAR *** list, size_t * count, size_t * capacity) {
+	TCHAR * line = NULL;
+	size_t lineSize = 256;
+	size_t len = 0;
+	line = (TCHAR *)malloc(lineSize * sizeof(TCHAR));
+	if (line == NULL) return 0;
+	while (_fgetts(line + len, (int)(lineSize - len), fp) != NULL) {
+		len += _tcslen(line + len);
+		if (len > 0 && line[len - 1] != _T('\n') && feof(fp) == 0) {
+			/* incomplete line */
+			if ((len + 1) >= lineSize) {
+				TCHAR * newLine = (TCHAR *)realloc(line, 2 * lineSize * sizeof(TCHAR));
+				if (newLine == NULL) goto onError;
+				line = newLine;
+				lineSize *= 2;
+			}
+			continue;
+		}
+		while (len > 0 && (line[len - 1] == _T('\n') || line[len - 1] == _T('\r'))) line[--len] = 0;
+		if (len > 0) {
+			if (*count >= *capacity) {
+				TCHAR ** newList = (TCHAR **)realloc(*list, 2 * (*capacity + 1) * sizeof(TCHAR *));
+				if (newList == NULL) goto onError;
+				*list = newList;
+				*capacity = 2 * (*capacity + 1);
+			}
+			(*list)[*count] = (TCHAR *)malloc((len + 1) * sizeof(TCHAR));
+			if ((*list)[*count] == NULL) goto onError;
+			memcpy((*list)[*count], line, (len + 1) * sizeof(TCHAR));
+			(*count)++;
+		}
+		len = 0;
+	}
+	free(line);
+	return 1;
+onError:
+	free(line);
+	return 0;
 }
 
 
+
 /**
- * Parses the given dhms time token and returns the value in seconds.
+ * Returns the socket path of a server started via --serve. This is the path given by the
+ * environment variable SM2PSPP_SOCKET or else sm2pspp.sock within XDG_RUNTIME_DIR.
  * 
- * @param[in] aToken - input token
- * @return time in seconds
+ * @return allocated socket path or NULL if not set
  */
-static size_t p_dtms(const tPToken * aToken) {
-	if (aToken->start == NULL || aToken->length <= 0) return 0;
-	size_t res = 0;
-	size_t val = 0;
-	for (size_t i = 0; i < aToken->length; i++) {
-		const char ch = aToken->start[i];
-		switch (ch) {
-		case '0': case '1': case '2': case '3': case '4':
-		case '5': case '6': case '7': case '8': case '9':
-			val = (val * 10) + ((size_t)(ch - '0'));
-			break;
-		case 'd':
-			res = res + (val * 86400);
-			val = 0;
-			break;
-		case 'h':
-			res = res + (val * 3600);
-			val = 0;
-			break;
-		case 'm':
-			res = res + (val * 60);
-			val = 0;
-			break;
-		case 's':
-			res = res + val;
-			val = 0;
-			break;
-		default:
-			break;
-		}
+TCHAR * defaultSocket(void) {
+	const TCHAR * path = _tgetenv(_T("SM2PSPP_SOCKET"));
+	const TCHAR * name = _T("");
+	TCHAR * res;
+	if (path == NULL) {
+		path = _tgetenv(_T("XDG_RUNTIME_DIR"));
+		name = _T("/sm2pspp.sock");
 	}
+	/* an empty value disables the server */
+	if (path == NULL || *path == 0) return NULL;
+	const size_t len = _tcslen(path);
+	const size_t nameLen = _tcslen(name);
+	res = (TCHAR *)malloc((len + nameLen + 1) * sizeof(TCHAR));
+	if (res == NULL) return NULL;
+	memcpy(res, path, len * sizeof(TCHAR));
+	memcpy(res + len, name, (nameLen + 1) * sizeof(TCHAR));
 	return res;
 }
 
 
 /**
- * Converts the given token into a float value. Simple float values are assumed.
+ * Error output callback for processFile().
  * 
- * @param[in] aToken - token to convert
- * @return float value from the token
+ * @param[in] msg - error message ID
+ * @param[in] file - input file path
+ * @param[in] line - input file path line number (0 if not applicable)
+ * @return 1 to continue, 0 to abort file processing
+ * @remarks File processing is always aborted on error.
+ * @remarks Each message is output with a single call to be safe for concurrent use.
  */
-static float p_float(const tPToken * aToken) {
-	if (aToken->start == NULL || aToken->length <= 0) return 0.0f;
-	size_t val = 0;
-	size_t frac = 0;
-	float fracDiv = 1.0f;
-	int isFrac = 0;
-	for (size_t i = 0; i < aToken->length; i++) {
-		const char ch = aToken->start[i];
-		switch (ch) {
-		case '0': case '1': case '2': case '3': case '4':
-		case '5': case '6': case '7': case '8': case '9':
-			if (isFrac == 0) {
-				val = (val * 10) + ((size_t)(ch - '0'));
-			} else {
-				frac = (frac * 10) + ((size_t)(ch - '0'));
-				fracDiv *= 10.0f;
-			}
-			break;
-		case '.':
-			isFrac = 1;
-			break;
-		default:
-			break;
-		}
+int errorCallback(const tMessage msg, const TCHAR * file, const size_t line) {
+	if (line > 0) {
+		_ftprintf(ferr, _T("%s:%u: %s"), file, (unsigned)line, fmsg[msg]);
+	} else {
+		_ftprintf(ferr, _T("%s: %s"), file, fmsg[msg]);
 	}
-	return (float)val + ((float)frac / fracDiv);
+	return 1;
 }
 
 
 /**
- * Processes the given PrusaSlicer generated G-Code file and converts
- * it into a Snapmaker 2.0 terminal compatible G-Code file.
+ * Returns the given nanoseconds in seconds.
  * 
- * @param[in] file - PrusaSlicer generated G-Code file
- * @param[in] cb - error output callback function
- * @return 1 on success, 0 on failure, -1 if aborted by callback function
+ * @param[in] ns - nanoseconds
+ * @return seconds
  */
-int processFile(const TCHAR * file, const tCallback cb) {
-#define ON_WARN(msg) do { \
-	if (cb(msg, file, lineNr) != 1) goto onError; \
-} while (0) \
+static double p_seconds(const uint64_t ns) {
+	return (double)ns / 1000000000.0;
+}
 
-#define ON_ERROR(msg) do { \
-	cb(msg, file, lineNr); \
-	goto onError; \
-} while (0)
 
-	if (file == NULL || cb == NULL) return 0;
-	int res = 0;
-	size_t lineNr = 1;
-	char * inputBuf = NULL;
-	size_t inputLen = 0;
-	FILE * fp = NULL;
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-	size_t origThumbnailLines = 0;
-	tPToken origThumbnail = {0};
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-	tPToken filamentUsed = {0};
-	tPToken layerHeight = {0};
-	tPToken estTime = {0};
-	tPToken nozzleTemp = {0};
-	tPToken plateTemp = {0};
-	tPToken maxX = {0};
-	tPToken maxY = {0};
-	tPToken maxZ = {0};
-	tPToken printSpeed = {0};
-	tPToken thumbnail = {0};
-	tPToken aToken = {0};
-	tPToken * valueToken = NULL;
-	const char * lineStart = NULL;
-	enum tState {
-		ST_LINE_START,
-		ST_FIND_LINE_START,
-		ST_COMMENT,
-		ST_PARAMETER_VALUE,
-		ST_THUMBNAIL
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-		, ST_THUMBNAIL_TAIL
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-	} state = ST_LINE_START;
-#ifdef DEBUG
-	static const TCHAR * stateStr[] = {
-		_T("ST_LINE_START"),
-		_T("ST_FIND_LINE_START"),
-		_T("ST_COMMENT"),
-		_T("ST_PARAMETER_VALUE"),
-		_T("ST_THUMBNAIL")
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-		, _T("ST_THUMBNAIL_TAIL")
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-	};
-#endif /* DEBUG */
-	
-	/* open input file for reading */
-	fp = _tfopen(file, _T("rb"));
-	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_OPEN);
-	
-	/* get file size */
-	fseeko64(fp, 0, SEEK_END);
-	inputLen = (size_t)ftello64(fp);
-	if (inputLen < 1) goto onSuccess;
-	fseek(fp, 0, SEEK_SET);
-	
-	/* allocate input buffer from file data */
-	inputBuf = (char *)malloc(inputLen);
-	if (inputBuf == NULL) ON_ERROR(MSGT_ERR_NO_MEM);
-	if (fread(inputBuf, inputLen, 1, fp) < 1) ON_ERROR(MSGT_ERR_FILE_READ);
-	
-	/* close input file */
-	fclose(fp);
-	fp = NULL;
-	
-	/* parse tokens */
-	lineStart = inputBuf;
-	for (const char * it = inputBuf, * endIt = inputBuf + inputLen; it < endIt; it++) {
-		const char ch = *it;
-#ifdef DEBUG
-		_ftprintf(ferr, _T("%u:%s: '%c'"), (unsigned)lineNr, stateStr[(int)state], ch);
-		if (aToken.start != NULL) {
-#ifdef UNICODE
-			_ftprintf(ferr, _T(", token: \"%.*S\""), (unsigned)aToken.length, aToken.start);
-#else /* not UNICODE */
-			_ftprintf(ferr, _T(", token: \"%.*s\""), (unsigned)aToken.length, aToken.start);
-#endif /* not UNICODE */
-		}
-		if (valueToken != NULL && valueToken->start != NULL) {
-#ifdef UNICODE
-			_ftprintf(ferr, _T(", value: \"%.*S\""), (unsigned)valueToken->length, valueToken->start);
-#else /* not UNICODE */
-			_ftprintf(ferr, _T(", value: \"%.*s\""), (unsigned)valueToken->length, valueToken->start);
-#endif /* not UNICODE */
-		}
-		_ftprintf(ferr, _T("\n"));
-#endif /* DEBUG */
-		switch (state) {
-		case ST_LINE_START:
-			 if (ch == ';') {
-				/* comment */
-				memset(&aToken, 0, sizeof(aToken));
-				state = ST_COMMENT;
-			} else if (isspace(ch) == 0) {
-				/* code */
-				state = ST_FIND_LINE_START;
-			}
-			/* spaces */
-			break;
-		case ST_FIND_LINE_START:
-			if (ch == '\n') {
-				/* new line */
-				state = ST_LINE_START;
-			}
-			break;
-		case ST_COMMENT:
-			if (ch == '\n') {
-				/* end of comment line */
-				state = ST_LINE_START;
-			} else if (aToken.start == NULL) {
-				if (isspace(ch) == 0) {
-					/* start of first word in comment */
-					aToken.start = it;
-					aToken.length = 1;
-				}
-			} else if (ch == ' ' && aToken.length > 0) {
-				if (p_cmpToken(&aToken, "post-processed by sm2pspp") == 0) {
-					/* already post-processed file */
-					goto onSuccess;
-				} else if (p_cmpToken(&aToken, "thumbnail begin") == 0) {
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-					if (origThumbnail.start == NULL) {
-						origThumbnail.start = lineStart;
-						origThumbnailLines = 1;
-					}
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-					memset(&aToken, 0, sizeof(aToken));
-					state = (thumbnail.start == NULL) ? ST_THUMBNAIL : ST_FIND_LINE_START;
-				}
-			} else if (ch == '=') {
-				/* end of commented parameter key */
-				if (aToken.length == 0) {
-					aToken.length = (size_t)(it - aToken.start);
-				}
-				if (p_cmpToken(&aToken, "filament used [mm]") == 0) {
-					valueToken = &filamentUsed;
-				} else if (p_cmpToken(&aToken, "layer_height") == 0) {
-					valueToken = &layerHeight;
-				} else if (p_cmpTokenStart(&aToken, "estimated printing time") == 0) {
-					valueToken = &estTime;
-				} else if (p_cmpToken(&aToken, "first_layer_temperature") == 0) {
-					valueToken = &nozzleTemp;
-				} else if (p_cmpToken(&aToken, "first_layer_bed_temperature") == 0) {
-					valueToken = &plateTemp;
-				} else if (p_cmpToken(&aToken, "max_print_speed") == 0) {
-					valueToken = &printSpeed;
-				} else if (p_cmpToken(&aToken, "max_x") == 0) {
-					valueToken = &maxX;
-				} else if (p_cmpToken(&aToken, "max_y") == 0) {
-					valueToken = &maxY;
-				} else if (p_cmpToken(&aToken, "max_z") == 0) {
-					valueToken = &maxZ;
-				} else {
-					state = ST_FIND_LINE_START;
-				}
-				if (valueToken != NULL) {
-					memset(&aToken, 0, sizeof(aToken));
-					if (valueToken->start == NULL) {
-						state = ST_PARAMETER_VALUE;
-					} else {
-						/* ignore duplicate keys */
-						valueToken = NULL;
-						state = ST_FIND_LINE_START;
-					}
-				}
-			} else if (isspace(ch) == 0) {
-				/* ignore trailing spaces */
-				aToken.length = (size_t)(it - aToken.start + 1);
-			}
-			break;
-		case ST_PARAMETER_VALUE:
-			if (ch == '\n') {
-				/* end of comment line */
-				valueToken = NULL;
-				state = ST_LINE_START;
-			} else if (valueToken->start == NULL) {
-				if (isspace(ch) == 0) {
-					/* start of comment parameter value */
-					valueToken->start = it;
-					valueToken->length = 1;
-				}
-			} else if (isspace(ch) == 0) {
-				/* ignore trailing spaces */
-				valueToken->length = (size_t)(it - valueToken->start + 1);
-			}
-			break;
-		case ST_THUMBNAIL:
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-			if (ch == '\n') {
-				/* count thumbnail lines to compensate cut */
-				origThumbnailLines++;
-			}
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-			if (thumbnail.start == NULL) {
-				if (ch == '\n') {
-					/* start of thumbnail data */
-					thumbnail.start = it + 1;
-				}
-			} else if (ch == ';') {
-				/* start of comment */
-				aToken.start = it + 1;
-				aToken.length = 0;
-			} else if (aToken.start != NULL) {
-				if (isspace(aToken.start[0]) != 0) {
-					/* ignore leading spaces */
-					aToken.start = it;
-					aToken.length = 1;
-				} else {
-					aToken.length++;
-					if (p_cmpToken(&aToken, "thumbnail end") == 0) {
-						/* got complete Base64 encoded thumbnail image data (PNG) */
-						thumbnail.length = (size_t)(lineStart - thumbnail.start);
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-						origThumbnail.length = (size_t)(it - origThumbnail.start);
-						state = ST_THUMBNAIL_TAIL;
-#else /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
-						state = ST_FIND_LINE_START;
-#endif /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
-					}
-				}
-			}
-			break;
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-		case ST_THUMBNAIL_TAIL:
-			if (ch == '\n') {
-				/* new line */
-				origThumbnail.length = (size_t)(it + 1 - origThumbnail.start);
-				state = ST_LINE_START;
-			}
-			break;
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-		}
-		if (ch == '\n') {
-			lineNr++;
-			lineStart = it + 1;
-		} else if (ch == '\r') {
-			lineStart = it + 1;
-		}
-	}
-	
-	/* check missing tokens */
-	if (filamentUsed.start == NULL || filamentUsed.length == 0) ON_WARN(MSGT_WARN_NO_FILAMENT_USED);
-	if (layerHeight.start == NULL || layerHeight.length == 0) ON_WARN(MSGT_WARN_NO_LAYER_HEIGHT);
-	if (estTime.start == NULL || estTime.length == 0) ON_WARN(MSGT_WARN_NO_EST_TIME);
-	if (nozzleTemp.start == NULL || nozzleTemp.length == 0) ON_WARN(MSGT_WARN_NO_NOZZLE_TEMP);
-	if (plateTemp.start == NULL || plateTemp.length == 0) ON_WARN(MSGT_WARN_NO_PLATE_TEMP);
-	if (printSpeed.start == NULL || printSpeed.length == 0) ON_WARN(MSGT_WARN_NO_PRINT_SPEED);
-	if (thumbnail.start == NULL || thumbnail.length == 0) ON_WARN(MSGT_WARN_NO_THUMBNAIL);
-	if (maxX.start == NULL || maxX.length == 0) ON_WARN(MSGT_WARN_NO_MAX_SIZE);
-	if (maxY.start == NULL || maxY.length == 0) ON_WARN(MSGT_WARN_NO_MAX_SIZE);
-	if (maxZ.start == NULL || maxZ.length == 0) ON_WARN(MSGT_WARN_NO_MAX_SIZE);
-	
-	/* re-create file */
-	fp = _tfopen(file, _T("wb"));
-	if (fp == NULL) ON_ERROR(MSGT_ERR_FILE_CREATE);
-	
-	/* output Snapmaker 2.0 specific start header */
-	clearerr(fp);
-	fprintf(fp, ";post-processed by sm2pspp (https://github.com/daniel-starke/sm2pspp)\n");
-	fprintf(fp, ";Header Start\n\n");
-	fprintf(fp, ";FLAVOR:Marlin\n");
-	fprintf(fp, ";TIME:6666\n\n\n");
-	fprintf(fp, ";Filament used: %.0fm\n", p_float(&filamentUsed) / 1000.0f);
-	fprintf(fp, ";Layer height: %.2f\n", p_float(&layerHeight));
-	fprintf(fp, ";header_type: 3dp\n");
-	if (thumbnail.start != NULL || thumbnail.length > 0) {
-		/* output thumbnail */
-		fprintf(fp, ";thumbnail: data:image/png;base64,");
-		memset(&aToken, 0, sizeof(aToken));
-		for (size_t i = 0; i < thumbnail.length; i++) {
-			const char ch = thumbnail.start[i];
-			if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '+' || ch == '/' || ch == '=') {
-				if (aToken.start == NULL) aToken.start = thumbnail.start + i;
-				aToken.length++;
-			} else {
-				if (aToken.start != NULL && aToken.length > 0) {
-					fwrite(aToken.start, aToken.length, 1, fp);
-					memset(&aToken, 0, sizeof(aToken));
-				}
-			}
-		}
-		fprintf(fp, "\n");
+/**
+ * Returns the throughput of the given statistics.
+ * 
+ * @param[in] stats - processing statistics
+ * @return MiB per second
+ */
+static double p_throughput(const tStats * stats) {
+	const uint64_t wall = st_wallTime(stats);
+	return (wall > 0) ? ((double)(stats->bytes) / 1048576.0) / p_seconds(wall) : 0.0;
+}
+
+
+/**
+ * Returns the upload throughput of the given statistics.
+ * 
+ * @param[in] stats - processing statistics
+ * @return MiB per second
+ */
+static double p_uploadThroughput(const tStats * stats) {
+	return (stats->uploadWall > 0) ? ((double)(stats->uploadBytes) / 1048576.0) / p_seconds(stats->uploadWall) : 0.0;
+}
+
+
+/**
+ * Returns the streaming rate of the given statistics.
+ * 
+ * @param[in] stats - processing statistics
+ * @return commands per second
+ */
+static double p_streamRate(const tStats * stats) {
+	return (stats->streamWall > 0) ? (double)(stats->streamCommands) / p_seconds(stats->streamWall) : 0.0;
+}
+
+
+/**
+ * Statistics callback for processFile(). Outputs a single human readable line to ferr.
+ * 
+ * @param[in] file - input file path
+ * @param[in] stats - processing statistics
+ * @remarks Each line is output with a single call to be safe for concurrent use.
+ */
+void statsCallback(const TCHAR * file, const tStats * stats) {
+	TCHAR upload[96] = {0};
+	TCHAR stream[160] = {0};
+	if (stats->uploadWall > 0) {
+		_sntprintf(upload, 96, _T(", upload ") UINT64_FMT _T(" bytes in %.3f s, %.1f MB/s"),
+			stats->uploadBytes, p_seconds(stats->uploadWall), p_uploadThroughput(stats)
+		);
 	}
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-	fprintf(fp, ";file_total_lines: %lu\n", (unsigned long)(lineNr + 25 - origThumbnailLines));
-#else /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
-	fprintf(fp, ";file_total_lines: %lu\n", (unsigned long)(lineNr + 25));
-#endif /* !FEATURE_REMOVE_ORIG_THUMBNAIL */
-	fprintf(fp, ";estimated_time(s): %.0f\n", (float)p_dtms(&estTime));
-	fprintf(fp, ";nozzle_temperature(°C): %.0f\n", p_float(&nozzleTemp));
-	fprintf(fp, ";build_plate_temperature(°C): %.0f\n", p_float(&plateTemp));
-	fprintf(fp, ";work_speed(mm/minute): %.0f\n", p_float(&printSpeed) * 60.0f);
-	fprintf(fp, ";max_x(mm): %.2f\n", p_float(&maxX));
-	fprintf(fp, ";max_y(mm): %.2f\n", p_float(&maxY));
-	fprintf(fp, ";max_z(mm): %.2f\n", p_float(&maxZ));
-	fprintf(fp, ";min_x(mm): 0\n"); /* not set by Snapmaker Luban */
-	fprintf(fp, ";min_y(mm): 0\n"); /* not set by Snapmaker Luban */
-	fprintf(fp, ";min_z(mm): 0\n\n"); /* not set by Snapmaker Luban */
-	fprintf(fp, ";Header End\n\n", p_float(&printSpeed) * 60.0f);
-	if (ferror(fp) != 0) ON_ERROR(MSGT_ERR_FILE_WRITE);
-	
-	/* output remaining file */
-#ifdef FEATURE_REMOVE_ORIG_THUMBNAIL
-	if (origThumbnail.start != NULL && origThumbnail.length != 0) {
-		/* cut out original thumbnail */
-		const char * thumbnailEndIt = origThumbnail.start + origThumbnail.length;
-		if (fwrite(inputBuf, (size_t)(origThumbnail.start - inputBuf), 1, fp) < 1) ON_ERROR(MSGT_ERR_FILE_WRITE);
-		if (fwrite(thumbnailEndIt, (size_t)(inputLen - (thumbnailEndIt - inputBuf)), 1, fp) < 1) ON_ERROR(MSGT_ERR_FILE_WRITE);
-	} else
-#endif /* FEATURE_REMOVE_ORIG_THUMBNAIL */
-	{
-		if (fwrite(inputBuf, inputLen, 1, fp) < 1) ON_ERROR(MSGT_ERR_FILE_WRITE);
+	if (stats->streamCommands > 0) {
+		_sntprintf(stream, 160, _T(", stream ") UINT64_FMT _T(" commands in %.3f s, %.1f commands/s, ")
+			UINT64_FMT _T(" underruns, ") UINT64_FMT _T(" resends"),
+			stats->streamCommands, p_seconds(stats->streamWall), p_streamRate(stats),
+			stats->streamUnderruns, stats->streamResends
+		);
 	}
-onSuccess:
-	res = 1;
-onError:
-	if (fp != NULL) fclose(fp);
-	if (inputBuf != NULL) free(inputBuf);
-	return res;
-	
-#undef ON_WARN
-#undef ON_ERROR
+	_ftprintf(ferr, _T("%s: read %.3f/%.3f s, scan %.3f/%.3f s, header %.3f/%.3f s, body %.3f/%.3f s (wall/CPU), ")
+		UINT64_FMT _T(" bytes, ") UINT64_FMT _T(" lines, %.1f MB/s, peak RSS ") UINT64_FMT _T(" KiB, ")
+		UINT64_FMT _T(" write calls%s%s\n"),
+		file,
+		p_seconds(stats->phase[ST_PHASE_READ].wall), p_seconds(stats->phase[ST_PHASE_READ].cpu),
+		p_seconds(stats->phase[ST_PHASE_SCAN].wall), p_seconds(stats->phase[ST_PHASE_SCAN].cpu),
+		p_seconds(stats->phase[ST_PHASE_HEADER].wall), p_seconds(stats->phase[ST_PHASE_HEADER].cpu),
+		p_seconds(stats->phase[ST_PHASE_BODY].wall), p_seconds(stats->phase[ST_PHASE_BODY].cpu),
+		stats->bytes, stats->lines, p_throughput(stats), stats->peakRss / 1024, stats->writeCalls, upload, stream
+	);
 }
 
 
 /**
- * Error output callback for processFile().
+ * Statistics callback for processFile(). Outputs a single line JSON object to ferr.
  * 
- * @param[in] msg - error message ID
  * @param[in] file - input file path
- * @param[in] line - input file path line number (0 if not applicable)
- * @return 1 to continue, 0 to abort file processing
- * @remarks File processing is always aborted on error.
+ * @param[in] stats - processing statistics
+ * @remarks Each line is output with a single call to be safe for concurrent use.
  */
-int errorCallback(const tMessage msg, const TCHAR * file, const size_t line) {
-	if (line > 0) {
-		_ftprintf(ferr, _T("%s:%u: %s"), file, (unsigned)line, fmsg[msg]);
-	} else {
-		_ftprintf(ferr, _T("%s: %s"), file, fmsg[msg]);
+void statsJsonCallback(const TCHAR * file, const tStats * stats) {
+	/* escape the file path as JSON string */
+	const size_t len = _tcslen(file);
+	TCHAR * path = (TCHAR *)malloc(((6 * len) + 1) * sizeof(TCHAR));
+	if (path == NULL) return;
+	TCHAR * ptr = path;
+	for (size_t i = 0; i < len; i++) {
+		if (file[i] == _T('"') || file[i] == _T('\\')) {
+			*ptr++ = _T('\\');
+			*ptr++ = file[i];
+		} else if ((unsigned)(file[i]) < 0x20) {
+			ptr += _sntprintf(ptr, 7, _T("\\u%04x"), (unsigned)(file[i]));
+		} else {
+			*ptr++ = file[i];
+		}
 	}
-	return 1;
+	*ptr = 0;
+	_ftprintf(ferr, _T("{\"file\":\"%s\",\"bytes\":") UINT64_FMT _T(",\"lines\":") UINT64_FMT
+		_T(",\"wall_s\":%.6f,\"cpu_s\":%.6f,\"mb_s\":%.3f,\"peak_rss_kib\":") UINT64_FMT _T(",\"write_calls\":") UINT64_FMT
+		_T(",\"phases\":{\"read\":{\"wall_s\":%.6f,\"cpu_s\":%.6f},\"scan\":{\"wall_s\":%.6f,\"cpu_s\":%.6f}")
+		_T(",\"header\":{\"wall_s\":%.6f,\"cpu_s\":%.6f},\"body\":{\"wall_s\":%.6f,\"cpu_s\":%.6f}}")
+		_T(",\"upload\":{\"bytes\":") UINT64_FMT _T(",\"wall_s\":%.6f,\"mb_s\":%.3f}")
+		_T(",\"stream\":{\"commands\":") UINT64_FMT _T(",\"wall_s\":%.6f,\"commands_s\":%.3f,\"underruns\":") UINT64_FMT
+		_T(",\"resends\":") UINT64_FMT _T("}}\n"),
+		path, stats->bytes, stats->lines,
+		p_seconds(st_wallTime(stats)), p_seconds(st_cpuTime(stats)), p_throughput(stats),
+		stats->peakRss / 1024, stats->writeCalls,
+		p_seconds(stats->phase[ST_PHASE_READ].wall), p_seconds(stats->phase[ST_PHASE_READ].cpu),
+		p_seconds(stats->phase[ST_PHASE_SCAN].wall), p_seconds(stats->phase[ST_PHASE_SCAN].cpu),
+		p_seconds(stats->phase[ST_PHASE_HEADER].wall), p_seconds(stats->phase[ST_PHASE_HEADER].cpu),
+		p_seconds(stats->phase[ST_PHASE_BODY].wall), p_seconds(stats->phase[ST_PHASE_BODY].cpu),
+		stats->uploadBytes, p_seconds(stats->uploadWall), p_uploadThroughput(stats),
+		stats->streamCommands, p_seconds(stats->streamWall), p_streamRate(stats),
+		stats->streamUnderruns, stats->streamResends
+	);
+	free(path);
+}
+
+
+/**
+ * Statistics callback for processFile() with --stream but without --stats. Outputs the streaming
+ * statistics as single human readable line to fout.
+ * 
+ * @param[in] file - input file path
+ * @param[in] stats - processing statistics
+ */
+void streamCallback(const TCHAR * file, const tStats * stats) {
+	if (stats->streamCommands == 0) return;
+	_ftprintf(fout, _T("%s: streamed ") UINT64_FMT _T(" commands in %.3f s, %.1f commands/s, ")
+		UINT64_FMT _T(" buffer underruns, ") UINT64_FMT _T(" resends\n"),
+		file, stats->streamCommands, p_seconds(stats->streamWall), p_streamRate(stats),
+		stats->streamUnderruns, stats->streamResends
+	);
 }
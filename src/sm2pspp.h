@@ -2,7 +2,7 @@
  * @file sm2pspp.h
  * @author Daniel Starke
  * @date 2021-01-30
- * @version 2021-02-12
+ * @version 2026-10-16
  * 
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -20,60 +20,34 @@
 #ifndef __SM2PSPP_H__
 #define __SM2PSPP_H__
 
-#include <ctype.h>
-#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "parser.h"
+#include "libsm2pspp.h"
 #include "target.h"
+#include "serial.h"
 #include "tchar.h"
+#include "upload.h"
 #include "version.h"
-
-
-/** Input line buffer size. */
-#define LINE_BUFFER_SIZE 0x80000
-
-
-/** The original thumbnail is removed if this macro is defined. */
-#define FEATURE_REMOVE_ORIG_THUMBNAIL 1
-
-
-/** Enumeration of possible error values. */
-typedef enum {
-	MSGT_SUCCESS = 0,
-	MSGT_ERR_NO_MEM,
-	MSGT_ERR_FILE_NOT_FOUND,
-	MSGT_ERR_FILE_OPEN,
-	MSGT_ERR_FILE_READ,
-	MSGT_ERR_FILE_CREATE,
-	MSGT_ERR_FILE_WRITE,
-	MSGT_WARN_NO_FILAMENT_USED,
-	MSGT_WARN_NO_LAYER_HEIGHT,
-	MSGT_WARN_NO_EST_TIME,
-	MSGT_WARN_NO_NOZZLE_TEMP,
-	MSGT_WARN_NO_PLATE_TEMP,
-	MSGT_WARN_NO_PRINT_SPEED,
-	MSGT_WARN_NO_THUMBNAIL,
-	MSGT_WARN_NO_MAX_SIZE,
-	MSG_COUNT
-} tMessage;
-
-
-/** Error callback type. */
-typedef int (* tCallback)(const tMessage msg, const TCHAR * file, const size_t line);
+#ifdef PCF_IS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif /* PCF_IS_WIN */
 
 
 extern FILE * fin;
 extern FILE * fout;
 extern FILE * ferr;
-extern const TCHAR * fmsg[MSG_COUNT];
 
 
 /* helper functions */
 void printHelp(void);
-int processFile(const TCHAR * file, const tCallback cb);
+int readFileList(FILE * fp, TCHAR *** list, size_t * count, size_t * capacity);
+TCHAR * defaultSocket(void);
 int errorCallback(const tMessage msg, const TCHAR * file, const size_t line);
+void statsCallback(const TCHAR * file, const tStats * stats);
+void statsJsonCallback(const TCHAR * file, const tStats * stats);
+void streamCallback(const TCHAR * file, const tStats * stats);
 
 
 #endif /* __SM2PSPP_H__ */
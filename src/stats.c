@@ -0,0 +1,185 @@
+/**
+ * @file stats.c
+ * @author Daniel Starke
+ * @see stats.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+#ifdef PCF_IS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else /* PCF_IS_NO_WIN */
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif /* PCF_IS_NO_WIN */
+
+
+/**
+ * Samples the current wall clock and process CPU time.
+ *
+ * @param[out] now - receives the current times in nanoseconds
+ */
+static void st_now(tStatsTime * now) {
+#ifdef PCF_IS_WIN
+	LARGE_INTEGER counter, freq;
+	FILETIME creationTime, exitTime, kernel, user;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&freq);
+	now->wall = (uint64_t)((double)(counter.QuadPart) * (1000000000.0 / (double)(freq.QuadPart)));
+	now->cpu = 0;
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernel, &user) != 0) {
+		/* 100 nanosecond units */
+		now->cpu = ((((uint64_t)(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime)
+			+ (((uint64_t)(user.dwHighDateTime) << 32) | user.dwLowDateTime)) * 100;
+	}
+#else /* PCF_IS_NO_WIN */
+	struct timespec ts;
+	now->wall = 0;
+	now->cpu = 0;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		now->wall = ((uint64_t)(ts.tv_sec) * 1000000000) + (uint64_t)(ts.tv_nsec);
+	}
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+		now->cpu = ((uint64_t)(ts.tv_sec) * 1000000000) + (uint64_t)(ts.tv_nsec);
+	}
+#endif /* CLOCK_PROCESS_CPUTIME_ID */
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Returns the number of write system calls issued by this process so far.
+ *
+ * @return number of write system calls or 0 if unknown
+ */
+static uint64_t st_writeCalls(void) {
+#ifdef PCF_IS_WIN
+	IO_COUNTERS io;
+	if (GetProcessIoCounters(GetCurrentProcess(), &io) == 0) return 0;
+	return (uint64_t)(io.WriteOperationCount);
+#elif defined(PCF_IS_LINUX)
+	char line[64];
+	unsigned long long value = 0;
+	FILE * fp = fopen("/proc/self/io", "r");
+	if (fp == NULL) return 0;
+	while (fgets(line, (int)sizeof(line), fp) != NULL) {
+		if (sscanf(line, "syscw: %llu", &value) == 1) break;
+	}
+	fclose(fp);
+	return (uint64_t)value;
+#else /* unknown */
+	return 0;
+#endif /* unknown */
+}
+
+
+/**
+ * Returns the peak resident set size of this process.
+ *
+ * @return peak resident set size in bytes or 0 if unknown
+ */
+static uint64_t st_peakRss(void) {
+#ifdef PCF_IS_WIN
+	PROCESS_MEMORY_COUNTERS mem;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &mem, sizeof(mem)) == 0) return 0;
+	return (uint64_t)(mem.PeakWorkingSetSize);
+#else /* PCF_IS_NO_WIN */
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0) return 0;
+#ifdef __APPLE__
+	return (uint64_t)(usage.ru_maxrss);
+#else /* !__APPLE__ */
+	return (uint64_t)(usage.ru_maxrss) * 1024;
+#endif /* !__APPLE__ */
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Resets the given statistics and starts measuring with the read phase.
+ *
+ * @param[out] stats - statistics to initialize (ignored if NULL)
+ */
+void st_begin(tStats * stats) {
+	if (stats == NULL) return;
+	memset(stats, 0, sizeof(*stats));
+	stats->current = ST_PHASE_READ;
+	stats->writeMark = st_writeCalls();
+	st_now(&(stats->mark));
+}
+
+
+/**
+ * Accounts the time since the last phase change to the current phase and switches to the given
+ * phase.
+ *
+ * @param[in,out] stats - statistics (ignored if NULL)
+ * @param[in] phase - next phase
+ */
+void st_enter(tStats * stats, const tStatsPhase phase) {
+	tStatsTime now;
+	if (stats == NULL) return;
+	st_now(&now);
+	stats->phase[stats->current].wall += now.wall - stats->mark.wall;
+	stats->phase[stats->current].cpu += now.cpu - stats->mark.cpu;
+	stats->current = phase;
+	stats->mark = now;
+}
+
+
+/**
+ * Finishes the measurement. The process-wide values are sampled here.
+ *
+ * @param[in,out] stats - statistics (ignored if NULL)
+ */
+void st_end(tStats * stats) {
+	if (stats == NULL) return;
+	st_enter(stats, stats->current);
+	stats->peakRss = st_peakRss();
+	stats->writeCalls = st_writeCalls();
+	stats->writeCalls = (stats->writeCalls >= stats->writeMark) ? stats->writeCalls - stats->writeMark : 0;
+}
+
+
+/**
+ * Returns the total wall clock time of all phases.
+ *
+ * @param[in] stats - statistics
+ * @return wall clock time in nanoseconds
+ */
+uint64_t st_wallTime(const tStats * stats) {
+	uint64_t res = 0;
+	for (int i = 0; i < ST_PHASE_COUNT; i++) res += stats->phase[i].wall;
+	return res;
+}
+
+
+/**
+ * Returns the total process CPU time of all phases.
+ *
+ * @param[in] stats - statistics
+ * @return process CPU time in nanoseconds
+ */
+uint64_t st_cpuTime(const tStats * stats) {
+	uint64_t res = 0;
+	for (int i = 0; i < ST_PHASE_COUNT; i++) res += stats->phase[i].cpu;
+	return res;
+}
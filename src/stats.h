@@ -0,0 +1,82 @@
+/**
+ * @file stats.h
+ * @author Daniel Starke
+ * @see stats.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdint.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Processing phases measured separately. */
+typedef enum {
+	ST_PHASE_READ = 0,         /**< open and read the input */
+	ST_PHASE_SCAN,             /**< tokenize the input */
+	ST_PHASE_HEADER,           /**< check values and emit the header */
+	ST_PHASE_BODY,             /**< write the body and finish the output */
+	ST_PHASE_COUNT
+} tStatsPhase;
+
+
+/** Time spent in a single phase. */
+typedef struct {
+	uint64_t wall;             /**< wall clock time in nanoseconds */
+	uint64_t cpu;              /**< process CPU time in nanoseconds */
+} tStatsTime;
+
+
+/** Processing statistics of a single file. */
+typedef struct {
+	tStatsTime phase[ST_PHASE_COUNT]; /**< time spent per phase */
+	uint64_t bytes;            /**< number of input bytes processed */
+	uint64_t lines;            /**< number of input lines counted */
+	uint64_t peakRss;          /**< peak resident set size of the process in bytes (0 if unknown) */
+	uint64_t writeCalls;       /**< number of write system calls of the process (0 if unknown) */
+	uint64_t uploadBytes;      /**< number of bytes uploaded (0 if not uploaded) */
+	uint64_t uploadWall;       /**< wall clock time of the upload in nanoseconds */
+	uint64_t streamCommands;   /**< number of commands streamed to the printer (0 if not streamed) */
+	uint64_t streamResends;    /**< number of commands sent again on request of the printer */
+	uint64_t streamUnderruns;  /**< number of times the printer ran out of commands while streaming */
+	uint64_t streamWall;       /**< wall clock time of the streaming in nanoseconds */
+	/* internal state */
+	tStatsPhase current;       /**< current phase */
+	tStatsTime mark;           /**< start of the current phase */
+	uint64_t writeMark;        /**< write system calls at start */
+} tStats;
+
+
+void st_begin(tStats * stats);
+void st_enter(tStats * stats, const tStatsPhase phase);
+void st_end(tStats * stats);
+uint64_t st_wallTime(const tStats * stats);
+uint64_t st_cpuTime(const tStats * stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __STATS_H__ */
@@ -2,7 +2,7 @@
  * @file tchar.h
  * @author Daniel Starke
  * @date 2014-05-04
- * @version 2021-02-01
+ * @version 2026-10-16
  * 
  * DISCLAIMER
  * This file has no copyright assigned and is placed in the Public Domain.
@@ -64,6 +64,7 @@ typedef wchar_t TCHAR;
 #define _tstat wstat
 #define _trename _wrename
 #define _tcserror _wcserror
+#define _tgetenv _wgetenv
 
 #else /* not UNICODE */
 typedef char TCHAR;
@@ -92,6 +93,7 @@ typedef char TCHAR;
 #define _tstat stat
 #define _trename rename
 #define _tcserror strerror
+#define _tgetenv getenv
 
 #endif /* not UNICODE */
 
@@ -124,6 +126,7 @@ extern __attribute__((__dllimport__)) FILE * _wfopen(const wchar_t *, const wcha
 #   define wstat _wstat
 #  endif /* !defined(_O_U16TEXT) && !defined(__MINGW64__) */
 # endif /* UNICODE */
+# include <inttypes.h>
 # define UINT64_FMT _T("%" PRIu64)
 #endif /* not _MSC_VER */
 
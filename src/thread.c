@@ -0,0 +1,234 @@
+/**
+ * @file thread.c
+ * @author Daniel Starke
+ * @see thread.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include "thread.h"
+#ifdef PCF_IS_WIN
+#include <process.h>
+#else /* PCF_IS_NO_WIN */
+#include <unistd.h>
+#endif /* PCF_IS_NO_WIN */
+
+
+/** Thread start parameters. */
+typedef struct {
+	tThreadFn fn;              /**< thread entry point */
+	void * arg;                /**< user argument */
+} tThreadStart;
+
+
+#ifdef PCF_IS_WIN
+/**
+ * Native thread entry point. Calls the user entry point.
+ *
+ * @param[in] param - allocated thread start parameters (freed here)
+ * @return always 0
+ */
+static unsigned __stdcall th_start(void * param) {
+#else /* PCF_IS_NO_WIN */
+static void * th_start(void * param) {
+#endif /* PCF_IS_NO_WIN */
+	tThreadStart start = *((tThreadStart *)param);
+	free(param);
+	start.fn(start.arg);
+	return 0;
+}
+
+
+/**
+ * Creates a new thread which executes the given function.
+ *
+ * @param[out] thread - receives the thread handle
+ * @param[in] fn - thread entry point
+ * @param[in] arg - argument passed to the entry point
+ * @return 1 on success, 0 on error
+ */
+int th_create(tThread * thread, tThreadFn fn, void * arg) {
+	if (thread == NULL || fn == NULL) return 0;
+	tThreadStart * start = (tThreadStart *)malloc(sizeof(tThreadStart));
+	if (start == NULL) return 0;
+	start->fn = fn;
+	start->arg = arg;
+#ifdef PCF_IS_WIN
+	*thread = (HANDLE)_beginthreadex(NULL, 0, th_start, start, 0, NULL);
+	if (*thread == NULL) {
+#else /* PCF_IS_NO_WIN */
+	if (pthread_create(thread, NULL, th_start, start) != 0) {
+#endif /* PCF_IS_NO_WIN */
+		free(start);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Waits for the given thread to finish and releases its resources.
+ *
+ * @param[in,out] thread - thread handle
+ */
+void th_join(tThread * thread) {
+	if (thread == NULL) return;
+#ifdef PCF_IS_WIN
+	WaitForSingleObject(*thread, INFINITE);
+	CloseHandle(*thread);
+#else /* PCF_IS_NO_WIN */
+	pthread_join(*thread, NULL);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Initializes the given mutex.
+ *
+ * @param[out] mutex - mutex to initialize
+ * @return 1 on success, 0 on error
+ */
+int th_mutexInit(tMutex * mutex) {
+	if (mutex == NULL) return 0;
+#ifdef PCF_IS_WIN
+	InitializeCriticalSection(mutex);
+	return 1;
+#else /* PCF_IS_NO_WIN */
+	return (pthread_mutex_init(mutex, NULL) == 0) ? 1 : 0;
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Releases the resources of the given mutex.
+ *
+ * @param[in,out] mutex - mutex to destroy
+ */
+void th_mutexDestroy(tMutex * mutex) {
+	if (mutex == NULL) return;
+#ifdef PCF_IS_WIN
+	DeleteCriticalSection(mutex);
+#else /* PCF_IS_NO_WIN */
+	pthread_mutex_destroy(mutex);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Locks the given mutex.
+ *
+ * @param[in,out] mutex - mutex to lock
+ */
+void th_lock(tMutex * mutex) {
+#ifdef PCF_IS_WIN
+	EnterCriticalSection(mutex);
+#else /* PCF_IS_NO_WIN */
+	pthread_mutex_lock(mutex);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Unlocks the given mutex.
+ *
+ * @param[in,out] mutex - mutex to unlock
+ */
+void th_unlock(tMutex * mutex) {
+#ifdef PCF_IS_WIN
+	LeaveCriticalSection(mutex);
+#else /* PCF_IS_NO_WIN */
+	pthread_mutex_unlock(mutex);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Initializes the given condition variable.
+ *
+ * @param[out] cond - condition variable to initialize
+ * @return 1 on success, 0 on error
+ */
+int th_condInit(tCondition * cond) {
+	if (cond == NULL) return 0;
+#ifdef PCF_IS_WIN
+	InitializeConditionVariable(cond);
+	return 1;
+#else /* PCF_IS_NO_WIN */
+	return (pthread_cond_init(cond, NULL) == 0) ? 1 : 0;
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Releases the resources of the given condition variable.
+ *
+ * @param[in,out] cond - condition variable to destroy
+ */
+void th_condDestroy(tCondition * cond) {
+	if (cond == NULL) return;
+#ifdef PCF_IS_NO_WIN
+	pthread_cond_destroy(cond);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Waits for the given condition variable to be signaled. The passed mutex needs to be locked and
+ * is locked again on return.
+ *
+ * @param[in,out] cond - condition variable
+ * @param[in,out] mutex - associated mutex
+ */
+void th_condWait(tCondition * cond, tMutex * mutex) {
+#ifdef PCF_IS_WIN
+	SleepConditionVariableCS(cond, mutex, INFINITE);
+#else /* PCF_IS_NO_WIN */
+	pthread_cond_wait(cond, mutex);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Wakes all threads waiting for the given condition variable.
+ *
+ * @param[in,out] cond - condition variable
+ */
+void th_condBroadcast(tCondition * cond) {
+#ifdef PCF_IS_WIN
+	WakeAllConditionVariable(cond);
+#else /* PCF_IS_NO_WIN */
+	pthread_cond_broadcast(cond);
+#endif /* PCF_IS_NO_WIN */
+}
+
+
+/**
+ * Returns the number of online processor cores.
+ *
+ * @return number of cores (at least 1)
+ */
+size_t th_cpuCount(void) {
+#ifdef PCF_IS_WIN
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? (size_t)(info.dwNumberOfProcessors) : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	const long res = sysconf(_SC_NPROCESSORS_ONLN);
+	return (res > 0) ? (size_t)res : 1;
+#else /* no processor count */
+	return 1;
+#endif /* no processor count */
+}
@@ -0,0 +1,71 @@
+/**
+ * @file thread.h
+ * @author Daniel Starke
+ * @see thread.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#include <stddef.h>
+#include "target.h"
+#ifdef PCF_IS_WIN
+#include <windows.h>
+#else /* PCF_IS_NO_WIN */
+#include <pthread.h>
+#endif /* PCF_IS_NO_WIN */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef PCF_IS_WIN
+typedef HANDLE tThread;
+typedef CRITICAL_SECTION tMutex;
+typedef CONDITION_VARIABLE tCondition;
+#else /* PCF_IS_NO_WIN */
+typedef pthread_t tThread;
+typedef pthread_mutex_t tMutex;
+typedef pthread_cond_t tCondition;
+#endif /* PCF_IS_NO_WIN */
+
+
+/** Thread entry point type. */
+typedef void (* tThreadFn)(void * arg);
+
+
+int th_create(tThread * thread, tThreadFn fn, void * arg);
+void th_join(tThread * thread);
+int th_mutexInit(tMutex * mutex);
+void th_mutexDestroy(tMutex * mutex);
+void th_lock(tMutex * mutex);
+void th_unlock(tMutex * mutex);
+int th_condInit(tCondition * cond);
+void th_condDestroy(tCondition * cond);
+void th_condWait(tCondition * cond, tMutex * mutex);
+void th_condBroadcast(tCondition * cond);
+size_t th_cpuCount(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __THREAD_H__ */
@@ -0,0 +1,1107 @@
+/**
+ * @file thumbnail.c
+ * @author Daniel Starke
+ * @see thumbnail.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base64.h"
+#include "thumbnail.h"
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif /* HAS_ZLIB */
+
+
+/** PNG file signature. */
+static const unsigned char tn_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+
+/**
+ * Reads a big endian 32-bit value.
+ *
+ * @param[in] ptr - input data
+ * @return read value
+ */
+static uint32_t tn_get32(const unsigned char * ptr) {
+	return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | (uint32_t)ptr[3];
+}
+
+
+#ifdef HAS_ZLIB
+
+
+/** Maximum number of pixels of a decoded image. */
+#define TN_MAX_PIXELS 0x100000
+
+
+/** Minimum width and height in pixels when shrinking the image to the size limit. */
+#define TN_MIN_DIMENSION 8
+
+
+/** Maximum number of palette entries. */
+#define TN_PALETTE_SIZE 256
+
+
+/** Image with 8 bit RGBA pixels. Fully transparent pixels are black. */
+typedef struct {
+	unsigned char * data;      /**< pixel data row by row */
+	size_t width;              /**< width in pixels */
+	size_t height;             /**< height in pixels */
+} tTnImage;
+
+
+/** Color map entry. */
+typedef struct {
+	uint32_t color;            /**< color as 0xRRGGBBAA */
+	uint32_t count;            /**< number of pixels with this color (0 if unused) */
+	uint32_t index;            /**< assigned palette index */
+} tTnColor;
+
+
+/** Hash table of the colors of an image. */
+typedef struct {
+	tTnColor * entry;          /**< table entries */
+	size_t mask;               /**< number of table entries minus one */
+	size_t count;              /**< number of used table entries */
+} tTnColorMap;
+
+
+/** Encoding format of an image. */
+typedef struct {
+	int colorType;             /**< PNG color type */
+	int depth;                 /**< bits per sample */
+	size_t channels;           /**< samples per pixel */
+	size_t colors;             /**< number of palette entries */
+	uint32_t palette[TN_PALETTE_SIZE]; /**< palette colors as 0xRRGGBBAA */
+	const tTnColorMap * map;   /**< color map with the palette indices */
+} tTnFormat;
+
+
+/** Range of colors within the color list of the median cut. */
+typedef struct {
+	size_t start;              /**< first color */
+	size_t end;                /**< end of the range (exclusive) */
+} tTnBox;
+
+
+/**
+ * Writes a big endian 32-bit value.
+ *
+ * @param[out] ptr - output buffer
+ * @param[in] val - value to write
+ */
+static void tn_put32(unsigned char * ptr, const uint32_t val) {
+	ptr[0] = (unsigned char)(val >> 24);
+	ptr[1] = (unsigned char)(val >> 16);
+	ptr[2] = (unsigned char)(val >> 8);
+	ptr[3] = (unsigned char)val;
+}
+
+
+/**
+ * Returns the color of the given RGBA pixel.
+ *
+ * @param[in] px - RGBA pixel
+ * @return color as 0xRRGGBBAA
+ */
+static uint32_t tn_color(const unsigned char * px) {
+	return ((uint32_t)px[0] << 24) | ((uint32_t)px[1] << 16) | ((uint32_t)px[2] << 8) | (uint32_t)px[3];
+}
+
+
+/**
+ * Returns the number of samples per pixel of the given PNG color type.
+ *
+ * @param[in] colorType - PNG color type
+ * @return samples per pixel or 0 if invalid
+ */
+static size_t tn_channels(const int colorType) {
+	switch (colorType) {
+	case 0: return 1;
+	case 2: return 3;
+	case 3: return 1;
+	case 4: return 2;
+	case 6: return 4;
+	default: return 0;
+	}
+}
+
+
+/**
+ * Returns the Paeth predictor of the given neighbor bytes.
+ *
+ * @param[in] a - left byte
+ * @param[in] b - upper byte
+ * @param[in] c - upper left byte
+ * @return predicted byte
+ */
+static unsigned char tn_paeth(const int a, const int b, const int c) {
+	const int p = a + b - c;
+	const int pa = abs(p - a);
+	const int pb = abs(p - b);
+	const int pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	if (pb <= pc) return (unsigned char)b;
+	return (unsigned char)c;
+}
+
+
+/**
+ * Returns the sample at the given index of a decoded PNG row.
+ *
+ * @param[in] row - unfiltered row data
+ * @param[in] i - sample index
+ * @param[in] depth - bits per sample
+ * @return sample value
+ */
+static unsigned tn_sample(const unsigned char * row, const size_t i, const int depth) {
+	if (depth == 16) return ((unsigned)row[2 * i] << 8) | (unsigned)row[(2 * i) + 1];
+	if (depth == 8) return row[i];
+	const size_t bit = i * (size_t)depth;
+	return (unsigned)(row[bit / 8] >> (8 - depth - (int)(bit % 8))) & ((1U << depth) - 1);
+}
+
+
+/**
+ * Scales the given sample to 8 bits.
+ *
+ * @param[in] val - sample value
+ * @param[in] depth - bits per sample
+ * @return 8-bit sample value
+ */
+static unsigned char tn_scale(const unsigned val, const int depth) {
+	if (depth == 16) return (unsigned char)(val >> 8);
+	if (depth == 8) return (unsigned char)val;
+	return (unsigned char)((val * 255) / ((1U << depth) - 1));
+}
+
+
+/**
+ * Reverts the PNG row filters in-place.
+ *
+ * @param[in,out] raw - filtered rows, each with a leading filter type byte
+ * @param[in] height - number of rows
+ * @param[in] stride - row length in bytes without the filter type byte
+ * @param[in] bpp - bytes per complete pixel (at least 1)
+ * @return 1 on success, 0 on invalid filter type
+ */
+static int tn_unfilter(unsigned char * raw, const size_t height, const size_t stride, const size_t bpp) {
+	const unsigned char * prev = NULL;
+	for (size_t y = 0; y < height; y++) {
+		unsigned char * row = raw + (y * (stride + 1)) + 1;
+		const int type = row[-1];
+		for (size_t x = 0; x < stride; x++) {
+			const int a = (x >= bpp) ? row[x - bpp] : 0;
+			const int b = (prev != NULL) ? prev[x] : 0;
+			const int c = (prev != NULL && x >= bpp) ? prev[x - bpp] : 0;
+			switch (type) {
+			case 0: break;
+			case 1: row[x] = (unsigned char)(row[x] + a); break;
+			case 2: row[x] = (unsigned char)(row[x] + b); break;
+			case 3: row[x] = (unsigned char)(row[x] + ((a + b) >> 1)); break;
+			case 4: row[x] = (unsigned char)(row[x] + tn_paeth(a, b, c)); break;
+			default: return 0;
+			}
+		}
+		prev = row;
+	}
+	return 1;
+}
+
+
+/**
+ * Decodes the given PNG image into 8 bit RGBA pixels. Interlaced images are not supported.
+ *
+ * @param[out] img - receives the decoded image (free data after use)
+ * @param[in] png - PNG file content
+ * @param[in] len - PNG file length in bytes
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_decode(tTnImage * img, const unsigned char * png, const size_t len) {
+	tThumbnailResult res = TN_ERR_FORMAT;
+	unsigned char * raw = NULL;
+	uint32_t palette[TN_PALETTE_SIZE];
+	size_t colors = 0;
+	unsigned key[3] = {0};
+	int hasKey = 0;
+	int colorType = -1;
+	int depth = 0;
+	size_t channels = 0;
+	size_t stride = 0;
+	size_t rawLen = 0;
+	int inflating = 0;
+	int done = 0;
+	z_stream zs;
+	memset(img, 0, sizeof(*img));
+	memset(&zs, 0, sizeof(zs));
+	if (len < sizeof(tn_signature) || memcmp(png, tn_signature, sizeof(tn_signature)) != 0) return TN_ERR_FORMAT;
+
+	/* parse chunks */
+	for (size_t pos = sizeof(tn_signature); done == 0; ) {
+		if ((len - pos) < 12) goto onEnd;
+		const size_t chunkLen = (size_t)tn_get32(png + pos);
+		if (chunkLen > (len - pos - 12)) goto onEnd;
+		const unsigned char * type = png + pos + 4;
+		const unsigned char * data = type + 4;
+		if ((uint32_t)crc32(0, type, (uInt)(chunkLen + 4)) != tn_get32(data + chunkLen)) goto onEnd;
+		pos += chunkLen + 12;
+		if (memcmp(type, "IHDR", 4) == 0) {
+			if (chunkLen != 13 || colorType >= 0) goto onEnd;
+			img->width = (size_t)tn_get32(data);
+			img->height = (size_t)tn_get32(data + 4);
+			depth = data[8];
+			colorType = data[9];
+			channels = tn_channels(colorType);
+			if (img->width < 1 || img->height < 1 || img->width > TN_MAX_PIXELS || img->height > (TN_MAX_PIXELS / img->width)) goto onEnd;
+			if (channels < 1 || data[10] != 0 || data[11] != 0) goto onEnd;
+			if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) goto onEnd;
+			if ((colorType == 3 && depth > 8) || (colorType != 0 && colorType != 3 && depth < 8)) goto onEnd;
+			if (data[12] != 0) {
+				/* interlaced */
+				goto onEnd;
+			}
+			stride = ((img->width * channels * (size_t)depth) + 7) / 8;
+			raw = (unsigned char *)malloc(img->height * (stride + 1));
+			if (raw == NULL) {
+				res = TN_ERR_NO_MEM;
+				goto onEnd;
+			}
+			if (inflateInit(&zs) != Z_OK) {
+				res = TN_ERR_NO_MEM;
+				goto onEnd;
+			}
+			inflating = 1;
+			zs.next_out = raw;
+			zs.avail_out = (uInt)(img->height * (stride + 1));
+		} else if (colorType < 0) {
+			/* IHDR needs to be first */
+			goto onEnd;
+		} else if (memcmp(type, "PLTE", 4) == 0) {
+			if ((chunkLen % 3) != 0 || chunkLen > (3 * TN_PALETTE_SIZE)) goto onEnd;
+			colors = chunkLen / 3;
+			for (size_t i = 0; i < colors; i++) {
+				palette[i] = ((uint32_t)data[3 * i] << 24) | ((uint32_t)data[(3 * i) + 1] << 16) | ((uint32_t)data[(3 * i) + 2] << 8) | 0xFF;
+			}
+		} else if (memcmp(type, "tRNS", 4) == 0) {
+			if (colorType == 3) {
+				if (chunkLen > colors) goto onEnd;
+				for (size_t i = 0; i < chunkLen; i++) palette[i] = (palette[i] & 0xFFFFFF00) | data[i];
+			} else if (colorType == 0 && chunkLen == 2) {
+				key[0] = ((unsigned)data[0] << 8) | data[1];
+				hasKey = 1;
+			} else if (colorType == 2 && chunkLen == 6) {
+				for (size_t i = 0; i < 3; i++) key[i] = ((unsigned)data[2 * i] << 8) | data[(2 * i) + 1];
+				hasKey = 1;
+			}
+		} else if (memcmp(type, "IDAT", 4) == 0) {
+			if (rawLen != 0) continue; /* already complete */
+			zs.next_in = (Bytef *)data;
+			zs.avail_in = (uInt)chunkLen;
+			const int zres = inflate(&zs, Z_NO_FLUSH);
+			if (zres == Z_STREAM_END) {
+				rawLen = img->height * (stride + 1) - (size_t)zs.avail_out;
+			} else if (zres != Z_OK && zres != Z_BUF_ERROR) {
+				goto onEnd;
+			}
+		} else if (memcmp(type, "IEND", 4) == 0) {
+			done = 1;
+		} else if ((type[0] & 0x20) == 0) {
+			/* unknown critical chunk */
+			goto onEnd;
+		}
+	}
+	if (rawLen != img->height * (stride + 1)) goto onEnd;
+	if (colorType == 3 && colors < 1) goto onEnd;
+	if (tn_unfilter(raw, img->height, stride, PCF_MAX((channels * (size_t)depth) / 8, (size_t)1)) != 1) goto onEnd;
+
+	/* convert to RGBA */
+	img->data = (unsigned char *)malloc(img->width * img->height * 4);
+	if (img->data == NULL) {
+		res = TN_ERR_NO_MEM;
+		goto onEnd;
+	}
+	for (size_t y = 0; y < img->height; y++) {
+		const unsigned char * row = raw + (y * (stride + 1)) + 1;
+		unsigned char * px = img->data + (y * img->width * 4);
+		for (size_t x = 0; x < img->width; x++, px += 4) {
+			const size_t i = x * channels;
+			unsigned s[4];
+			for (size_t c = 0; c < channels; c++) s[c] = tn_sample(row, i + c, depth);
+			switch (colorType) {
+			case 0:
+				px[0] = px[1] = px[2] = tn_scale(s[0], depth);
+				px[3] = (hasKey != 0 && s[0] == key[0]) ? 0 : 0xFF;
+				break;
+			case 2:
+				px[0] = tn_scale(s[0], depth);
+				px[1] = tn_scale(s[1], depth);
+				px[2] = tn_scale(s[2], depth);
+				px[3] = (hasKey != 0 && s[0] == key[0] && s[1] == key[1] && s[2] == key[2]) ? 0 : 0xFF;
+				break;
+			case 3:
+				if (s[0] >= colors) goto onEnd;
+				px[0] = (unsigned char)(palette[s[0]] >> 24);
+				px[1] = (unsigned char)(palette[s[0]] >> 16);
+				px[2] = (unsigned char)(palette[s[0]] >> 8);
+				px[3] = (unsigned char)palette[s[0]];
+				break;
+			case 4:
+				px[0] = px[1] = px[2] = tn_scale(s[0], depth);
+				px[3] = tn_scale(s[1], depth);
+				break;
+			default:
+				px[0] = tn_scale(s[0], depth);
+				px[1] = tn_scale(s[1], depth);
+				px[2] = tn_scale(s[2], depth);
+				px[3] = tn_scale(s[3], depth);
+				break;
+			}
+			if (px[3] == 0) memset(px, 0, 4);
+		}
+	}
+	res = TN_OK;
+onEnd:
+	if (inflating != 0) inflateEnd(&zs);
+	if (raw != NULL) free(raw);
+	if (res != TN_OK && img->data != NULL) {
+		free(img->data);
+		img->data = NULL;
+	}
+	return res;
+}
+
+
+/**
+ * Resamples the given image to the passed size. Each target pixel is the area weighted average of
+ * the covered source pixels with premultiplied alpha.
+ *
+ * @param[out] dst - receives the resampled image (free data after use)
+ * @param[in] src - source image
+ * @param[in] width - target width in pixels
+ * @param[in] height - target height in pixels
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_resample(tTnImage * dst, const tTnImage * src, const size_t width, const size_t height) {
+	const double sx = (double)src->width / (double)width;
+	const double sy = (double)src->height / (double)height;
+	float * tmp = (float *)malloc(width * src->height * 4 * sizeof(float));
+	memset(dst, 0, sizeof(*dst));
+	if (tmp == NULL) return TN_ERR_NO_MEM;
+	dst->data = (unsigned char *)malloc(width * height * 4);
+	if (dst->data == NULL) {
+		free(tmp);
+		return TN_ERR_NO_MEM;
+	}
+	dst->width = width;
+	dst->height = height;
+	/* horizontal pass */
+	for (size_t y = 0; y < src->height; y++) {
+		const unsigned char * row = src->data + (y * src->width * 4);
+		float * out = tmp + (y * width * 4);
+		for (size_t x = 0; x < width; x++, out += 4) {
+			const double a = (double)x * sx;
+			const double b = PCF_MIN((double)(x + 1) * sx, (double)src->width);
+			double acc[4] = {0.0, 0.0, 0.0, 0.0};
+			for (size_t i = (size_t)a; (double)i < b; i++) {
+				const double w = (PCF_MIN(b, (double)(i + 1)) - PCF_MAX(a, (double)i)) * (double)row[(4 * i) + 3];
+				acc[0] += w * (double)row[4 * i];
+				acc[1] += w * (double)row[(4 * i) + 1];
+				acc[2] += w * (double)row[(4 * i) + 2];
+				acc[3] += w;
+			}
+			for (size_t c = 0; c < 4; c++) out[c] = (float)(acc[c] / (b - a));
+		}
+	}
+	/* vertical pass */
+	for (size_t y = 0; y < height; y++) {
+		const double a = (double)y * sy;
+		const double b = PCF_MIN((double)(y + 1) * sy, (double)src->height);
+		unsigned char * px = dst->data + (y * width * 4);
+		for (size_t x = 0; x < width; x++, px += 4) {
+			double acc[4] = {0.0, 0.0, 0.0, 0.0};
+			for (size_t i = (size_t)a; (double)i < b; i++) {
+				const double w = PCF_MIN(b, (double)(i + 1)) - PCF_MAX(a, (double)i);
+				const float * in = tmp + (((i * width) + x) * 4);
+				for (size_t c = 0; c < 4; c++) acc[c] += w * (double)in[c];
+			}
+			const double alpha = acc[3] / (b - a);
+			if (alpha < 0.5) {
+				memset(px, 0, 4);
+				continue;
+			}
+			for (size_t c = 0; c < 3; c++) {
+				const double val = (acc[c] / acc[3]) + 0.5;
+				px[c] = (unsigned char)PCF_MIN(val, 255.0);
+			}
+			px[3] = (unsigned char)PCF_MIN(alpha + 0.5, 255.0);
+		}
+	}
+	free(tmp);
+	return TN_OK;
+}
+
+
+/**
+ * Returns the entry of the given color within the passed color map. This is either the entry
+ * with the color or the unused entry where it is to be inserted.
+ *
+ * @param[in] map - color map
+ * @param[in] color - color to search for
+ * @return color map entry
+ */
+static tTnColor * tn_findColor(const tTnColorMap * map, const uint32_t color) {
+	size_t i = (size_t)(((color ^ (color >> 15)) * 0x2C1B3C6DU) ^ (color >> 13)) & map->mask;
+	while (map->entry[i].count != 0 && map->entry[i].color != color) i = (i + 1) & map->mask;
+	return map->entry + i;
+}
+
+
+/**
+ * Creates the color map of the given image.
+ *
+ * @param[out] map - receives the color map (free entry after use)
+ * @param[in] img - input image
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_mapColors(tTnColorMap * map, const tTnImage * img) {
+	const size_t pixels = img->width * img->height;
+	size_t size = 1024;
+	while (size < (2 * pixels)) size *= 2;
+	map->entry = (tTnColor *)calloc(size, sizeof(tTnColor));
+	if (map->entry == NULL) return TN_ERR_NO_MEM;
+	map->mask = size - 1;
+	map->count = 0;
+	for (size_t i = 0; i < pixels; i++) {
+		const uint32_t color = tn_color(img->data + (4 * i));
+		tTnColor * entry = tn_findColor(map, color);
+		if (entry->count == 0) {
+			entry->color = color;
+			map->count++;
+		}
+		entry->count++;
+	}
+	return TN_OK;
+}
+
+
+/** Defines the color list comparator for the channel at the given bit shift. */
+#define TN_COMPARE_CHANNEL(name, shift) \
+	static int name(const void * lhs, const void * rhs) { \
+		const uint32_t a = ((const tTnColor *)lhs)->color; \
+		const uint32_t b = ((const tTnColor *)rhs)->color; \
+		const uint32_t ca = (a >> shift) & 0xFF; \
+		const uint32_t cb = (b >> shift) & 0xFF; \
+		if (ca != cb) return (ca < cb) ? -1 : 1; \
+		return (a < b) ? -1 : ((a > b) ? 1 : 0); \
+	}
+
+TN_COMPARE_CHANNEL(tn_compareRed, 24)
+TN_COMPARE_CHANNEL(tn_compareGreen, 16)
+TN_COMPARE_CHANNEL(tn_compareBlue, 8)
+TN_COMPARE_CHANNEL(tn_compareAlpha, 0)
+
+
+/**
+ * Returns the channel with the largest value range within the given color range.
+ *
+ * @param[in] list - color list
+ * @param[in] box - color range
+ * @param[out] range - receives the value range of the returned channel
+ * @return channel index (0 = red, 1 = green, 2 = blue, 3 = alpha)
+ */
+static int tn_widestChannel(const tTnColor * list, const tTnBox * box, unsigned * range) {
+	unsigned lo[4] = {255, 255, 255, 255};
+	unsigned hi[4] = {0, 0, 0, 0};
+	int res = 0;
+	for (size_t i = box->start; i < box->end; i++) {
+		for (int c = 0; c < 4; c++) {
+			const unsigned val = (unsigned)(list[i].color >> (24 - (8 * c))) & 0xFF;
+			lo[c] = PCF_MIN(lo[c], val);
+			hi[c] = PCF_MAX(hi[c], val);
+		}
+	}
+	*range = 0;
+	for (int c = 0; c < 4; c++) {
+		if (hi[c] >= lo[c] && (hi[c] - lo[c]) > *range) {
+			*range = hi[c] - lo[c];
+			res = c;
+		}
+	}
+	return res;
+}
+
+
+/**
+ * Creates a palette with at most the given number of colors from the passed color map via median
+ * cut. The palette is lossless if the image has not more colors. Palette entries with alpha come
+ * first to allow a short tRNS chunk. The palette index of each color is stored in the color map.
+ *
+ * @param[out] fmt - receives the palette
+ * @param[in,out] map - color map of the image
+ * @param[in] limit - maximum number of palette colors
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_createPalette(tTnFormat * fmt, tTnColorMap * map, const size_t limit) {
+	static int (* const compare[4])(const void *, const void *) = {
+		tn_compareRed, tn_compareGreen, tn_compareBlue, tn_compareAlpha
+	};
+	tTnBox box[TN_PALETTE_SIZE];
+	size_t order[TN_PALETTE_SIZE];
+	uint32_t palette[TN_PALETTE_SIZE];
+	size_t boxes = 1;
+	size_t n = 0;
+	tTnColor * list = (tTnColor *)malloc(map->count * sizeof(tTnColor));
+	if (list == NULL) return TN_ERR_NO_MEM;
+	for (size_t i = 0; i <= map->mask; i++) {
+		if (map->entry[i].count != 0) list[n++] = map->entry[i];
+	}
+	box[0].start = 0;
+	box[0].end = n;
+
+	/* split the box with the widest channel range at its median until the limit is reached */
+	while (boxes < limit) {
+		size_t best = boxes;
+		unsigned bestRange = 0;
+		int channel = 0;
+		for (size_t i = 0; i < boxes; i++) {
+			unsigned range;
+			if ((box[i].end - box[i].start) < 2) continue;
+			const int c = tn_widestChannel(list, box + i, &range);
+			if (best == boxes || range > bestRange) {
+				best = i;
+				bestRange = range;
+				channel = c;
+			}
+		}
+		if (best == boxes) break;
+		tTnBox * b = box + best;
+		qsort(list + b->start, b->end - b->start, sizeof(tTnColor), compare[channel]);
+		uint64_t total = 0;
+		uint64_t sum = 0;
+		for (size_t i = b->start; i < b->end; i++) total += list[i].count;
+		size_t split = b->start + 1;
+		for (size_t i = b->start; i < (b->end - 1); i++) {
+			sum += list[i].count;
+			split = i + 1;
+			if ((2 * sum) >= total) break;
+		}
+		box[boxes].start = split;
+		box[boxes].end = b->end;
+		b->end = split;
+		boxes++;
+	}
+
+	/* average each box and sort the palette by alpha */
+	for (size_t i = 0; i < boxes; i++) {
+		uint64_t acc[4] = {0, 0, 0, 0};
+		uint64_t total = 0;
+		for (size_t j = box[i].start; j < box[i].end; j++) {
+			for (int c = 0; c < 4; c++) acc[c] += (uint64_t)((list[j].color >> (24 - (8 * c))) & 0xFF) * list[j].count;
+			total += list[j].count;
+		}
+		palette[i] = 0;
+		for (int c = 0; c < 4; c++) palette[i] |= (uint32_t)((acc[c] + (total / 2)) / total) << (24 - (8 * c));
+		size_t k = i;
+		for (; k > 0 && (palette[order[k - 1]] & 0xFF) > (palette[i] & 0xFF); k--) order[k] = order[k - 1];
+		order[k] = i;
+	}
+	for (size_t i = 0; i < boxes; i++) {
+		fmt->palette[i] = palette[order[i]];
+		for (size_t j = box[order[i]].start; j < box[order[i]].end; j++) tn_findColor(map, list[j].color)->index = (uint32_t)i;
+	}
+	free(list);
+
+	fmt->colorType = 3;
+	fmt->channels = 1;
+	fmt->colors = boxes;
+	fmt->map = map;
+	if (boxes <= 2) {
+		fmt->depth = 1;
+	} else if (boxes <= 4) {
+		fmt->depth = 2;
+	} else if (boxes <= 16) {
+		fmt->depth = 4;
+	} else {
+		fmt->depth = 8;
+	}
+	return TN_OK;
+}
+
+
+/**
+ * Packs the given image row into PNG samples of the passed format.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] img - input image
+ * @param[in] fmt - output format
+ * @param[in] y - row index
+ */
+static void tn_packRow(unsigned char * dst, const tTnImage * img, const tTnFormat * fmt, const size_t y) {
+	const unsigned char * px = img->data + (y * img->width * 4);
+	if (fmt->colorType == 3) {
+		const size_t stride = ((img->width * (size_t)fmt->depth) + 7) / 8;
+		memset(dst, 0, stride);
+		for (size_t x = 0; x < img->width; x++, px += 4) {
+			const size_t bit = x * (size_t)fmt->depth;
+			const uint32_t index = tn_findColor(fmt->map, tn_color(px))->index;
+			dst[bit / 8] = (unsigned char)(dst[bit / 8] | (index << (8 - fmt->depth - (int)(bit % 8))));
+		}
+		return;
+	}
+	for (size_t x = 0; x < img->width; x++, px += 4) {
+		switch (fmt->colorType) {
+		case 0: *dst++ = px[0]; break;
+		case 4: *dst++ = px[0]; *dst++ = px[3]; break;
+		case 2: memcpy(dst, px, 3); dst += 3; break;
+		default: memcpy(dst, px, 4); dst += 4; break;
+		}
+	}
+}
+
+
+/**
+ * Applies the given PNG filter to a row.
+ *
+ * @param[out] dst - output buffer
+ * @param[in] row - row data
+ * @param[in] prev - previous row data or NULL for the first row
+ * @param[in] stride - row length in bytes
+ * @param[in] bpp - bytes per complete pixel
+ * @param[in] type - PNG filter type
+ * @return sum of the absolute signed output bytes
+ */
+static size_t tn_filterRow(unsigned char * dst, const unsigned char * row, const unsigned char * prev, const size_t stride, const size_t bpp, const int type) {
+	size_t sum = 0;
+	for (size_t x = 0; x < stride; x++) {
+		const int a = (x >= bpp) ? row[x - bpp] : 0;
+		const int b = (prev != NULL) ? prev[x] : 0;
+		const int c = (prev != NULL && x >= bpp) ? prev[x - bpp] : 0;
+		unsigned char val;
+		switch (type) {
+		case 1: val = (unsigned char)(row[x] - a); break;
+		case 2: val = (unsigned char)(row[x] - b); break;
+		case 3: val = (unsigned char)(row[x] - ((a + b) >> 1)); break;
+		case 4: val = (unsigned char)(row[x] - tn_paeth(a, b, c)); break;
+		default: val = row[x]; break;
+		}
+		dst[x] = val;
+		sum += (val < 128) ? val : (256 - (size_t)val);
+	}
+	return sum;
+}
+
+
+/**
+ * Appends a PNG chunk to the given buffer.
+ *
+ * @param[in,out] buf - output buffer (large enough)
+ * @param[in] type - chunk type
+ * @param[in] data - chunk data
+ * @param[in] len - chunk data length in bytes
+ * @return number of bytes written
+ */
+static size_t tn_putChunk(unsigned char * buf, const char * type, const unsigned char * data, const size_t len) {
+	tn_put32(buf, (uint32_t)len);
+	memcpy(buf + 4, type, 4);
+	if (len > 0) memcpy(buf + 8, data, len);
+	tn_put32(buf + 8 + len, (uint32_t)crc32(0, buf + 4, (uInt)(len + 4)));
+	return len + 12;
+}
+
+
+/**
+ * Encodes the given image as PNG in the passed format. Rows of true color images are filtered
+ * adaptively by the minimum sum of absolute differences and without filter. Palette images are
+ * not filtered. Each variant is compressed with different deflate strategies at maximum level and
+ * the smallest result is kept. No ancillary chunks except tRNS are written.
+ *
+ * @param[in] img - input image
+ * @param[in] fmt - output format
+ * @param[out] png - receives the allocated PNG file content (free after use)
+ * @param[out] pngLen - receives the PNG file length in bytes
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_encode(const tTnImage * img, const tTnFormat * fmt, unsigned char ** png, size_t * pngLen) {
+	static const int strategy[2] = {Z_DEFAULT_STRATEGY, Z_FILTERED};
+	tThumbnailResult res = TN_ERR_NO_MEM;
+	const size_t stride = ((img->width * fmt->channels * (size_t)fmt->depth) + 7) / 8;
+	const size_t bpp = PCF_MAX((fmt->channels * (size_t)fmt->depth) / 8, (size_t)1);
+	const size_t filteredLen = img->height * (stride + 1);
+	const size_t variants = (fmt->colorType == 3) ? 1 : 2;
+	unsigned char * rows = (unsigned char *)malloc(img->height * stride);
+	unsigned char * filtered = (unsigned char *)malloc(2 * filteredLen);
+	unsigned char * idat = NULL;
+	unsigned char * out = NULL;
+	unsigned char * best = NULL;
+	uLong bestLen = 0;
+	uLong bound;
+	z_stream zs;
+	*png = NULL;
+	*pngLen = 0;
+	if (rows == NULL || filtered == NULL) goto onEnd;
+
+	/* create the filter variants */
+	for (size_t y = 0; y < img->height; y++) tn_packRow(rows + (y * stride), img, fmt, y);
+	for (size_t y = 0; y < img->height; y++) {
+		const unsigned char * row = rows + (y * stride);
+		const unsigned char * prev = (y > 0) ? (row - stride) : NULL;
+		unsigned char * dst = filtered + (y * (stride + 1));
+		dst[0] = 0;
+		memcpy(dst + 1, row, stride);
+		if (variants < 2) continue;
+		dst += filteredLen;
+		size_t bestSum = 0;
+		for (int type = 0; type < 5; type++) {
+			const size_t sum = tn_filterRow(dst + 1, row, prev, stride, bpp, type);
+			if (type == 0 || sum < bestSum) {
+				bestSum = sum;
+				dst[0] = (unsigned char)type;
+			}
+		}
+		tn_filterRow(dst + 1, row, prev, stride, bpp, dst[0]);
+	}
+
+	/* compress each variant and keep the smallest */
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15, 9, Z_DEFAULT_STRATEGY) != Z_OK) goto onEnd;
+	bound = deflateBound(&zs, (uLong)filteredLen);
+	idat = (unsigned char *)malloc(2 * (size_t)bound);
+	if (idat == NULL) {
+		deflateEnd(&zs);
+		goto onEnd;
+	}
+	for (size_t v = 0; v < variants; v++) {
+		for (size_t s = 0; s < (sizeof(strategy) / sizeof(*strategy)); s++) {
+			unsigned char * dst = (best == idat) ? (idat + bound) : idat;
+			if (deflateReset(&zs) != Z_OK || deflateParams(&zs, Z_BEST_COMPRESSION, strategy[s]) != Z_OK) continue;
+			zs.next_in = filtered + (v * filteredLen);
+			zs.avail_in = (uInt)filteredLen;
+			zs.next_out = dst;
+			zs.avail_out = (uInt)bound;
+			if (deflate(&zs, Z_FINISH) != Z_STREAM_END) continue;
+			if (best == NULL || zs.total_out < bestLen) {
+				best = dst;
+				bestLen = zs.total_out;
+			}
+		}
+	}
+	deflateEnd(&zs);
+	if (best == NULL) {
+		res = TN_ERR_FORMAT;
+		goto onEnd;
+	}
+
+	/* assemble the PNG file */
+	out = (unsigned char *)malloc(sizeof(tn_signature) + 25 + (3 * TN_PALETTE_SIZE + 12) + (TN_PALETTE_SIZE + 12) + ((size_t)bestLen + 12) + 12);
+	if (out == NULL) goto onEnd;
+	{
+		unsigned char chunk[3 * TN_PALETTE_SIZE];
+		size_t len = sizeof(tn_signature);
+		memcpy(out, tn_signature, sizeof(tn_signature));
+		tn_put32(chunk, (uint32_t)img->width);
+		tn_put32(chunk + 4, (uint32_t)img->height);
+		chunk[8] = (unsigned char)fmt->depth;
+		chunk[9] = (unsigned char)fmt->colorType;
+		chunk[10] = 0;
+		chunk[11] = 0;
+		chunk[12] = 0;
+		len += tn_putChunk(out + len, "IHDR", chunk, 13);
+		if (fmt->colorType == 3) {
+			size_t alpha = 0;
+			for (size_t i = 0; i < fmt->colors; i++) {
+				chunk[3 * i] = (unsigned char)(fmt->palette[i] >> 24);
+				chunk[(3 * i) + 1] = (unsigned char)(fmt->palette[i] >> 16);
+				chunk[(3 * i) + 2] = (unsigned char)(fmt->palette[i] >> 8);
+				if ((fmt->palette[i] & 0xFF) != 0xFF) alpha = i + 1;
+			}
+			len += tn_putChunk(out + len, "PLTE", chunk, 3 * fmt->colors);
+			if (alpha > 0) {
+				for (size_t i = 0; i < alpha; i++) chunk[i] = (unsigned char)fmt->palette[i];
+				len += tn_putChunk(out + len, "tRNS", chunk, alpha);
+			}
+		}
+		len += tn_putChunk(out + len, "IDAT", best, (size_t)bestLen);
+		len += tn_putChunk(out + len, "IEND", NULL, 0);
+		*png = out;
+		*pngLen = len;
+		out = NULL;
+	}
+	res = TN_OK;
+onEnd:
+	if (rows != NULL) free(rows);
+	if (filtered != NULL) free(filtered);
+	if (idat != NULL) free(idat);
+	if (out != NULL) free(out);
+	return res;
+}
+
+
+/**
+ * Compresses the given image as small as possible. The image is stored as palette image if it
+ * has not more colors than a palette can hold or if the number of colors is limited. Otherwise,
+ * the smallest true color format which holds all pixels losslessly is used. Both variants are
+ * tried in the first case.
+ *
+ * @param[in] img - input image
+ * @param[in] colors - maximum number of colors or 0 for lossless compression
+ * @param[out] png - receives the allocated PNG file content (free after use)
+ * @param[out] pngLen - receives the PNG file length in bytes
+ * @return TN_OK on success, else the error cause
+ */
+static tThumbnailResult tn_compress(const tTnImage * img, const size_t colors, unsigned char ** png, size_t * pngLen) {
+	tThumbnailResult res;
+	tTnColorMap map;
+	tTnFormat fmt;
+	unsigned char * alt = NULL;
+	size_t altLen = 0;
+	*png = NULL;
+	*pngLen = 0;
+	memset(&fmt, 0, sizeof(fmt));
+	res = tn_mapColors(&map, img);
+	if (res != TN_OK) return res;
+	if (colors > 0 || map.count <= TN_PALETTE_SIZE) {
+		res = tn_createPalette(&fmt, &map, (colors > 0) ? PCF_MIN(colors, (size_t)TN_PALETTE_SIZE) : (size_t)TN_PALETTE_SIZE);
+		if (res == TN_OK) res = tn_encode(img, &fmt, png, pngLen);
+		if (res != TN_OK || colors > 0) goto onEnd;
+	}
+
+	/* lossless true color */
+	{
+		int gray = 1;
+		int alpha = 0;
+		const size_t pixels = img->width * img->height;
+		for (size_t i = 0; i < pixels; i++) {
+			const unsigned char * px = img->data + (4 * i);
+			if (px[0] != px[1] || px[0] != px[2]) gray = 0;
+			if (px[3] != 0xFF) alpha = 1;
+		}
+		memset(&fmt, 0, sizeof(fmt));
+		fmt.colorType = (gray != 0) ? ((alpha != 0) ? 4 : 0) : ((alpha != 0) ? 6 : 2);
+		fmt.channels = tn_channels(fmt.colorType);
+		fmt.depth = 8;
+	}
+	res = tn_encode(img, &fmt, &alt, &altLen);
+	if (res != TN_OK) goto onEnd;
+	if (*png == NULL || altLen < *pngLen) {
+		if (*png != NULL) free(*png);
+		*png = alt;
+		*pngLen = altLen;
+	} else {
+		free(alt);
+	}
+onEnd:
+	free(map.entry);
+	if (res != TN_OK && *png != NULL) {
+		free(*png);
+		*png = NULL;
+		*pngLen = 0;
+	}
+	return res;
+}
+#endif /* HAS_ZLIB */
+
+
+/**
+ * Returns whether thumbnail re-encoding is supported by this build.
+ *
+ * @return 1 if supported, else 0
+ */
+int tn_supported(void) {
+#ifdef HAS_ZLIB
+	return 1;
+#else /* !HAS_ZLIB */
+	return 0;
+#endif /* !HAS_ZLIB */
+}
+
+
+/**
+ * Reads the image size from the IHDR chunk of the given Base64 encoded PNG image without decoding
+ * the image. Only the first 32 characters are needed.
+ *
+ * @param[in] src - compacted Base64 encoded PNG image
+ * @param[in] len - input length in bytes
+ * @param[out] width - receives the width in pixels
+ * @param[out] height - receives the height in pixels
+ * @return 1 on success, 0 if the data does not start with a valid PNG header
+ */
+int tn_peekSize(const char * src, const size_t len, size_t * width, size_t * height) {
+	unsigned char head[24];
+	if (src == NULL || len < 32 || width == NULL || height == NULL) return 0;
+	if (b64_decode(head, src, 32) != sizeof(head)) return 0;
+	if (memcmp(head, tn_signature, sizeof(tn_signature)) != 0 || memcmp(head + 12, "IHDR", 4) != 0) return 0;
+	*width = (size_t)tn_get32(head + 16);
+	*height = (size_t)tn_get32(head + 20);
+	return 1;
+}
+
+
+/**
+ * Re-encodes the given Base64 encoded PNG image to reduce its size. The image is resampled to the
+ * target size if set. Only one target dimension may be given to keep the aspect ratio. The number
+ * of colors is reduced via palette if requested. The image is shrunk in steps until it meets the
+ * size limit if set. The original image is kept if it is not exceeding the size limit and was
+ * neither resampled nor is larger than the re-encoded image.
+ *
+ * @param[in] src - compacted Base64 encoded PNG image
+ * @param[in] len - input length in bytes
+ * @param[in] opt - re-encoding options
+ * @param[out] dst - receives the allocated Base64 encoded PNG image (free after use)
+ * @param[out] dstLen - receives the output length in bytes
+ * @return TN_OK on success, TN_KEEP if the original image is kept, else the error cause
+ */
+tThumbnailResult tn_recode(const char * src, const size_t len, const tThumbnailOptions * opt, char ** dst, size_t * dstLen) {
+#ifdef HAS_ZLIB
+	tThumbnailResult res = TN_ERR_NO_MEM;
+	unsigned char * png = NULL;
+	size_t pngLen;
+	tTnImage orig;
+	tTnImage img;
+	size_t width, height;
+	size_t encodedLen;
+	if (src == NULL || opt == NULL || dst == NULL || dstLen == NULL) return TN_ERR_FORMAT;
+	*dst = NULL;
+	*dstLen = 0;
+	memset(&orig, 0, sizeof(orig));
+	memset(&img, 0, sizeof(img));
+
+	/* decode */
+	png = (unsigned char *)malloc((len / 4) * 3 + 1);
+	if (png == NULL) return TN_ERR_NO_MEM;
+	pngLen = b64_decode(png, src, len);
+	if (pngLen == (size_t)-1) {
+		res = TN_ERR_FORMAT;
+		goto onEnd;
+	}
+	res = tn_decode(&orig, png, pngLen);
+	free(png);
+	png = NULL;
+	if (res != TN_OK) goto onEnd;
+
+	/* determine the target size */
+	width = orig.width;
+	height = orig.height;
+	if (opt->width > 0 && opt->height > 0) {
+		width = opt->width;
+		height = opt->height;
+	} else if (opt->width > 0) {
+		width = opt->width;
+		height = PCF_MAX((orig.height * opt->width + (orig.width / 2)) / orig.width, (size_t)1);
+	} else if (opt->height > 0) {
+		height = opt->height;
+		width = PCF_MAX((orig.width * opt->height + (orig.height / 2)) / orig.height, (size_t)1);
+	}
+	if (width > TN_MAX_PIXELS || height > (TN_MAX_PIXELS / width)) {
+		res = TN_ERR_FORMAT;
+		goto onEnd;
+	}
+
+	/* compress and shrink until the size limit is met */
+	for (;;) {
+		const tTnImage * cur = &orig;
+		if (width != orig.width || height != orig.height) {
+			if (img.data != NULL) free(img.data);
+			res = tn_resample(&img, &orig, width, height);
+			if (res != TN_OK) goto onEnd;
+			cur = &img;
+		}
+		if (png != NULL) free(png);
+		res = tn_compress(cur, opt->colors, &png, &pngLen);
+		if (res != TN_OK) goto onEnd;
+		encodedLen = ((pngLen + 2) / 3) * 4;
+		if (opt->maxSize == 0 || encodedLen <= opt->maxSize) break;
+		if (width <= TN_MIN_DIMENSION && height <= TN_MIN_DIMENSION) {
+			res = TN_ERR_TOO_LARGE;
+			goto onEnd;
+		}
+		width = PCF_MAX((width * 3) / 4, (size_t)1);
+		height = PCF_MAX((height * 3) / 4, (size_t)1);
+	}
+	if (width == orig.width && height == orig.height && encodedLen >= len) {
+		res = TN_KEEP;
+		goto onEnd;
+	}
+
+	/* encode */
+	*dst = (char *)malloc(encodedLen);
+	if (*dst == NULL) {
+		res = TN_ERR_NO_MEM;
+		goto onEnd;
+	}
+	*dstLen = b64_encode(*dst, png, pngLen);
+	res = TN_OK;
+onEnd:
+	if (png != NULL) free(png);
+	if (orig.data != NULL) free(orig.data);
+	if (img.data != NULL) free(img.data);
+	return res;
+#else /* !HAS_ZLIB */
+	PCF_UNUSED(src)
+	PCF_UNUSED(len)
+	PCF_UNUSED(opt)
+	if (dst != NULL) *dst = NULL;
+	if (dstLen != NULL) *dstLen = 0;
+	return TN_ERR_UNSUPPORTED;
+#endif /* !HAS_ZLIB */
+}
+
+
+/**
+ * Encodes the given RGBA image as Base64 encoded PNG image. The smallest lossless format is used.
+ * Fully transparent pixels need to be black.
+ *
+ * @param[in] rgba - 8 bit RGBA pixels row by row
+ * @param[in] width - width in pixels
+ * @param[in] height - height in pixels
+ * @param[out] dst - receives the allocated Base64 encoded PNG image (free after use)
+ * @param[out] dstLen - receives the output length in bytes
+ * @return TN_OK on success, else the error cause
+ */
+tThumbnailResult tn_encodeImage(const unsigned char * rgba, const size_t width, const size_t height, char ** dst, size_t * dstLen) {
+#ifdef HAS_ZLIB
+	tThumbnailResult res;
+	unsigned char * png = NULL;
+	size_t pngLen;
+	tTnImage img;
+	if (rgba == NULL || dst == NULL || dstLen == NULL) return TN_ERR_FORMAT;
+	*dst = NULL;
+	*dstLen = 0;
+	if (width < 1 || height < 1 || width > TN_MAX_PIXELS || height > (TN_MAX_PIXELS / width)) return TN_ERR_FORMAT;
+	img.data = (unsigned char *)rgba;
+	img.width = width;
+	img.height = height;
+	res = tn_compress(&img, 0, &png, &pngLen);
+	if (res != TN_OK) return res;
+	*dst = (char *)malloc(((pngLen + 2) / 3) * 4);
+	if (*dst == NULL) {
+		free(png);
+		return TN_ERR_NO_MEM;
+	}
+	*dstLen = b64_encode(*dst, png, pngLen);
+	free(png);
+	return TN_OK;
+#else /* !HAS_ZLIB */
+	PCF_UNUSED(rgba)
+	PCF_UNUSED(width)
+	PCF_UNUSED(height)
+	if (dst != NULL) *dst = NULL;
+	if (dstLen != NULL) *dstLen = 0;
+	return TN_ERR_UNSUPPORTED;
+#endif /* !HAS_ZLIB */
+}
@@ -0,0 +1,69 @@
+/**
+ * @file thumbnail.h
+ * @author Daniel Starke
+ * @see thumbnail.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __THUMBNAIL_H__
+#define __THUMBNAIL_H__
+
+#include <stddef.h>
+#include "preview.h"
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Enumeration of possible thumbnail re-encoding results. */
+typedef enum {
+	TN_OK = 0,
+	TN_KEEP,                   /**< the re-encoded image is not smaller than the original one */
+	TN_ERR_NO_MEM,
+	TN_ERR_FORMAT,             /**< invalid or unsupported PNG image */
+	TN_ERR_TOO_LARGE,          /**< the size limit cannot be met */
+	TN_ERR_UNSUPPORTED         /**< built without zlib */
+} tThumbnailResult;
+
+
+/** Thumbnail re-encoding options. */
+typedef struct {
+	int recode;                /**< 1 to re-encode the thumbnail PNG image, else 0 */
+	size_t colors;             /**< maximum number of palette colors (lossy) or 0 to keep all colors */
+	size_t width;              /**< target width in pixels or 0 to keep it */
+	size_t height;             /**< target height in pixels or 0 to keep it */
+	size_t maxSize;            /**< maximum Base64 encoded size in bytes or 0 for no limit */
+	size_t selectWidth;        /**< preferred width among several thumbnails or 0 for the default */
+	size_t selectHeight;       /**< preferred height among several thumbnails or 0 for the default */
+	tPreviewView preview;      /**< toolpath preview rendered if no thumbnail was found or PV_NONE */
+} tThumbnailOptions;
+
+
+int tn_supported(void);
+int tn_peekSize(const char * src, const size_t len, size_t * width, size_t * height);
+tThumbnailResult tn_recode(const char * src, const size_t len, const tThumbnailOptions * opt, char ** dst, size_t * dstLen);
+tThumbnailResult tn_encodeImage(const unsigned char * rgba, const size_t width, const size_t height, char ** dst, size_t * dstLen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __THUMBNAIL_H__ */
@@ -0,0 +1,307 @@
+/**
+ * @file upload.c
+ * @author Daniel Starke
+ * @see upload.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "upload.h"
+#ifdef PCF_IS_LINUX
+#include <netdb.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+
+/** Path of the file upload endpoint of the Snapmaker 2.0 terminal. */
+#define UP_ENDPOINT "/api/v1/upload"
+
+
+/** Maximum length of the request head including the leading multipart boundaries. */
+#define UP_HEAD_SIZE 4096
+
+
+/** Parsed HTTP URL. */
+typedef struct {
+	char host[256];            /**< host name or address (without brackets) */
+	char port[8];              /**< port number */
+	char authority[272];       /**< host and port as given (Host header) */
+	char path[1024];           /**< path prefix without trailing slash */
+} tUrl;
+
+
+/**
+ * Parses the given HTTP URL of the form http://host[:port][/path].
+ *
+ * @param[out] res - receives the URL parts
+ * @param[in] url - URL to parse
+ * @return 1 on success, 0 if invalid or unsupported
+ */
+static int up_parseUrl(tUrl * res, const char * url) {
+	const char * ptr;
+	const char * end;
+	const char * hostEnd;
+	size_t len;
+	if (url == NULL || strncmp(url, "http://", 7) != 0) return 0;
+	ptr = url + 7;
+	end = ptr + strcspn(ptr, "/?#");
+	if (*end == '?' || *end == '#') return 0;
+	/* authority */
+	len = (size_t)(end - ptr);
+	if (len < 1 || len >= sizeof(res->authority) || memchr(ptr, '@', len) != NULL) return 0;
+	memcpy(res->authority, ptr, len);
+	res->authority[len] = 0;
+	if (*ptr == '[') {
+		/* IPv6 address */
+		hostEnd = (const char *)memchr(ptr, ']', len);
+		if (hostEnd == NULL) return 0;
+		ptr++;
+		len = (size_t)(hostEnd - ptr);
+		hostEnd++;
+	} else {
+		hostEnd = (const char *)memchr(ptr, ':', len);
+		if (hostEnd == NULL) hostEnd = end;
+		len = (size_t)(hostEnd - ptr);
+	}
+	if (len < 1 || len >= sizeof(res->host)) return 0;
+	memcpy(res->host, ptr, len);
+	res->host[len] = 0;
+	/* port */
+	if (hostEnd == end) {
+		strcpy(res->port, "80");
+	} else {
+		if (*hostEnd != ':') return 0;
+		hostEnd++;
+		len = (size_t)(end - hostEnd);
+		if (len < 1 || len > 5 || strspn(hostEnd, "0123456789") < len) return 0;
+		memcpy(res->port, hostEnd, len);
+		res->port[len] = 0;
+		if (atoi(res->port) < 1 || atoi(res->port) > 65535) return 0;
+	}
+	/* path prefix */
+	len = strlen(end);
+	while (len > 0 && end[len - 1] == '/') len--;
+	if ((len + sizeof(UP_ENDPOINT)) > sizeof(res->path)) return 0;
+	for (size_t i = 0; i < len; i++) {
+		if ((unsigned char)(end[i]) <= ' ' || end[i] == '?' || end[i] == '#') return 0;
+	}
+	memcpy(res->path, end, len);
+	res->path[len] = 0;
+	return 1;
+}
+
+
+/**
+ * Connects to the given host and port. The socket operations time out after UP_TIMEOUT
+ * milliseconds.
+ *
+ * @param[in] url - parsed URL
+ * @param[out] fd - receives the connected socket
+ * @return UP_OK on success, else the error cause
+ */
+static tUploadResult up_connect(const tUrl * url, int * fd) {
+	struct addrinfo hints;
+	struct addrinfo * list = NULL;
+	struct timeval timeout;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(url->host, url->port, &hints, &list) != 0) return UP_ERR_CONNECT;
+	timeout.tv_sec = UP_TIMEOUT / 1000;
+	timeout.tv_usec = (UP_TIMEOUT % 1000) * 1000;
+	*fd = -1;
+	for (struct addrinfo * ai = list; ai != NULL; ai = ai->ai_next) {
+		*fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (*fd < 0) continue;
+		/* a connect() timeout is given by the send timeout */
+		setsockopt(*fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		setsockopt(*fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		if (connect(*fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+		close(*fd);
+		*fd = -1;
+	}
+	freeaddrinfo(list);
+	return (*fd >= 0) ? UP_OK : UP_ERR_CONNECT;
+}
+
+
+/**
+ * Sends the given data completely. Interrupted and partial sends are continued.
+ *
+ * @param[in] fd - connected socket
+ * @param[in] data - data to send
+ * @param[in] len - data length in bytes
+ * @param[in] more - 1 if more data follows immediately, else 0
+ * @return 1 on success, 0 on error
+ */
+static int up_sendAll(const int fd, const void * data, const size_t len, const int more) {
+	const char * ptr = (const char *)data;
+	for (size_t done = 0; done < len; ) {
+		const ssize_t got = send(fd, ptr + done, len - done, MSG_NOSIGNAL | ((more != 0) ? MSG_MORE : 0));
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) return 0;
+		done += (size_t)got;
+	}
+	return 1;
+}
+
+
+/**
+ * Receives the HTTP status line and returns the status code.
+ *
+ * @param[in] fd - connected socket
+ * @return HTTP status code or 0 on error
+ */
+static int up_status(const int fd) {
+	char buf[256];
+	size_t len = 0;
+	int major, minor, code;
+	while (len < (sizeof(buf) - 1)) {
+		const ssize_t got = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) break;
+		len += (size_t)got;
+		buf[len] = 0;
+		if (strstr(buf, "\r\n") != NULL) break;
+	}
+	buf[len] = 0;
+	if (sscanf(buf, "HTTP/%d.%d %d", &major, &minor, &code) != 3) return 0;
+	return code;
+}
+
+
+/**
+ * Checks whether the given URL can be used with up_send().
+ *
+ * @param[in] url - URL of the Snapmaker 2.0 terminal (http://host[:port][/path])
+ * @return 1 if valid, else 0
+ */
+int up_checkUrl(const char * url) {
+	tUrl parsed;
+	return up_parseUrl(&parsed, url);
+}
+
+
+/**
+ * Uploads the concatenation of the given segments as file to the file upload endpoint of the
+ * Snapmaker 2.0 terminal. The file is sent as multipart/form-data POST request together with the
+ * given token. The segments are sent directly from the passed buffers as they are. This function
+ * may be called concurrently.
+ *
+ * @param[in] url - URL of the Snapmaker 2.0 terminal (http://host[:port][/path])
+ * @param[in] token - access token of the terminal or NULL
+ * @param[in] name - file name presented to the terminal
+ * @param[in] vec - file data segments
+ * @param[in] count - number of file data segments
+ * @param[out] sent - receives the number of file data bytes sent (may be NULL)
+ * @return UP_OK on success, else the error cause
+ */
+tUploadResult up_send(const char * url, const char * token, const char * name, const struct iovec * vec, const size_t count, uint64_t * sent) {
+	tUploadResult res = UP_OK;
+	tUrl parsed;
+	struct timespec now;
+	char boundary[40];
+	char tail[64];
+	char * head = NULL;
+	int headLen, partLen, tailLen;
+	uint64_t length = 0;
+	int fd = -1;
+	if (sent != NULL) *sent = 0;
+	if (name == NULL || (vec == NULL && count > 0)) return UP_ERR_URL;
+	if (up_parseUrl(&parsed, url) != 1) return UP_ERR_URL;
+	if (token != NULL && strpbrk(token, "\r\n") != NULL) return UP_ERR_URL;
+	for (size_t i = 0; i < count; i++) length += (uint64_t)(vec[i].iov_len);
+	
+	/* the boundary only needs to be unlikely within G-Code */
+	clock_gettime(CLOCK_REALTIME, &now);
+	snprintf(boundary, sizeof(boundary), "sm2pspp-%08lx%08lx", (unsigned long)now.tv_sec & 0xFFFFFFFFUL, (unsigned long)now.tv_nsec);
+	head = (char *)malloc(UP_HEAD_SIZE);
+	if (head == NULL) return UP_ERR_NO_MEM;
+	
+	/* multipart parts preceding the file data (placed behind the request head later) */
+	partLen = 0;
+	if (token != NULL) {
+		partLen = snprintf(head, UP_HEAD_SIZE, "--%s\r\nContent-Disposition: form-data; name=\"token\"\r\n\r\n%s\r\n", boundary, token);
+		if (partLen < 0 || partLen >= UP_HEAD_SIZE) goto onInvalid;
+	}
+	headLen = snprintf(head + partLen, (size_t)(UP_HEAD_SIZE - partLen), "--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"", boundary);
+	if (headLen < 0 || (partLen + headLen) >= UP_HEAD_SIZE) goto onInvalid;
+	partLen += headLen;
+	for (const char * ptr = name; *ptr != 0 && partLen < (UP_HEAD_SIZE - 64); ptr++) {
+		/* keep the quoted file name valid */
+		head[partLen++] = (*ptr == '"' || *ptr == '\\' || (unsigned char)(*ptr) < ' ') ? '_' : *ptr;
+	}
+	headLen = snprintf(head + partLen, (size_t)(UP_HEAD_SIZE - partLen), "\"\r\nContent-Type: application/octet-stream\r\n\r\n");
+	if (headLen < 0 || (partLen + headLen) >= UP_HEAD_SIZE) goto onInvalid;
+	partLen += headLen;
+	tailLen = snprintf(tail, sizeof(tail), "\r\n--%s--\r\n", boundary);
+	
+	/* request head followed by the parts */
+	{
+		char * req = (char *)malloc(UP_HEAD_SIZE + sizeof(parsed.path) + sizeof(parsed.authority) + 256);
+		if (req == NULL) {
+			res = UP_ERR_NO_MEM;
+			goto onEnd;
+		}
+		headLen = sprintf(req,
+			"POST %s" UP_ENDPOINT " HTTP/1.1\r\n"
+			"Host: %s\r\n"
+			"User-Agent: sm2pspp\r\n"
+			"Content-Type: multipart/form-data; boundary=%s\r\n"
+			"Content-Length: %llu\r\n"
+			"Connection: close\r\n"
+			"\r\n",
+			parsed.path, parsed.authority, boundary,
+			(unsigned long long)((uint64_t)partLen + length + (uint64_t)tailLen)
+		);
+		memcpy(req + headLen, head, (size_t)partLen);
+		headLen += partLen;
+		free(head);
+		head = req;
+	}
+	
+	/* send request */
+	res = up_connect(&parsed, &fd);
+	if (res != UP_OK) goto onEnd;
+	if (up_sendAll(fd, head, (size_t)headLen, 1) != 1) goto onSendError;
+	for (size_t i = 0; i < count; i++) {
+		if (up_sendAll(fd, vec[i].iov_base, vec[i].iov_len, 1) != 1) goto onSendError;
+		if (sent != NULL) *sent += (uint64_t)(vec[i].iov_len);
+	}
+	if (up_sendAll(fd, tail, (size_t)tailLen, 0) != 1) goto onSendError;
+	
+	/* check response */
+	{
+		const int code = up_status(fd);
+		if (code < 200 || code > 299) res = UP_ERR_RESPONSE;
+	}
+	goto onEnd;
+onInvalid:
+	res = UP_ERR_URL;
+	goto onEnd;
+onSendError:
+	res = UP_ERR_SEND;
+onEnd:
+	if (fd >= 0) close(fd);
+	if (head != NULL) free(head);
+	return res;
+}
+#endif /* PCF_IS_LINUX */
@@ -0,0 +1,63 @@
+/**
+ * @file upload.h
+ * @author Daniel Starke
+ * @see upload.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __UPLOAD_H__
+#define __UPLOAD_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "target.h"
+#ifdef PCF_IS_LINUX
+#include <sys/uio.h>
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Time in milliseconds to wait for the connection, each send and the response of an upload. */
+#define UP_TIMEOUT 30000
+
+
+/** Enumeration of possible upload results. */
+typedef enum {
+	UP_OK = 0,
+	UP_ERR_NO_MEM,
+	UP_ERR_URL,                /**< invalid or unsupported URL */
+	UP_ERR_CONNECT,            /**< host not found or connection refused */
+	UP_ERR_SEND,               /**< connection lost or timed out while sending */
+	UP_ERR_RESPONSE            /**< missing, invalid or unsuccessful HTTP response */
+} tUploadResult;
+
+
+#ifdef PCF_IS_LINUX
+int up_checkUrl(const char * url);
+tUploadResult up_send(const char * url, const char * token, const char * name, const struct iovec * vec, const size_t count, uint64_t * sent);
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __UPLOAD_H__ */
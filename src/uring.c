@@ -0,0 +1,385 @@
+/**
+ * @file uring.c
+ * @author Daniel Starke
+ * @see uring.h
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uring.h"
+#ifdef PCF_IS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+
+/** Number of operations queried via IORING_REGISTER_PROBE. */
+#define UR_PROBE_OPS 256
+
+
+/**
+ * Checks whether the kernel supports all operations used by this module.
+ *
+ * @param[in] fd - io_uring file descriptor
+ * @return 1 if supported, else 0
+ */
+static int ur_probe(const int fd) {
+	static const unsigned char op[] = {
+		IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT
+	};
+	const size_t size = sizeof(struct io_uring_probe) + (UR_PROBE_OPS * sizeof(struct io_uring_probe_op));
+	struct io_uring_probe * probe = (struct io_uring_probe *)calloc(1, size);
+	int res = 1;
+	if (probe == NULL) return 0;
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, UR_PROBE_OPS) < 0) {
+		free(probe);
+		return 0;
+	}
+	for (size_t i = 0; i < sizeof(op); i++) {
+		if (op[i] >= probe->ops_len || (probe->ops[op[i]].flags & IO_URING_OP_SUPPORTED) == 0) res = 0;
+	}
+	free(probe);
+	return res;
+}
+
+
+/**
+ * Returns the next free submission queue entry. The entry is cleared.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] op - operation code
+ * @param[in] fd - file descriptor
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return submission queue entry or NULL if the queue is full
+ */
+static struct io_uring_sqe * ur_sqe(tUring * ur, const unsigned char op, const int fd, const uint64_t user, const int link) {
+	if (ur->fd < 0 || ur->inflight >= ur->entries) return NULL;
+	/* this is the only writer of the tail */
+	const unsigned tail = *(ur->sqTail) + ur->prepared;
+	const unsigned index = tail & *(ur->sqMask);
+	struct io_uring_sqe * sqe = (struct io_uring_sqe *)(ur->sqes) + index;
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->user_data = user;
+	if (link != 0) sqe->flags = IOSQE_IO_LINK;
+	ur->sqArray[index] = index;
+	ur->prepared++;
+	ur->inflight++;
+	return sqe;
+}
+
+
+/**
+ * Creates an io_uring instance. The completion queue holds twice the number of entries of the
+ * submission queue. Hence, it cannot overflow as long as no more than the given number of
+ * requests are in flight (see ur_space()).
+ *
+ * @param[out] ur - io_uring instance
+ * @param[in] entries - number of submission queue entries (rounded up to a power of two)
+ * @return 1 on success, 0 if io_uring or one of the used operations is not supported
+ */
+int ur_init(tUring * ur, const unsigned entries) {
+	struct io_uring_params p;
+	if (ur == NULL) return 0;
+	memset(ur, 0, sizeof(*ur));
+	memset(&p, 0, sizeof(p));
+	ur->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (ur->fd < 0) return 0;
+	if (ur_probe(ur->fd) != 1) goto onError;
+	ur->entries = p.sq_entries;
+	ur->sqRingSize = p.sq_off.array + (p.sq_entries * sizeof(unsigned));
+	ur->cqRingSize = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+	if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		ur->sqRingSize = PCF_MAX(ur->sqRingSize, ur->cqRingSize);
+		ur->cqRingSize = ur->sqRingSize;
+	}
+	ur->sqRing = mmap(NULL, ur->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+	if (ur->sqRing == MAP_FAILED) {
+		ur->sqRing = NULL;
+		goto onError;
+	}
+	if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		ur->cqRing = ur->sqRing;
+	} else {
+		ur->cqRing = mmap(NULL, ur->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+		if (ur->cqRing == MAP_FAILED) {
+			ur->cqRing = NULL;
+			goto onError;
+		}
+	}
+	ur->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	ur->sqes = mmap(NULL, ur->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQES);
+	if (ur->sqes == MAP_FAILED) {
+		ur->sqes = NULL;
+		goto onError;
+	}
+	ur->sqTail = (unsigned *)((char *)(ur->sqRing) + p.sq_off.tail);
+	ur->sqMask = (unsigned *)((char *)(ur->sqRing) + p.sq_off.ring_mask);
+	ur->sqArray = (unsigned *)((char *)(ur->sqRing) + p.sq_off.array);
+	ur->cqHead = (unsigned *)((char *)(ur->cqRing) + p.cq_off.head);
+	ur->cqTail = (unsigned *)((char *)(ur->cqRing) + p.cq_off.tail);
+	ur->cqMask = (unsigned *)((char *)(ur->cqRing) + p.cq_off.ring_mask);
+	ur->cqes = (char *)(ur->cqRing) + p.cq_off.cqes;
+	return 1;
+onError:
+	ur_free(ur);
+	return 0;
+}
+
+
+/**
+ * Frees the given io_uring instance. Requests still in flight are canceled by the kernel.
+ *
+ * @param[in,out] ur - io_uring instance
+ */
+void ur_free(tUring * ur) {
+	if (ur == NULL) return;
+	if (ur->sqes != NULL) munmap(ur->sqes, ur->sqesSize);
+	if (ur->cqRing != NULL && ur->cqRing != ur->sqRing) munmap(ur->cqRing, ur->cqRingSize);
+	if (ur->sqRing != NULL) munmap(ur->sqRing, ur->sqRingSize);
+	if (ur->fd >= 0) close(ur->fd);
+	memset(ur, 0, sizeof(*ur));
+	ur->fd = -1;
+}
+
+
+/**
+ * Returns the number of requests which can be prepared before the queue is full.
+ *
+ * @param[in] ur - io_uring instance
+ * @return number of free entries
+ */
+unsigned ur_space(const tUring * ur) {
+	if (ur == NULL || ur->fd < 0) return 0;
+	return ur->entries - ur->inflight;
+}
+
+
+/**
+ * Prepares opening the given file relative to the current working directory.
+ * The completion result is the file descriptor or the negative error code.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] path - file path (needs to stay valid until completion)
+ * @param[in] flags - open() flags
+ * @param[in] mode - file mode for O_CREAT
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_openat(tUring * ur, const char * path, const int flags, const unsigned mode, const uint64_t user, const int link) {
+	struct io_uring_sqe * sqe = ur_sqe(ur, IORING_OP_OPENAT, AT_FDCWD, user, link);
+	if (sqe == NULL) return 0;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->len = mode;
+	sqe->open_flags = (uint32_t)flags;
+	return 1;
+}
+
+
+/**
+ * Prepares querying the size, mode and owner of the given file.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] path - file path (needs to stay valid until completion)
+ * @param[out] st - receives the file status (needs to stay valid until completion)
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_statx(tUring * ur, const char * path, tUringStat * st, const uint64_t user, const int link) {
+	struct io_uring_sqe * sqe = ur_sqe(ur, IORING_OP_STATX, AT_FDCWD, user, link);
+	if (sqe == NULL) return 0;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->len = STATX_SIZE | STATX_MODE | STATX_UID | STATX_GID;
+	sqe->off = (uint64_t)(uintptr_t)st;
+	return 1;
+}
+
+
+/**
+ * Prepares reading from the given file at the passed offset.
+ * The completion result is the number of bytes read or the negative error code.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] fd - file descriptor
+ * @param[out] buf - receives the read data (needs to stay valid until completion)
+ * @param[in] len - number of bytes to read
+ * @param[in] offset - file offset
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_read(tUring * ur, const int fd, void * buf, const unsigned len, const uint64_t offset, const uint64_t user, const int link) {
+	struct io_uring_sqe * sqe = ur_sqe(ur, IORING_OP_READ, fd, user, link);
+	if (sqe == NULL) return 0;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = offset;
+	return 1;
+}
+
+
+/**
+ * Prepares writing to the given file at the passed offset.
+ * The completion result is the number of bytes written or the negative error code.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] fd - file descriptor
+ * @param[in] buf - data to write (needs to stay valid until completion)
+ * @param[in] len - number of bytes to write
+ * @param[in] offset - file offset
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_write(tUring * ur, const int fd, const void * buf, const unsigned len, const uint64_t offset, const uint64_t user, const int link) {
+	struct io_uring_sqe * sqe = ur_sqe(ur, IORING_OP_WRITE, fd, user, link);
+	if (sqe == NULL) return 0;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = offset;
+	return 1;
+}
+
+
+/**
+ * Prepares flushing the data and metadata of the given file to the storage device.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] fd - file descriptor
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_fsync(tUring * ur, const int fd, const uint64_t user, const int link) {
+	return (ur_sqe(ur, IORING_OP_FSYNC, fd, user, link) != NULL) ? 1 : 0;
+}
+
+
+/**
+ * Prepares closing the given file descriptor.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] fd - file descriptor
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_close(tUring * ur, const int fd, const uint64_t user, const int link) {
+	return (ur_sqe(ur, IORING_OP_CLOSE, fd, user, link) != NULL) ? 1 : 0;
+}
+
+
+/**
+ * Prepares renaming the given file. An existing destination file is replaced.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] from - source path (needs to stay valid until completion)
+ * @param[in] to - destination path (needs to stay valid until completion)
+ * @param[in] user - user data passed to the completion
+ * @param[in] link - 1 to start the next request after this one completed successfully, else 0
+ * @return 1 on success, 0 if the queue is full
+ */
+int ur_renameat(tUring * ur, const char * from, const char * to, const uint64_t user, const int link) {
+	struct io_uring_sqe * sqe = ur_sqe(ur, IORING_OP_RENAMEAT, AT_FDCWD, user, link);
+	if (sqe == NULL) return 0;
+	sqe->addr = (uint64_t)(uintptr_t)from;
+	sqe->len = (uint32_t)AT_FDCWD;
+	sqe->addr2 = (uint64_t)(uintptr_t)to;
+	return 1;
+}
+
+
+/**
+ * Submits all prepared requests and waits for the given number of completions.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[in] wait - minimal number of completions to wait for (limited to the requests in flight)
+ * @return 1 on success, 0 on error
+ */
+int ur_submit(tUring * ur, const unsigned wait) {
+	if (ur == NULL || ur->fd < 0) return 0;
+	unsigned submit = ur->prepared;
+	const unsigned minComplete = PCF_MIN(wait, ur->inflight);
+	if (submit > 0) {
+		__atomic_store_n(ur->sqTail, *(ur->sqTail) + submit, __ATOMIC_RELEASE);
+		ur->prepared = 0;
+	}
+	if (submit == 0 && minComplete == 0) return 1;
+	for (;;) {
+		const long res = syscall(__NR_io_uring_enter, ur->fd, submit, (submit == 0) ? minComplete : 0, (submit == 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (res < 0) {
+			if (errno == EINTR) continue;
+			return 0;
+		}
+		submit -= PCF_MIN((unsigned)res, submit);
+		if (submit == 0) break;
+	}
+	/* wait separately to retry on interrupts without resubmitting */
+	while (minComplete > 0 && __atomic_load_n(ur->cqTail, __ATOMIC_ACQUIRE) == *(ur->cqHead)) {
+		if (syscall(__NR_io_uring_enter, ur->fd, 0, minComplete, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * Retrieves the next completion.
+ *
+ * @param[in,out] ur - io_uring instance
+ * @param[out] user - receives the user data of the completed request
+ * @param[out] res - receives the request result (negative error code on failure)
+ * @return 1 if a completion was retrieved, 0 if none is available
+ */
+int ur_complete(tUring * ur, uint64_t * user, int32_t * res) {
+	if (ur == NULL || ur->fd < 0) return 0;
+	/* this is the only writer of the head */
+	const unsigned head = *(ur->cqHead);
+	if (head == __atomic_load_n(ur->cqTail, __ATOMIC_ACQUIRE)) return 0;
+	const struct io_uring_cqe * cqe = (const struct io_uring_cqe *)(ur->cqes) + (head & *(ur->cqMask));
+	*user = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ur->cqHead, head + 1, __ATOMIC_RELEASE);
+	ur->inflight--;
+	return 1;
+}
+
+
+/**
+ * Returns the size, mode and owner of the given file status.
+ *
+ * @param[in] st - file status of ur_statx()
+ * @param[out] size - receives the file size in bytes
+ * @param[out] mode - receives the file mode
+ * @param[out] uid - receives the user ID of the file owner
+ * @param[out] gid - receives the group ID of the file owner
+ */
+void ur_statInfo(const tUringStat * st, uint64_t * size, unsigned * mode, unsigned * uid, unsigned * gid) {
+	const struct statx * sx = (const struct statx *)(st->raw);
+	*size = (uint64_t)(sx->stx_size);
+	*mode = (unsigned)(sx->stx_mode);
+	*uid = (unsigned)(sx->stx_uid);
+	*gid = (unsigned)(sx->stx_gid);
+}
+#endif /* PCF_IS_LINUX */
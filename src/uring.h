@@ -0,0 +1,84 @@
+/**
+ * @file uring.h
+ * @author Daniel Starke
+ * @see uring.c
+ * @date 2026-10-16
+ * @version 2026-10-16
+ *
+ * DISCLAIMER
+ * This file has no copyright assigned and is placed in the Public Domain.
+ * All contributions are also assumed to be in the Public Domain.
+ * Other contributions are not permitted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "target.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef PCF_IS_LINUX
+/** io_uring instance accessed via raw system calls. */
+typedef struct {
+	int fd;                    /**< io_uring file descriptor or -1 */
+	unsigned entries;          /**< number of submission queue entries */
+	unsigned inflight;         /**< number of prepared or submitted requests without completion */
+	unsigned prepared;         /**< number of prepared requests not yet submitted */
+	void * sqRing;             /**< mapped submission queue ring */
+	size_t sqRingSize;         /**< size of the mapped submission queue ring in bytes */
+	void * cqRing;             /**< mapped completion queue ring (may equal sqRing) */
+	size_t cqRingSize;         /**< size of the mapped completion queue ring in bytes */
+	void * sqes;               /**< mapped submission queue entries */
+	size_t sqesSize;           /**< size of the mapped submission queue entries in bytes */
+	unsigned * sqTail;         /**< submission queue tail */
+	unsigned * sqMask;         /**< submission queue index mask */
+	unsigned * sqArray;        /**< submission queue index array */
+	unsigned * cqHead;         /**< completion queue head */
+	unsigned * cqTail;         /**< completion queue tail */
+	unsigned * cqMask;         /**< completion queue index mask */
+	void * cqes;               /**< completion queue entries */
+} tUring;
+
+
+/** Buffer receiving the file status of ur_statx() (layout of struct statx). */
+typedef struct {
+	uint64_t raw[32];          /**< opaque data */
+} tUringStat;
+
+
+int ur_init(tUring * ur, const unsigned entries);
+void ur_free(tUring * ur);
+unsigned ur_space(const tUring * ur);
+int ur_openat(tUring * ur, const char * path, const int flags, const unsigned mode, const uint64_t user, const int link);
+int ur_statx(tUring * ur, const char * path, tUringStat * st, const uint64_t user, const int link);
+int ur_read(tUring * ur, const int fd, void * buf, const unsigned len, const uint64_t offset, const uint64_t user, const int link);
+int ur_write(tUring * ur, const int fd, const void * buf, const unsigned len, const uint64_t offset, const uint64_t user, const int link);
+int ur_fsync(tUring * ur, const int fd, const uint64_t user, const int link);
+int ur_close(tUring * ur, const int fd, const uint64_t user, const int link);
+int ur_renameat(tUring * ur, const char * from, const char * to, const uint64_t user, const int link);
+int ur_submit(tUring * ur, const unsigned wait);
+int ur_complete(tUring * ur, uint64_t * user, int32_t * res);
+void ur_statInfo(const tUringStat * st, uint64_t * size, unsigned * mode, unsigned * uid, unsigned * gid);
+#endif /* PCF_IS_LINUX */
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* __URING_H__ */